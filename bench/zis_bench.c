@@ -0,0 +1,539 @@
+/// Benchmark runner.
+///
+/// Each benchmark is run in a new instance. The number of iterations is first
+/// calibrated so that a run takes about the target time, and then the runs are
+/// repeated and the fastest one is reported, with the numbers of bytes
+/// allocated and the GC pauses during that run (from `zis_gc_stats()`).
+/// Run `zis_bench -h` for usage.
+
+#include <zis.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef ZIS_BENCH_DIR
+#    define ZIS_BENCH_DIR "."
+#endif
+
+#define REG_MAX 8
+
+/* ----- timing ------------------------------------------------------------- */
+
+static uint64_t bench_clock_ns(void) {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+/// State of one run of a benchmark.
+struct bench_run {
+    size_t iterations;
+    const char *bench_dir;
+    uint64_t time_begin, time_end;
+    struct zis_gc_stats gc_begin, gc_end;
+};
+
+/// Start timing. To be called by a benchmark after its setup.
+static void bench_run_begin(zis_t z, struct bench_run *r) {
+    zis_gc_stats(z, &r->gc_begin);
+    r->time_begin = bench_clock_ns();
+}
+
+/// Stop timing. To be called by a benchmark after the last iteration.
+static void bench_run_end(zis_t z, struct bench_run *r) {
+    r->time_end = bench_clock_ns();
+    zis_gc_stats(z, &r->gc_end);
+}
+
+/* ----- benchmarks --------------------------------------------------------- */
+
+struct bench_case {
+    const char *name;
+    const char *script; ///< Script file name without extension, or NULL.
+    const char *func;   ///< Function to call in the script, or NULL.
+    int (*run)(zis_t z, const struct bench_case *bc, struct bench_run *r);
+};
+
+static char *bench_script_path(const struct bench_run *r, const char *script) {
+    const size_t dir_len = strlen(r->bench_dir), name_len = strlen(script);
+    char *path = malloc(dir_len + name_len + 6);
+    memcpy(path, r->bench_dir, dir_len);
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, script, name_len);
+    memcpy(path + dir_len + 1 + name_len, ".zis", 5);
+    return path;
+}
+
+/// Calls function `bc->func(n)` in script `bc->script`.
+static int bench_run_script(zis_t z, const struct bench_case *bc, struct bench_run *r) {
+    char *path = bench_script_path(r, bc->script);
+    int status = zis_import(z, 1, path, ZIS_IMP_PATH);
+    free(path);
+    if (status != ZIS_OK)
+        return status;
+    status = zis_load_field(z, 1, bc->func, (size_t)-1, 1);
+    if (status != ZIS_OK)
+        return status;
+    zis_make_int(z, 2, (int64_t)r->iterations);
+    bench_run_begin(z, r);
+    status = zis_invoke(z, (unsigned int[]){0, 1, 2}, 1);
+    bench_run_end(z, r);
+    return status;
+}
+
+/// Calls a two-argument function with `zis_invoke()`.
+static int bench_run_api_invoke(zis_t z, const struct bench_case *bc, struct bench_run *r) {
+    (void)bc;
+    int status = zis_import(z, 1, "func f(a, b)\n return a\nend\n", ZIS_IMP_CODE);
+    if (status != ZIS_OK)
+        return status;
+    status = zis_load_field(z, 1, "f", (size_t)-1, 1);
+    if (status != ZIS_OK)
+        return status;
+    zis_make_int(z, 2, 1);
+    zis_make_int(z, 3, 2);
+    const unsigned int regs[] = {0, 1, 2, 3};
+    bench_run_begin(z, r);
+    for (size_t i = 0, n = r->iterations; i < n; i++) {
+        status = zis_invoke(z, regs, 2);
+        if (status != ZIS_OK)
+            break;
+    }
+    bench_run_end(z, r);
+    return status;
+}
+
+/// Makes a `(Int, Float, String)` tuple with `zis_make_values()`.
+static int bench_run_api_make_values(zis_t z, const struct bench_case *bc, struct bench_run *r) {
+    (void)bc;
+    int status = ZIS_OK;
+    bench_run_begin(z, r);
+    for (size_t i = 0, n = r->iterations; i < n; i++) {
+        status = zis_make_values(z, 1, "(ifs)", (int64_t)i, 0.5, "string", (size_t)-1);
+        if (status < 0)
+            break;
+        status = ZIS_OK;
+    }
+    bench_run_end(z, r);
+    return status;
+}
+
+/// Compiles (and initializes) the source code of script `bc->script`, which is read into memory first.
+static int bench_run_compile(zis_t z, const struct bench_case *bc, struct bench_run *r) {
+    char *path = bench_script_path(r, bc->script);
+    FILE *fp = fopen(path, "rb");
+    free(path);
+    if (!fp)
+        return ZIS_E_ARG;
+    fseek(fp, 0, SEEK_END);
+    const long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *code = malloc((size_t)(size > 0 ? size : 0) + 1);
+    const size_t code_len = fread(code, 1, (size_t)(size > 0 ? size : 0), fp);
+    code[code_len] = 0;
+    fclose(fp);
+
+    int status = ZIS_OK;
+    bench_run_begin(z, r);
+    for (size_t i = 0, n = r->iterations; i < n; i++) {
+        status = zis_import(z, 1, code, ZIS_IMP_CODE);
+        if (status != ZIS_OK)
+            break;
+    }
+    bench_run_end(z, r);
+    free(code);
+    return status;
+}
+
+/// Imports script `bc->script` by path, which reads, compiles, and initializes it every time.
+static int bench_run_import(zis_t z, const struct bench_case *bc, struct bench_run *r) {
+    char *path = bench_script_path(r, bc->script);
+    int status = ZIS_OK;
+    bench_run_begin(z, r);
+    for (size_t i = 0, n = r->iterations; i < n; i++) {
+        status = zis_import(z, 1, path, ZIS_IMP_PATH);
+        if (status != ZIS_OK)
+            break;
+    }
+    bench_run_end(z, r);
+    free(path);
+    return status;
+}
+
+/// Imports module `module` (if not NULL) from the benchmark directory.
+static int bench_import_module(zis_t z, const struct bench_run *r, const char *module) {
+    if (!module)
+        return ZIS_OK;
+    int status = zis_import(z, 0, r->bench_dir, ZIS_IMP_ADDP);
+    if (status != ZIS_OK)
+        return status;
+    return zis_import(z, 0, module, ZIS_IMP_NAME);
+}
+
+/// Creates and deletes an instance, importing module `bc->script` if any.
+static int bench_run_startup_create(zis_t z, const struct bench_case *bc, struct bench_run *r) {
+    int status = ZIS_OK;
+    bench_run_begin(z, r);
+    for (size_t i = 0, n = r->iterations; i < n; i++) {
+        zis_t z1 = zis_create();
+        status = bench_import_module(z1, r, bc->script);
+        zis_destroy(z1);
+        if (status != ZIS_OK)
+            break;
+    }
+    bench_run_end(z, r);
+    return status;
+}
+
+#define BENCH_SNAPSHOT_FILE "zis_bench.snapshot.tmp"
+
+/// Creates an instance from a snapshot and deletes it. The snapshot is saved
+/// after importing module `bc->script` if any, so that this can be compared
+/// with `bench_run_startup_create()`.
+static int bench_run_startup_snapshot(zis_t z, const struct bench_case *bc, struct bench_run *r) {
+    int status = bench_import_module(z, r, bc->script);
+    if (status != ZIS_OK)
+        return status;
+    status = zis_save_snapshot(z, BENCH_SNAPSHOT_FILE);
+    if (status != ZIS_OK)
+        return status;
+    bench_run_begin(z, r);
+    for (size_t i = 0, n = r->iterations; i < n; i++) {
+        zis_t z1 = zis_create_from_snapshot(BENCH_SNAPSHOT_FILE);
+        if (!z1) {
+            status = ZIS_E_ARG;
+            break;
+        }
+        zis_destroy(z1);
+    }
+    bench_run_end(z, r);
+    remove(BENCH_SNAPSHOT_FILE);
+    return status;
+}
+
+#define BENCH_SCRIPT(SCRIPT, FUNC) \
+    { SCRIPT "." FUNC, SCRIPT, "bench_" FUNC, bench_run_script }
+
+static const struct bench_case bench_cases[] = {
+    BENCH_SCRIPT("calls", "global_func"),
+    BENCH_SCRIPT("calls", "method"),
+    BENCH_SCRIPT("calls", "recursion"),
+    BENCH_SCRIPT("arith", "int"),
+    BENCH_SCRIPT("arith", "float"),
+    BENCH_SCRIPT("arith", "bigint"),
+    BENCH_SCRIPT("arith", "compare"),
+    BENCH_SCRIPT("strings", "concat"),
+    BENCH_SCRIPT("strings", "int_to_string"),
+    BENCH_SCRIPT("strings", "join"),
+    BENCH_SCRIPT("strings", "find"),
+    BENCH_SCRIPT("strings", "equal"),
+    BENCH_SCRIPT("maps", "int_keys_insert_remove"),
+    BENCH_SCRIPT("maps", "int_keys_get"),
+    BENCH_SCRIPT("maps", "str_keys_get"),
+    BENCH_SCRIPT("maps", "str_keys_miss"),
+    BENCH_SCRIPT("maps", "set_str_contains"),
+    BENCH_SCRIPT("maps", "map_as_set_str_contains"),
+    BENCH_SCRIPT("maps", "set_ops"),
+    BENCH_SCRIPT("arrays", "sort_ints"),
+    BENCH_SCRIPT("arrays", "sort_strs"),
+    BENCH_SCRIPT("arrays", "sort_key"),
+    BENCH_SCRIPT("arrays", "typed_sum"),
+    BENCH_SCRIPT("arrays", "typed_axpy"),
+    BENCH_SCRIPT("arrays", "typed_compare"),
+    BENCH_SCRIPT("arrays", "queue_deque"),
+    BENCH_SCRIPT("arrays", "queue_array"),
+    BENCH_SCRIPT("gc_churn", "short_lived"),
+    BENCH_SCRIPT("gc_churn", "long_lived"),
+    BENCH_SCRIPT("gc_churn", "old_to_young"),
+    { "module.compile", "sample_module", NULL, bench_run_compile },
+    { "module.import", "sample_module", NULL, bench_run_import },
+    { "startup.create", NULL, NULL, bench_run_startup_create },
+    { "startup.create_import", "sample_module", NULL, bench_run_startup_create },
+    { "startup.snapshot", NULL, NULL, bench_run_startup_snapshot },
+    { "startup.snapshot_import", "sample_module", NULL, bench_run_startup_snapshot },
+    { "api.invoke", NULL, NULL, bench_run_api_invoke },
+    { "api.make_values", NULL, NULL, bench_run_api_make_values },
+    { NULL, NULL, NULL, NULL },
+};
+
+#undef BENCH_SCRIPT
+
+/* ----- measurement -------------------------------------------------------- */
+
+struct bench_result {
+    size_t iterations;
+    double ns_per_op;
+    double alloc_bytes_per_op;
+    size_t gc_count;
+    uint64_t gc_time_ns;
+    uint64_t elapsed_ns;
+};
+
+struct bench_block_arg {
+    const struct bench_case *bc;
+    struct bench_run *run;
+};
+
+static int bench_block_fn(zis_t z, void *_arg) {
+    struct bench_block_arg *arg = _arg;
+    const int status = arg->bc->run(z, arg->bc, arg->run);
+    if (status == ZIS_THR) {
+        zis_move_local(z, 1, 0);
+        zis_make_stream(z, 2, ZIS_IOS_STDX, 2); // stderr
+        zis_read_exception(z, 1, ZIS_RDE_DUMP, 2);
+    }
+    return status;
+}
+
+/// Runs a benchmark once in a new instance. Returns false on failure.
+static bool bench_measure(
+    const struct bench_case *bc, const char *bench_dir,
+    size_t iterations, struct bench_result *result
+) {
+    struct bench_run run;
+    memset(&run, 0, sizeof run);
+    run.iterations = iterations;
+    run.bench_dir = bench_dir;
+    struct bench_block_arg arg = { bc, &run };
+
+    zis_t z = zis_create();
+    const int status = zis_native_block(z, REG_MAX, bench_block_fn, &arg);
+    zis_destroy(z);
+    if (status != ZIS_OK) {
+        fprintf(stderr, "zis_bench: %s: failed (status %i)\n", bc->name, status);
+        return false;
+    }
+
+    const struct zis_gc_stats *s0 = &run.gc_begin, *s1 = &run.gc_end;
+    const uint64_t allocated =
+        (s1->new_space_allocated - s0->new_space_allocated) +
+        (s1->old_space_allocated - s0->old_space_allocated) +
+        (s1->big_space_allocated - s0->big_space_allocated);
+    result->iterations = iterations;
+    result->elapsed_ns = run.time_end - run.time_begin;
+    result->ns_per_op = (double)result->elapsed_ns / (double)iterations;
+    result->alloc_bytes_per_op = (double)allocated / (double)iterations;
+    result->gc_count =
+        (s1->fast_gc_count - s0->fast_gc_count) + (s1->full_gc_count - s0->full_gc_count);
+    result->gc_time_ns = s1->pause_time_total - s0->pause_time_total;
+    return true;
+}
+
+/// Calibrates the number of iterations, and reports the fastest of the repeated runs.
+static bool bench_run_case(
+    const struct bench_case *bc, const char *bench_dir,
+    double target_time, unsigned int repeat, struct bench_result *result
+) {
+    const uint64_t target_ns = (uint64_t)(target_time * 1e9);
+    struct bench_result r;
+    size_t n = 1;
+    while (true) {
+        if (!bench_measure(bc, bench_dir, n, &r))
+            return false;
+        if (r.elapsed_ns >= target_ns / 10 || n >= SIZE_MAX / 100)
+            break;
+        n *= r.elapsed_ns < target_ns / 1000 ? 100 : 10;
+    }
+    if (r.elapsed_ns < target_ns) {
+        const double scale = (double)target_ns / (double)(r.elapsed_ns ? r.elapsed_ns : 1);
+        n = (size_t)((double)n * scale);
+        if (n < 1)
+            n = 1;
+    }
+
+    bool has_result = false;
+    for (unsigned int i = 0; i < repeat; i++) {
+        if (!bench_measure(bc, bench_dir, n, &r))
+            return false;
+        if (!has_result || r.ns_per_op < result->ns_per_op) {
+            *result = r;
+            has_result = true;
+        }
+    }
+    return has_result;
+}
+
+/* ----- output ------------------------------------------------------------- */
+
+static void json_write_string(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; s++) {
+        const unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(fp, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(fp, "\\u%04x", c);
+        else
+            fputc(c, fp);
+    }
+    fputc('"', fp);
+}
+
+static void print_text_header(FILE *fp) {
+    fprintf(
+        fp, "%-32s %12s %12s %12s %8s %8s\n",
+        "benchmark", "iterations", "ns/op", "alloc B/op", "GCs", "GC %"
+    );
+}
+
+static void print_text_result(FILE *fp, const char *name, const struct bench_result *r) {
+    fprintf(
+        fp, "%-32s %12zu %12.2f %12.1f %8zu %7.1f%%\n",
+        name, r->iterations, r->ns_per_op, r->alloc_bytes_per_op, r->gc_count,
+        r->elapsed_ns ? 100.0 * (double)r->gc_time_ns / (double)r->elapsed_ns : 0.0
+    );
+    fflush(fp);
+}
+
+static void print_json_header(FILE *fp, double target_time, unsigned int repeat) {
+    const struct zis_build_info *bi = &zis_build_info;
+    fprintf(fp, "{\n  \"version\": \"%u.%u.%u\",\n", bi->version[0], bi->version[1], bi->version[2]);
+    fputs("  \"system\": ", fp), json_write_string(fp, bi->system), fputs(",\n", fp);
+    fputs("  \"machine\": ", fp), json_write_string(fp, bi->machine), fputs(",\n", fp);
+    fputs("  \"compiler\": ", fp), json_write_string(fp, bi->compiler), fputs(",\n", fp);
+    fprintf(fp, "  \"build_timestamp\": %llu,\n", (unsigned long long)bi->timestamp * 60);
+    fprintf(fp, "  \"target_time\": %g,\n  \"repeat\": %u,\n", target_time, repeat);
+    fputs("  \"results\": [", fp);
+}
+
+static void print_json_result(FILE *fp, bool first, const char *name, const struct bench_result *r) {
+    fputs(first ? "\n    {" : ",\n    {", fp);
+    fputs("\"name\": ", fp), json_write_string(fp, name);
+    fprintf(
+        fp, ", \"iterations\": %zu, \"ns_per_op\": %.3f, \"alloc_bytes_per_op\": %.3f,"
+        " \"gc_count\": %zu, \"gc_time_ns\": %llu, \"elapsed_ns\": %llu}",
+        r->iterations, r->ns_per_op, r->alloc_bytes_per_op,
+        r->gc_count, (unsigned long long)r->gc_time_ns, (unsigned long long)r->elapsed_ns
+    );
+}
+
+static void print_json_footer(FILE *fp) {
+    fputs("\n  ]\n}\n", fp);
+}
+
+/* ----- main --------------------------------------------------------------- */
+
+static void print_usage(FILE *fp, const char *prog) {
+    fprintf(
+        fp,
+        "Usage: %s [OPTION...] [NAME_PREFIX...]\n"
+        "Run the benchmarks whose names start with any of NAME_PREFIX (all by default).\n"
+        "\n"
+        "Options:\n"
+        "  -h        Print help message and exit.\n"
+        "  -l        List the benchmarks and exit.\n"
+        "  -j        Write results in JSON format.\n"
+        "  -t SEC    Target time of a run, in seconds (default: 0.5).\n"
+        "  -r N      Number of runs for each benchmark (default: 3).\n"
+        "  -d DIR    Directory of the benchmark scripts (default: " ZIS_BENCH_DIR ").\n",
+        prog
+    );
+}
+
+static bool name_selected(const char *name, char *prefixes[], int prefix_count) {
+    if (!prefix_count)
+        return true;
+    for (int i = 0; i < prefix_count; i++) {
+        if (!strncmp(name, prefixes[i], strlen(prefixes[i])))
+            return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    const char *bench_dir = ZIS_BENCH_DIR;
+    double target_time = 0.5;
+    unsigned int repeat = 3;
+    bool json = false, list_only = false;
+
+    int arg_i = 1;
+    for (; arg_i < argc && argv[arg_i][0] == '-' && argv[arg_i][1]; arg_i++) {
+        const char *opt = argv[arg_i];
+        if (opt[2]) {
+            fprintf(stderr, "zis_bench: unknown option: %s\n", opt);
+            return EXIT_FAILURE;
+        }
+        const char *val = NULL;
+        if (strchr("trd", opt[1])) {
+            if (arg_i + 1 >= argc) {
+                fprintf(stderr, "zis_bench: option %s requires an argument\n", opt);
+                return EXIT_FAILURE;
+            }
+            val = argv[++arg_i];
+        }
+        switch (opt[1]) {
+        case 'h':
+            print_usage(stdout, argv[0]);
+            return EXIT_SUCCESS;
+        case 'l':
+            list_only = true;
+            break;
+        case 'j':
+            json = true;
+            break;
+        case 't':
+            target_time = atof(val);
+            if (!(target_time > 0.0)) {
+                fprintf(stderr, "zis_bench: illegal target time: %s\n", val);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'r':
+            repeat = (unsigned int)atoi(val);
+            if (!repeat) {
+                fprintf(stderr, "zis_bench: illegal number of runs: %s\n", val);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'd':
+            bench_dir = val;
+            break;
+        default:
+            fprintf(stderr, "zis_bench: unknown option: %s\n", opt);
+            return EXIT_FAILURE;
+        }
+    }
+    char **prefixes = argv + arg_i;
+    const int prefix_count = argc - arg_i;
+
+    if (list_only) {
+        for (const struct bench_case *bc = bench_cases; bc->name; bc++) {
+            if (name_selected(bc->name, prefixes, prefix_count))
+                puts(bc->name);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    FILE *const out = stdout;
+    bool failed = false, first = true;
+    if (json)
+        print_json_header(out, target_time, repeat);
+    else
+        print_text_header(out);
+    for (const struct bench_case *bc = bench_cases; bc->name; bc++) {
+        if (!name_selected(bc->name, prefixes, prefix_count))
+            continue;
+        struct bench_result result;
+        if (!bench_run_case(bc, bench_dir, target_time, repeat, &result)) {
+            failed = true;
+            continue;
+        }
+        if (json)
+            print_json_result(out, first, bc->name, &result);
+        else
+            print_text_result(out, bc->name, &result);
+        first = false;
+    }
+    if (json)
+        print_json_footer(out);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
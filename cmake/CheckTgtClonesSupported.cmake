@@ -0,0 +1,44 @@
+###
+### Checks whether the compiler supports GNUC's `target_clones` function attribute,
+### which compiles a function for several targets and selects one at load time.
+###
+
+## check_gnuc_target_clones_supported( [RESULT <result_var>] [OUTPUT <output_var>] )
+function(check_gnuc_target_clones_supported)
+    cmake_parse_arguments(PARSE_ARGV 0 arg "" "RESULT;OUTPUT" "")
+
+    set(test_dir "${CMAKE_CURRENT_BINARY_DIR}/CMakeFiles/_TgtClonesTest-C")
+    set(test_src "${test_dir}/test.c")
+
+    if(NOT EXISTS ${test_dir})
+        file(MAKE_DIRECTORY ${test_dir})
+    endif()
+
+    file(WRITE ${test_src} [[
+#include <stdio.h>
+
+// https://gcc.gnu.org/onlinedocs/gcc/Common-Function-Attributes.html#index-target_005fclones-function-attribute
+__attribute__((target_clones("avx2", "default")))
+static double test(const double *v, int n) {
+    double s = 0;
+    for (int i = 0; i < n; i++)
+        s += v[i];
+    return s;
+}
+
+int main(int argc, char *argv[]) {
+    const double v[] = { 1.0, 2.0, 3.0 };
+    printf("%f\n", test(v, argc < 3 ? argc : 3));
+}
+]])
+
+    try_compile(result "${test_dir}" "${test_src}" OUTPUT_VARIABLE outputs)
+    if(DEFINED arg_RESULT)
+        set(${arg_RESULT} ${result} PARENT_SCOPE)
+    elseif(NOT result)
+        message(FATAL_ERROR "The compiler ${CMAKE_C_COMPILER} does not support the target_clones attribute:\n${outputs}")
+    endif()
+    if(DEFINED arg_OUTPUT)
+        set(${arg_OUTPUT} ${outputs} PARENT_SCOPE)
+    endif()
+endfunction()
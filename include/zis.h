@@ -109,6 +109,52 @@ ZIS_API zis_t zis_create(void) ZIS_NOEXCEPT;
  */
 ZIS_API void zis_destroy(zis_t z) ZIS_NOEXCEPT;
 
+/**
+ * Create a runtime instance from a heap snapshot.
+ *
+ * The objects that a new instance creates when bootstrapping (built-in types,
+ * loaded modules, and so on) are restored from the snapshot file, which is
+ * usually faster than `zis_create()`.
+ *
+ * @param file path to the snapshot file made by `zis_save_snapshot()`
+ * @return Returns the newly created instance; or `NULL` if the file cannot be read,
+ * or is not a valid snapshot made by the same build of the library.
+ *
+ * @warning To avoid a memory leak, the instance must be finalized with `zis_destroy()`.
+ */
+ZIS_API zis_t zis_create_from_snapshot(const char *file) ZIS_NOEXCEPT;
+
+/**
+ * Save a heap snapshot of a runtime instance.
+ *
+ * The global objects and the loaded modules are saved, so that a new instance
+ * can be created from the snapshot with `zis_create_from_snapshot()`. Registers
+ * and the standard streams are not saved.
+ *
+ * @param z zis instance
+ * @param file path to the snapshot file to write
+ * @return `ZIS_OK`; `ZIS_E_ARG` (the file cannot be written), `ZIS_E_TYPE` (there
+ * are objects that cannot be saved, like native functions that are not from
+ * built-in types or embedded modules, or streams).
+ */
+ZIS_API int zis_save_snapshot(zis_t z, const char *file) ZIS_NOEXCEPT;
+
+/**
+ * Reset a runtime instance to the state right after it was created.
+ *
+ * Modules imported after creation are forgotten, registers are cleared, and
+ * unreachable objects are collected. The bootstrapped objects (built-in types,
+ * the prelude, and so on) and the allocated heap memory are kept, so resetting
+ * an instance is cheaper than deleting it and creating a new one. This makes it
+ * possible to reuse one instance for a series of independent jobs.
+ *
+ * @param z zis instance
+ *
+ * @warning This function must not be called inside a native block (`zis_native_block()`).
+ * Changes made to the bootstrapped objects (like the prelude module) are not undone.
+ */
+ZIS_API void zis_reset(zis_t z) ZIS_NOEXCEPT;
+
 /** @name Panic cause */
 /** @{ */
 #define ZIS_PANIC_OOM   1  /**< Panic cause: out of memory (object memory) */
@@ -133,6 +179,152 @@ typedef void (*zis_panic_handler_t)(zis_t, int) ZIS_NOEXCEPT;
  */
 ZIS_API zis_panic_handler_t zis_at_panic(zis_t z, zis_panic_handler_t h) ZIS_NOEXCEPT;
 
+/**
+ * Start the sampling profiler.
+ *
+ * While the profiler is running, the call stack of the instance is sampled
+ * periodically (by CPU time), and the samples are aggregated by stacks of
+ * (function, instruction offset). Only one instance in a process can be profiled
+ * at a time. Native code is not profiled; time spent in a native function is
+ * accounted to the caller's stack after the function returns.
+ *
+ * @param z zis instance
+ * @param interval_us sampling interval in microseconds, or 0 for the default (1 ms)
+ * @return `ZIS_OK`; `ZIS_E_ARG` (a profiler is already running, or the profiler
+ * is not supported by this build).
+ *
+ * @see zis_stop_profiler()
+ */
+ZIS_API int zis_start_profiler(zis_t z, unsigned int interval_us) ZIS_NOEXCEPT;
+
+/**
+ * Stop the sampling profiler and write the samples.
+ *
+ * The output is in the folded-stack format that flame graph tools accept: one line
+ * for each stack, frames separated by semicolons with the outermost one first,
+ * followed by a space and the number of samples. A frame is written as
+ * `NAME:LINE`, or `NAME+OFFSET` if the line number is unknown.
+ *
+ * @param z zis instance
+ * @param file path to the output file, or `NULL` to discard the samples
+ * @return `ZIS_OK`; `ZIS_E_ARG` (the profiler is not running on this instance,
+ * or the file cannot be written).
+ */
+ZIS_API int zis_stop_profiler(zis_t z, const char *file) ZIS_NOEXCEPT;
+
+/**
+ * Start the allocation profiler.
+ *
+ * While the allocation profiler is running, object allocations are sampled about
+ * once every `sample_interval` bytes. Each sample is attributed to its allocation
+ * site: the object type, and the innermost bytecode function on the call stack
+ * with the instruction offset in it.
+ *
+ * @param z zis instance
+ * @param sample_interval sampling interval in bytes, or 0 for the default (64 KiB);
+ * 1 to record every allocation
+ * @return `ZIS_OK`; `ZIS_E_ARG` (the allocation profiler is already running,
+ * or is not supported by this build).
+ *
+ * @see zis_read_alloc_profile(), zis_stop_alloc_profiler()
+ */
+ZIS_API int zis_start_alloc_profiler(zis_t z, size_t sample_interval) ZIS_NOEXCEPT;
+
+/**
+ * Get a report of the allocation profiler.
+ *
+ * The report is an array of tuples `(type, func, offset, line, count, bytes)`,
+ * one for each allocation site, in descending order of `bytes`. `func` is the
+ * bytecode function or nil; `offset` and `line` are the instruction offset and
+ * the line number in `func`, or nil if unknown; `count` and `bytes` are the
+ * number of objects and bytes allocated there, estimated from the samples.
+ * The profiler keeps running.
+ *
+ * @param z zis instance
+ * @param reg register to store the report to
+ * @return `ZIS_OK`; `ZIS_E_IDX` (invalid `reg`), `ZIS_E_ARG` (the allocation
+ * profiler is not running).
+ */
+ZIS_API int zis_read_alloc_profile(zis_t z, unsigned int reg) ZIS_NOEXCEPT;
+
+/**
+ * Stop the allocation profiler and drop the samples.
+ *
+ * @param z zis instance
+ * @return `ZIS_OK`; `ZIS_E_ARG` (the allocation profiler is not running).
+ */
+ZIS_API int zis_stop_alloc_profiler(zis_t z) ZIS_NOEXCEPT;
+
+/**
+ * Write a heap dump.
+ *
+ * Garbage is collected first. Then each object in the heap is written with its
+ * type, its size, and the objects it refers to, followed by the objects that
+ * are referred to directly by the GC roots (registers, globals, and so on) and
+ * the names of the types. The file format is described in "src/core/heapdump.c".
+ *
+ * @param z zis instance
+ * @param file path to the output file
+ * @return `ZIS_OK`; `ZIS_E_ARG` (the file cannot be written).
+ *
+ * @warning The dump file can be as large as the heap.
+ */
+ZIS_API int zis_dump_heap(zis_t z, const char *file) ZIS_NOEXCEPT;
+
+/**
+ * Count the objects in the heap by type.
+ *
+ * The result is an array of tuples `(type, count, bytes)`, one for each type,
+ * in descending order of `bytes`. Counting walks through the heap once and is
+ * much faster than writing a heap dump with `zis_dump_heap()`.
+ *
+ * @param z zis instance
+ * @param reg register to store the result to
+ * @param live_only whether to collect garbage first; if false, unreachable
+ * objects that have not been collected are counted too
+ * @return `ZIS_OK`; `ZIS_E_IDX` (invalid `reg`).
+ */
+ZIS_API int zis_read_heap_census(zis_t z, unsigned int reg, bool live_only) ZIS_NOEXCEPT;
+
+/**
+ * Number of buckets in `zis_gc_stats::pause_histogram`.
+ */
+#define ZIS_GC_STATS_PAUSE_BUCKETS 24
+
+/**
+ * Garbage collection statistics. @see `zis_gc_stats()`.
+ */
+struct zis_gc_stats {
+    size_t   fast_gc_count;        /**< Number of fast (young) GCs. */
+    size_t   full_gc_count;        /**< Number of full GCs. */
+    uint64_t pause_time_total;     /**< Total GC pause time, in nanoseconds. */
+    uint64_t pause_time_max;       /**< The longest GC pause time, in nanoseconds. */
+    /**
+     * Numbers of GC pauses, by duration. Bucket `i` counts pauses that take
+     * [2^i, 2^(i+1)) microseconds; the first bucket also counts shorter pauses,
+     * and the last one longer pauses.
+     */
+    size_t   pause_histogram[ZIS_GC_STATS_PAUSE_BUCKETS];
+    uint64_t new_space_allocated;  /**< Bytes allocated in new space (for young objects). */
+    uint64_t old_space_allocated;  /**< Bytes allocated directly in old space. */
+    uint64_t big_space_allocated;  /**< Bytes allocated in big space (for large objects). */
+    uint64_t promoted;             /**< Bytes of objects promoted from new space to old space. */
+    size_t   old_space_remembered; /**< Objects in the old-space remembered set at the last fast GC. */
+    size_t   big_space_remembered; /**< Objects in the big-space remembered set at the last fast GC. */
+    size_t   new_space_size;       /**< Current size of new space (both of its chunks), in bytes. */
+};
+
+/**
+ * Get garbage collection statistics.
+ *
+ * The counters are always maintained, and are counted since the instance was
+ * created. Objects restored from a snapshot are not counted as allocated.
+ *
+ * @param z zis instance
+ * @param stats where to store the statistics
+ */
+ZIS_API void zis_gc_stats(zis_t z, struct zis_gc_stats *stats) ZIS_NOEXCEPT;
+
 /** @} */
 
 /** @defgroup zis-api-natives API: native functions, types, and modules */
@@ -722,6 +914,7 @@ ZIS_API int zis_read_exception(zis_t z, unsigned int reg, int flag, unsigned int
 #define ZIS_IOS_WINEOL  0x40 /**< `zis_make_stream()` `ZIS_IOS_FILE` mode: use Windows style of end-of-line (CRLF). */
 
 #define ZIS_IOS_STATIC  0x80 /**< `zis_make_stream()` `ZIS_IOS_TEXT` mode: string is static (infinite lifetime). */
+#define ZIS_IOS_BUFSZ   0x100 /**< `zis_make_stream()` `ZIS_IOS_FILE` mode: buffer size is given as an extra `size_t` argument. */
 
 /** @} */
 
@@ -742,6 +935,11 @@ ZIS_API int zis_read_exception(zis_t z, unsigned int reg, int flag, unsigned int
  * const int other_flags = ...;
  * int status = zis_make_stream(z, reg, ZIS_IOS_FILE | other_flags, file_path, encoding);
  * ```
+ * To open a file with a specific buffer size:
+ * ```c
+ * const size_t buffer_size = ...; // buffer size in bytes, or 0 for the default size
+ * int status = zis_make_stream(z, reg, ZIS_IOS_FILE | ZIS_IOS_BUFSZ | other_flags, file_path, encoding, buffer_size);
+ * ```
  * To get the standard input stream:
  * ```c
  * const int stdio_id = 0; // 0 for stdin
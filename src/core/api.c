@@ -9,10 +9,14 @@
 #include "context.h"
 #include "debug.h"
 #include "globals.h"
+#include "heapdump.h"
 #include "invoke.h"
 #include "loader.h"
 #include "locals.h"
 #include "object.h"
+#include "objmem.h"
+#include "profiler.h"
+#include "snapshot.h"
 #include "stack.h"
 #include "strutil.h"
 
@@ -152,16 +156,113 @@ ZIS_API zis_t zis_create(void) {
     return zis_context_create();
 }
 
+static int _api_create_from_snapshot_fn(const zis_path_char_t *file, void *_res) {
+    zis_t *res = _res;
+    *res = zis_context_create_from_snapshot(file);
+    return ZIS_OK;
+}
+
+ZIS_API zis_t zis_create_from_snapshot(const char *file) {
+    zis_t z = NULL;
+    zis_path_with_temp_path_from_str(file, _api_create_from_snapshot_fn, &z);
+    return z;
+}
+
 ZIS_API void zis_destroy(zis_t z) {
     zis_context_destroy(z);
 }
 
+static int _api_save_snapshot_fn(const zis_path_char_t *file, void *_z) {
+    return zis_snapshot_save(_z, file);
+}
+
+ZIS_API int zis_save_snapshot(zis_t z, const char *file) {
+    return zis_path_with_temp_path_from_str(file, _api_save_snapshot_fn, z);
+}
+
+ZIS_API void zis_reset(zis_t z) {
+    zis_context_reset(z);
+}
+
 ZIS_API zis_panic_handler_t zis_at_panic(zis_t z, zis_panic_handler_t h) {
     zis_panic_handler_t old_h = z->panic_handler;
     z->panic_handler = h;
     return old_h;
 }
 
+ZIS_API int zis_start_profiler(zis_t z, unsigned int interval_us) {
+    return zis_profiler_start(z, interval_us) ? ZIS_OK : ZIS_E_ARG;
+}
+
+static int _api_profiler_stop_fn(const zis_path_char_t *file, void *_z) {
+    struct zis_context *z = _z;
+    return zis_profiler_stop(z, file) ? ZIS_OK : ZIS_E_ARG;
+}
+
+ZIS_API int zis_stop_profiler(zis_t z, const char *file) {
+    if (!file)
+        return zis_profiler_stop(z, NULL) ? ZIS_OK : ZIS_E_ARG;
+    if (!z->profiler)
+        return ZIS_E_ARG;
+    return zis_path_with_temp_path_from_str(file, _api_profiler_stop_fn, z);
+}
+
+ZIS_API int zis_start_alloc_profiler(zis_t z, size_t sample_interval) {
+    return zis_alloc_profiler_start(z, sample_interval) ? ZIS_OK : ZIS_E_ARG;
+}
+
+ZIS_API int zis_read_alloc_profile(zis_t z, unsigned int reg) {
+    struct zis_object **const obj_ref = api_ref_local(z, reg);
+    if (zis_unlikely(!obj_ref))
+        return ZIS_E_IDX;
+    struct zis_array_obj *const report = zis_alloc_profiler_report(z);
+    if (!report)
+        return ZIS_E_ARG;
+    *obj_ref = zis_object_from(report);
+    return ZIS_OK;
+}
+
+ZIS_API int zis_stop_alloc_profiler(zis_t z) {
+    return zis_alloc_profiler_stop(z) ? ZIS_OK : ZIS_E_ARG;
+}
+
+static int _api_dump_heap_fn(const zis_path_char_t *file, void *_z) {
+    struct zis_context *z = _z;
+    return zis_heapdump_write(z, file) ? ZIS_OK : ZIS_E_ARG;
+}
+
+ZIS_API int zis_dump_heap(zis_t z, const char *file) {
+    return zis_path_with_temp_path_from_str(file, _api_dump_heap_fn, z);
+}
+
+ZIS_API int zis_read_heap_census(zis_t z, unsigned int reg, bool live_only) {
+    struct zis_object **const obj_ref = api_ref_local(z, reg);
+    if (zis_unlikely(!obj_ref))
+        return ZIS_E_IDX;
+    struct zis_array_obj *const census = zis_heapdump_census(z, live_only);
+    *obj_ref = zis_object_from(census);
+    return ZIS_OK;
+}
+
+static_assert(ZIS_GC_STATS_PAUSE_BUCKETS == ZIS_OBJMEM_STATS_PAUSE_BUCKETS, "");
+
+ZIS_API void zis_gc_stats(zis_t z, struct zis_gc_stats *stats) {
+    struct zis_objmem_stats s;
+    zis_objmem_read_stats(z, &s);
+    stats->fast_gc_count = s.fast_gc_count;
+    stats->full_gc_count = s.full_gc_count;
+    stats->pause_time_total = s.pause_time_total_ns;
+    stats->pause_time_max = s.pause_time_max_ns;
+    memcpy(stats->pause_histogram, s.pause_histogram, sizeof stats->pause_histogram);
+    stats->new_space_allocated = s.new_space_allocated;
+    stats->old_space_allocated = s.old_space_allocated;
+    stats->big_space_allocated = s.big_space_allocated;
+    stats->promoted = s.promoted;
+    stats->old_space_remembered = s.old_space_remembered;
+    stats->big_space_remembered = s.big_space_remembered;
+    stats->new_space_size = s.new_space_size;
+}
+
 /* ----- zis-api-natives ---------------------------------------------------- */
 
 static_assert(sizeof(struct zis_native_func_def) < sizeof(struct zis_native_func_def_ex), "");
@@ -256,6 +357,7 @@ ZIS_API int zis_read_int(zis_t z, unsigned int reg, int64_t *val) {
         return ZIS_OK;
     }
     if (zis_object_type(obj) == z->globals->type_Int) {
+        errno = 0;
         const int64_t v_i64 =
             zis_int_obj_value_i(zis_object_cast(obj, struct zis_int_obj));
         if (zis_unlikely(v_i64 == INT64_MIN && errno == ERANGE))
@@ -844,6 +946,7 @@ do {                  \
                 break;
             }
             CHECK_TYPE(Int);
+            errno = 0;
             const int64_t val =
                 zis_int_obj_value_i(zis_object_cast(in_obj, struct zis_int_obj));
             if (zis_unlikely(val == INT64_MIN && errno == ERANGE)) {
@@ -1115,6 +1218,7 @@ struct _api_make_stream_context {
 static int _api_make_stream_open_file_fn(const zis_path_char_t *path, void *_arg) {
     struct _api_make_stream_context *const x =_arg;
     const char *const encoding = va_arg(x->api_args, char *);
+    const size_t buffer_size = x->api_flags & ZIS_IOS_BUFSZ ? va_arg(x->api_args, size_t) : 0;
     int flags = x->stream_obj_flags;
     if (encoding) {
         flags |= ZIS_STREAM_OBJ_TEXT;
@@ -1123,7 +1227,7 @@ static int _api_make_stream_open_file_fn(const zis_path_char_t *path, void *_arg
         else
             return ZIS_E_ARG; // Supports UTF-8 only.
     }
-    struct zis_stream_obj *stream_obj = zis_stream_obj_new_file(x->z, path, flags);
+    struct zis_stream_obj *stream_obj = zis_stream_obj_new_file(x->z, path, flags, buffer_size);
     if (!stream_obj)
         return ZIS_THR;
     *x->res_obj_ref = zis_object_from(stream_obj);
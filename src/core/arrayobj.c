@@ -2,13 +2,16 @@
 
 #include "context.h"
 #include "globals.h"
+#include "invoke.h"
 #include "locals.h"
+#include "memory.h"
 #include "ndefutil.h"
 #include "objmem.h"
 #include "objvec.h"
 #include "stack.h"
 
 #include "exceptobj.h"
+#include "floatobj.h"
 #include "stringobj.h"
 
 /* ----- array slots -------------------------------------------------------- */
@@ -69,6 +72,19 @@ struct zis_array_slots_obj *zis_array_slots_obj_new2(
     return self;
 }
 
+/// Try to enlarge the slots without moving them. New slots are zeroed.
+static bool array_slots_obj_try_extend(
+    struct zis_context *z, struct zis_array_slots_obj *self, size_t new_len
+) {
+    const size_t old_len = zis_array_slots_obj_length(self);
+    assert(new_len > old_len);
+    if (!zis_objmem_try_extend_slots(z, zis_object_from(self), 1 + new_len))
+        return false;
+    assert(zis_array_slots_obj_length(self) == new_len);
+    zis_object_vec_zero(self->_data + old_len, new_len - old_len);
+    return true;
+}
+
 struct zis_array_slots_obj *_zis_array_slots_obj_new_empty(struct zis_context *z) {
     return array_slots_obj_alloc(z, 0);
 }
@@ -90,7 +106,7 @@ struct zis_array_obj *zis_array_obj_new(
         struct zis_array_obj
     );
     self->_data = z->globals->val_empty_array_slots;
-    zis_object_assert_no_write_barrier(self);
+    zis_object_assert_no_write_barrier_2(self, zis_object_from(self->_data));
     self->length = n;
     if (n) {
         zis_locals_decl_1(z, var, struct zis_array_obj *self);
@@ -99,7 +115,7 @@ struct zis_array_obj *zis_array_obj_new(
         self = var.self;
         zis_locals_drop(z, var);
         self->_data = data;
-        zis_object_assert_no_write_barrier(self);
+        zis_object_write_barrier(self, data); // `self` may be pretenured.
     }
     return self;
 }
@@ -124,6 +140,7 @@ struct zis_array_obj *zis_array_obj_new2(
         if (v) {
             data = array_slots_obj_alloc(z, reserve);
             zis_object_vec_copy(data->_data, v, n);
+            zis_object_write_barrier_n(data, v, n); // `data` may be in big space.
             zis_object_vec_zero(data->_data + n, reserve - n);
         } else {
             data = zis_array_slots_obj_new(z, NULL, reserve);
@@ -131,7 +148,7 @@ struct zis_array_obj *zis_array_obj_new2(
         self = var.self;
         zis_locals_drop(z, var);
         self->_data = data;
-        zis_object_assert_no_write_barrier(self);
+        zis_object_write_barrier(self, data); // `self` may be pretenured.
     }
     return self;
 }
@@ -172,6 +189,8 @@ void zis_array_obj_reserve(struct zis_context *z, struct zis_array_obj *self, si
 
     if (old_cap >= new_cap)
         return;
+    if (array_slots_obj_try_extend(z, self_data, new_cap))
+        return;
 
     zis_locals_decl_1(z, var, struct zis_array_obj *self);
     var.self = self;
@@ -199,14 +218,16 @@ void zis_array_obj_append(
     if (zis_unlikely(old_len == old_cap)) {
         const size_t new_cap = old_cap >= 2 ? old_cap * 2 : 4;
 
-        zis_locals_decl(z, var, struct zis_array_obj *self; struct zis_object *v;);
-        var.self = self, var.v = v;
-        self_data = zis_array_slots_obj_new2(z, new_cap, self_data);
-        self = var.self, v = var.v;
-        zis_locals_drop(z, var);
+        if (!array_slots_obj_try_extend(z, self_data, new_cap)) {
+            zis_locals_decl(z, var, struct zis_array_obj *self; struct zis_object *v;);
+            var.self = self, var.v = v;
+            self_data = zis_array_slots_obj_new2(z, new_cap, self_data);
+            self = var.self, v = var.v;
+            zis_locals_drop(z, var);
 
-        self->_data = self_data;
-        zis_object_write_barrier(self, self_data);
+            self->_data = self_data;
+            zis_object_write_barrier(self, self_data);
+        }
     }
 
     zis_array_slots_obj_set(self_data, old_len, v);
@@ -250,17 +271,19 @@ bool zis_array_obj_insert(
     if (zis_unlikely(old_len == old_cap)) {
         const size_t new_cap = old_cap >= 2 ? old_cap * 2 : 4;
 
-        zis_locals_decl(z, var, struct zis_array_obj *self; struct zis_object *v;);
-        var.self = self, var.v = v;
-        self_data = array_slots_obj_alloc(z, new_cap);
-        self = var.self, v = var.v;
-        zis_locals_drop(z, var);
-        old_data = self->_data->_data;
-
-        self->_data = self_data;
-        zis_object_write_barrier(self, self_data);
-        zis_object_vec_copy(self_data->_data, old_data, pos);
-        zis_object_write_barrier_n(self_data, old_data, pos);
+        if (!array_slots_obj_try_extend(z, self_data, new_cap)) {
+            zis_locals_decl(z, var, struct zis_array_obj *self; struct zis_object *v;);
+            var.self = self, var.v = v;
+            self_data = array_slots_obj_alloc(z, new_cap);
+            self = var.self, v = var.v;
+            zis_locals_drop(z, var);
+            old_data = self->_data->_data;
+
+            self->_data = self_data;
+            zis_object_write_barrier(self, self_data);
+            zis_object_vec_copy(self_data->_data, old_data, pos);
+            zis_object_write_barrier_n(self_data, old_data, pos);
+        }
     }
     zis_object_vec_move(self_data->_data + pos + 1, old_data + pos, old_len - pos);
     zis_array_slots_obj_set(self_data, pos, v);
@@ -307,6 +330,280 @@ bool zis_array_obj_remove(
     return true;
 }
 
+/* ----- sorting ----------------------------------------------------------- */
+
+// The array is sorted as a vector of indices to the sort keys, with a simplified
+// Timsort (natural runs extended with binary insertion sort, and merged with the
+// run-stack invariants; no galloping), which is stable. If all the keys are
+// small integers, Floats, or Strings, they are compared without invoking
+// methods, and no GC can happen during the sorting; otherwise the keys are
+// compared with `zis_object_compare()`, which may invoke methods and trigger a
+// GC, so they are loaded from the GC-visible slots by index for each comparison.
+
+enum array_sort_kind {
+    ARRAY_SORT_SMALLINT,
+    ARRAY_SORT_FLOAT,
+    ARRAY_SORT_STRING,
+    ARRAY_SORT_GENERIC,
+};
+
+struct array_sort_state {
+    enum array_sort_kind kind;
+    bool reverse;
+    bool failed; ///< A comparison has thrown; the rest comparisons are skipped.
+    struct zis_context *z;
+    struct zis_array_slots_obj **keys_ref; ///< The keys, for `ARRAY_SORT_GENERIC`.
+    union {
+        zis_smallint_t *smi;
+        double *flt;
+        struct zis_string_obj **str;
+    } keys;
+};
+
+/// Compare keys `a` and `b`. Returns true if `a` < `b` (or `a` > `b` if reversed).
+static bool array_sort_less(struct array_sort_state *st, size_t a, size_t b) {
+    if (st->reverse) {
+        const size_t t = a;
+        a = b, b = t;
+    }
+    switch (st->kind) {
+    case ARRAY_SORT_SMALLINT:
+        return st->keys.smi[a] < st->keys.smi[b];
+    case ARRAY_SORT_FLOAT:
+        return st->keys.flt[a] < st->keys.flt[b];
+    case ARRAY_SORT_STRING:
+        return zis_string_obj_compare(st->keys.str[a], st->keys.str[b]) < 0;
+    case ARRAY_SORT_GENERIC: {
+        if (zis_unlikely(st->failed))
+            return false;
+        struct zis_array_slots_obj *keys = *st->keys_ref;
+        const enum zis_object_ordering o = zis_object_compare(
+            st->z, zis_array_slots_obj_get(keys, a), zis_array_slots_obj_get(keys, b)
+        );
+        if (zis_unlikely(o == ZIS_OBJECT_IC)) {
+            st->failed = true;
+            return false;
+        }
+        return o == ZIS_OBJECT_LT;
+    }
+    default:
+        zis_unreachable();
+    }
+}
+
+/// Sort `v[begin ... end-1]`, where `v[begin ... sorted_end-1]` is sorted, with binary insertion sort.
+static void array_sort_insertion(
+    struct array_sort_state *st, size_t *v, size_t begin, size_t sorted_end, size_t end
+) {
+    for (size_t i = sorted_end; i < end; i++) {
+        const size_t x = v[i];
+        size_t lo = begin, hi = i;
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (array_sort_less(st, x, v[mid]))
+                hi = mid;
+            else
+                lo = mid + 1; // Equal keys stay in order.
+        }
+        memmove(v + lo + 1, v + lo, (i - lo) * sizeof *v);
+        v[lo] = x;
+    }
+}
+
+/// Find the run starting at `begin`, and make it ascending. Returns the end of the run.
+static size_t array_sort_count_run(struct array_sort_state *st, size_t *v, size_t begin, size_t end) {
+    size_t i = begin + 1;
+    if (i == end)
+        return end;
+    if (array_sort_less(st, v[i], v[i - 1])) {
+        // Strictly descending. Reversing it keeps the sort stable.
+        for (i++; i < end && array_sort_less(st, v[i], v[i - 1]); i++);
+        for (size_t lo = begin, hi = i - 1; lo < hi; lo++, hi--) {
+            const size_t t = v[lo];
+            v[lo] = v[hi], v[hi] = t;
+        }
+    } else {
+        for (i++; i < end && !array_sort_less(st, v[i], v[i - 1]); i++);
+    }
+    return i;
+}
+
+/// Merge sorted `v[begin ... mid-1]` and `v[mid ... end-1]`, using `tmp` as the buffer.
+static void array_sort_merge(
+    struct array_sort_state *st, size_t *v, size_t *tmp,
+    size_t begin, size_t mid, size_t end
+) {
+    // Skip the elements that are already in place.
+    while (begin < mid && !array_sort_less(st, v[mid], v[begin]))
+        begin++;
+    while (mid < end && !array_sort_less(st, v[end - 1], v[mid - 1]))
+        end--;
+    if (begin == mid || mid == end)
+        return;
+
+    const size_t left_n = mid - begin;
+    memcpy(tmp, v + begin, left_n * sizeof *v);
+    size_t i = 0, j = mid, k = begin;
+    while (i < left_n && j < end) {
+        if (array_sort_less(st, v[j], tmp[i]))
+            v[k++] = v[j++];
+        else
+            v[k++] = tmp[i++];
+    }
+    memcpy(v + k, tmp + i, (left_n - i) * sizeof *v);
+}
+
+/// Sort `v[0 ... n-1]`. `tmp` must be able to hold `n` elements.
+static void array_sort_indices(struct array_sort_state *st, size_t *v, size_t *tmp, size_t n) {
+    size_t min_run = n, r = 0;
+    while (min_run >= 64)
+        r |= min_run & 1, min_run >>= 1;
+    min_run += r;
+
+    struct { size_t begin, len; } runs[sizeof(size_t) * 8 * 2];
+    size_t runs_n = 0;
+
+    for (size_t begin = 0; begin < n; ) {
+        size_t end = array_sort_count_run(st, v, begin, n);
+        if (end - begin < min_run) {
+            const size_t forced_end = n - begin < min_run ? n : begin + min_run;
+            array_sort_insertion(st, v, begin, end, forced_end);
+            end = forced_end;
+        }
+        runs[runs_n].begin = begin, runs[runs_n].len = end - begin;
+        runs_n++;
+        begin = end;
+
+        // Keep the invariants: len[-3] > len[-2] + len[-1], len[-2] > len[-1].
+        while (runs_n > 1) {
+            size_t i = runs_n - 2;
+            if (
+                (i > 0 && runs[i - 1].len <= runs[i].len + runs[i + 1].len) ||
+                (i > 1 && runs[i - 2].len <= runs[i - 1].len + runs[i].len)
+            ) {
+                if (runs[i - 1].len < runs[i + 1].len)
+                    i--;
+            } else if (runs[i].len > runs[i + 1].len) {
+                break;
+            }
+            array_sort_merge(
+                st, v, tmp, runs[i].begin,
+                runs[i + 1].begin, runs[i + 1].begin + runs[i + 1].len
+            );
+            runs[i].len += runs[i + 1].len;
+            memmove(runs + i + 1, runs + i + 2, (runs_n - i - 2) * sizeof runs[0]);
+            runs_n--;
+        }
+    }
+
+    while (runs_n > 1) {
+        size_t i = runs_n - 2;
+        if (i > 0 && runs[i - 1].len < runs[i + 1].len)
+            i--;
+        array_sort_merge(
+            st, v, tmp, runs[i].begin,
+            runs[i + 1].begin, runs[i + 1].begin + runs[i + 1].len
+        );
+        runs[i].len += runs[i + 1].len;
+        memmove(runs + i + 1, runs + i + 2, (runs_n - i - 2) * sizeof runs[0]);
+        runs_n--;
+    }
+}
+
+/// Sort the array in place. `*slots_ref` and `*keys_ref` must be GC-safe and are used
+/// as the work space. If `key` is not NULL, elements are sorted by `key(elem)`.
+/// On failure (the key function or a comparison throws), returns false and leaves the array unchanged.
+static bool array_obj_sort(
+    struct zis_context *z, struct zis_array_obj **self_ref, struct zis_object **key_ref,
+    struct zis_array_slots_obj **slots_ref, struct zis_array_slots_obj **keys_ref,
+    bool reverse
+) {
+    const size_t n = zis_array_obj_length(*self_ref);
+    if (n < 2)
+        return true;
+
+    *slots_ref = zis_array_slots_obj_new2(z, n, (*self_ref)->_data);
+    if (key_ref) {
+        *keys_ref = zis_array_slots_obj_new(z, NULL, n);
+        for (size_t i = 0; i < n; i++) {
+            struct zis_object *k;
+            struct zis_object *elem = zis_array_slots_obj_get(*slots_ref, i);
+            if (zis_invoke_vn(z, &k, *key_ref, &elem, 1))
+                return false;
+            zis_array_slots_obj_set(*keys_ref, i, k);
+        }
+    } else {
+        *keys_ref = *slots_ref;
+    }
+
+    struct array_sort_state st;
+    st.reverse = reverse;
+    st.failed = false;
+    st.z = z;
+    st.keys_ref = keys_ref;
+    st.keys.smi = NULL;
+
+    struct zis_object *const *keys = (*keys_ref)->_data;
+    struct zis_type_obj *const first_type =
+        zis_object_is_smallint(keys[0]) ? NULL : zis_object_type(keys[0]);
+    st.kind =
+        first_type == NULL ? ARRAY_SORT_SMALLINT :
+        first_type == z->globals->type_Float ? ARRAY_SORT_FLOAT :
+        first_type == z->globals->type_String ? ARRAY_SORT_STRING :
+        ARRAY_SORT_GENERIC;
+    for (size_t i = 1; i < n && st.kind != ARRAY_SORT_GENERIC; i++) {
+        struct zis_object *const k = keys[i];
+        if (zis_object_is_smallint(k) ? first_type != NULL : zis_object_type(k) != first_type)
+            st.kind = ARRAY_SORT_GENERIC;
+    }
+    switch (st.kind) {
+    case ARRAY_SORT_SMALLINT:
+        st.keys.smi = zis_mem_alloc(n * sizeof st.keys.smi[0]);
+        for (size_t i = 0; i < n; i++)
+            st.keys.smi[i] = zis_smallint_from_ptr(keys[i]);
+        break;
+    case ARRAY_SORT_FLOAT:
+        st.keys.flt = zis_mem_alloc(n * sizeof st.keys.flt[0]);
+        for (size_t i = 0; i < n; i++)
+            st.keys.flt[i] = zis_float_obj_value(zis_object_cast(keys[i], struct zis_float_obj));
+        break;
+    case ARRAY_SORT_STRING:
+        // No allocation during the sorting, so the strings will not be moved.
+        st.keys.str = zis_mem_alloc(n * sizeof st.keys.str[0]);
+        for (size_t i = 0; i < n; i++)
+            st.keys.str[i] = zis_object_cast(keys[i], struct zis_string_obj);
+        break;
+    default:
+        break;
+    }
+
+    size_t *const indices = zis_mem_alloc(n * 2 * sizeof(size_t));
+    for (size_t i = 0; i < n; i++)
+        indices[i] = i;
+    array_sort_indices(&st, indices, indices + n, n);
+    zis_mem_free(st.keys.smi);
+
+    if (st.failed) {
+        zis_mem_free(indices);
+        return false;
+    }
+
+    // Permute the elements into the keys slots, which are not used any more,
+    // or a new one if the keys slots are the elements slots.
+    if (*keys_ref == *slots_ref)
+        *keys_ref = zis_array_slots_obj_new(z, NULL, n);
+    struct zis_array_slots_obj *const result = *keys_ref, *const elems = *slots_ref;
+    for (size_t i = 0; i < n; i++)
+        zis_array_slots_obj_set(result, i, zis_array_slots_obj_get(elems, indices[i]));
+    zis_mem_free(indices);
+
+    struct zis_array_obj *const self = *self_ref;
+    self->_data = result;
+    self->length = n;
+    zis_object_write_barrier(self, result);
+    return true;
+}
+
 #define assert_arg1_Array(__z) \
     (assert(zis_object_type_is((__z)->callstack->frame[1], (__z)->globals->type_Array)))
 
@@ -630,6 +927,39 @@ ZIS_NATIVE_FUNC_DEF(T_Array_M_remove, z, {2, 0, 2}) {
     return ZIS_OK;
 }
 
+ZIS_NATIVE_FUNC_DEF(T_Array_M_sort, z, {1, 2, 5}) {
+    /*#DOCSTR# func Array:sort(?key :: Callable, ?reverse :: Bool)
+    Sorts the elements in place, in ascending order, or descending order if
+    `reverse` is true. The sort is stable. If `key` is given, the elements are
+    sorted by `key(element)`. Arrays of only small integers, only Floats, or
+    only Strings are sorted without invoking the `<=>` methods. */
+    assert_arg1_Array(z);
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+
+    bool reverse = false;
+    if (frame[3] == zis_object_from(g->val_true)) {
+        reverse = true;
+    } else if (zis_unlikely(frame[3] != zis_object_from(g->val_nil) && frame[3] != zis_object_from(g->val_false))) {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_WRONG_ARGUMENT_TYPE, "reverse", frame[3]
+        ));
+        return ZIS_THR;
+    }
+    const bool has_key = frame[2] != zis_object_from(g->val_nil);
+
+    if (!array_obj_sort(
+        z, (struct zis_array_obj **)(frame + 1), has_key ? frame + 2 : NULL,
+        (struct zis_array_slots_obj **)(frame + 4), (struct zis_array_slots_obj **)(frame + 5),
+        reverse
+    )) {
+        return ZIS_THR;
+    }
+
+    frame[0] = zis_object_from(g->val_nil);
+    return ZIS_OK;
+}
+
 ZIS_NATIVE_FUNC_DEF_LIST(
     T_array_D_methods,
     { "+"           , &T_Array_M_operator_add      },
@@ -643,6 +973,7 @@ ZIS_NATIVE_FUNC_DEF_LIST(
     { "pop"         , &T_Array_M_pop               },
     { "insert"      , &T_Array_M_insert            },
     { "remove"      , &T_Array_M_remove            },
+    { "sort"        , &T_Array_M_sort              },
 );
 
 ZIS_NATIVE_TYPE_DEF(
@@ -287,6 +287,54 @@ static void jumpinstr_table_shift(struct jumpinstr_table *jt, uint32_t addr_star
     }
 }
 
+struct line_table {
+    struct zis_func_obj_line_info *data;
+    size_t length, capacity;
+    uint32_t current_line; // Line of the instructions to append; 0 if unknown.
+};
+
+static void line_table_init(struct line_table *lt) {
+    lt->data = NULL;
+    lt->length = 0;
+    lt->capacity = 0;
+    lt->current_line = 0;
+}
+
+static void line_table_fini(struct line_table *lt) {
+    zis_mem_free(lt->data);
+}
+
+static void line_table_clear(struct line_table *lt) {
+    lt->length = 0;
+    lt->current_line = 0;
+}
+
+/// Record the current line for an instruction to be placed at `addr`, if changed.
+static void line_table_mark(struct line_table *lt, uint32_t addr) {
+    const uint32_t line = lt->current_line;
+    if (!line || (lt->length && lt->data[lt->length - 1].line == line))
+        return;
+    assert(lt->length <= lt->capacity);
+    if (zis_unlikely(lt->length == lt->capacity)) {
+        const size_t new_cap = lt->capacity ? lt->capacity * 2 : 16;
+        lt->data = zis_mem_realloc(lt->data, new_cap * sizeof lt->data[0]);
+        assert(lt->data);
+        lt->capacity = new_cap;
+    }
+    struct zis_func_obj_line_info *const entry = &lt->data[lt->length++];
+    entry->address = addr;
+    entry->line = line;
+}
+
+static void line_table_shift(struct line_table *lt, uint32_t addr_start) {
+    struct zis_func_obj_line_info *data = lt->data;
+    for (size_t i = 0, n = lt->length; i < n; i++) {
+        const uint32_t x = data[i].address;
+        if (x >= addr_start)
+            data[i].address = x + 1U;
+    }
+}
+
 struct zis_assembler {
 #define AS_OBJ_MEMBER_BEGIN func_constants
     struct zis_array_obj *func_constants;
@@ -295,6 +343,7 @@ struct zis_assembler {
     struct instr_buffer instr_buffer;
     struct label_table  label_table;
     struct jumpinstr_table jumpinstr_table;
+    struct line_table   line_table;
     struct zis_func_obj_meta func_meta;
     struct zis_assembler *_as_list_next;
 };
@@ -318,6 +367,7 @@ struct zis_assembler *zis_assembler_create(
     instr_buffer_init(&as->instr_buffer);
     label_table_init(&as->label_table);
     jumpinstr_table_init(&as->jumpinstr_table);
+    line_table_init(&as->line_table);
     as->func_meta.na = 0, as->func_meta.no = 0, as->func_meta.nr = 0;
     as->_as_list_next = NULL;
 
@@ -349,6 +399,7 @@ void zis_assembler_destroy(
     instr_buffer_fini(&as->instr_buffer);
     label_table_fini(&as->label_table);
     jumpinstr_table_fini(&as->jumpinstr_table);
+    line_table_fini(&as->line_table);
     zis_mem_free(as);
 }
 
@@ -358,6 +409,7 @@ void zis_assembler_clear(struct zis_assembler *as) {
     instr_buffer_clear(&as->instr_buffer);
     label_table_clear(&as->label_table);
     jumpinstr_table_clear(&as->jumpinstr_table);
+    line_table_clear(&as->line_table);
     as->func_meta.na = 0, as->func_meta.no = 0, as->func_meta.nr = 0;
 }
 
@@ -437,6 +489,7 @@ struct zis_func_obj *zis_assembler_finish(
                         instr_buffer_insert(&as->instr_buffer, instr_i + 1, zis_instr_make_Asw(_ZIS_OPC_COUNT, jt_i));
                         label_table_shift(&as->label_table, instr_i + 1);
                         jumpinstr_table_shift(&as->jumpinstr_table, instr_i + 1);
+                        line_table_shift(&as->line_table, instr_i + 1);
                         goto _re_fill_jump_instr;
                     }
                     jt_entry->instr[0] = zis_instr_make_AsBw(opcode, jump_offset, operand);
@@ -467,12 +520,20 @@ struct zis_func_obj *zis_assembler_finish(
     }
 
     // Create a function object from the bytecode.
-    zis_locals_decl_1(z, var, struct zis_func_obj *func_obj);
-    zis_locals_zero_1(var, func_obj);
+    zis_locals_decl(
+        z, var,
+        struct zis_func_obj *func_obj;
+        struct zis_module_obj *module;
+    );
+    zis_locals_zero(var);
+    var.module = _module;
     var.func_obj = zis_func_obj_new_bytecode(
         z, as->func_meta, as->instr_buffer.data, as->instr_buffer.length
     );
-    zis_func_obj_set_module(z, var.func_obj, _module); // No GC should have been triggered before this.
+    zis_func_obj_set_module(z, var.func_obj, var.module); // The allocation above may have moved the module.
+
+    // Attach the line-number table.
+    zis_func_obj_set_line_table(z, var.func_obj, as->line_table.data, as->line_table.length);
 
     // Add constants & symbols to the function object.
     if (zis_array_obj_length(as->func_constants)) {
@@ -553,8 +614,15 @@ int zis_assembler_place_label(struct zis_assembler *as, int id) {
     return id;
 }
 
+unsigned int zis_assembler_set_line(struct zis_assembler *as, unsigned int line) {
+    const uint32_t prev_line = as->line_table.current_line;
+    as->line_table.current_line = (uint32_t)line;
+    return prev_line;
+}
+
 void zis_assembler_append(struct zis_assembler *as, zis_instr_word_t instr) {
     zis_debug_log(TRACE, "Asm", "append instruction %08x", instr);
+    line_table_mark(&as->line_table, (uint32_t)as->instr_buffer.length);
     instr_buffer_append(&as->instr_buffer, instr);
 }
 
@@ -792,6 +860,7 @@ static struct zis_func_obj *tas_parse_func(
         union tas_parse_line_result line_result;
         enum tas_parse_line_status line_status = tas_parse_line(tas, &line_result);
         if (line_status == TAS_PARSE_INSTR) {
+            zis_assembler_set_line(as, tas->line_number);
             switch (op_type_of(line_result.instr.opcode)) {
                 // FIXME: ranges of operands are not checked.
             case ZIS_OP_Aw:
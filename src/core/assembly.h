@@ -69,6 +69,11 @@ int zis_assembler_alloc_label(struct zis_assembler *as);
 /// The label must not be placed before.
 int zis_assembler_place_label(struct zis_assembler *as, int id);
 
+/// Set the source line number of the instructions appended after this call,
+/// and return the old one. Line 0 means unknown, in which case the instructions
+/// are regarded as on the line of the instructions before them.
+unsigned int zis_assembler_set_line(struct zis_assembler *as, unsigned int line);
+
 /// Append an instruction.
 void zis_assembler_append(struct zis_assembler *as, zis_instr_word_t instr);
 
@@ -841,7 +841,13 @@ codegen_node_handlers[(unsigned int)_ZIS_AST_NODE_TYPE_COUNT] = {
 static int emit_any(struct zis_codegen *cg, struct zis_ast_node_obj *node, unsigned int tgt_reg) {
     unsigned int node_type_index = (unsigned int)zis_ast_node_obj_type(node);
     assert(node_type_index < (unsigned int)_ZIS_AST_NODE_TYPE_COUNT);
-    return codegen_node_handlers[node_type_index](cg, node, tgt_reg);
+    // Instructions are attributed to the first line of the innermost node.
+    struct zis_assembler *const as = scope_assembler(cg);
+    const unsigned int outer_line =
+        zis_assembler_set_line(as, zis_ast_node_obj_location(node)->line0);
+    const int ret = codegen_node_handlers[node_type_index](cg, node, tgt_reg);
+    zis_assembler_set_line(as, outer_line);
+    return ret;
 }
 
 /// Handle a unary operator node.
@@ -11,10 +11,16 @@
 #include "memory.h"
 #include "ndefutil.h"
 #include "objmem.h"
+#include "opstat.h"
+#include "profiler.h"
+#include "snapshot.h"
 #include "stack.h"
+#include "streamobj.h"
 #include "symbolobj.h"
 #include "zis.h" // ZIS_PANIC_*
 
+#include "coroutineobj.h"
+#include "exceptobj.h"
 #include "funcobj.h"
 #include "mapobj.h"
 #include "moduleobj.h"
@@ -96,10 +102,16 @@ zis_cold_fn static void context_read_environ_mems(
     if (!var)
         return;
 
-    // syntax="STACK_SZ;<heap_opts>", heap_opts="NEW_SPC,OLD_SPC_NEW:OLD_SPC_MAX,BIG_SPC_NEW:BIG_SPC_MAX"
+    // syntax="STACK_SZ;<heap_opts>", heap_opts="NEW_SPC[:NEW_SPC_MAX],OLD_SPC_NEW:OLD_SPC_MAX,BIG_SPC_NEW:BIG_SPC_MAX"
+    const char *p = var;
+    int n;
+    if (sscanf(p, "%zu;%zu%n", stack_size, &objmem_opts->new_space_size, &n) != 2)
+        return;
+    p += n;
+    if (*p == ':' && sscanf(p, ":%zu%n", &objmem_opts->new_space_size_max, &n) == 1)
+        p += n;
     sscanf(
-        var, "%zu;%zu,%zu:%zu,%zu:%zu",
-        stack_size, &objmem_opts->new_space_size,
+        p, ",%zu:%zu,%zu:%zu",
         &objmem_opts->old_space_size_new, &objmem_opts->old_space_size_max,
         &objmem_opts->big_space_size_new, &objmem_opts->big_space_size_max
     );
@@ -113,9 +125,45 @@ zis_cold_fn static void context_read_environ_mems(
 #endif // ZIS_ENVIRON_NAME_MEMS
 }
 
-/* ----- public functions --------------------------------------------------- */
+#if ZIS_FEATURE_OPSTAT
 
-zis_nodiscard struct zis_context *zis_context_create(void) {
+zis_cold_fn static void context_read_environ_opstat(struct zis_context *z) {
+#if ZIS_SYSTEM_WINDOWS
+#    define char       wchar_t
+#    define strchr     wcschr
+#    define getenv(x)  _wgetenv(ZIS_PATH_STR(x))
+#endif // ZIS_SYSTEM_WINDOWS
+
+    const char *var = NULL;
+#ifdef ZIS_ENVIRON_NAME_OPSTAT
+    var = getenv(ZIS_ENVIRON_NAME_OPSTAT);
+#endif // ZIS_ENVIRON_NAME_OPSTAT
+
+    // syntax="[SUMMARY_FILE][;TRACE_FILE]", where an empty SUMMARY_FILE means stderr
+    zis_path_char_t *summary_file = NULL;
+    const char *trace_file = NULL;
+    if (var) {
+        const char *const sep = strchr(var, ';');
+        summary_file = zis_path_dup_n(var, sep ? (size_t)(sep - var) : zis_path_len(var));
+        if (sep && sep[1])
+            trace_file = sep + 1;
+    }
+    z->opstat = zis_opstat_create(z, summary_file, trace_file);
+    zis_mem_free(summary_file);
+
+#if ZIS_SYSTEM_WINDOWS
+#    undef char
+#    undef strchr
+#    undef getenv
+#endif // ZIS_SYSTEM_WINDOWS
+}
+
+#endif // ZIS_FEATURE_OPSTAT
+
+/* ----- init: create context ----------------------------------------------- */
+
+/// Create a context with the memory and the runtime infrastructure, but no globals.
+zis_cold_fn static struct zis_context *context_create_bare(void) {
     zis_debug_try_init();
 
     struct zis_context *const z = zis_mem_alloc(sizeof(struct zis_context));
@@ -125,15 +173,30 @@ zis_nodiscard struct zis_context *zis_context_create(void) {
     struct zis_objmem_options objmem_options;
     context_read_environ_mems(&stack_size, &objmem_options);
     z->objmem_context = zis_objmem_context_create(&objmem_options);
-    z->callstack = zis_callstack_create(z, stack_size);
+    z->callstack = zis_callstack_create(z, stack_size, true);
     z->symbol_registry = zis_symbol_registry_create(z);
     zis_locals_root_init(&z->locals_root, z);
+    z->stream_buf_pool = zis_stream_buf_pool_create(z);
+    z->coroutine_stack_pool = zis_coroutine_stack_pool_create(z);
+    z->exception_trace_buffer = zis_exception_trace_buffer_create(z);
+#if ZIS_FEATURE_OPSTAT
+    context_read_environ_opstat(z);
+#endif // ZIS_FEATURE_OPSTAT
+
+    return z;
+}
+
+/* ----- public functions --------------------------------------------------- */
+
+zis_nodiscard struct zis_context *zis_context_create(void) {
+    struct zis_context *const z = context_create_bare();
 
     z->globals = zis_context_globals_create(z);
     z->module_loader = zis_module_loader_create(z);
 
     context_load_builtin_modules(z);
     context_read_environ_path(z);
+    zis_module_loader_set_bootstrapped(z);
 
     assert(!z->panic_handler);
 
@@ -141,17 +204,69 @@ zis_nodiscard struct zis_context *zis_context_create(void) {
     return z;
 }
 
+zis_nodiscard struct zis_context *zis_context_create_from_snapshot(const zis_path_char_t *file) {
+    struct zis_snapshot *const snapshot = zis_snapshot_open(file);
+    if (!snapshot)
+        return NULL;
+
+    struct zis_context *const z = context_create_bare();
+
+    struct zis_object *loaded_modules;
+    z->globals = zis_context_globals_create_empty(z);
+    if (!zis_snapshot_restore(snapshot, z, &loaded_modules)) {
+        zis_snapshot_close(snapshot);
+        zis_context_destroy(z);
+        return NULL;
+    }
+    z->module_loader = zis_module_loader_create_restored(z, loaded_modules);
+    zis_context_globals_post_restore(z->globals, z);
+    const bool rehash_ok = zis_snapshot_rebuild_hash_tables(snapshot, z);
+    zis_snapshot_close(snapshot);
+    if (!rehash_ok) {
+        zis_context_destroy(z);
+        return NULL;
+    }
+
+    context_read_environ_path(z);
+    zis_module_loader_set_bootstrapped(z);
+
+    assert(!z->panic_handler);
+
+    zis_debug_log(INFO, "Context", "new context @%p from snapshot", (void *)z);
+    return z;
+}
+
 void zis_context_destroy(struct zis_context *z) {
     zis_debug_log(INFO, "Context", "deleting context @%p", (void *)z);
+    if (z->profiler)
+        zis_profiler_stop(z, NULL);
+    if (z->alloc_profiler)
+        zis_alloc_profiler_stop(z);
+#if ZIS_FEATURE_OPSTAT
+    zis_opstat_destroy(z->opstat, z);
+    z->opstat = NULL;
+#endif // ZIS_FEATURE_OPSTAT
     zis_locals_root_fini(&z->locals_root, z);
-    zis_module_loader_destroy(z->module_loader, z);
+    if (z->module_loader) // NULL if failed to restore from a snapshot.
+        zis_module_loader_destroy(z->module_loader, z);
     zis_context_globals_destroy(z->globals, z);
+    zis_exception_trace_buffer_destroy(z->exception_trace_buffer, z);
+    zis_coroutine_stack_pool_destroy(z->coroutine_stack_pool, z);
+    zis_stream_buf_pool_destroy(z->stream_buf_pool, z);
     zis_symbol_registry_destroy(z->symbol_registry, z);
     zis_callstack_destroy(z->callstack, z);
     zis_objmem_context_destroy(z->objmem_context);
     zis_mem_free(z);
 }
 
+void zis_context_reset(struct zis_context *z) {
+    zis_debug_log(INFO, "Context", "resetting context @%p", (void *)z);
+    zis_locals_root_reset(&z->locals_root);
+    zis_callstack_clear(z->callstack);
+    zis_module_loader_reset(z);
+    zis_objmem_gc(z, ZIS_OBJMEM_GC_FULL);
+}
+
 void zis_context_set_reg0(struct zis_context *z, struct zis_object *v) {
     z->callstack->frame[0] = v;
 }
@@ -3,14 +3,21 @@
 #pragma once
 
 #include "attributes.h"
+#include "fsutil.h" // zis_path_char_t
 #include "locals.h"
 
+struct zis_alloc_profiler;
 struct zis_callstack;
 struct zis_context;
 struct zis_context_globals;
+struct zis_coroutine_stack_pool;
+struct zis_exception_trace_buffer;
 struct zis_module_loader;
 struct zis_object;
 struct zis_objmem_context;
+struct zis_opstat;
+struct zis_profiler;
+struct zis_stream_buf_pool;
 struct zis_string_obj;
 struct zis_symbol_registry;
 
@@ -18,21 +25,36 @@ typedef void(*zis_context_panic_handler_t)(struct zis_context *, int);
 
 /// Runtime context.
 struct zis_context {
-    struct zis_objmem_context  *objmem_context;
-    struct zis_callstack       *callstack;
-    struct zis_symbol_registry *symbol_registry;
-    struct zis_context_globals *globals;
-    struct zis_module_loader   *module_loader;
-    struct zis_locals_root      locals_root;
-    zis_context_panic_handler_t panic_handler;
+    struct zis_objmem_context         *objmem_context;
+    struct zis_callstack              *callstack;
+    struct zis_symbol_registry        *symbol_registry;
+    struct zis_stream_buf_pool        *stream_buf_pool;
+    struct zis_coroutine_stack_pool   *coroutine_stack_pool;
+    struct zis_exception_trace_buffer *exception_trace_buffer;
+    struct zis_context_globals        *globals;
+    struct zis_module_loader          *module_loader;
+    struct zis_profiler               *profiler;
+    struct zis_alloc_profiler         *alloc_profiler;
+    struct zis_opstat                 *opstat; ///< Only with `ZIS_FEATURE_OPSTAT`.
+    struct zis_locals_root             locals_root;
+    zis_context_panic_handler_t        panic_handler;
 };
 
 /// Create a runtime context.
 zis_nodiscard struct zis_context *zis_context_create(void);
 
+/// Create a runtime context from a heap snapshot (see `zis_snapshot_save()`).
+/// Returns NULL if the snapshot file cannot be used.
+zis_nodiscard struct zis_context *zis_context_create_from_snapshot(const zis_path_char_t *file);
+
 /// Delete a runtime context.
 void zis_context_destroy(struct zis_context *z);
 
+/// Return a context to the state right after it was created: the modules loaded
+/// since then, the locals, and the callstack are dropped, and a full GC is run.
+/// The heap memory is kept for later use. Must not be called inside a native block.
+void zis_context_reset(struct zis_context *z);
+
 /// Store `v` to REG-0.
 void zis_context_set_reg0(struct zis_context *z, struct zis_object *v);
 
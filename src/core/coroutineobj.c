@@ -0,0 +1,351 @@
+#include "coroutineobj.h"
+
+#include <string.h>
+
+#include "context.h"
+#include "debug.h"
+#include "globals.h"
+#include "invoke.h"
+#include "locals.h"
+#include "memory.h"
+#include "ndefutil.h"
+#include "objmem.h"
+#include "stack.h"
+
+#include "exceptobj.h"
+#include "funcobj.h"
+#include "symbolobj.h"
+#include "tupleobj.h"
+
+/* ----- coroutine stack pool ----------------------------------------------- */
+
+/// Size of a coroutine stack. Smaller than the default main stack, as a coroutine
+/// function usually does not go deep.
+#define COROUTINE_STACK_SIZE  (sizeof(void *) * 508)
+/// Max number of free stacks kept in the pool.
+#define COROUTINE_STACK_POOL_MAX_FREE  8
+
+struct zis_coroutine_stack_pool {
+    struct zis_callstack *free_stacks[COROUTINE_STACK_POOL_MAX_FREE];
+    unsigned int free_count;
+    struct zis_coroutine_obj **owners; // Coroutines that hold stacks. Weak references.
+    size_t owner_count, owner_capacity;
+};
+
+/// Get a stack from the pool, or create one.
+static struct zis_callstack *coroutine_stack_pool_take(
+    struct zis_coroutine_stack_pool *restrict pool, struct zis_context *z
+) {
+    if (pool->free_count)
+        return pool->free_stacks[--pool->free_count];
+    return zis_callstack_create(z, COROUTINE_STACK_SIZE, false);
+}
+
+/// Return a stack to the pool.
+static void coroutine_stack_pool_give_back(
+    struct zis_coroutine_stack_pool *restrict pool, struct zis_context *z,
+    struct zis_callstack *stack
+) {
+    if (pool->free_count < COROUTINE_STACK_POOL_MAX_FREE) {
+        stack->resumer = NULL;
+        zis_callstack_clear(stack);
+        pool->free_stacks[pool->free_count++] = stack;
+        return;
+    }
+    zis_callstack_destroy(stack, z);
+}
+
+/// Record a coroutine that holds a stack.
+static void coroutine_stack_pool_add_owner(
+    struct zis_coroutine_stack_pool *restrict pool, struct zis_coroutine_obj *coroutine
+) {
+    assert(coroutine->_pool_index == (size_t)-1);
+    if (pool->owner_count == pool->owner_capacity) {
+        const size_t new_cap = pool->owner_capacity ? pool->owner_capacity * 2 : 8;
+        pool->owners = zis_mem_realloc(pool->owners, new_cap * sizeof pool->owners[0]);
+        pool->owner_capacity = new_cap;
+    }
+    coroutine->_pool_index = pool->owner_count;
+    pool->owners[pool->owner_count++] = coroutine;
+}
+
+/// Remove a coroutine recorded with `coroutine_stack_pool_add_owner()`.
+static void coroutine_stack_pool_remove_owner(
+    struct zis_coroutine_stack_pool *restrict pool, struct zis_coroutine_obj *coroutine
+) {
+    const size_t index = coroutine->_pool_index;
+    assert(index < pool->owner_count && pool->owners[index] == coroutine);
+    struct zis_coroutine_obj *const last = pool->owners[--pool->owner_count];
+    pool->owners[index] = last;
+    last->_pool_index = index;
+    coroutine->_pool_index = (size_t)-1;
+}
+
+/// Swap two owners.
+static void coroutine_stack_pool_swap_owners(
+    struct zis_coroutine_stack_pool *restrict pool, size_t i, size_t j
+) {
+    struct zis_coroutine_obj *const a = pool->owners[i], *const b = pool->owners[j];
+    pool->owners[i] = b, b->_pool_index = i;
+    pool->owners[j] = a, a->_pool_index = j;
+}
+
+/// GC objects visitor. See `zis_objmem_object_visitor_t`.
+/// The stacks are visited only for running coroutines and reachable suspended ones.
+static void coroutine_stack_pool_gc_visitor(void *_pool, enum zis_objmem_obj_visit_op op) {
+    struct zis_coroutine_stack_pool *const pool = _pool;
+
+    if (op == ZIS_OBJMEM_OBJ_VISIT_MOVE) {
+        for (size_t i = 0; i < pool->owner_count; i++)
+            zis_callstack_gc_visit(pool->owners[i]->_stack, op);
+        return;
+    }
+
+    // Owners whose stacks have been visited are moved to the front.
+    // A stack may refer to other coroutines, so repeat until nothing is found.
+    size_t visited_count = 0;
+    for (bool found = true; found; ) {
+        found = false;
+        for (size_t i = visited_count; i < pool->owner_count; i++) {
+            struct zis_coroutine_obj *const coroutine = pool->owners[i];
+            struct zis_callstack *const stack = coroutine->_stack;
+            if (!stack->resumer && !zis_objmem_object_is_marked(coroutine, op))
+                continue;
+            coroutine_stack_pool_swap_owners(pool, i, visited_count++);
+            zis_callstack_gc_visit(stack, op);
+            found = true;
+        }
+    }
+}
+
+static void coroutine_stack_pool_wr_visitor(void *_pool, enum zis_objmem_weak_ref_visit_op op) {
+    struct zis_coroutine_stack_pool *const pool = _pool;
+
+    for (size_t i = 0; i < pool->owner_count; ) {
+        struct zis_coroutine_obj *const coroutine = pool->owners[i];
+        bool dead = false;
+
+#define WEAK_REF_FINI(the_obj)  (dead = true)
+        zis_objmem_visit_weak_ref(pool->owners[i], op);
+#undef WEAK_REF_FINI
+
+        if (zis_unlikely(dead)) {
+            // A suspended coroutine that is no longer reachable. It will never be resumed.
+            struct zis_callstack *const stack = coroutine->_stack;
+            assert(stack && !stack->resumer);
+            zis_debug_log(TRACE, "Coroutine", "releasing stack of unreachable coroutine %p", (void *)coroutine);
+            coroutine_stack_pool_remove_owner(pool, coroutine);
+            coroutine_stack_pool_give_back(pool, stack->z, stack);
+            continue; // The last one has been moved to index `i`.
+        }
+        i++;
+    }
+}
+
+struct zis_coroutine_stack_pool *zis_coroutine_stack_pool_create(struct zis_context *z) {
+    struct zis_coroutine_stack_pool *const pool = zis_mem_alloc(sizeof(struct zis_coroutine_stack_pool));
+    memset(pool, 0, sizeof *pool);
+    zis_objmem_add_dependent_gc_root(z, pool, coroutine_stack_pool_gc_visitor);
+    zis_objmem_register_weak_ref_collection(z, pool, coroutine_stack_pool_wr_visitor);
+    return pool;
+}
+
+void zis_coroutine_stack_pool_destroy(struct zis_coroutine_stack_pool *pool, struct zis_context *z) {
+    zis_objmem_unregister_weak_ref_collection(z, pool);
+    zis_objmem_remove_dependent_gc_root(z, pool);
+    for (size_t i = 0; i < pool->owner_count; i++) {
+        struct zis_coroutine_obj *const coroutine = pool->owners[i];
+        zis_callstack_destroy(coroutine->_stack, z);
+        coroutine->_stack = NULL, coroutine->_pool_index = (size_t)-1;
+        coroutine->_state = ZIS_COROUTINE_OBJ_DEAD;
+    }
+    zis_mem_free(pool->owners);
+    for (unsigned int i = 0; i < pool->free_count; i++)
+        zis_callstack_destroy(pool->free_stacks[i], z);
+    zis_mem_free(pool);
+}
+
+/* ----- coroutine object --------------------------------------------------- */
+
+struct zis_coroutine_obj *zis_coroutine_obj_new(struct zis_context *z, struct zis_object *_func) {
+    zis_locals_decl_1(z, var, struct zis_object *func);
+    var.func = _func;
+    struct zis_object *const obj = zis_objmem_alloc(z, z->globals->type_Coroutine);
+    struct zis_coroutine_obj *const self = zis_object_cast(obj, struct zis_coroutine_obj);
+    self->_func = var.func;
+    zis_object_write_barrier(self, var.func);
+    zis_locals_drop(z, var);
+    self->_stack = NULL;
+    self->_pool_index = (size_t)-1;
+    self->_state = ZIS_COROUTINE_OBJ_SUSPENDED;
+    return self;
+}
+
+/// Check whether the current native function is allowed to suspend the invocation:
+/// the current stack is a running coroutine stack, and all the frames on it are of
+/// functions called from bytecode, except the first one (the coroutine function).
+static bool coroutine_stack_can_suspend(const struct zis_callstack *stack) {
+    if (!stack->resumer)
+        return false; // Not in a coroutine.
+    const struct zis_callstack_frame_info *fi = zis_callstack_frame_info(stack);
+    if (!fi->_next_node)
+        return false; // The coroutine function itself.
+    for (; fi->_next_node; fi = fi->_next_node) {
+        if (!fi->caller_ip)
+            return false; // Called from a C function, which cannot be suspended.
+    }
+    return true;
+}
+
+int zis_coroutine_obj_resume(struct zis_context *z, unsigned int self_reg, unsigned int args_reg) {
+    struct zis_coroutine_stack_pool *const pool = z->coroutine_stack_pool;
+    struct zis_callstack *const caller_stack = z->callstack;
+    struct zis_object **const caller_frame = caller_stack->frame;
+    assert(caller_frame + self_reg <= caller_stack->top && caller_frame + args_reg <= caller_stack->top);
+    assert(zis_object_type_is(caller_frame[self_reg], z->globals->type_Coroutine));
+    assert(zis_object_type_is(caller_frame[args_reg], z->globals->type_Tuple));
+    struct zis_coroutine_obj *self = zis_object_cast(caller_frame[self_reg], struct zis_coroutine_obj);
+    struct zis_tuple_obj *const args = zis_object_cast(caller_frame[args_reg], struct zis_tuple_obj);
+    const size_t argc = zis_tuple_obj_length(args);
+    struct zis_callstack *stack = self->_stack;
+    int status;
+
+    if (zis_unlikely(self->_state != ZIS_COROUTINE_OBJ_SUSPENDED)) {
+        caller_frame[0] = zis_object_from(zis_exception_obj_format(
+            z, "value", zis_object_from(self), "cannot resume a %s coroutine",
+            self->_state == ZIS_COROUTINE_OBJ_RUNNING ? "running" : "dead"
+        ));
+        return ZIS_THR;
+    }
+
+    if (!stack) {
+        // Start it. The function and the arguments go to the new stack.
+        stack = coroutine_stack_pool_take(pool, z);
+        self->_stack = stack;
+        self->_state = ZIS_COROUTINE_OBJ_RUNNING;
+        coroutine_stack_pool_add_owner(pool, self);
+        stack->resumer = caller_stack;
+        z->callstack = stack;
+        struct zis_func_obj *const func = zis_invoke_prepare_pa(
+            z, self->_func, NULL, caller_frame[args_reg], argc
+        );
+        self = zis_object_cast(caller_frame[self_reg], struct zis_coroutine_obj);
+        self->_func = zis_object_from(z->globals->val_nil);
+        status = func ? zis_invoke_func(z, func) : ZIS_THR;
+    } else {
+        // Continue it. The argument is returned by the `Coroutine.yield()` call.
+        if (zis_unlikely(argc > 1)) {
+            caller_frame[0] = zis_object_from(zis_exception_obj_format(
+                z, "value", caller_frame[args_reg], "too many values to pass to a suspended coroutine"
+            ));
+            return ZIS_THR;
+        }
+        self->_state = ZIS_COROUTINE_OBJ_RUNNING;
+        stack->resumer = caller_stack;
+        z->callstack = stack;
+        stack->frame[0] = argc ? zis_tuple_obj_get(args, 0) : zis_object_from(z->globals->val_nil);
+        status = zis_invoke_resume(z);
+    }
+
+    z->callstack = caller_stack;
+    stack->resumer = NULL;
+    self = zis_object_cast(caller_frame[self_reg], struct zis_coroutine_obj);
+    assert(self->_stack == stack);
+
+    if (status == ZIS_INVOKE_SUSPEND) {
+        // The value to yield is in REG-0 of the `Coroutine.yield()` frame.
+        self->_state = ZIS_COROUTINE_OBJ_SUSPENDED;
+        caller_frame[0] = stack->frame[0];
+        return ZIS_OK;
+    }
+
+    // Finished. The returned or thrown value is at the bottom of the stack.
+    assert(zis_callstack_empty(stack));
+    self->_state = ZIS_COROUTINE_OBJ_DEAD;
+    caller_frame[0] = stack->_data[0];
+    coroutine_stack_pool_remove_owner(pool, self);
+    coroutine_stack_pool_give_back(pool, z, stack);
+    self->_stack = NULL;
+    return status;
+}
+
+#define assert_arg1_Coroutine(__z) \
+    (assert(zis_object_type_is((__z)->callstack->frame[1], (__z)->globals->type_Coroutine)))
+
+ZIS_NATIVE_FUNC_DEF(T_Coroutine_M_resume, z, {1, -1, 2}) {
+    /*#DOCSTR# func Coroutine:resume(*args) :: Any
+    Starts or continues running the coroutine, until it yields or returns.
+    When starting it, `args` are passed to the function. When continuing it,
+    `args` can be empty or one value, which becomes the return value of
+    the `Coroutine.yield()` that suspended it. Returns the value passed to
+    `Coroutine.yield()` or returned by the function. Objects thrown by the
+    function are re-thrown. */
+    assert_arg1_Coroutine(z);
+    return zis_coroutine_obj_resume(z, 1, 2);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Coroutine_M_status, z, {1, 0, 1}) {
+    /*#DOCSTR# func Coroutine:status() :: Symbol
+    Returns `suspended` (also before started), `running`, or `dead`. */
+    assert_arg1_Coroutine(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_coroutine_obj *self = zis_object_cast(frame[1], struct zis_coroutine_obj);
+    const char *name;
+    switch (zis_coroutine_obj_state(self)) {
+    case ZIS_COROUTINE_OBJ_SUSPENDED:
+        name = "suspended";
+        break;
+    case ZIS_COROUTINE_OBJ_RUNNING:
+        name = "running";
+        break;
+    default:
+        name = "dead";
+        break;
+    }
+    frame[0] = zis_object_from(zis_symbol_registry_get(z, name, (size_t)-1));
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Coroutine_F_new, z, {1, 0, 1}) {
+    /*#DOCSTR# func Coroutine.new(fn :: Callable) :: Coroutine
+    Creates a coroutine that calls `fn` when it is resumed for the first time. */
+    struct zis_object **frame = z->callstack->frame;
+    frame[0] = zis_object_from(zis_coroutine_obj_new(z, frame[1]));
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Coroutine_F_yield, z, {0, 1, 1}) {
+    /*#DOCSTR# func Coroutine.yield(?value) :: Any
+    Suspends the running coroutine, making `Coroutine:resume()` return `value`.
+    Returns the value passed to the next `Coroutine:resume()`. Must be called
+    from a function in a coroutine, not through a native function. */
+    struct zis_callstack *const stack = z->callstack;
+    struct zis_object **frame = stack->frame;
+    if (zis_unlikely(!coroutine_stack_can_suspend(stack))) {
+        frame[0] = zis_object_from(zis_exception_obj_format(
+            z, "sys", NULL, "cannot yield %s",
+            stack->resumer ? "across a native function call" : "outside a coroutine"
+        ));
+        return ZIS_THR;
+    }
+    frame[0] = frame[1];
+    return ZIS_INVOKE_SUSPEND;
+}
+
+ZIS_NATIVE_FUNC_DEF_LIST(
+    T_Coroutine_D_methods,
+    { "resume"      , &T_Coroutine_M_resume    },
+    { "status"      , &T_Coroutine_M_status    },
+);
+
+ZIS_NATIVE_VAR_DEF_LIST(
+    T_Coroutine_D_statics,
+    { "new"         , { '^', .F = &T_Coroutine_F_new   } },
+    { "yield"       , { '^', .F = &T_Coroutine_F_yield } },
+);
+
+ZIS_NATIVE_TYPE_DEF(
+    Coroutine,
+    struct zis_coroutine_obj, _stack,
+    NULL, T_Coroutine_D_methods, T_Coroutine_D_statics
+);
@@ -0,0 +1,61 @@
+/// The `Coroutine` type.
+
+#pragma once
+
+#include "object.h"
+
+struct zis_callstack;
+struct zis_context;
+
+/* ----- coroutine stack pool ----------------------------------------------- */
+
+/// Coroutine stack pool. A coroutine runs on a call stack of its own, which is
+/// taken from the pool when the coroutine starts and is returned when it finishes.
+/// The stacks are not GC roots: a stack is traced only when its coroutine is running
+/// or reachable. Stacks of unreachable coroutines are returned to the pool by the GC.
+struct zis_coroutine_stack_pool;
+
+/// Create a coroutine stack pool.
+struct zis_coroutine_stack_pool *zis_coroutine_stack_pool_create(struct zis_context *z);
+
+/// Delete a coroutine stack pool, freeing all the stacks including the ones in use.
+void zis_coroutine_stack_pool_destroy(struct zis_coroutine_stack_pool *pool, struct zis_context *z);
+
+/* ----- coroutine object --------------------------------------------------- */
+
+/// Coroutine states.
+enum zis_coroutine_obj_state {
+    ZIS_COROUTINE_OBJ_SUSPENDED, ///< Not started yet, or suspended by `Coroutine.yield()`.
+    ZIS_COROUTINE_OBJ_RUNNING,   ///< Running, or resuming another coroutine.
+    ZIS_COROUTINE_OBJ_DEAD,      ///< Finished, by returning or throwing.
+};
+
+/// The `Coroutine` object.
+/// Its frames live on a call stack of its own (`_stack`); resuming or suspending
+/// a coroutine switches `zis_context::callstack` to the other stack.
+struct zis_coroutine_obj {
+    ZIS_OBJECT_HEAD
+    // --- SLOTS ---
+    struct zis_object *_func; // The function to call when started; nil after that.
+    // --- BYTES ---
+    struct zis_callstack *_stack; // NULL if not started or dead.
+    size_t _pool_index; // Index in the owner list of the stack pool, or -1.
+    int _state; // enum zis_coroutine_obj_state
+};
+
+/// Create a `Coroutine` object, which calls `func` when started.
+struct zis_coroutine_obj *zis_coroutine_obj_new(struct zis_context *z, struct zis_object *func);
+
+/// Get the state of a coroutine.
+zis_static_force_inline enum zis_coroutine_obj_state
+zis_coroutine_obj_state(const struct zis_coroutine_obj *self) {
+    return (enum zis_coroutine_obj_state)self->_state;
+}
+
+/// Start or continue running the coroutine in `REG-self_reg`, until it suspends or finishes.
+/// `REG-args_reg` shall be a `Tuple`. For the first run, the elements are passed to the
+/// function as arguments; otherwise, there shall be at most one element, which becomes
+/// the return value of the `Coroutine.yield()` call that suspended the coroutine.
+/// The value yielded or returned is stored to REG-0.
+/// Returns `ZIS_OK`; or `ZIS_THR` (exception in REG-0).
+int zis_coroutine_obj_resume(struct zis_context *z, unsigned int self_reg, unsigned int args_reg);
@@ -8,20 +8,6 @@
 
 #include "zis_config.h" // ZIS_ENVIRON_NAME_DEBUG_LOG
 
-#if ZIS_DEBUG
-
-#include <time.h>
-
-void zis_debug_time(struct timespec *tp) {
-#if ZIS_SYSTEM_POSIX || (defined(__MINGW32__) && !defined(_UCRT))
-    clock_gettime(CLOCK_MONOTONIC, tp);
-#else
-    timespec_get(tp, TIME_UTC);
-#endif
-}
-
-#endif // ZIS_DEBUG
-
 #if ZIS_DEBUG_LOGGING
 
 #include <stdarg.h>
@@ -7,15 +7,6 @@
 /// Initialize global debugging environment. It's safe to be called more than once.
 void zis_debug_try_init(void);
 
-#if ZIS_DEBUG
-
-struct timespec; // "time.h"
-
-/// Get current time from a high-resolution clock.
-void zis_debug_time(struct timespec *tp);
-
-#endif // ZIS_DEBUG
-
 #if ZIS_DEBUG_LOGGING
 
 #include <stdio.h>
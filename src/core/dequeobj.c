@@ -0,0 +1,401 @@
+#include "dequeobj.h"
+
+#include "context.h"
+#include "globals.h"
+#include "locals.h"
+#include "ndefutil.h"
+#include "objmem.h"
+#include "objvec.h"
+#include "stack.h"
+
+#include "arrayobj.h"
+#include "exceptobj.h"
+#include "stringobj.h"
+
+struct zis_deque_obj *zis_deque_obj_new(struct zis_context *z) {
+    struct zis_deque_obj *self = zis_object_cast(
+        zis_objmem_alloc(z, z->globals->type_Deque),
+        struct zis_deque_obj
+    );
+    self->_data = z->globals->val_empty_array_slots;
+    zis_object_assert_no_write_barrier_2(self, zis_object_from(self->_data));
+    self->_head = 0;
+    self->length = 0;
+    return self;
+}
+
+/// Double the capacity (or allocate the initial one), moving the elements
+/// to the beginning of the new ring.
+static void deque_obj_grow(
+    struct zis_context *z,
+    struct zis_deque_obj **self_p, struct zis_object **v_p
+) {
+    zis_locals_decl(z, var, struct zis_deque_obj *self; struct zis_object *v;);
+    var.self = *self_p, var.v = *v_p;
+    const size_t old_cap = zis_array_slots_obj_length(var.self->_data);
+    const size_t new_cap = old_cap ? old_cap * 2 : 8;
+    struct zis_array_slots_obj *const new_data = zis_array_slots_obj_new(z, NULL, new_cap);
+    struct zis_deque_obj *const self = var.self;
+    *self_p = self, *v_p = var.v;
+    zis_locals_drop(z, var);
+
+    struct zis_array_slots_obj *const old_data = self->_data;
+    const size_t len = self->length, head = self->_head;
+    assert(len == old_cap);
+    if (len) {
+        const size_t n1 = old_cap - head, n2 = len - n1;
+        zis_object_vec_copy(new_data->_data, old_data->_data + head, n1);
+        zis_object_vec_copy(new_data->_data + n1, old_data->_data, n2);
+        zis_object_write_barrier_n(new_data, new_data->_data, len);
+    }
+    self->_data = new_data;
+    self->_head = 0;
+    zis_object_write_barrier(self, new_data);
+}
+
+void zis_deque_obj_push_back(
+    struct zis_context *z,
+    struct zis_deque_obj *self, struct zis_object *v
+) {
+    if (zis_unlikely(self->length == zis_array_slots_obj_length(self->_data)))
+        deque_obj_grow(z, &self, &v);
+    const size_t i = self->length++;
+    zis_deque_obj_set(self, i, v);
+}
+
+void zis_deque_obj_push_front(
+    struct zis_context *z,
+    struct zis_deque_obj *self, struct zis_object *v
+) {
+    if (zis_unlikely(self->length == zis_array_slots_obj_length(self->_data)))
+        deque_obj_grow(z, &self, &v);
+    const size_t cap = zis_array_slots_obj_length(self->_data);
+    self->_head = (self->_head - 1) & (cap - 1);
+    self->length++;
+    zis_deque_obj_set(self, 0, v);
+}
+
+struct zis_object *zis_deque_obj_pop_back(struct zis_deque_obj *self) {
+    if (zis_unlikely(!self->length))
+        return NULL; // empty
+    const size_t slot = _zis_deque_obj_slot_index(self, self->length - 1);
+    struct zis_object **const p = self->_data->_data + slot;
+    struct zis_object *const elem = *p;
+    *p = zis_smallint_to_ptr(0);
+    self->length--;
+    return elem;
+}
+
+struct zis_object *zis_deque_obj_pop_front(struct zis_deque_obj *self) {
+    if (zis_unlikely(!self->length))
+        return NULL; // empty
+    const size_t slot = self->_head;
+    struct zis_object **const p = self->_data->_data + slot;
+    struct zis_object *const elem = *p;
+    *p = zis_smallint_to_ptr(0);
+    self->_head = (slot + 1) & (zis_array_slots_obj_length(self->_data) - 1);
+    self->length--;
+    return elem;
+}
+
+void zis_deque_obj_clear(struct zis_deque_obj *self) {
+    zis_object_vec_zero(self->_data->_data, zis_array_slots_obj_length(self->_data));
+    self->_head = 0;
+    self->length = 0;
+}
+
+#define assert_arg1_Deque(__z) \
+    (assert(zis_object_type_is((__z)->callstack->frame[1], (__z)->globals->type_Deque)))
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_operator_get_elem, z, {2, 0, 2}) {
+    /*#DOCSTR# func Deque:\'[]'(index :: Int) :: Any
+    Gets an element by index. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_context_globals *g = z->globals;
+
+    struct zis_object *result;
+    struct zis_deque_obj *self = zis_object_cast(frame[1], struct zis_deque_obj);
+    if (zis_object_is_smallint(frame[2])) {
+        const size_t index = zis_object_index_convert(
+            zis_deque_obj_length(self),
+            zis_smallint_from_ptr(frame[2])
+        );
+        if (zis_unlikely(index == (size_t)-1))
+            goto thr_index_out_of_range;
+        result = zis_deque_obj_get(self, index);
+    } else if (zis_object_type(frame[2]) == g->type_Int) {
+    thr_index_out_of_range:
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_INDEX_OUT_OF_RANGE, frame[2]
+        ));
+        return ZIS_THR;
+    } else {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_UNSUPPORTED_OPERATION_SUBS,
+            "[]", frame[1], frame[2]
+        ));
+        return ZIS_THR;
+    }
+
+    frame[0] = result;
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_operator_set_elem, z, {3, 0, 3}) {
+    /*#DOCSTR# func Deque:\'[]='(index :: Int, value :: Any)
+    Sets an element by index. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_context_globals *g = z->globals;
+
+    struct zis_deque_obj *self = zis_object_cast(frame[1], struct zis_deque_obj);
+    if (zis_object_is_smallint(frame[2])) {
+        const size_t index = zis_object_index_convert(
+            zis_deque_obj_length(self),
+            zis_smallint_from_ptr(frame[2])
+        );
+        if (zis_unlikely(index == (size_t)-1))
+            goto thr_index_out_of_range;
+        zis_deque_obj_set(self, index, frame[3]);
+    } else if (zis_object_type(frame[2]) == g->type_Int) {
+    thr_index_out_of_range:
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_INDEX_OUT_OF_RANGE, frame[2]
+        ));
+        return ZIS_THR;
+    } else {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_UNSUPPORTED_OPERATION_SUBS,
+            "[]=", frame[1], frame[2]
+        ));
+        return ZIS_THR;
+    }
+
+    frame[0] = frame[3];
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_operator_equ, z, {2, 0, 2}) {
+    /*#DOCSTR# func Deque:\'=='(other :: Deque) :: Bool
+    Operator ==. */
+    assert_arg1_Deque(z);
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+
+    bool equals;
+    if (zis_unlikely(!zis_object_type_is(frame[2], g->type_Deque))) {
+        equals = false;
+    } else if (
+        zis_deque_obj_length(zis_object_cast(frame[1], struct zis_deque_obj)) !=
+        zis_deque_obj_length(zis_object_cast(frame[2], struct zis_deque_obj))
+    ) {
+        equals = false;
+    } else {
+        for (size_t i = 0; ; i++) {
+            struct zis_deque_obj *lhs = zis_object_cast(frame[1], struct zis_deque_obj);
+            struct zis_object *lhs_elem = zis_deque_obj_get_checked(lhs, i);
+            struct zis_deque_obj *rhs = zis_object_cast(frame[2], struct zis_deque_obj);
+            struct zis_object *rhs_elem = zis_deque_obj_get_checked(rhs, i);
+            if (!lhs_elem) {
+                equals = rhs_elem ? false : true;
+                break;
+            } else if (!rhs_elem) {
+                equals = false;
+                break;
+            }
+            equals = zis_object_equals(z, lhs_elem, rhs_elem);
+            if (!equals)
+                break;
+        }
+    }
+
+    frame[0] = zis_object_from(equals ? g->val_true : g->val_false);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_length, z, {1, 0, 1}) {
+    /*#DOCSTR# func Deque:length() :: Int
+    Returns the total number of elements. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_deque_obj *self = zis_object_cast(frame[1], struct zis_deque_obj);
+    const size_t len = zis_deque_obj_length(self);
+    assert(len <= ZIS_SMALLINT_MAX);
+    frame[0] = zis_smallint_to_ptr((zis_smallint_t)len);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_to_string, z, {1, 1, 4}) {
+    /*#DOCSTR# func Deque:to_string(?fmt) :: String
+    Returns string representation for this deque. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    struct zis_string_builder_obj **str_builder_p = (struct zis_string_builder_obj **)(frame + 3);
+    struct zis_string_obj **comma_str_p = (struct zis_string_obj **)(frame + 4);
+    *str_builder_p = zis_string_builder_obj_new(z);
+    *comma_str_p = zis_string_obj_new(z, "Deque[", 6);
+    zis_string_builder_obj_append(z, *str_builder_p, *comma_str_p);
+    *comma_str_p = zis_string_obj_new(z, ", ", 2);
+
+    for (size_t i = 0; ; i++) {
+        struct zis_deque_obj *deque = zis_object_cast(frame[1], struct zis_deque_obj);
+        if (i >= zis_deque_obj_length(deque))
+            break;
+        if (i)
+            zis_string_builder_obj_append(z, *str_builder_p, *comma_str_p);
+        struct zis_string_obj *item_str = zis_object_to_string(z, zis_deque_obj_get(deque, i), true, NULL);
+        zis_string_builder_obj_append(z, *str_builder_p, item_str);
+    }
+    zis_string_builder_obj_append_char(z, *str_builder_p, ']');
+
+    assert(zis_object_type_is(zis_object_from(*str_builder_p), z->globals->type_String_Builder));
+    frame[0] = zis_object_from(zis_string_builder_obj_string(z, *str_builder_p));
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_to_array, z, {1, 0, 2}) {
+    /*#DOCSTR# func Deque:to_array() :: Array
+    Returns an array of the elements from the first to the last. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    const size_t n = zis_deque_obj_length(zis_object_cast(frame[1], struct zis_deque_obj));
+    struct zis_array_obj *const array = zis_array_obj_new(z, NULL, n);
+    struct zis_deque_obj *const self = zis_object_cast(frame[1], struct zis_deque_obj);
+    assert(zis_deque_obj_length(self) == n);
+    for (size_t i = 0; i < n; i++)
+        zis_array_obj_set(array, i, zis_deque_obj_get(self, i));
+    frame[0] = zis_object_from(array);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_push_back, z, {2, 0, 2}) {
+    /*#DOCSTR# func Deque:push_back(value :: Any)
+    Inserts an element to the end. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_deque_obj *self = zis_object_cast(frame[1], struct zis_deque_obj);
+    zis_deque_obj_push_back(z, self, frame[2]);
+    frame[0] = zis_object_from(z->globals->val_nil);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_push_front, z, {2, 0, 2}) {
+    /*#DOCSTR# func Deque:push_front(value :: Any)
+    Inserts an element to the beginning. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_deque_obj *self = zis_object_cast(frame[1], struct zis_deque_obj);
+    zis_deque_obj_push_front(z, self, frame[2]);
+    frame[0] = zis_object_from(z->globals->val_nil);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_pop_back, z, {1, 0, 1}) {
+    /*#DOCSTR# func Deque:pop_back() :: Any
+    Deletes and returns the last element. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_deque_obj *self = zis_object_cast(frame[1], struct zis_deque_obj);
+    struct zis_object *value = zis_deque_obj_pop_back(self);
+    if (!value) {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_INDEX_OUT_OF_RANGE, zis_smallint_to_ptr(-1)
+        ));
+        return ZIS_THR;
+    }
+    frame[0] = value;
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_pop_front, z, {1, 0, 1}) {
+    /*#DOCSTR# func Deque:pop_front() :: Any
+    Deletes and returns the first element. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_deque_obj *self = zis_object_cast(frame[1], struct zis_deque_obj);
+    struct zis_object *value = zis_deque_obj_pop_front(self);
+    if (!value) {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_INDEX_OUT_OF_RANGE, zis_smallint_to_ptr(1)
+        ));
+        return ZIS_THR;
+    }
+    frame[0] = value;
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_M_clear, z, {1, 0, 1}) {
+    /*#DOCSTR# func Deque:clear()
+    Deletes all elements. */
+    assert_arg1_Deque(z);
+    struct zis_object **frame = z->callstack->frame;
+    zis_deque_obj_clear(zis_object_cast(frame[1], struct zis_deque_obj));
+    frame[0] = zis_object_from(z->globals->val_nil);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Deque_F_new, z, {0, 1, 3}) {
+    /*#DOCSTR# func Deque.new(?values :: Array) :: Deque
+    Creates a deque, empty or holding the given values. */
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+
+    size_t n = 0;
+    if (frame[1] != zis_object_from(g->val_nil)) {
+        if (zis_unlikely(!zis_object_type_is(frame[1], g->type_Array))) {
+            frame[0] = zis_object_from(zis_exception_obj_format_common(
+                z, ZIS_EXC_FMT_WRONG_ARGUMENT_TYPE, "values", frame[1]
+            ));
+            return ZIS_THR;
+        }
+        n = zis_array_obj_length(zis_object_cast(frame[1], struct zis_array_obj));
+    }
+
+    frame[2] = zis_object_from(zis_deque_obj_new(z));
+    if (n) {
+        size_t cap = 8;
+        while (cap < n)
+            cap *= 2;
+        frame[3] = zis_object_from(zis_array_slots_obj_new(z, NULL, cap));
+        struct zis_array_slots_obj *const data = zis_object_cast(frame[3], struct zis_array_slots_obj);
+        struct zis_array_obj *const values = zis_object_cast(frame[1], struct zis_array_obj);
+        assert(zis_array_obj_length(values) == n);
+        zis_object_vec_copy(data->_data, values->_data->_data, n);
+        zis_object_write_barrier_n(data, data->_data, n);
+        struct zis_deque_obj *const self = zis_object_cast(frame[2], struct zis_deque_obj);
+        self->_data = data;
+        self->length = n;
+        zis_object_write_barrier(self, data);
+    }
+    frame[0] = frame[2];
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF_LIST(
+    T_Deque_D_methods,
+    { "[]"          , &T_Deque_M_operator_get_elem },
+    { "[]="         , &T_Deque_M_operator_set_elem },
+    { "=="          , &T_Deque_M_operator_equ      },
+    { "length"      , &T_Deque_M_length            },
+    { "to_string"   , &T_Deque_M_to_string         },
+    { "to_array"    , &T_Deque_M_to_array          },
+    { "push_back"   , &T_Deque_M_push_back         },
+    { "push_front"  , &T_Deque_M_push_front        },
+    { "pop_back"    , &T_Deque_M_pop_back          },
+    { "pop_front"   , &T_Deque_M_pop_front         },
+    { "clear"       , &T_Deque_M_clear             },
+);
+
+ZIS_NATIVE_VAR_DEF_LIST(
+    T_Deque_D_statics,
+    { "new"         , { '^', .F = &T_Deque_F_new } },
+);
+
+ZIS_NATIVE_TYPE_DEF(
+    Deque,
+    struct zis_deque_obj, _head,
+    NULL, T_Deque_D_methods, T_Deque_D_statics
+);
@@ -0,0 +1,79 @@
+/// The `Deque` type.
+
+#pragma once
+
+#include "arrayobj.h"
+#include "attributes.h"
+#include "object.h"
+
+struct zis_context;
+
+/// `Deque` object. Double-ended queue, a ring buffer of objects.
+struct zis_deque_obj {
+    ZIS_OBJECT_HEAD
+    // --- SLOTS ---
+    struct zis_array_slots_obj *_data; ///< The ring. Its length is 0 or a power of 2.
+    // --- BYTES ---
+    size_t _head; ///< Index of the first element in `_data`.
+    size_t length;
+};
+
+/// Create an empty `Deque` object.
+struct zis_deque_obj *zis_deque_obj_new(struct zis_context *z);
+
+/// Return number of elements.
+zis_static_force_inline size_t zis_deque_obj_length(const struct zis_deque_obj *self) {
+    return self->length;
+}
+
+zis_static_force_inline size_t _zis_deque_obj_slot_index(const struct zis_deque_obj *self, size_t i) {
+    const size_t cap = zis_array_slots_obj_length(self->_data);
+    assert(cap && !(cap & (cap - 1)));
+    return (self->_head + i) & (cap - 1);
+}
+
+/// Get element without bounds checking.
+zis_static_force_inline struct zis_object *zis_deque_obj_get(
+    const struct zis_deque_obj *self, size_t i
+) {
+    assert(i < self->length);
+    return zis_array_slots_obj_get(self->_data, _zis_deque_obj_slot_index(self, i));
+}
+
+/// Get element with bounds checking. Return NULL if `i` is out of range.
+zis_static_force_inline zis_nodiscard struct zis_object *zis_deque_obj_get_checked(
+    const struct zis_deque_obj *self, size_t i
+) {
+    if (zis_unlikely(i >= self->length))
+        return NULL;
+    return zis_array_slots_obj_get(self->_data, _zis_deque_obj_slot_index(self, i));
+}
+
+/// Set element without bounds checking.
+zis_static_force_inline void zis_deque_obj_set(
+    struct zis_deque_obj *self, size_t i, struct zis_object *v
+) {
+    assert(i < self->length);
+    zis_array_slots_obj_set(self->_data, _zis_deque_obj_slot_index(self, i), v);
+}
+
+/// Add an element to the end. Amortized O(1).
+void zis_deque_obj_push_back(
+    struct zis_context *z,
+    struct zis_deque_obj *self, struct zis_object *v
+);
+
+/// Add an element to the beginning. Amortized O(1).
+void zis_deque_obj_push_front(
+    struct zis_context *z,
+    struct zis_deque_obj *self, struct zis_object *v
+);
+
+/// Remove and return the last element. Return NULL if the deque is empty.
+struct zis_object *zis_deque_obj_pop_back(struct zis_deque_obj *self);
+
+/// Remove and return the first element. Return NULL if the deque is empty.
+struct zis_object *zis_deque_obj_pop_front(struct zis_deque_obj *self);
+
+/// Delete all elements.
+void zis_deque_obj_clear(struct zis_deque_obj *self);
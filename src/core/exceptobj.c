@@ -6,6 +6,7 @@
 #include "context.h"
 #include "globals.h"
 #include "locals.h"
+#include "memory.h"
 #include "ndefutil.h"
 #include "objmem.h"
 
@@ -15,6 +16,194 @@
 #include "stringobj.h"
 #include "symbolobj.h"
 
+/* ----- stack trace buffer ------------------------------------------------- */
+
+/// Max number of exceptions that can have records in the buffer at the same time.
+/// When exceeded, the records of the oldest one are moved into the exception.
+#define EXC_TRACE_BUFFER_MAX_RECORDS  16
+
+struct exc_trace_frame {
+    struct zis_object *func; // zis_func_obj
+    unsigned int ip_offset;
+};
+
+struct exc_trace_record {
+    struct zis_object *exc; // zis_exception_obj; weak reference
+    struct exc_trace_frame *frames;
+    size_t frame_count, frame_capacity;
+};
+
+struct zis_exception_trace_buffer {
+    struct exc_trace_record records[EXC_TRACE_BUFFER_MAX_RECORDS]; // Oldest first.
+    unsigned int record_count;
+};
+
+/// Find the record of an exception. Returns -1 if not found.
+static int exc_trace_buffer_find(
+    const struct zis_exception_trace_buffer *restrict buf,
+    const struct zis_exception_obj *exc
+) {
+    // The exception being thrown is usually the latest one.
+    for (unsigned int i = buf->record_count; i > 0; i--) {
+        if (buf->records[i - 1].exc == zis_object_from(exc))
+            return (int)(i - 1);
+    }
+    return -1;
+}
+
+/// Remove a record. The frame storage is kept for reuse.
+static void exc_trace_buffer_remove(
+    struct zis_exception_trace_buffer *restrict buf, unsigned int index
+) {
+    assert(index < buf->record_count);
+    struct exc_trace_record removed = buf->records[index];
+    const unsigned int last_index = buf->record_count - 1;
+    memmove(
+        buf->records + index, buf->records + index + 1,
+        (last_index - index) * sizeof buf->records[0]
+    );
+    removed.exc = NULL;
+    removed.frame_count = 0;
+    buf->records[last_index] = removed;
+    buf->record_count = last_index;
+}
+
+/// Move the buffered frames of `exc` into its `_stack_trace` array.
+/// Returns the array, or NULL if there is no stack trace.
+static struct zis_array_obj *exc_trace_buffer_flush_one(
+    struct zis_context *z, struct zis_exception_obj *exc
+) {
+    struct zis_exception_trace_buffer *const buf = z->exception_trace_buffer;
+    int index = exc_trace_buffer_find(buf, exc);
+    if (index < 0) {
+        if (!zis_object_type_is(exc->_stack_trace, z->globals->type_Array))
+            return NULL;
+        return zis_object_cast(exc->_stack_trace, struct zis_array_obj);
+    }
+
+    zis_locals_decl(
+        z, var,
+        struct zis_exception_obj *exc;
+        struct zis_array_obj *stack_trace;
+    );
+    zis_locals_zero(var);
+    var.exc = exc;
+
+    const size_t n = buf->records[index].frame_count;
+    if (zis_object_type_is(var.exc->_stack_trace, z->globals->type_Array)) {
+        var.stack_trace = zis_object_cast(var.exc->_stack_trace, struct zis_array_obj);
+        zis_array_obj_reserve(z, var.stack_trace, zis_array_obj_length(var.stack_trace) + n * 2);
+    } else {
+        struct zis_array_obj *const x = zis_array_obj_new2(z, n * 2, NULL, 0);
+        var.stack_trace = x;
+        var.exc->_stack_trace = zis_object_from(x);
+        zis_object_write_barrier(var.exc, x);
+    }
+
+    // The GC may have run and removed other records.
+    index = exc_trace_buffer_find(buf, var.exc);
+    assert(index >= 0);
+    const struct exc_trace_record *const rec = &buf->records[index];
+    assert(rec->frame_count == n);
+    // Slots have been reserved, so the appending does not allocate.
+    for (size_t i = 0; i < n; i++) {
+        const struct exc_trace_frame *const frame = &rec->frames[i];
+        zis_array_obj_append(z, var.stack_trace, frame->func);
+        zis_array_obj_append(z, var.stack_trace, zis_smallint_to_ptr((zis_smallint_t)frame->ip_offset));
+    }
+    exc_trace_buffer_remove(buf, (unsigned int)index);
+
+    zis_locals_drop(z, var);
+    return var.stack_trace;
+}
+
+/// Append a frame to the record of `exc`.
+static void exc_trace_buffer_append(
+    struct zis_context *z, struct zis_exception_obj *exc,
+    struct zis_func_obj *func, unsigned int ip_offset
+) {
+    struct zis_exception_trace_buffer *const buf = z->exception_trace_buffer;
+    int index = exc_trace_buffer_find(buf, exc);
+    if (index < 0) {
+        if (zis_unlikely(buf->record_count == EXC_TRACE_BUFFER_MAX_RECORDS)) {
+            zis_locals_decl(
+                z, var,
+                struct zis_exception_obj *exc;
+                struct zis_func_obj *func;
+            );
+            var.exc = exc, var.func = func;
+            exc_trace_buffer_flush_one(z, zis_object_cast(buf->records[0].exc, struct zis_exception_obj));
+            exc = var.exc, func = var.func;
+            zis_locals_drop(z, var);
+        }
+        assert(buf->record_count < EXC_TRACE_BUFFER_MAX_RECORDS);
+        index = (int)buf->record_count++;
+        buf->records[index].exc = zis_object_from(exc);
+        assert(buf->records[index].frame_count == 0);
+    }
+
+    struct exc_trace_record *const rec = &buf->records[index];
+    if (zis_unlikely(rec->frame_count == rec->frame_capacity)) {
+        const size_t new_cap = rec->frame_capacity ? rec->frame_capacity * 2 : 16;
+        rec->frames = zis_mem_realloc(rec->frames, new_cap * sizeof rec->frames[0]);
+        rec->frame_capacity = new_cap;
+    }
+    struct exc_trace_frame *const frame = &rec->frames[rec->frame_count++];
+    frame->func = zis_object_from(func);
+    frame->ip_offset = ip_offset;
+}
+
+static void exc_trace_buffer_gc_visitor(void *_buf, enum zis_objmem_obj_visit_op op) {
+    struct zis_exception_trace_buffer *const buf = _buf;
+    for (unsigned int i = 0; i < buf->record_count; i++) {
+        struct exc_trace_record *const rec = &buf->records[i];
+        for (size_t j = 0; j < rec->frame_count; j++)
+            zis_objmem_visit_object(rec->frames[j].func, op);
+    }
+}
+
+static void exc_trace_buffer_wr_visitor(void *_buf, enum zis_objmem_weak_ref_visit_op op) {
+    struct zis_exception_trace_buffer *const buf = _buf;
+    for (unsigned int i = 0; i < buf->record_count; ) {
+        bool dead = false;
+
+#define WEAK_REF_FINI(the_obj)  (dead = true)
+        zis_objmem_visit_weak_ref(buf->records[i].exc, op);
+#undef WEAK_REF_FINI
+
+        if (dead) {
+            exc_trace_buffer_remove(buf, i);
+            continue; // The next one has been moved to index `i`.
+        }
+        i++;
+    }
+}
+
+struct zis_exception_trace_buffer *zis_exception_trace_buffer_create(struct zis_context *z) {
+    struct zis_exception_trace_buffer *const buf =
+        zis_mem_alloc(sizeof(struct zis_exception_trace_buffer));
+    memset(buf, 0, sizeof *buf);
+    zis_objmem_add_gc_root(z, buf, exc_trace_buffer_gc_visitor);
+    zis_objmem_register_weak_ref_collection(z, buf, exc_trace_buffer_wr_visitor);
+    return buf;
+}
+
+void zis_exception_trace_buffer_destroy(struct zis_exception_trace_buffer *buf, struct zis_context *z) {
+    zis_objmem_unregister_weak_ref_collection(z, buf);
+    zis_objmem_remove_gc_root(z, buf);
+    for (unsigned int i = 0; i < EXC_TRACE_BUFFER_MAX_RECORDS; i++)
+        zis_mem_free(buf->records[i].frames);
+    zis_mem_free(buf);
+}
+
+void zis_exception_trace_buffer_flush(struct zis_context *z) {
+    struct zis_exception_trace_buffer *const buf = z->exception_trace_buffer;
+    while (buf->record_count)
+        exc_trace_buffer_flush_one(z, zis_object_cast(buf->records[0].exc, struct zis_exception_obj));
+}
+
+/* ----- exception object --------------------------------------------------- */
+
 struct zis_exception_obj *zis_exception_obj_new(
     struct zis_context *z,
     struct zis_object *type, struct zis_object *what, struct zis_object *data
@@ -230,38 +419,23 @@ void zis_exception_obj_stack_trace(
     else
         ip_offset = (unsigned int)((zis_func_obj_bytecode_word_t *)ip - func_p);
 
-    zis_locals_decl(
-        z, var,
-        struct zis_exception_obj *self;
-        struct zis_array_obj *stack_trace;
-        struct zis_func_obj *func_obj;
-    );
-    var.self = self;
-    var.stack_trace = zis_object_cast(self->_stack_trace, struct zis_array_obj);
-    var.func_obj = func_obj;
-
-    if (!zis_object_type_is(self->_stack_trace, z->globals->type_Array)) {
-        struct zis_array_obj *x = zis_array_obj_new(z, NULL, 0);
-        var.stack_trace = x;
-        var.self->_stack_trace = zis_object_from(x);
-        zis_object_write_barrier(var.self, x);
-    }
-
-    zis_array_obj_append(z, var.stack_trace, zis_object_from(var.func_obj));
-    zis_array_obj_append(z, var.stack_trace, zis_smallint_to_ptr((zis_smallint_t)ip_offset));
-
-    zis_locals_drop(z, var);
+    exc_trace_buffer_append(z, self, func_obj, ip_offset);
 }
 
 size_t zis_exception_obj_stack_trace_length(
     struct zis_context *z, const struct zis_exception_obj *self
 ) {
-    if (!zis_object_type_is(self->_stack_trace, z->globals->type_Array))
-        return 0;
-    const size_t n =
-        zis_array_obj_length(zis_object_cast(self->_stack_trace, struct zis_array_obj));
-    assert(!(n & 1));
-    return n / 2;
+    size_t n = 0;
+    if (zis_object_type_is(self->_stack_trace, z->globals->type_Array)) {
+        n = zis_array_obj_length(zis_object_cast(self->_stack_trace, struct zis_array_obj));
+        assert(!(n & 1));
+        n /= 2;
+    }
+    const struct zis_exception_trace_buffer *const buf = z->exception_trace_buffer;
+    const int index = exc_trace_buffer_find(buf, self);
+    if (index >= 0)
+        n += buf->records[index].frame_count;
+    return n;
 }
 
 int zis_exception_obj_walk_stack_trace(
@@ -273,9 +447,10 @@ int zis_exception_obj_walk_stack_trace(
     if (!n)
         return 0;
 
-    assert(zis_object_type_is(self->_stack_trace, z->globals->type_Array));
     zis_locals_decl_1(z, var, struct zis_array_obj *stack_trace);
-    var.stack_trace = zis_object_cast(self->_stack_trace, struct zis_array_obj);
+    zis_locals_zero_1(var, stack_trace);
+    var.stack_trace = exc_trace_buffer_flush_one(z, self);
+    assert(var.stack_trace && zis_array_obj_length(var.stack_trace) == n * 2);
 
     int fn_ret = 0;
     for (unsigned int i = 0; i < n; i++) {
@@ -319,9 +494,13 @@ static int _print_stack_trace_fn(
         strcpy(buffer, "??");
     } while (0);
     fputs(buffer, stdout);
-    snprintf(buffer, sizeof buffer, " (+%u)\n", instr_offset);
+    const unsigned int line = zis_func_obj_line_number(z, func_obj, instr_offset);
+    if (line)
+        snprintf(buffer, sizeof buffer, " (+%u, line %u)\n", instr_offset, line);
+    else
+        snprintf(buffer, sizeof buffer, " (+%u)\n", instr_offset);
     fputs(buffer, stdout);
-    // TODO: print source location.
+    // TODO: print source file.
     // TODO: print to the `out_stream`.
     return 0;
 }
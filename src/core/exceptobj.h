@@ -11,6 +11,25 @@ struct zis_context;
 struct zis_func_obj;
 struct zis_stream_obj;
 
+/* ----- stack trace buffer ------------------------------------------------- */
+
+/// Stack trace buffer. While an exception propagates, the unwound frames are
+/// recorded here as raw (function, instruction offset) pairs instead of in an
+/// `Array` of the exception, which is created only when the trace is read.
+/// Records of unreachable exceptions are dropped by the GC.
+struct zis_exception_trace_buffer;
+
+/// Create a stack trace buffer.
+struct zis_exception_trace_buffer *zis_exception_trace_buffer_create(struct zis_context *z);
+
+/// Delete a stack trace buffer.
+void zis_exception_trace_buffer_destroy(struct zis_exception_trace_buffer *buf, struct zis_context *z);
+
+/// Move all the buffered records into the exceptions they belong to.
+void zis_exception_trace_buffer_flush(struct zis_context *z);
+
+/* ----- exception object --------------------------------------------------- */
+
 /// `Exception` object.
 struct zis_exception_obj {
     ZIS_OBJECT_HEAD
@@ -18,7 +37,7 @@ struct zis_exception_obj {
     struct zis_object *type; ///< Exception type.
     struct zis_object *what; ///< Message.
     struct zis_object *data; ///< Exception data.
-    struct zis_object *_stack_trace; // nil or zis_array_obj{ func1, ip_off1, func2, ip_off2, ... }
+    struct zis_object *_stack_trace; // nil or zis_array_obj{ func1, ip_off1, func2, ip_off2, ... }; see `struct zis_exception_trace_buffer`
 };
 
 /// Create an `Exception` object. `type`, `what`, and `data` are all optional.
@@ -14,6 +14,7 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 
@@ -465,9 +466,9 @@ zis_nodiscard zis_file_handle_t zis_file_open(const zis_path_char_t *path, int m
         if (mode & ZIS_FILE_MODE_RD)
             o_mode = O_RDWR;
         else if (mode & ZIS_FILE_MODE_APP)
-            o_mode = O_WRONLY;
+            o_mode = O_WRONLY | O_APPEND;
         else
-            o_mode = O_WRONLY | O_CREAT, create_mode = S_IRUSR | S_IWUSR;
+            o_mode = O_WRONLY | O_CREAT | O_TRUNC, create_mode = S_IRUSR | S_IWUSR;
     } else {
         o_mode = O_RDONLY;
     }
@@ -486,13 +487,14 @@ zis_nodiscard zis_file_handle_t zis_file_open(const zis_path_char_t *path, int m
         access, //dwDesiredAccess
         FILE_SHARE_READ | FILE_SHARE_WRITE, //dwShareMode
         NULL, //lpSecurityAttributes
-        (mode & ZIS_FILE_MODE_APP) ? OPEN_EXISTING : OPEN_ALWAYS, //dwCreationDisposition
+        !(mode & ZIS_FILE_MODE_WR) ? OPEN_EXISTING :
+        (mode & (ZIS_FILE_MODE_RD | ZIS_FILE_MODE_APP)) ? OPEN_ALWAYS : CREATE_ALWAYS, //dwCreationDisposition
         FILE_ATTRIBUTE_NORMAL, //dwFlagsAndAttributes
         NULL //hTemplateFile
     );
     if (h == INVALID_HANDLE_VALUE)
         return NULL;
-    if (mode == 2)
+    if (mode & ZIS_FILE_MODE_APP)
         SetFilePointer(h, 0, NULL, FILE_END);
     return (void *)h;
 
@@ -553,19 +555,20 @@ zis_ssize_t zis_file_seek(zis_file_handle_t f, zis_ssize_t offset, int whence) {
 #elif ZIS_FS_WINDOWS
 
     HANDLE h = (HANDLE)f;
-    LONG pos = 0;
+    LARGE_INTEGER distance, pos;
+    distance.QuadPart = offset;
     static_assert(FILE_BEGIN == SEEK_SET, "");
     static_assert(FILE_CURRENT == SEEK_CUR, "");
     static_assert(FILE_END == SEEK_END, "");
-    const BOOL ok = SetFilePointer(
+    const BOOL ok = SetFilePointerEx(
         h, // hFile
-        (LONG)offset, // liDistanceToMove
+        distance, // liDistanceToMove
         &pos, // lpNewFilePointer
-        whence  // dwMoveMethod
+        (DWORD)whence  // dwMoveMethod
     );
     if (!ok)
         return -1;
-    return (zis_ssize_t)pos;
+    return (zis_ssize_t)pos.QuadPart;
 
 #endif
 }
@@ -643,3 +646,62 @@ int zis_file_write(zis_file_handle_t f, const char *restrict data, size_t size)
 
 #endif
 }
+
+void *zis_file_map(zis_file_handle_t f, size_t min_size, size_t *restrict size) {
+#if ZIS_FS_POSIX
+
+    const int fd = (int)(intptr_t)f;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return NULL;
+    if (st.st_size <= 0 || (uintmax_t)st.st_size < min_size || (uintmax_t)st.st_size > SIZE_MAX)
+        return NULL;
+    const size_t file_size = (size_t)st.st_size;
+    void *const addr = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED)
+        return NULL;
+#ifdef MADV_SEQUENTIAL
+    madvise(addr, file_size, MADV_SEQUENTIAL);
+#endif // MADV_SEQUENTIAL
+    *size = file_size;
+    return addr;
+
+#elif ZIS_FS_WINDOWS
+
+    HANDLE h = (HANDLE)f;
+    LARGE_INTEGER file_size;
+    if (GetFileType(h) != FILE_TYPE_DISK || !GetFileSizeEx(h, &file_size))
+        return NULL;
+    if (file_size.QuadPart <= 0 || (uint64_t)file_size.QuadPart < min_size || (uint64_t)file_size.QuadPart > SIZE_MAX)
+        return NULL;
+    HANDLE mapping = CreateFileMappingW(
+        h, // hFile
+        NULL, // lpFileMappingAttributes
+        PAGE_READONLY, // flProtect
+        0, 0, // dwMaximumSizeHigh, dwMaximumSizeLow
+        NULL // lpName
+    );
+    if (!mapping)
+        return NULL;
+    void *const addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping); // The view keeps the mapping object alive.
+    if (!addr)
+        return NULL;
+    *size = (size_t)file_size.QuadPart;
+    return addr;
+
+#endif
+}
+
+void zis_file_unmap(void *addr, size_t size) {
+#if ZIS_FS_POSIX
+
+    munmap(addr, size);
+
+#elif ZIS_FS_WINDOWS
+
+    zis_unused_var(size);
+    UnmapViewOfFile(addr);
+
+#endif
+}
@@ -179,9 +179,10 @@ typedef void *zis_file_handle_t;
 
 #define ZIS_FILE_MODE_RD    1 ///< File open mode: read. Default.
 #define ZIS_FILE_MODE_WR    2 ///< File open mode: write.
-#define ZIS_FILE_MODE_APP   3 ///< File open mode: append. `ZIS_FILE_MODE_WR` required.
+#define ZIS_FILE_MODE_APP   4 ///< File open mode: append. `ZIS_FILE_MODE_WR` required.
 
-/// Open a file.
+/// Open a file. Opening a file in mode `ZIS_FILE_MODE_WR` (without `ZIS_FILE_MODE_RD`
+/// or `ZIS_FILE_MODE_APP`) creates or truncates it.
 zis_nodiscard zis_file_handle_t zis_file_open(const zis_path_char_t *path, int mode);
 
 #define ZIS_FILE_STDIN   0
@@ -202,3 +203,14 @@ size_t zis_file_read(zis_file_handle_t f, char *restrict buffer, size_t size);
 
 /// Write bytes to the file. Returns 0 on success, or -1 on error.
 int zis_file_write(zis_file_handle_t f, const char *restrict data, size_t size);
+
+/// Map a whole regular file into memory for reading. The file size is stored to `*size`.
+/// Returns NULL if the file is not a regular file, is empty or smaller than `min_size`,
+/// or cannot be mapped. The file handle can be closed after mapping.
+/// On POSIX systems, the mapping is not protected against the file being truncated
+/// by others: accessing pages beyond the new end of the file raises `SIGBUS`.
+/// (On Windows, a file that has a mapped view cannot be truncated.)
+void *zis_file_map(zis_file_handle_t f, size_t min_size, size_t *restrict size);
+
+/// Unmap a file mapped with `zis_file_map()`.
+void zis_file_unmap(void *addr, size_t size);
@@ -7,10 +7,12 @@
 #include "context.h"
 #include "globals.h"
 #include "invoke.h"
+#include "memory.h"
 #include "ndefutil.h"
 #include "objmem.h"
 #include "stack.h"
 
+#include "bytesobj.h"
 #include "tupleobj.h"
 
 static_assert(sizeof(struct zis_func_obj_meta) <= sizeof(void *), "");
@@ -52,6 +54,7 @@ static struct zis_func_obj *func_obj_alloc(
     struct zis_context_globals *g = z->globals;
     zis_func_obj_set_resources(self, g->val_empty_array_slots, g->val_empty_array_slots);
     self->_module = g->val_mod_unnamed;
+    self->_line_table = zis_object_from(g->val_nil);
     return self;
 }
 
@@ -103,6 +106,96 @@ void zis_func_obj_set_module(
     zis_object_assert_no_write_barrier_2(self, zis_object_from(mod));
 }
 
+/*
+ * The line-number table is a sequence of variable-length encoded pairs
+ * `(address - prev_address, line - prev_line)`, starting from `(0, 0)`.
+ * The address delta is unsigned; the line delta is zigzag-encoded.
+ * Each integer is stored 7 bits a byte, least significant group first,
+ * with the high bit set on all but the last byte.
+ */
+
+static size_t line_table_put_uint(unsigned char *restrict p, uint32_t x) {
+    size_t n = 0;
+    while (x >= 0x80) {
+        p[n++] = (unsigned char)(x | 0x80);
+        x >>= 7;
+    }
+    p[n++] = (unsigned char)x;
+    return n;
+}
+
+static const unsigned char *line_table_get_uint(
+    const unsigned char *restrict p, const unsigned char *end, uint32_t *restrict x
+) {
+    uint32_t v = 0;
+    for (unsigned int shift = 0; p < end && shift < 32; shift += 7) {
+        const unsigned char c = *p++;
+        v |= (uint32_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            *x = v;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+void zis_func_obj_set_line_table(
+    struct zis_context *z, struct zis_func_obj *self,
+    const struct zis_func_obj_line_info *v, size_t n
+) {
+    assert(!self->native);
+    if (!n)
+        return;
+
+    const size_t max_entry_size = 10; // two 5-byte integers
+    unsigned char small_buffer[256];
+    unsigned char *const buffer = n * max_entry_size <= sizeof small_buffer ?
+        small_buffer : zis_mem_alloc(n * max_entry_size);
+    size_t size = 0;
+    uint32_t prev_addr = 0, prev_line = 0;
+    for (size_t i = 0; i < n; i++) {
+        assert(v[i].address >= prev_addr);
+        const int32_t line_delta = (int32_t)(v[i].line - prev_line);
+        const uint32_t line_delta_zz = ((uint32_t)line_delta << 1) ^ (line_delta < 0 ? UINT32_MAX : 0);
+        size += line_table_put_uint(buffer + size, v[i].address - prev_addr);
+        size += line_table_put_uint(buffer + size, line_delta_zz);
+        prev_addr = v[i].address, prev_line = v[i].line;
+    }
+
+    // Bytecode functions are not moved, so `self` stays valid after the allocation.
+    struct zis_bytes_obj *const table = zis_bytes_obj_new(z, buffer, size);
+    if (buffer != small_buffer)
+        zis_mem_free(buffer);
+    self->_line_table = zis_object_from(table);
+    zis_object_write_barrier(self, table);
+}
+
+unsigned int zis_func_obj_line_number(
+    struct zis_context *z, const struct zis_func_obj *self, size_t instr_offset
+) {
+    if (!zis_object_type_is(self->_line_table, z->globals->type_Bytes))
+        return 0;
+    const struct zis_bytes_obj *const table =
+        zis_object_cast(self->_line_table, struct zis_bytes_obj);
+    const unsigned char *p = zis_bytes_obj_data(table);
+    const unsigned char *const end = p + zis_bytes_obj_size(table);
+    uint32_t addr = 0, line = 0;
+    while (p < end) {
+        uint32_t addr_delta, line_delta_zz;
+        p = line_table_get_uint(p, end, &addr_delta);
+        if (zis_unlikely(!p))
+            break;
+        p = line_table_get_uint(p, end, &line_delta_zz);
+        if (zis_unlikely(!p))
+            break;
+        if (addr + addr_delta > instr_offset)
+            break;
+        addr += addr_delta;
+        line += (line_delta_zz >> 1) ^ (0U - (line_delta_zz & 1));
+    }
+    return line;
+}
+
 size_t zis_func_obj_bytecode_length(const struct zis_func_obj *self) {
     assert(self->_bytes_size >= FUN_OBJ_BYTES_FIXED_SIZE);
     return (self->_bytes_size - FUN_OBJ_BYTES_FIXED_SIZE) / sizeof(zis_func_obj_bytecode_word_t);
@@ -47,6 +47,7 @@ struct zis_func_obj {
     struct zis_array_slots_obj *_symbols;
     struct zis_array_slots_obj *_constants;
     struct zis_module_obj      *_module; // Optional.
+    struct zis_object          *_line_table; // nil or zis_bytes_obj; see `zis_func_obj_set_line_table()`
     // --- BYTES ---
     size_t _bytes_size;
     struct zis_func_obj_meta     meta;
@@ -80,6 +81,27 @@ void zis_func_obj_set_module(
     struct zis_func_obj *self, struct zis_module_obj *mod
 );
 
+/// An entry of a function line-number table: instructions starting from `address`
+/// are generated from source line `line`.
+struct zis_func_obj_line_info {
+    uint32_t address;
+    uint32_t line;
+};
+
+/// Set the line-number table of a bytecode function. Entries in `v[0 ... n-1]` must
+/// be sorted by the `address` field. The table is stored delta-encoded.
+/// Shall only be used immediately after function created.
+void zis_func_obj_set_line_table(
+    struct zis_context *z, struct zis_func_obj *self,
+    const struct zis_func_obj_line_info *v, size_t n
+);
+
+/// Look up the source line number of the instruction at `instr_offset`.
+/// Returns 0 if unknown.
+unsigned int zis_func_obj_line_number(
+    struct zis_context *z, const struct zis_func_obj *self, size_t instr_offset
+);
+
 /// Get parent module of a function.
 zis_static_force_inline struct zis_module_obj *
 zis_func_obj_module(const struct zis_func_obj *self) {
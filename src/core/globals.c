@@ -94,26 +94,33 @@ zis_cold_fn static void _init_values_0(
     g->val_empty_array_slots = _zis_array_slots_obj_new_empty(z);
 }
 
-/// Initialize the rest values.
-zis_cold_fn static void _init_values_1(
+/// Initialize the standard streams.
+zis_cold_fn static void _init_values_stdio(
     struct zis_context_globals *g, struct zis_context *z
 ) {
-    g->val_mod_prelude = zis_module_obj_new(z, false);
-    g->val_mod_unnamed = zis_module_obj_new(z, true);
-
     int stdio_common_flags = ZIS_STREAM_OBJ_TEXT | ZIS_STREAM_OBJ_UTF8;
 #if ZIS_SYSTEM_WINDOWS
     stdio_common_flags |= ZIS_STREAM_OBJ_CRLF;
 #endif // ZIS_SYSTEM_WINDOWS
     g->val_stream_stdin = zis_stream_obj_new_file_native(
-        z, zis_file_stdio(ZIS_FILE_STDIN), stdio_common_flags | ZIS_STREAM_OBJ_MODE_IN
+        z, zis_file_stdio(ZIS_FILE_STDIN), stdio_common_flags | ZIS_STREAM_OBJ_MODE_IN, 0
     );
     g->val_stream_stdout = zis_stream_obj_new_file_native(
-        z, zis_file_stdio(ZIS_FILE_STDOUT), stdio_common_flags | ZIS_STREAM_OBJ_MODE_OUT
+        z, zis_file_stdio(ZIS_FILE_STDOUT), stdio_common_flags | ZIS_STREAM_OBJ_MODE_OUT, 0
     );
     g->val_stream_stderr = zis_stream_obj_new_file_native(
-        z, zis_file_stdio(ZIS_FILE_STDERR), stdio_common_flags | ZIS_STREAM_OBJ_MODE_OUT
+        z, zis_file_stdio(ZIS_FILE_STDERR), stdio_common_flags | ZIS_STREAM_OBJ_MODE_OUT, 0
     );
+}
+
+/// Initialize the rest values.
+zis_cold_fn static void _init_values_1(
+    struct zis_context_globals *g, struct zis_context *z
+) {
+    g->val_mod_prelude = zis_module_obj_new(z, false);
+    g->val_mod_unnamed = zis_module_obj_new(z, true);
+
+    _init_values_stdio(g, z);
 
 #if ZIS_FEATURE_SRC
     // NOTE: Leave it uninitialized. Shall be initialized by a lexer lazily.
@@ -176,13 +183,23 @@ static void globals_gc_visitor(void *_g, enum zis_objmem_obj_visit_op op) {
 }
 
 zis_cold_fn struct zis_context_globals *zis_context_globals_create(struct zis_context *z) {
+    struct zis_context_globals *const g = zis_context_globals_create_empty(z);
+    globals_init(g, z);
+    return g;
+}
+
+zis_cold_fn struct zis_context_globals *zis_context_globals_create_empty(struct zis_context *z) {
     struct zis_context_globals *const g = zis_mem_alloc(sizeof(struct zis_context_globals));
     memset(g, 0xff, sizeof *g); // Fill globals with small integers.
     zis_objmem_add_gc_root(z, g, globals_gc_visitor);
-    globals_init(g, z);
     return g;
 }
 
+zis_cold_fn void zis_context_globals_post_restore(struct zis_context_globals *g, struct zis_context *z) {
+    assert(z->globals == g);
+    _init_values_stdio(g, z);
+}
+
 zis_cold_fn void zis_context_globals_destroy(struct zis_context_globals *g, struct zis_context *z) {
     zis_objmem_remove_gc_root(z, g);
     zis_mem_free(g);
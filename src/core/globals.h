@@ -40,17 +40,24 @@ struct zis_type_obj;
     E(Array)                    \
     E(Bool)                     \
     E(Bytes)                    \
+    E(Coroutine)                \
+    E(Deque)                    \
     E(Exception)                \
     E(Float)                    \
+    E(Float32Array)             \
+    E(Float64Array)             \
     E(Int)                      \
+    E(Int64Array)               \
     E(Map)                      \
     E(Nil)                      \
     E(Path)                     \
     E(Range)                    \
+    E(Set)                      \
     E(Stream)                   \
     E(String)                   \
     E(Symbol)                   \
     E(Tuple)                    \
+    E(UInt8Array)               \
 // ^^^ _ZIS_BUILTIN_TYPE_LIST1 ^^^
 
 /// List of types (internal).
@@ -113,5 +120,13 @@ struct zis_context_globals {
 /// Create globals.
 struct zis_context_globals *zis_context_globals_create(struct zis_context *z);
 
+/// Create globals without initializing them (all are small integers). The values
+/// shall be restored from a heap snapshot, and then `zis_context_globals_post_restore()`
+/// shall be called.
+struct zis_context_globals *zis_context_globals_create_empty(struct zis_context *z);
+
+/// Create the global values that heap snapshots do not save (the standard streams).
+void zis_context_globals_post_restore(struct zis_context_globals *g, struct zis_context *z);
+
 /// Destroy globals.
 void zis_context_globals_destroy(struct zis_context_globals *g, struct zis_context *z);
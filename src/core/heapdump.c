@@ -0,0 +1,362 @@
+#include "heapdump.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h> // SEEK_SET
+#include <stdlib.h>
+#include <string.h>
+
+#include "algorithm.h"
+#include "attributes.h"
+#include "context.h"
+#include "debug.h"
+#include "globals.h"
+#include "memory.h"
+#include "objmem.h"
+#include "smallint.h"
+#include "stack.h"
+
+#include "arrayobj.h"
+#include "intobj.h"
+#include "stringobj.h"
+#include "tupleobj.h"
+#include "typeobj.h"
+
+/*
+ * Heap dump file layout:
+ *
+ * ```
+ * +---------+
+ * | HEADER  |  struct heapdump_header
+ * +---------+
+ * | OBJECTS |  object records
+ * +---------+
+ * | ROOTS   |  addresses of the objects referred to by GC roots
+ * +---------+
+ * | TYPES   |  type name records
+ * +---------+
+ * ```
+ *
+ * Apart from the header, the file is a sequence of words, whose size and byte
+ * order are those of the machine that wrote the file (see the header).
+ * An object record is: the address of the object, the address of its type,
+ * the object size in bytes, the number of references N, and then the N addresses
+ * of the objects that the slots refer to (small integers are left out).
+ * A type name record is: the address of the type, the length of the name in bytes,
+ * and then the name in UTF-8, padded with zeros to a multiple of the word size.
+ * Types whose names are unknown have no records.
+ */
+
+#define HEAPDUMP_MAGIC    "ZISHDMP"
+#define HEAPDUMP_VERSION  1
+
+struct heapdump_header {
+    char     magic[8];
+    uint32_t version;
+    uint16_t word_size;
+    uint16_t byte_order; // 0x0102 in the byte order of the file
+    uint64_t object_count;
+    uint64_t root_count;
+    uint64_t type_count;
+};
+
+/* ----- type table --------------------------------------------------------- */
+
+struct type_table_entry {
+    struct zis_object *type; // NULL for an empty entry
+    size_t count, bytes;
+};
+
+/// Objects counted by type, in a hash table keyed by the types.
+/// While the table is a GC root, the types are kept alive and updated if moved,
+/// but the hash table becomes invalid, so `type_table_get()` must not be used.
+struct type_table {
+    struct type_table_entry *entries;
+    size_t size; // power of 2
+    size_t count;
+    struct type_table_entry *last; // The last entry found. Nullable.
+};
+
+static void type_table_init(struct type_table *t) {
+    t->size = 64;
+    t->count = 0;
+    t->entries = zis_mem_alloc(t->size * sizeof t->entries[0]);
+    memset(t->entries, 0, t->size * sizeof t->entries[0]);
+    t->last = NULL;
+}
+
+static void type_table_fini(struct type_table *t) {
+    zis_mem_free(t->entries);
+}
+
+static void type_table_gc_visitor(void *_t, enum zis_objmem_obj_visit_op op) {
+    struct type_table *const t = _t;
+    for (size_t i = 0; i < t->size; i++) {
+        if (t->entries[i].type)
+            zis_objmem_visit_object(t->entries[i].type, op);
+    }
+}
+
+static void type_table_rehash(struct type_table *t, size_t new_size) {
+    struct type_table_entry *const old_entries = t->entries;
+    const size_t old_size = t->size;
+    t->entries = zis_mem_alloc(new_size * sizeof t->entries[0]);
+    memset(t->entries, 0, new_size * sizeof t->entries[0]);
+    t->size = new_size;
+    for (size_t i = 0; i < old_size; i++) {
+        if (!old_entries[i].type)
+            continue;
+        size_t j = zis_hash_pointer(old_entries[i].type) & (new_size - 1);
+        while (t->entries[j].type)
+            j = (j + 1) & (new_size - 1);
+        t->entries[j] = old_entries[i];
+    }
+    zis_mem_free(old_entries);
+    t->last = NULL;
+}
+
+/// Get the entry of a type, adding it if missing.
+static struct type_table_entry *type_table_get(struct type_table *t, struct zis_object *type) {
+    if (zis_likely(t->last && t->last->type == type))
+        return t->last; // Objects of a type are often allocated together.
+    const size_t mask = t->size - 1;
+    size_t j = zis_hash_pointer(type) & mask;
+    for (; t->entries[j].type; j = (j + 1) & mask) {
+        if (t->entries[j].type == type)
+            return t->last = &t->entries[j];
+    }
+    if (zis_unlikely((t->count + 1) * 4 > t->size * 3)) {
+        type_table_rehash(t, t->size * 2);
+        return type_table_get(t, type);
+    }
+    t->count++;
+    t->entries[j].type = type;
+    return t->last = &t->entries[j];
+}
+
+static int type_table_entry_compare(const void *_a, const void *_b) {
+    const struct type_table_entry *const a = _a, *const b = _b;
+    return a->bytes < b->bytes ? 1 : a->bytes > b->bytes ? -1 : 0;
+}
+
+/// Move the entries to the front and sort them by bytes in descending order.
+/// The table cannot be used as a hash table any more.
+static void type_table_sort(struct type_table *t) {
+    size_t n = 0;
+    for (size_t i = 0; i < t->size; i++) {
+        if (t->entries[i].type)
+            t->entries[n++] = t->entries[i];
+    }
+    assert(n == t->count);
+    t->size = n;
+    t->last = NULL;
+    qsort(t->entries, n, sizeof t->entries[0], type_table_entry_compare);
+}
+
+static void type_table_count_walker(
+    void *_t, struct zis_object *obj, struct zis_type_obj *obj_type, size_t obj_size, bool is_root
+) {
+    zis_unused_var(obj), zis_unused_var(is_root);
+    struct type_table_entry *const e = type_table_get(_t, zis_object_from(obj_type));
+    e->count++;
+    e->bytes += obj_size;
+}
+
+/* ----- heap dump ---------------------------------------------------------- */
+
+struct dump_state {
+    zis_file_handle_t file;
+    uintptr_t *buffer;
+    size_t length, capacity; // in words
+    bool failed;
+    uint64_t object_count;
+    struct zis_object **roots;
+    size_t root_count, root_capacity;
+};
+
+static void dump_flush(struct dump_state *d) {
+    if (d->length && !d->failed) {
+        if (zis_file_write(d->file, (const char *)d->buffer, d->length * sizeof(uintptr_t)) != 0)
+            d->failed = true;
+    }
+    d->length = 0;
+}
+
+zis_force_inline static void dump_word(struct dump_state *d, uintptr_t w) {
+    if (zis_unlikely(d->length == d->capacity))
+        dump_flush(d);
+    d->buffer[d->length++] = w;
+}
+
+static void dump_object_walker(
+    void *_d, struct zis_object *obj, struct zis_type_obj *obj_type, size_t obj_size, bool is_root
+) {
+    struct dump_state *const d = _d;
+
+    size_t slot_i = 0, slot_n = obj_type->_slots_num;
+    if (zis_unlikely(slot_n == (size_t)-1)) { // See `zis_object_slot_count()`.
+        slot_i = 1, slot_n = (size_t)zis_smallint_from_ptr(zis_object_get_slot(obj, 0));
+    }
+    size_t ref_count = 0;
+    for (size_t i = slot_i; i < slot_n; i++) {
+        if (!zis_object_is_smallint(zis_object_get_slot(obj, i)))
+            ref_count++;
+    }
+
+    dump_word(d, (uintptr_t)obj);
+    dump_word(d, (uintptr_t)obj_type);
+    dump_word(d, (uintptr_t)obj_size);
+    dump_word(d, (uintptr_t)ref_count);
+    for (size_t i = slot_i; i < slot_n; i++) {
+        struct zis_object *const slot_obj = zis_object_get_slot(obj, i);
+        if (!zis_object_is_smallint(slot_obj))
+            dump_word(d, (uintptr_t)slot_obj);
+    }
+    d->object_count++;
+
+    if (is_root) {
+        if (d->root_count == d->root_capacity) {
+            d->root_capacity = d->root_capacity ? d->root_capacity * 2 : 256;
+            d->roots = zis_mem_realloc(d->roots, d->root_capacity * sizeof d->roots[0]);
+        }
+        d->roots[d->root_count++] = obj;
+    }
+}
+
+/// Get the names of the types in the table. Returns an array of strings, each of which
+/// is NULL or allocated with `zis_mem_alloc()`. The table must be a GC root.
+static char **dump_type_names(struct zis_context *z, struct type_table *types) {
+    char **const names = zis_mem_alloc(types->size * sizeof(char *) + 1);
+    for (size_t i = 0; i < types->size; i++) {
+        names[i] = NULL;
+        if (!types->entries[i].type)
+            continue;
+        char buffer[128];
+        struct zis_string_obj *const name =
+            zis_context_guess_variable_name(z, types->entries[i].type); // may trigger GC
+        const size_t n = name ? zis_string_obj_to_u8str(name, buffer, sizeof buffer - 1) : (size_t)-1;
+        if (n == (size_t)-1)
+            continue;
+        buffer[n] = 0;
+        names[i] = zis_mem_alloc(n + 1);
+        memcpy(names[i], buffer, n + 1);
+    }
+    return names;
+}
+
+static void dump_header(struct dump_state *d, size_t type_count) {
+    union {
+        struct heapdump_header header;
+        uintptr_t words[(sizeof(struct heapdump_header) + sizeof(uintptr_t) - 1) / sizeof(uintptr_t)];
+    } u;
+    memset(&u, 0, sizeof u);
+    memcpy(u.header.magic, HEAPDUMP_MAGIC, sizeof u.header.magic);
+    u.header.version = HEAPDUMP_VERSION;
+    u.header.word_size = (uint16_t)sizeof(uintptr_t);
+    u.header.byte_order = 0x0102;
+    u.header.object_count = d->object_count;
+    u.header.root_count = (uint64_t)d->root_count;
+    u.header.type_count = (uint64_t)type_count;
+    for (size_t i = 0; i < sizeof u.words / sizeof u.words[0]; i++)
+        dump_word(d, u.words[i]);
+}
+
+bool zis_heapdump_write(struct zis_context *z, const zis_path_char_t *file) {
+    struct dump_state d;
+    d.file = zis_file_open(file, ZIS_FILE_MODE_WR);
+    if (!d.file)
+        return false;
+    d.capacity = 8192;
+    d.buffer = zis_mem_alloc(d.capacity * sizeof(uintptr_t));
+    d.length = 0;
+    d.failed = false;
+    d.object_count = 0;
+    d.roots = NULL;
+    d.root_count = 0, d.root_capacity = 0;
+
+    // Find the types and their names first, because getting the names allocates
+    // objects. Then collect the garbage, including the names.
+    struct type_table types;
+    type_table_init(&types);
+    zis_objmem_walk_heap(z, false, type_table_count_walker, &types);
+    zis_objmem_add_gc_root(z, &types, type_table_gc_visitor);
+    char **const type_names = dump_type_names(z, &types);
+    zis_objmem_gc(z, ZIS_OBJMEM_GC_FULL);
+
+    dump_header(&d, 0); // placeholder
+    zis_objmem_walk_heap(z, true, dump_object_walker, &d);
+    for (size_t i = 0; i < d.root_count; i++)
+        dump_word(&d, (uintptr_t)d.roots[i]);
+    size_t type_count = 0;
+    for (size_t i = 0; i < types.size; i++) {
+        const char *const name = type_names[i];
+        if (!name)
+            continue;
+        const size_t name_len = strlen(name);
+        dump_word(&d, (uintptr_t)types.entries[i].type);
+        dump_word(&d, (uintptr_t)name_len);
+        for (size_t j = 0; j < name_len; j += sizeof(uintptr_t)) {
+            uintptr_t w = 0;
+            memcpy(&w, name + j, name_len - j < sizeof w ? name_len - j : sizeof w);
+            dump_word(&d, w);
+        }
+        type_count++;
+    }
+    dump_flush(&d);
+
+    if (!d.failed) {
+        if (zis_file_seek(d.file, 0, SEEK_SET) != 0)
+            d.failed = true;
+        dump_header(&d, type_count);
+        dump_flush(&d);
+    }
+
+    zis_debug_log(
+        INFO, "HeapDump", "%llu objects, %zu roots, %zu types",
+        (unsigned long long)d.object_count, d.root_count, type_count
+    );
+
+    zis_objmem_remove_gc_root(z, &types);
+    for (size_t i = 0; i < types.size; i++)
+        zis_mem_free(type_names[i]);
+    zis_mem_free(type_names);
+    type_table_fini(&types);
+    zis_mem_free(d.roots);
+    zis_mem_free(d.buffer);
+    zis_file_close(d.file);
+    return !d.failed;
+}
+
+/* ----- census ------------------------------------------------------------- */
+
+struct zis_array_obj *zis_heapdump_census(struct zis_context *z, bool live_only) {
+    if (live_only)
+        zis_objmem_gc(z, ZIS_OBJMEM_GC_FULL);
+
+    struct type_table types;
+    type_table_init(&types);
+    zis_objmem_walk_heap(z, false, type_table_count_walker, &types);
+    type_table_sort(&types);
+    zis_objmem_add_gc_root(z, &types, type_table_gc_visitor);
+
+    // tmp_regs = { result, type, count, bytes }
+    struct zis_object **const tmp_regs = zis_callstack_frame_alloc_temp(z, 4);
+    tmp_regs[0] = zis_object_from(zis_array_obj_new2(z, types.size, NULL, 0));
+    for (size_t i = 0; i < types.size; i++) {
+        const struct type_table_entry *const e = &types.entries[i];
+        tmp_regs[1] = e->type;
+        tmp_regs[2] = zis_int_obj_or_smallint(z, (int64_t)e->count);
+        tmp_regs[3] = zis_int_obj_or_smallint(z, (int64_t)e->bytes);
+        struct zis_tuple_obj *const tuple = zis_tuple_obj_new(z, tmp_regs + 1, 3);
+        assert(zis_object_type_is(tmp_regs[0], z->globals->type_Array));
+        zis_array_obj_append(
+            z, zis_object_cast(tmp_regs[0], struct zis_array_obj), zis_object_from(tuple)
+        );
+    }
+    struct zis_array_obj *const result = zis_object_cast(tmp_regs[0], struct zis_array_obj);
+    zis_callstack_frame_free_temp(z, 4);
+
+    zis_objmem_remove_gc_root(z, &types);
+    type_table_fini(&types);
+    return result;
+}
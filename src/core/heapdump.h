@@ -0,0 +1,21 @@
+/// Heap dumps and object census.
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "fsutil.h" // zis_path_char_t
+
+struct zis_array_obj;
+struct zis_context;
+
+/// Collect garbage, and then write all the objects in the heap to a file, with
+/// their types, sizes, and references, and the objects referred to by GC roots.
+/// See the comments in "heapdump.c" for the file format.
+/// Returns false if the file cannot be written.
+bool zis_heapdump_write(struct zis_context *z, const zis_path_char_t *file);
+
+/// Count the objects in the heap by type. Returns an `Array` of `(type, count, bytes)`
+/// tuples in descending order of `bytes`. If `live_only` is true, garbage is collected
+/// before counting; otherwise unreachable objects that have not been collected are counted too.
+struct zis_array_obj *zis_heapdump_census(struct zis_context *z, bool live_only);
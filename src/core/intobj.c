@@ -539,6 +539,14 @@ static void dummy_int_obj_for_smi_init(dummy_int_obj_for_smi *restrict di, zis_s
     }
 }
 
+/// Get the int object `x`, or the dummy int object if `x` is a small int, in which
+/// case the dummy must have been initialized with `x`. A dummy is not in the heap,
+/// so GC roots (like locals) must hold `x` instead of the dummy, and the pointer
+/// returned should be taken again after an allocation.
+static struct zis_int_obj *int_obj_or_dummy(struct zis_object *x, dummy_int_obj_for_smi *dummy) {
+    return zis_object_is_smallint(x) ? &dummy->int_obj : zis_object_cast(x, struct zis_int_obj);
+}
+
 /// Allocate but do not initialize. If `cell_count` is too large, returns NULL.
 static struct zis_int_obj *int_obj_alloc(struct zis_context *z, size_t cell_count) {
     if (zis_unlikely(cell_count > INT_OBJ_CELL_COUNT_MAX))
@@ -762,6 +770,8 @@ int64_t zis_int_obj_value_i(const struct zis_int_obj *self) {
             const int64_t v = ((int64_t)self->cells[1] << BIGINT_CELL_WIDTH) | (int64_t)self->cells[0];
             return self->negative ? -v : v;
         }
+        if (self->negative && self->cells[1] == UINT32_MAX / 2 + 1 && self->cells[0] == 0)
+            return INT64_MIN;
     }
     errno = ERANGE;
     return INT64_MIN;
@@ -963,51 +973,52 @@ static struct zis_object *_int_obj_or_smallint_add_or_sub_slow(
     dummy_int_obj_for_smi _dummy_int;
     zis_locals_decl(
         z, var,
-        struct zis_int_obj *lhs_int_obj, *rhs_int_obj;
+        struct zis_object *lhs, *rhs;
     );
+    var.lhs = lhs, var.rhs = rhs;
 
     if (zis_object_is_smallint(lhs)) {
         assert(zis_object_type_is(rhs, z->globals->type_Int));
         dummy_int_obj_for_smi_init(&_dummy_int, zis_smallint_from_ptr(lhs));
-        var.lhs_int_obj = &_dummy_int.int_obj;
-        var.rhs_int_obj = zis_object_cast(rhs, struct zis_int_obj);
     } else if (zis_object_is_smallint(rhs)) {
         assert(zis_object_type_is(lhs, z->globals->type_Int));
         dummy_int_obj_for_smi_init(&_dummy_int, zis_smallint_from_ptr(rhs));
-        var.lhs_int_obj = zis_object_cast(lhs, struct zis_int_obj);
-        var.rhs_int_obj = &_dummy_int.int_obj;
     } else {
         assert(zis_object_type_is(lhs, z->globals->type_Int) && zis_object_type_is(rhs, z->globals->type_Int));
-        var.lhs_int_obj = zis_object_cast(lhs, struct zis_int_obj);
-        var.rhs_int_obj = zis_object_cast(rhs, struct zis_int_obj);
     }
+    struct zis_int_obj *lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int);
+    struct zis_int_obj *rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int);
 
     struct zis_int_obj *res_int_obj;
     const unsigned int lhs_rhs_max_cell_count =
-        var.lhs_int_obj->cell_count >= var.rhs_int_obj->cell_count ?
-        var.lhs_int_obj->cell_count : var.rhs_int_obj->cell_count;
+        lhs_int_obj->cell_count >= rhs_int_obj->cell_count ?
+        lhs_int_obj->cell_count : rhs_int_obj->cell_count;
     const bool lhs_rhs_sign_same =
-        var.lhs_int_obj->negative == var.rhs_int_obj->negative;
+        lhs_int_obj->negative == rhs_int_obj->negative;
     if (!do_sub ? lhs_rhs_sign_same : !lhs_rhs_sign_same) {
         res_int_obj = int_obj_alloc(z, lhs_rhs_max_cell_count + 1);
         if (zis_unlikely(!res_int_obj))
             goto too_large;
-        res_int_obj->negative = var.lhs_int_obj->negative;
+        lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int);
+        rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int);
+        res_int_obj->negative = lhs_int_obj->negative;
         bigint_add(
-            var.lhs_int_obj->cells, var.lhs_int_obj->cell_count,
-            var.rhs_int_obj->cells, var.rhs_int_obj->cell_count,
+            lhs_int_obj->cells, lhs_int_obj->cell_count,
+            rhs_int_obj->cells, rhs_int_obj->cell_count,
             res_int_obj->cells, res_int_obj->cell_count
         );
     } else {
         res_int_obj = int_obj_alloc(z, lhs_rhs_max_cell_count);
         if (zis_unlikely(!res_int_obj))
             goto too_large;
+        lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int);
+        rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int);
         const bool neg = bigint_sub(
-            var.lhs_int_obj->cells, var.lhs_int_obj->cell_count,
-            var.rhs_int_obj->cells, var.rhs_int_obj->cell_count,
+            lhs_int_obj->cells, lhs_int_obj->cell_count,
+            rhs_int_obj->cells, rhs_int_obj->cell_count,
             res_int_obj->cells, res_int_obj->cell_count
         );
-        bool res_neg = var.lhs_int_obj->negative;
+        bool res_neg = lhs_int_obj->negative;
         if (neg)
             res_neg = !res_neg;
         res_int_obj->negative = res_neg;
@@ -1082,30 +1093,27 @@ struct zis_object *zis_int_obj_or_smallint_mul(
     dummy_int_obj_for_smi _dummy_int_l, _dummy_int_r;
     zis_locals_decl(
         z, var,
-        struct zis_int_obj *lhs_int_obj, *rhs_int_obj;
+        struct zis_object *lhs, *rhs;
     );
+    var.lhs = lhs, var.rhs = rhs;
 
-    if (zis_object_is_smallint(lhs)) {
+    if (zis_object_is_smallint(lhs))
         dummy_int_obj_for_smi_init(&_dummy_int_l, zis_smallint_from_ptr(lhs));
-        var.lhs_int_obj = &_dummy_int_l.int_obj;
-    } else {
+    else
         assert(zis_object_type_is(lhs, z->globals->type_Int));
-        var.lhs_int_obj = zis_object_cast(lhs, struct zis_int_obj);
-    }
-    if (zis_object_is_smallint(rhs)) {
+    if (zis_object_is_smallint(rhs))
         dummy_int_obj_for_smi_init(&_dummy_int_r, zis_smallint_from_ptr(rhs));
-        var.rhs_int_obj = &_dummy_int_r.int_obj;
-    } else {
+    else
         assert(zis_object_type_is(rhs, z->globals->type_Int));
-        var.rhs_int_obj = zis_object_cast(rhs, struct zis_int_obj);
-    }
+    struct zis_int_obj *lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int_l);
+    struct zis_int_obj *rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int_r);
 
     do {
         struct zis_object *res;
-        if (int_obj_is_pow2(var.rhs_int_obj))
-            res = _int_obj_mul_using_shl(z, var.lhs_int_obj, var.rhs_int_obj);
-        else if (int_obj_is_pow2(var.lhs_int_obj))
-            res = _int_obj_mul_using_shl(z, var.rhs_int_obj, var.lhs_int_obj);
+        if (int_obj_is_pow2(rhs_int_obj))
+            res = _int_obj_mul_using_shl(z, lhs_int_obj, rhs_int_obj);
+        else if (int_obj_is_pow2(lhs_int_obj))
+            res = _int_obj_mul_using_shl(z, rhs_int_obj, lhs_int_obj);
         else
             break;
         zis_locals_drop(z, var);
@@ -1113,15 +1121,17 @@ struct zis_object *zis_int_obj_or_smallint_mul(
     } while (0);
 
     struct zis_int_obj *res_int_obj =
-        int_obj_alloc(z, var.lhs_int_obj->cell_count + var.rhs_int_obj->cell_count);
+        int_obj_alloc(z, lhs_int_obj->cell_count + rhs_int_obj->cell_count);
     if (zis_unlikely(!res_int_obj)) {
         zis_locals_drop(z, var);
         return NULL; // Too large.
     }
-    res_int_obj->negative = var.lhs_int_obj->negative != var.rhs_int_obj->negative;
+    lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int_l);
+    rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int_r);
+    res_int_obj->negative = lhs_int_obj->negative != rhs_int_obj->negative;
     bigint_mul(
-        var.lhs_int_obj->cells, var.lhs_int_obj->cell_count,
-        var.rhs_int_obj->cells, var.rhs_int_obj->cell_count,
+        lhs_int_obj->cells, lhs_int_obj->cell_count,
+        rhs_int_obj->cells, rhs_int_obj->cell_count,
         res_int_obj->cells, res_int_obj->cell_count
     );
 
@@ -1216,53 +1226,55 @@ zis_nodiscard bool zis_int_obj_or_smallint_divmod(
     dummy_int_obj_for_smi _dummy_int_l, _dummy_int_r;
     zis_locals_decl(
         z, var,
-        struct zis_int_obj *lhs_int_obj, *rhs_int_obj, *res_quot, *res_rem;
+        struct zis_object *lhs, *rhs;
+        struct zis_int_obj *res_quot, *res_rem;
         struct zis_object *res_tmp;
     );
     zis_locals_zero(var);
+    var.lhs = lhs, var.rhs = rhs;
 
-    if (zis_object_is_smallint(lhs)) {
+    if (zis_object_is_smallint(lhs))
         dummy_int_obj_for_smi_init(&_dummy_int_l, zis_smallint_from_ptr(lhs));
-        var.lhs_int_obj = &_dummy_int_l.int_obj;
-    } else {
+    else
         assert(zis_object_type_is(lhs, z->globals->type_Int));
-        var.lhs_int_obj = zis_object_cast(lhs, struct zis_int_obj);
-    }
-    if (zis_object_is_smallint(rhs)) {
+    if (zis_object_is_smallint(rhs))
         dummy_int_obj_for_smi_init(&_dummy_int_r, zis_smallint_from_ptr(rhs));
-        var.rhs_int_obj = &_dummy_int_r.int_obj;
-    } else {
+    else
         assert(zis_object_type_is(rhs, z->globals->type_Int));
-        var.rhs_int_obj = zis_object_cast(rhs, struct zis_int_obj);
-    }
+    struct zis_int_obj *lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int_l);
+    struct zis_int_obj *rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int_r);
 
-    if (int_obj_is_pow2(var.rhs_int_obj)) {
-        _int_obj_divmod_using_shr(z, var.lhs_int_obj, var.rhs_int_obj, quot, rem);
+    if (int_obj_is_pow2(rhs_int_obj)) {
+        _int_obj_divmod_using_shr(z, lhs_int_obj, rhs_int_obj, quot, rem);
         zis_locals_drop(z, var);
         return true;
     }
 
-    var.res_quot = int_obj_alloc(z, var.lhs_int_obj->cell_count);
-    var.res_rem  = int_obj_alloc(z, var.lhs_int_obj->cell_count);
-    var.res_quot->negative = var.lhs_int_obj->negative != var.rhs_int_obj->negative;
+    const unsigned int lhs_cell_count = lhs_int_obj->cell_count;
+    var.res_quot = int_obj_alloc(z, lhs_cell_count);
+    var.res_rem  = int_obj_alloc(z, lhs_cell_count);
+    lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int_l);
+    rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int_r);
+    var.res_quot->negative = lhs_int_obj->negative != rhs_int_obj->negative;
     var.res_rem->negative  = var.res_quot->negative;
 
-    if (var.rhs_int_obj->cell_count == 1) {
+    if (rhs_int_obj->cell_count == 1) {
         bigint_copy(
-            var.res_quot->cells, var.lhs_int_obj->cells,
-            var.lhs_int_obj->cell_count
+            var.res_quot->cells, lhs_int_obj->cells,
+            lhs_int_obj->cell_count
         );
         var.res_rem->cell_count = 1;
         var.res_rem->cells[0] = bigint_self_div_1(
             var.res_quot->cells, var.res_quot->cell_count,
-            var.rhs_int_obj->cells[0]
+            rhs_int_obj->cells[0]
         );
     } else {
-        struct zis_int_obj *const tmp_buf =
-            int_obj_alloc(z, var.lhs_int_obj->cell_count);
+        struct zis_int_obj *const tmp_buf = int_obj_alloc(z, lhs_cell_count);
+        lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int_l);
+        rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int_r);
         bigint_div(
-            var.lhs_int_obj->cells, var.lhs_int_obj->cell_count,
-            var.rhs_int_obj->cells, var.rhs_int_obj->cell_count,
+            lhs_int_obj->cells, lhs_int_obj->cell_count,
+            rhs_int_obj->cells, rhs_int_obj->cell_count,
             tmp_buf->cells,
             var.res_quot->cells, var.res_rem->cells
         );
@@ -1396,12 +1408,16 @@ struct zis_object *zis_int_obj_or_smallint_shl(
         return (void *)res == (void *)&_dummy_int.int_obj ?
             zis_object_from(int_obj_clone(z, &_dummy_int.int_obj)) : res;
     } else {
-        zis_locals_decl_1(z, var, struct zis_int_obj *lhs);
-        var.lhs = lhs_v;
+        // A dummy int is not in the heap, and must not be put in the locals.
+        const bool lhs_is_dummy = zis_object_type(lhs) == NULL;
+        zis_locals_decl_1(z, var, struct zis_object *lhs);
+        var.lhs = lhs_is_dummy ? zis_smallint_to_ptr(0) : lhs;
         const unsigned int res_cell_count =
             zis_round_up_to_n_pow2(BIGINT_CELL_WIDTH, res_width) / BIGINT_CELL_WIDTH;
         struct zis_int_obj *res = int_obj_alloc(z, res_cell_count);
-        res->negative = var.lhs->negative;
+        if (!lhs_is_dummy)
+            lhs_v = zis_object_cast(var.lhs, struct zis_int_obj);
+        res->negative = lhs_v->negative;
         bigint_shl(lhs_v->cells, lhs_v->cell_count, rhs, res->cells, res->cell_count);
         zis_locals_drop(z, var);
         assert(res->cells[res->cell_count - 1]); // `int_obj_shrink()` is not needed.
@@ -1449,7 +1465,7 @@ struct zis_object *zis_int_obj_or_smallint_shr(
             zis_round_up_to_n_pow2(BIGINT_CELL_WIDTH, res_width) / BIGINT_CELL_WIDTH;
         struct zis_int_obj *res = int_obj_alloc(z, res_cell_count);
         res->negative = var.lhs->negative;
-        bigint_shr(lhs_v->cells, lhs_v->cell_count, rhs, res->cells, res->cell_count);
+        bigint_shr(var.lhs->cells, var.lhs->cell_count, rhs, res->cells, res->cell_count);
         zis_locals_drop(z, var);
         assert(res->cells[res->cell_count - 1]); // `int_obj_shrink()` is not needed.
         return zis_object_from(res);
@@ -1475,7 +1491,10 @@ int zis_int_obj_or_smallint_compare(struct zis_object *lhs, struct zis_object *r
             return lhs_int_obj->negative ? -1 : 1;
         } else {
             struct zis_int_obj *rhs_int_obj = zis_object_cast(rhs, struct zis_int_obj);
-            return bigint_cmp(lhs_int_obj->cells, lhs_int_obj->cell_count, rhs_int_obj->cells, rhs_int_obj->cell_count);
+            if (lhs_int_obj->negative != rhs_int_obj->negative)
+                return lhs_int_obj->negative ? -1 : 1;
+            const int cmp = bigint_cmp(lhs_int_obj->cells, lhs_int_obj->cell_count, rhs_int_obj->cells, rhs_int_obj->cell_count);
+            return lhs_int_obj->negative ? -cmp : cmp;
         }
     }
 }
@@ -1487,7 +1506,7 @@ bool zis_int_obj_or_smallint_equals(struct zis_object *lhs, struct zis_object *r
         return false;
     const struct zis_int_obj *lhs_int_obj = zis_object_cast(lhs, struct zis_int_obj);
     const struct zis_int_obj *rhs_int_obj = zis_object_cast(rhs, struct zis_int_obj);
-    if (lhs_int_obj->cell_count != rhs_int_obj->cell_count)
+    if (lhs_int_obj->negative != rhs_int_obj->negative || lhs_int_obj->cell_count != rhs_int_obj->cell_count)
         return false;
     return memcmp(lhs_int_obj->cells, rhs_int_obj->cells, lhs_int_obj->cell_count * sizeof(bigint_cell_t)) == 0;
 }
@@ -1510,62 +1529,69 @@ static struct zis_object *_int_obj_or_smallint_bitwise_op_slow(
     dummy_int_obj_for_smi _dummy_int;
     zis_locals_decl(
         z, var,
-        struct zis_int_obj *lhs_int_obj, *rhs_int_obj, *res_int_obj;
+        struct zis_object *lhs, *rhs;
+        struct zis_int_obj *res_int_obj;
     );
     zis_locals_zero(var);
 
     if (zis_object_is_smallint(_lhs)) {
         assert(zis_object_type_is(_rhs, z->globals->type_Int));
         dummy_int_obj_for_smi_init(&_dummy_int, zis_smallint_from_ptr(_lhs));
-        var.lhs_int_obj = &_dummy_int.int_obj;
-        var.rhs_int_obj = zis_object_cast(_rhs, struct zis_int_obj);
     } else if (zis_object_is_smallint(_rhs)) {
         assert(zis_object_type_is(_lhs, z->globals->type_Int));
         dummy_int_obj_for_smi_init(&_dummy_int, zis_smallint_from_ptr(_rhs));
-        var.lhs_int_obj = zis_object_cast(_lhs, struct zis_int_obj);
-        var.rhs_int_obj = &_dummy_int.int_obj;
     } else {
         assert(zis_object_type_is(_lhs, z->globals->type_Int) && zis_object_type_is(_rhs, z->globals->type_Int));
-        var.lhs_int_obj = zis_object_cast(_lhs, struct zis_int_obj);
-        var.rhs_int_obj = zis_object_cast(_rhs, struct zis_int_obj);
     }
+    var.lhs = _lhs, var.rhs = _rhs;
+    struct zis_int_obj *lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int);
+    struct zis_int_obj *rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int);
 
     // Make sure lhs is not shorter than rhs.
-    if (var.lhs_int_obj->cell_count < var.rhs_int_obj->cell_count) {
-        struct zis_int_obj *tmp = var.lhs_int_obj;
-        var.lhs_int_obj = var.rhs_int_obj;
-        var.rhs_int_obj = tmp;
+    if (lhs_int_obj->cell_count < rhs_int_obj->cell_count) {
+        struct zis_int_obj *tmp = lhs_int_obj;
+        lhs_int_obj = rhs_int_obj;
+        rhs_int_obj = tmp;
+        struct zis_object *tmp_obj = var.lhs;
+        var.lhs = var.rhs;
+        var.rhs = tmp_obj;
     }
 
     // Use two's complement if negative.
-    if (var.lhs_int_obj->negative)
-        bigint_complement(var.lhs_int_obj->cells, var.lhs_int_obj->cell_count, var.lhs_int_obj->cells);
-    if (var.rhs_int_obj->negative)
-        bigint_complement(var.rhs_int_obj->cells, var.rhs_int_obj->cell_count, var.rhs_int_obj->cells);
+    if (lhs_int_obj->negative)
+        bigint_complement(lhs_int_obj->cells, lhs_int_obj->cell_count, lhs_int_obj->cells);
+    if (rhs_int_obj->negative)
+        bigint_complement(rhs_int_obj->cells, rhs_int_obj->cell_count, rhs_int_obj->cells);
 
     switch (op) {
     case BITWISE_OP_AND:
-        var.res_int_obj = int_obj_alloc(z, var.rhs_int_obj->negative ? var.lhs_int_obj->cell_count : var.rhs_int_obj->cell_count);
-        var.res_int_obj->negative = var.lhs_int_obj->negative && var.rhs_int_obj->negative;
-        for (size_t i = 0, n = var.rhs_int_obj->cell_count; i < n; i++)
-            var.res_int_obj->cells[i] = var.lhs_int_obj->cells[i] & var.rhs_int_obj->cells[i];
+        var.res_int_obj = int_obj_alloc(z, rhs_int_obj->negative ? lhs_int_obj->cell_count : rhs_int_obj->cell_count);
+        lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int);
+        rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int);
+        var.res_int_obj->negative = lhs_int_obj->negative && rhs_int_obj->negative;
+        for (size_t i = 0, n = rhs_int_obj->cell_count; i < n; i++)
+            var.res_int_obj->cells[i] = lhs_int_obj->cells[i] & rhs_int_obj->cells[i];
         break;
 
     case BITWISE_OP_OR:
-        var.res_int_obj = int_obj_alloc(z, var.rhs_int_obj->negative ? var.rhs_int_obj->cell_count : var.lhs_int_obj->cell_count);
-        var.res_int_obj->negative = var.lhs_int_obj->negative || var.rhs_int_obj->negative;
-        for (size_t i = 0, n = var.rhs_int_obj->cell_count; i < n; i++)
-            var.res_int_obj->cells[i] = var.lhs_int_obj->cells[i] | var.rhs_int_obj->cells[i];
+        var.res_int_obj = int_obj_alloc(z, rhs_int_obj->negative ? rhs_int_obj->cell_count : lhs_int_obj->cell_count);
+        lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int);
+        rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int);
+        var.res_int_obj->negative = lhs_int_obj->negative || rhs_int_obj->negative;
+        for (size_t i = 0, n = rhs_int_obj->cell_count; i < n; i++)
+            var.res_int_obj->cells[i] = lhs_int_obj->cells[i] | rhs_int_obj->cells[i];
         break;
 
     case BITWISE_OP_XOR:
-        var.res_int_obj = int_obj_alloc(z, var.lhs_int_obj->cell_count);
-        var.res_int_obj->negative = var.lhs_int_obj->negative != var.rhs_int_obj->negative;
-        for (size_t i = 0, n = var.rhs_int_obj->cell_count; i < n; i++)
-            var.res_int_obj->cells[i] = var.lhs_int_obj->cells[i] ^ var.rhs_int_obj->cells[i];
-        if (var.rhs_int_obj->negative) {
-            for (size_t i = var.rhs_int_obj->cell_count, i_end = var.lhs_int_obj->cell_count; i < i_end; i++)
-                var.res_int_obj->cells[i] = ~var.lhs_int_obj->cells[i];
+        var.res_int_obj = int_obj_alloc(z, lhs_int_obj->cell_count);
+        lhs_int_obj = int_obj_or_dummy(var.lhs, &_dummy_int);
+        rhs_int_obj = int_obj_or_dummy(var.rhs, &_dummy_int);
+        var.res_int_obj->negative = lhs_int_obj->negative != rhs_int_obj->negative;
+        for (size_t i = 0, n = rhs_int_obj->cell_count; i < n; i++)
+            var.res_int_obj->cells[i] = lhs_int_obj->cells[i] ^ rhs_int_obj->cells[i];
+        if (rhs_int_obj->negative) {
+            for (size_t i = rhs_int_obj->cell_count, i_end = lhs_int_obj->cell_count; i < i_end; i++)
+                var.res_int_obj->cells[i] = ~lhs_int_obj->cells[i];
             goto skip_copying_rest_cells;
         }
         break;
@@ -1573,12 +1599,12 @@ static struct zis_object *_int_obj_or_smallint_bitwise_op_slow(
     default:
         zis_unreachable();
     }
-    if (var.res_int_obj->cell_count > var.rhs_int_obj->cell_count) {
-        const size_t copied_count = var.rhs_int_obj->cell_count;
+    if (var.res_int_obj->cell_count > rhs_int_obj->cell_count) {
+        const size_t copied_count = rhs_int_obj->cell_count;
         const size_t rest_count = var.res_int_obj->cell_count - copied_count;
         bigint_copy(
             var.res_int_obj->cells + copied_count,
-            var.lhs_int_obj->cells + copied_count,
+            lhs_int_obj->cells + copied_count,
             rest_count
         );
     }
@@ -1588,10 +1614,10 @@ skip_copying_rest_cells:;
     }
 
     // Undo two's complement if negative.
-    if (var.lhs_int_obj->negative)
-        bigint_complement(var.lhs_int_obj->cells, var.lhs_int_obj->cell_count, var.lhs_int_obj->cells);
-    if (var.rhs_int_obj->negative && var.rhs_int_obj != &_dummy_int.int_obj)
-        bigint_complement(var.rhs_int_obj->cells, var.rhs_int_obj->cell_count, var.rhs_int_obj->cells);
+    if (lhs_int_obj->negative)
+        bigint_complement(lhs_int_obj->cells, lhs_int_obj->cell_count, lhs_int_obj->cells);
+    if (rhs_int_obj->negative && rhs_int_obj != &_dummy_int.int_obj)
+        bigint_complement(rhs_int_obj->cells, rhs_int_obj->cell_count, rhs_int_obj->cells);
 
     zis_locals_drop(z, var);
     return int_obj_shrink(z, var.res_int_obj);
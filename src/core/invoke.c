@@ -11,7 +11,10 @@
 #include "instr.h"
 #include "loader.h"
 #include "object.h"
+#include "objmem.h"
 #include "objvec.h"
+#include "opstat.h"
+#include "profiler.h"
 #include "stack.h"
 
 #include "arrayobj.h"
@@ -26,7 +29,7 @@
 #include "tupleobj.h"
 #include "typeobj.h"
 
-#include "zis_config.h" // ZIS_BUILD_CGOTO
+#include "zis_config.h" // ZIS_USE_COMPUTED_GOTO, ZIS_FEATURE_OPSTAT
 
 /* ----- invocation tools --------------------------------------------------- */
 
@@ -418,14 +421,14 @@ format_error_cond_is_not_bool(
     zis_context_set_reg0(z, zis_object_from(exc));
 }
 
-/// Run the bytecode in the function object.
+/// Run the bytecode in the function object, starting from `start_ip`.
 /// Then pop the current frame and handles the return value.
 zis_hot_fn static int invoke_bytecode_func(
-    struct zis_context *z, struct zis_func_obj *this_func
+    struct zis_context *z, struct zis_func_obj *this_func, zis_instr_word_t *start_ip
 ) {
 #define OP_DISPATCH_USE_COMPUTED_GOTO ZIS_USE_COMPUTED_GOTO
 
-    zis_instr_word_t *ip = this_func->bytecode; // The instruction pointer.
+    zis_instr_word_t *ip = start_ip; // The instruction pointer.
     zis_instr_word_t this_instr = *ip;
 
 #define IP_ADVANCE     (this_instr = *++ip)
@@ -449,6 +452,30 @@ zis_hot_fn static int invoke_bytecode_func(
         assert((size_t)func_sym_count == zis_func_obj_symbol_count(this_func));     \
         assert((size_t)func_const_count == zis_func_obj_constant_count(this_func)); \
     } while (0)
+
+#if ZIS_FEATURE_PROF
+#define PROF_SAFEPOINT \
+    do {  /* take a sample if the profiler timer has ticked; no allocation */ \
+        if (zis_unlikely(zis_profiler_pending_ticks))                     \
+            zis_profiler_sample(z, ip);                                    \
+    } while (0)
+#else // !ZIS_FEATURE_PROF
+#define PROF_SAFEPOINT ((void)0)
+#endif // ZIS_FEATURE_PROF
+#if ZIS_FEATURE_OPSTAT
+#define OPSTAT_RECORD \
+    do {  /* count the instruction to be executed */ \
+        struct zis_opstat *const _os = z->opstat;                           \
+        const unsigned int _op = zis_instr_extract_opcode(this_instr);      \
+        _os->op_counts[_op]++;                                              \
+        _os->op_pair_counts[_os->last_op][_op]++;                           \
+        _os->last_op = _op;                                                 \
+        if (zis_unlikely(_os->trace))                                       \
+            zis_opstat_trace(_os, this_func, ip);                           \
+    } while (0)
+#else // !ZIS_FEATURE_OPSTAT
+#define OPSTAT_RECORD ((void)0)
+#endif // ZIS_FEATURE_OPSTAT
 #define FUNC_CHANGED \
     do {             \
         struct zis_object *p = zis_callstack_frame_info(stack)->prev_frame[0]; \
@@ -483,7 +510,11 @@ zis_hot_fn static int invoke_bytecode_func(
 #define OP_LABEL(NAME)   _op_##NAME##_label
 #define OP_DEFINE(NAME)  OP_LABEL(NAME) :
 #define OP_UNDEFINED     OP_LABEL() :
-#define OP_DISPATCH      goto *(&& OP_LABEL(NOP) + _op_dispatch_table[zis_instr_extract_opcode(this_instr)])
+#define OP_DISPATCH \
+    do {            \
+        OPSTAT_RECORD; \
+        goto *(&& OP_LABEL(NOP) + _op_dispatch_table[zis_instr_extract_opcode(this_instr)]); \
+    } while (0)
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wpedantic" // &&label
@@ -501,7 +532,7 @@ zis_hot_fn static int invoke_bytecode_func(
 
 #define OP_DEFINE(NAME)  case (zis_instr_word_t)ZIS_OPC_##NAME :
 #define OP_UNDEFINED     default :
-#define OP_DISPATCH      goto _interp_loop
+#define OP_DISPATCH      do { OPSTAT_RECORD; goto _interp_loop; } while (0)
 
 _interp_loop:
     switch (zis_instr_extract_opcode(this_instr)) {
@@ -674,7 +705,9 @@ zis_hot_fn static int invoke_bytecode_func(
         struct zis_object **tgt_p = bp + tgt, **val_p = bp + val_start;
         BOUND_CHECK_REG(tgt_p);
         BOUND_CHECK_REG_VEC(val_p, val_count);
+        zis_objmem_enter_alloc_site(z, ip);
         *tgt_p = zis_object_from(zis_tuple_obj_new(z, val_p, val_count));
+        zis_objmem_leave_alloc_site(z);
         IP_ADVANCE;
         OP_DISPATCH;
     }
@@ -685,7 +718,9 @@ zis_hot_fn static int invoke_bytecode_func(
         struct zis_object **tgt_p = bp + tgt, **val_p = bp + val_start;
         BOUND_CHECK_REG(tgt_p);
         BOUND_CHECK_REG_VEC(val_p, val_count);
+        zis_objmem_enter_alloc_site(z, ip);
         *tgt_p = zis_object_from(zis_array_obj_new(z, val_p, val_count));
+        zis_objmem_leave_alloc_site(z);
         IP_ADVANCE;
         OP_DISPATCH;
     }
@@ -699,7 +734,9 @@ zis_hot_fn static int invoke_bytecode_func(
         if (val_count) {
             BOUND_CHECK_REG(val_end_p - 1);
             struct zis_object **const map_reg = zis_callstack_frame_alloc_temp(z, 1);
+            zis_objmem_enter_alloc_site(z, ip);
             *map_reg = zis_object_from(zis_map_obj_new(z, 0.0f, val_count));
+            zis_objmem_leave_alloc_site(z);
             for (; val_p < val_end_p; val_p += 2) {
                 assert(zis_object_type_is(*map_reg, g->type_Map));
                 struct zis_map_obj *map = zis_object_cast(*map_reg, struct zis_map_obj);
@@ -716,7 +753,9 @@ zis_hot_fn static int invoke_bytecode_func(
             assert(stack->top == sp);
         } else {
             // val_count == 0
+            zis_objmem_enter_alloc_site(z, ip);
             *tgt_p = zis_object_from(zis_map_obj_new(z, 0.0f, 0));
+            zis_objmem_leave_alloc_site(z);
         }
         IP_ADVANCE;
         OP_DISPATCH;
@@ -830,11 +869,16 @@ zis_hot_fn static int invoke_bytecode_func(
             THROW_REG0;
     } {
     _do_call_func_obj:
+        PROF_SAFEPOINT;
         if (this_func->native) {
             const int status = this_func->native(z);
-            if (zis_unlikely(status == ZIS_THR))
-                THROW_REG0;
-            assert(status == ZIS_OK);
+            if (zis_unlikely(status != ZIS_OK)) {
+                if (status == ZIS_THR)
+                    THROW_REG0;
+                // Suspended. The frame of the native function is kept. See `zis_invoke_resume()`.
+                assert(status == ZIS_INVOKE_SUSPEND);
+                return status;
+            }
             zis_instr_word_t *ip0 = invocation_leave(z, bp[0]);
             assert(ip0 == ip), zis_unused_var(ip0);
             BP_SP_CHANGED;
@@ -1270,6 +1314,7 @@ zis_hot_fn static int invoke_bytecode_func(
     OP_DEFINE(JMP) {
         int32_t offset;
         zis_instr_extract_operands_Asw(this_instr, offset);
+        PROF_SAFEPOINT;
         IP_JUMP_TO(ip + offset);
         OP_DISPATCH;
     }
@@ -1974,6 +2019,8 @@ zis_hot_fn static int invoke_bytecode_func(
 #undef FUNC_ENSURE
 #undef FUNC_CHANGED
 #undef FUNC_CHANGED_TO
+#undef PROF_SAFEPOINT
+#undef OPSTAT_RECORD
 
 #undef OP_DISPATCH_USE_COMPUTED_GOTO
 }
@@ -2127,11 +2174,23 @@ int zis_invoke_func(struct zis_context *z, struct zis_func_obj *func) {
             }
             frame_info->prev_frame[0] = frame[0];
         }
+        assert(status != ZIS_INVOKE_SUSPEND);
         void *ret_ip = invocation_leave(z, z->callstack->frame[0]);
         assert(!ret_ip), zis_unused_var(ret_ip);
         return status;
     }
-    return invoke_bytecode_func(z, func);
+    return invoke_bytecode_func(z, func, func->bytecode);
+}
+
+int zis_invoke_resume(struct zis_context *z) {
+    struct zis_callstack *const stack = z->callstack;
+    zis_instr_word_t *const caller_ip = invocation_leave(z, stack->frame[0]);
+    assert(caller_ip);
+    struct zis_object *const caller_func = zis_callstack_frame_info(stack)->prev_frame[0];
+    assert(zis_object_type_is(caller_func, z->globals->type_Function));
+    struct zis_func_obj *const func = zis_object_cast(caller_func, struct zis_func_obj);
+    assert(!func->native);
+    return invoke_bytecode_func(z, func, caller_ip + 1);
 }
 
 int zis_invoke_vn(
@@ -46,8 +46,20 @@ struct zis_func_obj *zis_invoke_prepare_da(
 /// and the function `func` shall have been stored in the REG-0 in the caller's frame.
 /// If an exception is thrown, the stack trace will be updated, and the exception
 /// it self will be copied to REG-0.
+/// If the invocation is suspended (see `ZIS_INVOKE_SUSPEND`), the frames are kept.
 int zis_invoke_func(struct zis_context *z, struct zis_func_obj *func);
 
+/// Status code that a native function returns to suspend the bytecode invocation
+/// that called it. The frames, including the one of the native function, are kept
+/// and the invocation can be continued with `zis_invoke_resume()`.
+/// This is how coroutines are implemented. See `Coroutine.yield()`.
+#define ZIS_INVOKE_SUSPEND  1
+
+/// Continue a bytecode invocation suspended by a native function (see `ZIS_INVOKE_SUSPEND`).
+/// The current frame shall be the one of that native function, whose REG-0 is taken
+/// as its return value. Returns like `zis_invoke_func()` or returns `ZIS_INVOKE_SUSPEND` again.
+int zis_invoke_resume(struct zis_context *z);
+
 /* ----- convenient wrappers ------------------------------------------------ */
 
 /// Invoke the `callable` object.
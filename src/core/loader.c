@@ -97,11 +97,27 @@ static const struct zis_native_module_def *find_embedded_module(const char *name
 #endif // ZIS_EMBEDDED_MODULE_LIST_EMPTY
 }
 
+const struct zis_native_module_def *zis_module_loader_embedded_module(size_t index) {
+#if ZIS_EMBEDDED_MODULE_LIST_EMPTY
+
+    zis_unused_var(index);
+    return NULL;
+
+#else // !ZIS_EMBEDDED_MODULE_LIST_EMPTY
+
+    const size_t embedded_module_count =
+        sizeof embedded_module_list / sizeof embedded_module_list[0];
+    return index < embedded_module_count ? embedded_module_list[index].def : NULL;
+
+#endif // ZIS_EMBEDDED_MODULE_LIST_EMPTY
+}
+
 /* ----- internal data structures ------------------------------------------- */
 
 struct module_loader_data {
     struct zis_array_obj *search_path; // { dir (Path) }
     struct zis_map_obj   *loaded_modules; // { name (Symbol) -> mod (Module) / tree ( Map{ name (Symbol) -> mod (Module) } ) }
+    struct zis_map_obj   *bootstrap_modules; // copy of `loaded_modules` when bootstrapped, or smallint if not yet
 };
 
 static void module_loader_data_as_obj_vec(
@@ -110,7 +126,7 @@ static void module_loader_data_as_obj_vec(
 ) {
     begin_and_end[0] = (struct zis_object **)d;
     begin_and_end[1] = (struct zis_object **)((char *)d + sizeof(*d));
-    assert(begin_and_end[1] - begin_and_end[0] == 2);
+    assert(begin_and_end[1] - begin_and_end[0] == 3);
 }
 
 /// GC objects visitor. See `zis_objmem_object_visitor_t`.
@@ -123,10 +139,15 @@ static void module_loader_data_gc_visitor(void *_d, enum zis_objmem_obj_visit_op
 
 struct zis_module_loader {
     struct module_loader_data data;
+    size_t bootstrap_search_path_length;
 };
 
 /* ----- module search and loading ------------------------------------------ */
 
+/// Stream buffer size for reading module source files, which is also the window
+/// size of mapped files (see `ZIS_STREAM_OBJ_MMAP`).
+#define MODULE_SOURCE_FILE_BUF_SZ  (64 * 1024)
+
 /// Type of a module file.
 enum module_loader_module_file_type {
     MOD_FILE_NOT_FOUND,
@@ -325,8 +346,8 @@ static bool module_loader_load_from_file(
     case MOD_FILE_SRC: {
         struct zis_compilation_bundle comp_bundle;
         zis_compilation_bundle_init(&comp_bundle, z);
-        const int ff = ZIS_STREAM_OBJ_MODE_IN | ZIS_STREAM_OBJ_TEXT | ZIS_STREAM_OBJ_UTF8;
-        struct zis_stream_obj *f = zis_stream_obj_new_file(z, file, ff);
+        const int ff = ZIS_STREAM_OBJ_MODE_IN | ZIS_STREAM_OBJ_TEXT | ZIS_STREAM_OBJ_UTF8 | ZIS_STREAM_OBJ_MMAP;
+        struct zis_stream_obj *f = zis_stream_obj_new_file(z, file, ff, MODULE_SOURCE_FILE_BUF_SZ);
         var.init_func = zis_compile_source(&comp_bundle, f, var.module);
         zis_stream_obj_close(f);
         zis_compilation_bundle_fini(&comp_bundle);
@@ -367,8 +388,8 @@ static bool module_loader_load_from_file(
 
 #if ZIS_FEATURE_ASM
     case MOD_FILE_ASM: {
-        const int ff = ZIS_STREAM_OBJ_MODE_IN | ZIS_STREAM_OBJ_TEXT | ZIS_STREAM_OBJ_UTF8;
-        struct zis_stream_obj *f = zis_stream_obj_new_file(z, file, ff);
+        const int ff = ZIS_STREAM_OBJ_MODE_IN | ZIS_STREAM_OBJ_TEXT | ZIS_STREAM_OBJ_UTF8 | ZIS_STREAM_OBJ_MMAP;
+        struct zis_stream_obj *f = zis_stream_obj_new_file(z, file, ff, MODULE_SOURCE_FILE_BUF_SZ);
         var.init_func = zis_assemble_func_from_text(z, f, var.module);
         zis_stream_obj_close(f);
         if (!var.init_func) {
@@ -393,7 +414,7 @@ static bool module_loader_load_from_file(
 
 static bool module_loader_load_from_source(
     struct zis_context *z,
-    struct zis_stream_obj *input,
+    struct zis_stream_obj *_input,
     struct zis_module_obj *_module
 ) {
 #if ZIS_FEATURE_SRC
@@ -401,13 +422,15 @@ static bool module_loader_load_from_source(
     struct zis_compilation_bundle comp_bundle;
     zis_locals_decl(
         z, var,
+        struct zis_stream_obj *input;
         struct zis_module_obj *module;
         struct zis_func_obj *init_func;
     );
     zis_locals_zero(var);
+    var.input = _input;
     var.module = _module;
     zis_compilation_bundle_init(&comp_bundle, z);
-    var.init_func = zis_compile_source(&comp_bundle, input, var.module);
+    var.init_func = zis_compile_source(&comp_bundle, var.input, var.module);
     zis_compilation_bundle_fini(&comp_bundle);
     int status = ZIS_OK;
     if (!var.init_func)
@@ -420,7 +443,7 @@ static bool module_loader_load_from_source(
 
 #else // ZIS_FEATURE_SRC
 
-    zis_unused_var(input), zis_unused_var(_module);
+    zis_unused_var(_input), zis_unused_var(_module);
     zis_context_set_reg0(z, zis_object_from(zis_exception_obj_format(
         z, "sys", NULL, ""
     )));
@@ -454,7 +477,9 @@ static bool module_loader_try_load_from_embedded(
 
 /* ----- public functions --------------------------------------------------- */
 
-struct zis_module_loader *zis_module_loader_create(struct zis_context *z) {
+static struct zis_module_loader *module_loader_create(
+    struct zis_context *z, struct zis_object *loaded_modules /* = NULL */
+) {
     struct zis_module_loader*const ml = zis_mem_alloc(sizeof(struct zis_module_loader));
 
     {
@@ -463,14 +488,56 @@ struct zis_module_loader *zis_module_loader_create(struct zis_context *z) {
         zis_object_vec_zero(range[0], range[1] - range[0]);
     }
     zis_objmem_add_gc_root(z, &ml->data, module_loader_data_gc_visitor);
+    ml->bootstrap_search_path_length = 0;
 
-    ml->data.search_path = zis_array_obj_new(z, NULL, 0);
-    ml->data.loaded_modules = zis_map_obj_new(z, 0.0f, 8);
+    if (loaded_modules) {
+        // Store the map before any allocation.
+        assert(zis_object_type_is(loaded_modules, z->globals->type_Map));
+        ml->data.loaded_modules = zis_object_cast(loaded_modules, struct zis_map_obj);
+        ml->data.search_path = zis_array_obj_new(z, NULL, 0);
+    } else {
+        ml->data.search_path = zis_array_obj_new(z, NULL, 0);
+        ml->data.loaded_modules = zis_map_obj_new(z, 0.0f, 8);
+    }
 
     zis_debug_log(TRACE, "Loader", "new module loader %p", (void *)ml);
     return ml;
 }
 
+struct zis_module_loader *zis_module_loader_create(struct zis_context *z) {
+    return module_loader_create(z, NULL);
+}
+
+struct zis_module_loader *zis_module_loader_create_restored(
+    struct zis_context *z, struct zis_object *loaded_modules
+) {
+    return module_loader_create(z, loaded_modules);
+}
+
+struct zis_object *zis_module_loader_loaded_modules(struct zis_module_loader *ml) {
+    return zis_object_from(ml->data.loaded_modules);
+}
+
+void zis_module_loader_set_bootstrapped(struct zis_context *z) {
+    struct zis_module_loader *const ml = z->module_loader;
+    struct module_loader_data *const d = &ml->data;
+    ml->bootstrap_search_path_length = zis_array_obj_length(d->search_path);
+    d->bootstrap_modules = zis_map_obj_combine(z, &d->loaded_modules, 1);
+    assert(d->bootstrap_modules);
+}
+
+void zis_module_loader_reset(struct zis_context *z) {
+    struct zis_module_loader *const ml = z->module_loader;
+    struct module_loader_data *const d = &ml->data;
+    assert(zis_object_type_is(zis_object_from(d->bootstrap_modules), z->globals->type_Map));
+    while (zis_array_obj_length(d->search_path) > ml->bootstrap_search_path_length)
+        zis_array_obj_pop(d->search_path);
+    struct zis_map_obj *const loaded_modules =
+        zis_map_obj_combine(z, &d->bootstrap_modules, 1);
+    assert(loaded_modules);
+    d->loaded_modules = loaded_modules;
+}
+
 void zis_module_loader_destroy(struct zis_module_loader *ml, struct zis_context *z) {
     zis_debug_log(TRACE, "Loader", "deleting loader %p", (void *)ml);
     zis_objmem_remove_gc_root(z, &ml->data);
@@ -760,6 +827,7 @@ struct zis_module_obj *zis_module_loader_import_file(
         struct zis_path_obj *file;
         struct zis_module_obj *module;
     );
+    zis_locals_zero(var);
     var.file = _file;
     var.module = _module ? _module : zis_module_obj_new(z, true);
 
@@ -773,14 +841,17 @@ struct zis_module_obj *zis_module_loader_import_file(
 
 struct zis_module_obj *zis_module_loader_import_source(
     struct zis_context *z, struct zis_module_obj *_module /* = NULL */,
-    struct zis_stream_obj *input
+    struct zis_stream_obj *_input
 ) {
     zis_locals_decl(
         z, var,
+        struct zis_stream_obj *input;
         struct zis_module_obj *module;
     );
+    zis_locals_zero(var);
+    var.input = _input;
     var.module = _module ? _module : zis_module_obj_new(z, true);
-    const bool ok = module_loader_load_from_source(z, input, var.module);
+    const bool ok = module_loader_load_from_source(z, var.input, var.module);
     zis_locals_drop(z, var);
     return ok ? var.module : NULL;
 }
@@ -8,16 +8,40 @@
 struct zis_array_obj;
 struct zis_context;
 struct zis_module_obj;
+struct zis_native_module_def;
+struct zis_object;
 struct zis_path_obj;
 struct zis_stream_obj;
 struct zis_symbol_obj;
 
+/// Get the definition of an embedded native module by its index in the list
+/// of embedded modules. Returns NULL if the index is out of range.
+const struct zis_native_module_def *zis_module_loader_embedded_module(size_t index);
+
 /// Module loader. This is a GC root.
 struct zis_module_loader;
 
 /// Create a module loader.
 struct zis_module_loader *zis_module_loader_create(struct zis_context *z);
 
+/// Create a module loader, with the map of loaded modules restored from a heap
+/// snapshot. See `zis_module_loader_loaded_modules()`.
+struct zis_module_loader *zis_module_loader_create_restored(
+    struct zis_context *z, struct zis_object *loaded_modules
+);
+
+/// Get the map of loaded modules, which is what a heap snapshot saves of a
+/// module loader. The search paths are not included.
+struct zis_object *zis_module_loader_loaded_modules(struct zis_module_loader *ml);
+
+/// Mark the currently loaded modules and search paths as the bootstrap state,
+/// to which `zis_module_loader_reset()` returns.
+void zis_module_loader_set_bootstrapped(struct zis_context *z);
+
+/// Forget the modules loaded and the search paths added after
+/// `zis_module_loader_set_bootstrapped()`. The bootstrap modules themselves are kept as they are.
+void zis_module_loader_reset(struct zis_context *z);
+
 /// Delete a module loader.
 void zis_module_loader_destroy(struct zis_module_loader *ml, struct zis_context *z);
 
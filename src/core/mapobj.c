@@ -189,7 +189,8 @@ static bool zis_hashmap_buckets_del_node(
         bkt_head_node = zis_hashmap_buckets_get_bucket(locals->buckets, key_hash);
         if (i == 0) {
             node = bkt_head_node;
-            zis_array_slots_obj_set(locals->buckets, key_hash, node->_next_node); // See `zis_hashmap_buckets_put_node()`.
+            const size_t bkt_index = key_hash % zis_hashmap_buckets_length(locals->buckets);
+            zis_array_slots_obj_set(locals->buckets, bkt_index, node->_next_node); // See `zis_hashmap_buckets_put_node()`.
         } else {
             struct zis_hashmap_bucket_node_obj * prev_node =
                 zis_hashmap_bucket_node_obj_nth_node(bkt_head_node, i - 1);
@@ -303,6 +304,7 @@ void zis_map_obj_rehash(
     );
     var.self = _self;
     var.buckets = _self->_buckets;
+    var.new_buckets = (zis_hashmap_buckets_obj_t *)zis_smallint_to_ptr(0);
     var.temp = zis_smallint_to_ptr(0);
     var.new_buckets = zis_hashmap_buckets_obj_new(z, n_buckets);
 
@@ -320,6 +322,37 @@ void zis_map_obj_rehash(
     zis_locals_drop(z, var);
 }
 
+int zis_map_obj_rehash_keys(struct zis_context *z, struct zis_map_obj *_self) {
+    zis_locals_decl(
+        z, var,
+        struct zis_map_obj *self;
+        zis_hashmap_buckets_obj_t *buckets;
+        struct zis_hashmap_bucket_node_obj *node;
+        struct zis_object *temp;
+    );
+    zis_locals_zero(var);
+    var.self = _self;
+    var.buckets = _self->_buckets;
+
+    int status = ZIS_OK;
+    zis_hashmap_buckets_foreach_node_r(var.buckets, var.temp, node, {
+        var.node = node;
+        size_t key_hash;
+        if (zis_unlikely(!zis_object_hash(&key_hash, z, node->_key))) {
+            status = ZIS_THR;
+            break;
+        }
+        var.node->key_hash = key_hash;
+    });
+
+    const size_t n_buckets = zis_hashmap_buckets_length(var.self->_buckets);
+    if (n_buckets)
+        zis_map_obj_rehash(z, var.self, n_buckets);
+
+    zis_locals_drop(z, var);
+    return status;
+}
+
 void zis_map_obj_reserve(
     struct zis_context *z,
     struct zis_map_obj *self, size_t n
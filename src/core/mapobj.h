@@ -99,6 +99,12 @@ void zis_map_obj_rehash(
     struct zis_map_obj *self, size_t n_buckets
 );
 
+/// Recompute the hash codes of the keys and rehash. Needed when the hash codes
+/// may have changed, like those made from addresses after a heap snapshot is restored.
+/// Returns `ZIS_OK` or `ZIS_THR` (throw REG-0). On failure, the remaining keys keep
+/// their old hash codes.
+int zis_map_obj_rehash_keys(struct zis_context *z, struct zis_map_obj *self);
+
 /// Reserve buckets for more elements.
 void zis_map_obj_reserve(
     struct zis_context *z,
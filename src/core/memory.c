@@ -1,6 +1,9 @@
+#define _GNU_SOURCE // mremap()
+
 #include "memory.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 #include "debug.h"
@@ -52,6 +55,44 @@ zis_malloc_fn_attrs(1, size) void *zis_vmem_alloc(size_t size) {
     return ptr;
 }
 
+zis_malloc_fn_attrs(1, size) void *zis_vmem_alloc_aligned(size_t size, size_t align) {
+    assert(align && !(align & (align - 1)));
+    void *ptr;
+#if ZIS_SYSTEM_POSIX
+    // Map more, then unmap the unaligned head and the tail.
+    const int   prot = PROT_READ | PROT_WRITE;
+    const int   flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    char *const raw = mmap(NULL, size + align, prot, flags, -1, 0);
+    if (zis_unlikely(raw == MAP_FAILED)) {
+        ptr = NULL;
+    } else {
+        char *const aligned = (char *)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+        if (aligned != raw)
+            munmap(raw, (size_t)(aligned - raw));
+        if (aligned + size != raw + size + align)
+            munmap(aligned + size, (size_t)(raw + align - aligned));
+        ptr = aligned;
+    }
+#elif ZIS_SYSTEM_WINDOWS
+    // Reserve more to find an aligned address, then release it and allocate there.
+    // Another thread may take the address in between, so retry on failure.
+    ptr = NULL;
+    for (int i = 0; i < 8 && !ptr; i++) {
+        void *const raw = VirtualAlloc(NULL, size + align, MEM_RESERVE, PAGE_NOACCESS);
+        if (zis_unlikely(!raw))
+            break;
+        void *const aligned = (void *)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+        VirtualFree(raw, 0, MEM_RELEASE);
+        ptr = VirtualAlloc(aligned, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+#else
+    ptr = NULL; // Not supported.
+#endif
+    assert(!((uintptr_t)ptr & (align - 1)));
+    zis_debug_log(INFO, "Memory", "vmem_alloc_aligned(%zu, %zu) -> %p", size, align, ptr);
+    return ptr;
+}
+
 void zis_vmem_free(void *ptr, size_t size) {
     bool ok;
     zis_debug_log(INFO, "Memory", "vmem_free(%p, %zu)", ptr, size);
@@ -81,3 +122,45 @@ size_t zis_vmem_pagesize(void) {
     return 4096;
 #endif
 }
+
+void zis_vmem_discard(void *ptr, size_t size) {
+    zis_debug_log(TRACE, "Memory", "vmem_discard(%p, %zu)", ptr, size);
+#if ZIS_SYSTEM_POSIX
+#    if defined(MADV_FREE)
+    if (madvise(ptr, size, MADV_FREE) == 0)
+        return;
+#    endif // MADV_FREE
+    madvise(ptr, size, MADV_DONTNEED);
+#elif ZIS_SYSTEM_WINDOWS
+    VirtualAlloc(ptr, size, MEM_RESET, PAGE_READWRITE);
+#else
+    zis_unused_var(ptr), zis_unused_var(size);
+#endif
+}
+
+void zis_vmem_prefault(void *ptr, size_t size) {
+    zis_debug_log(TRACE, "Memory", "vmem_prefault(%p, %zu)", ptr, size);
+#if ZIS_SYSTEM_POSIX && defined(MADV_POPULATE_WRITE) // Linux 5.14+
+    const uintptr_t page_mask = (uintptr_t)zis_vmem_pagesize() - 1;
+    const uintptr_t begin = (uintptr_t)ptr & ~page_mask;
+    const uintptr_t end = ((uintptr_t)ptr + size + page_mask) & ~page_mask;
+    madvise((void *)begin, (size_t)(end - begin), MADV_POPULATE_WRITE);
+#else
+    zis_unused_var(ptr), zis_unused_var(size);
+#endif
+}
+
+bool zis_vmem_grow(void *ptr, size_t size, size_t new_size) {
+    assert(new_size >= size);
+#if ZIS_SYSTEM_LINUX
+    const bool ok = mremap(ptr, size, new_size, 0) != MAP_FAILED;
+#else
+    zis_unused_var(ptr), zis_unused_var(size), zis_unused_var(new_size);
+    const bool ok = false;
+#endif
+    zis_debug_log(
+        TRACE, "Memory", "vmem_grow(%p, %zu, %zu) -> %s",
+        ptr, size, new_size, ok ? "ok" : "failed"
+    );
+    return ok;
+}
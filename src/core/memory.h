@@ -23,8 +23,26 @@ void zis_mem_free(void *ptr);
 /// Allocate virtual memory like `mmap()` or `VirtualAlloc()`.
 zis_malloc_fn_attrs(1, size) void *zis_vmem_alloc(size_t size);
 
+/// Alloc virtual memory like `zis_vmem_alloc()`, at an address that is a
+/// multiple of `align`, which shall be a power of 2 and a multiple of the page size.
+zis_malloc_fn_attrs(1, size) void *zis_vmem_alloc_aligned(size_t size, size_t align);
+
 /// Dealloc virtual memory like `munmap()` or `VirtualFree()`.
 void zis_vmem_free(void *ptr, size_t size);
 
+/// Tell the system that the contents of the pages are no longer needed, so that
+/// the physical memory can be reclaimed. The range stays valid, but its contents
+/// become undefined. `ptr` and `size` shall be multiples of the page size.
+void zis_vmem_discard(void *ptr, size_t size);
+
+/// Tell the system that the pages are about to be written, so that they can be
+/// made present at once rather than faulted in one by one. The range is extended
+/// to whole pages. This is only a hint and may do nothing.
+void zis_vmem_prefault(void *ptr, size_t size);
+
+/// Enlarge the virtual memory from `zis_vmem_alloc()` without moving it, like
+/// `mremap()` without `MREMAP_MAYMOVE`. Returns whether successful.
+bool zis_vmem_grow(void *ptr, size_t size, size_t new_size);
+
 /// Get virtual memory page size.
 size_t zis_vmem_pagesize(void);
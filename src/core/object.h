@@ -11,6 +11,8 @@
 #include "platform.h"
 #include "smallint.h"
 
+#include "zis_config.h" // ZIS_USE_COMPACT_OBJECT_META
+
 struct zis_type_obj;
 struct zis_object;
 
@@ -21,6 +23,8 @@ struct zis_object_meta {
 
     static_assert(ZIS_WORDSIZE == 64 || ZIS_WORDSIZE == 32, "");
 
+#if !ZIS_USE_COMPACT_OBJECT_META
+
     /**
      * @struct zis_object_meta
      * ## Object Meta Layout
@@ -37,8 +41,35 @@ struct zis_object_meta {
      */
 
     uintptr_t _1, _2;
+
+#else // ZIS_USE_COMPACT_OBJECT_META
+
+    static_assert(ZIS_WORDSIZE == 64, "ZIS_USE_COMPACT_OBJECT_META");
+
+    /**
+     * @struct zis_object_meta
+     * ## Object Meta Layout (Compact)
+     *
+     * ```
+     *      63     ...      3     2        1 0
+     *      +----------------+--------+--------+
+     * [_1] |    TYPE_PTR    | GC_MARK|GC_STATE|
+     *      +----------------+--------+--------+
+     * ```
+     *
+     * There is no GC_PTR. During a GC, an object that is to be moved is
+     * forwarded: the meta is replaced with a pointer to a forwarding record
+     * kept in a side table (see `zis_object_meta_set_forwarding()`), which
+     * holds the original meta and the new storage address.
+     */
+
+    uintptr_t _1;
+
+#endif // ZIS_USE_COMPACT_OBJECT_META
 };
 
+#if !ZIS_USE_COMPACT_OBJECT_META
+
 /// Initialize meta.
 #define zis_object_meta_init(meta, gc_state, gc_ptr, type_ptr) \
     do { (meta)._1 = (uintptr_t)(type_ptr) | (uintptr_t)(gc_state), (meta)._2 = (uintptr_t)gc_ptr; } while (0)
@@ -61,6 +92,37 @@ struct zis_object_meta {
 #define zis_object_meta_get_gc_ptr(meta, ret_type) \
     ((ret_type)((meta)._2 & ~(uintptr_t)3U))
 
+#else // ZIS_USE_COMPACT_OBJECT_META
+
+/// Initialize meta. The `gc_ptr` is ignored.
+#define zis_object_meta_init(meta, gc_state, gc_ptr, type_ptr) \
+    do { (void)(gc_ptr); (meta)._1 = (uintptr_t)(type_ptr) | (uintptr_t)(gc_state); } while (0)
+
+/// Check whether a ptr value can be stored into the meta.
+#define zis_object_meta_assert_ptr_fits(ptr) \
+    do { static_assert(sizeof(ptr) <= sizeof(uintptr_t), ""); assert(!((uintptr_t)(ptr) & 7U)); } while (0)
+
+/// Set object meta TYPE_PTR.
+#define zis_object_meta_set_type_ptr(meta, ptr) \
+    do { (meta)._1 = (uintptr_t)(ptr) | ((meta)._1 & (uintptr_t)7U); } while (0)
+/// Get object meta TYPE_PTR.
+#define zis_object_meta_get_type_ptr(meta) \
+    ((struct zis_type_obj *)((meta)._1 & ~(uintptr_t)7U))
+
+/// Forward the object to a record during GC: the meta becomes `RECORD_PTR | 0b111`,
+/// i.e., a marked BIG object, which no forwarded object could be (big objects
+/// never move, and their marks are cleared before others are forwarded).
+#define zis_object_meta_set_forwarding(meta, record_ptr) \
+    do { (meta)._1 = (uintptr_t)(record_ptr) | (uintptr_t)7U; } while (0)
+/// Check whether an object in new space or old space has been forwarded.
+#define zis_object_meta_is_forwarded(meta) \
+    (((meta)._1 & (uintptr_t)7U) == (uintptr_t)7U)
+/// Get the record of a forwarded object.
+#define zis_object_meta_get_forwarding(meta, ret_type) \
+    ((ret_type)((meta)._1 & ~(uintptr_t)7U))
+
+#endif // ZIS_USE_COMPACT_OBJECT_META
+
 /// Set object meta GC_STATE. See `enum zis_objmem_obj_state`.
 #define zis_object_meta_set_gc_state(meta, type) \
     do { (meta)._1 = (uintptr_t)(type) | ((meta)._1 & ~(uintptr_t)3U); } while (0)
@@ -74,6 +136,8 @@ struct zis_object_meta {
 #define zis_object_meta_get_gc_state_bit1(meta) \
     ((meta)._1 & (uintptr_t)2U)
 
+#if !ZIS_USE_COMPACT_OBJECT_META
+
 /// Set object meta GC_MARK to true.
 #define zis_object_meta_set_gc_mark(meta) \
     do { (meta)._2 |= (uintptr_t)1U; } while (0)
@@ -84,6 +148,20 @@ struct zis_object_meta {
 #define zis_object_meta_test_gc_mark(meta) \
     ((meta)._2 & (uintptr_t)1U)
 
+#else // ZIS_USE_COMPACT_OBJECT_META
+
+/// Set object meta GC_MARK to true.
+#define zis_object_meta_set_gc_mark(meta) \
+    do { (meta)._1 |= (uintptr_t)4U; } while (0)
+/// Set object meta GC_MARK to false.
+#define zis_object_meta_reset_gc_mark(meta) \
+    do { (meta)._1 &= ~(uintptr_t)4U; } while (0)
+/// Get object meta GC_MARK.
+#define zis_object_meta_test_gc_mark(meta) \
+    ((meta)._1 & (uintptr_t)4U)
+
+#endif // ZIS_USE_COMPACT_OBJECT_META
+
 /* ----- object basics ------------------------------------------------------ */
 
 /// Common head of any object struct.
@@ -163,6 +241,22 @@ struct zis_object {
  * a small int, and its values is `(intptr_t)x >> 1`. See `zis_object_is_smallint()`.
  */
 
+/**
+ * @struct zis_object
+ * ## Full-width references
+ *
+ * References in SLOTS are always full machine words; there is no compressed
+ * (32-bit) reference mode. Such a mode would need all of the following, each
+ * of which touches most of the core:
+ * small integers narrowed to 31 bits (many callers rely on the current range);
+ * every typed pointer field in object structs (like `zis_array_obj::_data`)
+ * read and written through encoding functions;
+ * and SLOTS no longer sharing the representation of registers and native
+ * vectors, which are copied to and from each other with `zis_object_vec_copy()`.
+ * On 64-bit targets, the object meta can be shrunk to one word instead
+ * (`ZIS_USE_COMPACT_OBJECT_META`).
+ */
+
 /// Cast an object struct pointer to `struct zis_object *`.
 #define zis_object_from(obj_ptr) \
     ((struct zis_object *)(obj_ptr))
@@ -2,8 +2,10 @@
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h> // abort()
 #include <string.h>
+#include <time.h> // clock_gettime(), timespec_get()
 
 #include "algorithm.h"
 #include "attributes.h"
@@ -13,13 +15,13 @@
 #include "debug.h"
 #include "memory.h"
 #include "object.h"
+#include "platform.h"
 #include "typeobj.h"
 
 #include "zis_config.h"
 
 #if ZIS_DEBUG
 #    include <stdio.h>
-#    include <time.h>
 #endif // ZIS_DEBUG
 
 /* ----- Configurations ----------------------------------------------------- */
@@ -29,26 +31,42 @@
 #define SIZE_MiB(N)                    (SIZE_KiB((N)) * (size_t)1024)
 #define SIZE_GiB(N)                    (SIZE_MiB((N)) * (size_t)1024)
 
-#define NON_BIG_SPACE_MAX_ALLOC_SIZE   (OBJECT_POINTER_SIZE * SIZE_KiB(1))
+#define NON_BIG_SPACE_MAX_ALLOC_SIZE   ZIS_OBJMEM_NON_BIG_SIZE_MAX
 
 #define NEW_SPACE_CHUNK_SIZE_MIN       (OBJECT_POINTER_SIZE * SIZE_KiB(4))
 #define NEW_SPACE_CHUNK_SIZE_DFL       (OBJECT_POINTER_SIZE * SIZE_KiB(64))
+#define NEW_SPACE_CHUNK_SIZE_MAX_DFL   (OBJECT_POINTER_SIZE * SIZE_KiB(1024))
+#define NEW_SPACE_GROW_SURVIVAL_DIV    8   // Grow if more than 1/N of allocations survived.
+#define NEW_SPACE_SHRINK_SURVIVAL_DIV  32  // Shrink if less than 1/N of allocations survived ...
+#define NEW_SPACE_SHRINK_INTERVAL_MS   100 // ... and the fast GCs are rarer than one per N ms.
+#define NEW_SPACE_GROW_INTERVAL_MS     1   // Grow if the fast GCs are more frequent than one per N ms.
 
 #define OLD_SPACE_CHUNK_SIZE_MIN       (OBJECT_POINTER_SIZE * SIZE_KiB(4))
 #define OLD_SPACE_CHUNK_SIZE_DFL       (OBJECT_POINTER_SIZE * SIZE_KiB(32))
 #define OLD_SPACE_SIZE_LIMIT_DFL       (SIZE_GiB(1))
+#define OLD_SPACE_THRESHOLD_MIN_CHUNKS 4
+#define OLD_SPACE_GROWTH_FACTOR        2
+#define OLD_SPACE_CHUNK_ALIGN          (SIZE_MiB(4)) // Chunk alignment and max chunk size, with compact object meta.
 
 #define BIG_SPACE_THRESHOLD_INIT_DFL   (16 * NON_BIG_SPACE_MAX_ALLOC_SIZE)
 #define BIG_SPACE_SIZE_LIMIT_DFL       (SIZE_GiB(1))
+#define BIG_SPACE_GROWTH_FACTOR        2
+#define BIG_SPACE_CACHE_CLASS_COUNT    28  // Size classes up to 256 pages.
+#define BIG_SPACE_CACHE_SIZE_MAX       (SIZE_MiB(32))
+#define BIG_SPACE_EXTENDABLE_RESERVE   (sizeof(void *) >= 8 ? 4 : 1) // Address space for extendable objects, times the size.
 
 static_assert(NON_BIG_SPACE_MAX_ALLOC_SIZE >= SIZE_KiB(4), "");
 static_assert(NEW_SPACE_CHUNK_SIZE_DFL >= NEW_SPACE_CHUNK_SIZE_MIN, "");
+static_assert(NEW_SPACE_CHUNK_SIZE_MAX_DFL >= NEW_SPACE_CHUNK_SIZE_DFL, "");
 static_assert(OLD_SPACE_CHUNK_SIZE_DFL >= OLD_SPACE_CHUNK_SIZE_MIN, "");
 static_assert(NEW_SPACE_CHUNK_SIZE_MIN > NON_BIG_SPACE_MAX_ALLOC_SIZE * 2, "");
 static_assert(OLD_SPACE_CHUNK_SIZE_MIN > NON_BIG_SPACE_MAX_ALLOC_SIZE * 2, "");
+static_assert(OLD_SPACE_CHUNK_ALIGN >= OLD_SPACE_CHUNK_SIZE_DFL, "");
 
 struct objmem_config {
     size_t new_spc_chunk_size;
+    size_t new_spc_chunk_size_min;
+    size_t new_spc_chunk_size_max;
     size_t old_spc_chunk_size;
     size_t old_spc_size_limit;
     size_t big_spc_threshold_init;
@@ -63,6 +81,17 @@ static void objmem_config_conv(struct objmem_config *config, const struct zis_ob
         config->new_spc_chunk_size = NEW_SPACE_CHUNK_SIZE_MIN;
     else
         config->new_spc_chunk_size = opts->new_space_size / 2;
+    if (opts->new_space_size_max == 0)
+        config->new_spc_chunk_size_max = NEW_SPACE_CHUNK_SIZE_MAX_DFL;
+    else
+        config->new_spc_chunk_size_max = opts->new_space_size_max / 2;
+    if (config->new_spc_chunk_size_max <= config->new_spc_chunk_size) {
+        // Fixed size.
+        config->new_spc_chunk_size_max = config->new_spc_chunk_size;
+        config->new_spc_chunk_size_min = config->new_spc_chunk_size;
+    } else {
+        config->new_spc_chunk_size_min = NEW_SPACE_CHUNK_SIZE_MIN;
+    }
     // old space
     if (opts->old_space_size_new == 0)
         config->old_spc_chunk_size = OLD_SPACE_CHUNK_SIZE_DFL;
@@ -70,6 +99,8 @@ static void objmem_config_conv(struct objmem_config *config, const struct zis_ob
         config->old_spc_chunk_size = OLD_SPACE_CHUNK_SIZE_MIN;
     else
         config->old_spc_chunk_size = opts->old_space_size_new;
+    if (ZIS_USE_COMPACT_OBJECT_META && config->old_spc_chunk_size > OLD_SPACE_CHUNK_ALIGN)
+        config->old_spc_chunk_size = OLD_SPACE_CHUNK_ALIGN;
     if (opts->old_space_size_max == 0)
         config->old_spc_size_limit = OLD_SPACE_SIZE_LIMIT_DFL;
     else if (opts->old_space_size_max < config->old_spc_chunk_size)
@@ -87,6 +118,19 @@ static void objmem_config_conv(struct objmem_config *config, const struct zis_ob
         config->big_spc_size_limit = opts->big_space_size_max;
 }
 
+/* ----- Clock -------------------------------------------------------------- */
+
+/// Read a monotonic clock, in nanoseconds.
+static uint64_t objmem_clock_ns(void) {
+    struct timespec ts;
+#if ZIS_SYSTEM_POSIX || (defined(__MINGW32__) && !defined(_UCRT))
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    timespec_get(&ts, TIME_UTC);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
 /* ----- Memory span set with function pointer ------------------------------ */
 
 /// A record of span.
@@ -209,6 +253,122 @@ static bool mem_span_set_remove(struct mem_span_set *set, void *span_addr) {
     return true;
 }
 
+/* ----- GC forwarding table ----------------------------------------------- */
+
+/*
+ * Without compact object meta, the new storage address of a moved object is
+ * written to the GC_PTR in its meta. With compact object meta, there is no
+ * GC_PTR; the original meta and the new address are written to a record in
+ * the forwarding table, and the meta is replaced with a pointer to the record.
+ * See `zis_object_meta_set_forwarding()`.
+ */
+
+#define FWD_TABLE_BLOCK_RECORDS 4096
+
+#if ZIS_USE_COMPACT_OBJECT_META
+
+/// A block of forwarding records.
+struct fwd_table_block {
+    struct fwd_table_block *_next;
+    struct _zis_objmem_fwd_record records[FWD_TABLE_BLOCK_RECORDS];
+};
+
+#endif // ZIS_USE_COMPACT_OBJECT_META
+
+/// The forwarding table. Records are valid until the table is reset.
+struct fwd_table {
+#if ZIS_USE_COMPACT_OBJECT_META
+    struct fwd_table_block *_blocks; // The first one is in use.
+    size_t _used_count; // Number of used records in the first block.
+#else // !ZIS_USE_COMPACT_OBJECT_META
+    char _unused;
+#endif // ZIS_USE_COMPACT_OBJECT_META
+};
+
+#if ZIS_USE_COMPACT_OBJECT_META
+
+/// Initialize the table.
+static void fwd_table_init(struct fwd_table *table) {
+    table->_blocks = NULL;
+    table->_used_count = FWD_TABLE_BLOCK_RECORDS;
+}
+
+/// Delete all records and blocks.
+static void fwd_table_fini(struct fwd_table *table) {
+    for (struct fwd_table_block *block = table->_blocks; block; ) {
+        struct fwd_table_block *const next = block->_next;
+        zis_mem_free(block);
+        block = next;
+    }
+    table->_blocks = NULL;
+    table->_used_count = FWD_TABLE_BLOCK_RECORDS;
+}
+
+/// Delete all records. The last block is kept for reuse.
+static void fwd_table_reset(struct fwd_table *table) {
+    struct fwd_table_block *block = table->_blocks;
+    if (!block)
+        return;
+    while (block->_next) {
+        struct fwd_table_block *const next = block->_next;
+        zis_mem_free(block);
+        block = next;
+    }
+    table->_blocks = block;
+    table->_used_count = 0;
+}
+
+/// Allocate a record.
+zis_force_inline static struct _zis_objmem_fwd_record *
+fwd_table_alloc(struct fwd_table *table) {
+    if (zis_unlikely(table->_used_count >= FWD_TABLE_BLOCK_RECORDS)) {
+        struct fwd_table_block *const block = zis_mem_alloc(sizeof(struct fwd_table_block));
+        assert(block);
+        block->_next = table->_blocks;
+        table->_blocks = block;
+        table->_used_count = 0;
+    }
+    return &table->_blocks->records[table->_used_count++];
+}
+
+#else // !ZIS_USE_COMPACT_OBJECT_META
+
+#define fwd_table_init(table)  ((void)(table))
+#define fwd_table_fini(table)  ((void)(table))
+#define fwd_table_reset(table) ((void)(table))
+
+#endif // ZIS_USE_COMPACT_OBJECT_META
+
+/// GC: record the new storage of an object that is going to be moved.
+zis_force_inline static void
+gc_forward_object(struct fwd_table *table, struct zis_object *obj, void *new_mem) {
+#if ZIS_USE_COMPACT_OBJECT_META
+    assert(!zis_object_meta_is_forwarded(obj->_meta));
+    struct _zis_objmem_fwd_record *const rec = fwd_table_alloc(table);
+    rec->new_obj = new_mem;
+    rec->orig_meta = obj->_meta;
+    zis_object_meta_set_forwarding(obj->_meta, rec);
+#else // !ZIS_USE_COMPACT_OBJECT_META
+    zis_unused_var(table);
+    zis_object_meta_assert_ptr_fits(new_mem);
+    zis_object_meta_set_gc_ptr(obj->_meta, new_mem);
+#endif // ZIS_USE_COMPACT_OBJECT_META
+}
+
+/// GC: get the original meta of an object, which may have been forwarded.
+zis_force_inline static struct zis_object_meta *gc_object_meta_ref(struct zis_object *obj) {
+#if ZIS_USE_COMPACT_OBJECT_META
+    if (zis_object_meta_is_forwarded(obj->_meta))
+        return &zis_object_meta_get_forwarding(obj->_meta, struct _zis_objmem_fwd_record *)->orig_meta;
+#endif // ZIS_USE_COMPACT_OBJECT_META
+    return &obj->_meta;
+}
+
+/// GC: get the type of an object, which may have been forwarded.
+zis_force_inline static struct zis_type_obj *gc_object_type(struct zis_object *obj) {
+    return zis_object_meta_get_type_ptr(*gc_object_meta_ref(obj));
+}
+
 /* ----- Memory chunk ------------------------------------------------------- */
 
 /// A huge block of memory from where smaller memory block can be allocated.
@@ -256,6 +416,17 @@ static struct mem_chunk *mem_chunk_create(size_t size) {
     return chunk;
 }
 
+/// Allocate a chunk (virtual memory) at an address that is a multiple of `align`.
+static struct mem_chunk *mem_chunk_create_aligned(size_t size, size_t align) {
+    assert(size > sizeof(struct mem_chunk) && size <= align);
+    struct mem_chunk *const chunk = zis_vmem_alloc_aligned(size, align);
+    assert(chunk);
+    chunk->_free = chunk->_mem;
+    chunk->_end  = (char *)chunk + size;
+    chunk->_next = NULL;
+    return chunk;
+}
+
 /// Deallocate a chunk.
 static void mem_chunk_destroy(struct mem_chunk *chunk) {
     assert(chunk->_end >= chunk->_mem);
@@ -300,9 +471,10 @@ static void mem_chunk_allocated(
             (void *)__this_obj < allocated_end;                                \
             __this_obj = (struct zis_object *)((char *)__this_obj + __obj_size)\
         ) {                                                                    \
-            __obj_size = zis_object_size(__this_obj);                          \
+            struct zis_type_obj *const __obj_type = gc_object_type(__this_obj);\
+            __obj_size = zis_object_size_by_type(__this_obj, __obj_type);      \
             struct zis_object *const OBJ_VAR = __this_obj;                     \
-            struct zis_type_obj *const OBJ_TYPE_VAR = zis_object_type(__this_obj); \
+            struct zis_type_obj *const OBJ_TYPE_VAR = __obj_type;              \
             const size_t OBJ_SIZE_VAR = __obj_size;                            \
             STMT                                                               \
         }                                                                      \
@@ -410,71 +582,79 @@ static void mem_chunk_list_pop_after(
     list->_tail->_next = NULL;
 }
 
-/// Create chunk and add it to the list tail.
-static struct mem_chunk *mem_chunk_list_append_created(
-    struct mem_chunk_list *list, size_t chunk_size
-) {
-    struct mem_chunk *const chunk = mem_chunk_create(chunk_size);
-    mem_chunk_list_append(list, chunk);
-    return chunk;
-}
-
-/// Delete chunks after the given one.
-static void mem_chunk_list_destroy_after(
-    struct mem_chunk_list *list, const struct mem_chunk *after_chunk
-) {
-    struct mem_chunk *const first_chunk = after_chunk->_next;
-    mem_chunk_list_pop_after(list, after_chunk);
-    _mem_chunk_list_del_from(first_chunk);
-}
-
 /* ----- Big space (old generation, large objects) -------------------------- */
 
 /*
  * In big space, mark-sweep GC algorithm is used.
  * All allocated objects are put in a linked list.
- * The GC_PTR in object meta stores the next object in the list.
- * `GC_PTR & 0b0100` indicates whether this object contains references to young objects.
+ * Each object is stored after a `struct big_space_block` header, whose link
+ * field stores the next object in the list; `link & 0b0100` indicates whether
+ * this object contains references to young objects. The GC_PTR in object meta
+ * is not used.
+ *
+ * Small objects (pinned ones) are allocated with `zis_mem_alloc()`. Large
+ * objects are allocated with `zis_vmem_alloc()`, in mappings whose numbers of
+ * pages are rounded up to size classes (exact up to 8 pages, then 4 classes per doubling). Mappings freed
+ * in a full GC are discarded (`zis_vmem_discard()`) except the first page, and
+ * cached by class for reuse until the next full GC, which unmaps those left.
+ * Objects with extendable slots get more address space than they need (pages
+ * that are never touched cost no physical memory), so that they can grow in
+ * place; a mapping can also grow in place with `zis_vmem_grow()` if possible.
  */
 
-struct _big_space_head {
-    ZIS_OBJECT_HEAD
+/// Header of a block of memory in big space. The object follows.
+struct big_space_block {
+    size_t size; // Size of the block (rounded up to pages if in vmem), including the header.
+    size_t map_size; // Size of the mapping, for blocks from vmem.
+    union {
+        uintptr_t _link; // Next object in the list and flags. See `big_space_make_link()`.
+        struct big_space_block *_next_cached; // Next cached block.
+    };
 };
 
-static_assert(
-    sizeof(struct _big_space_head) == sizeof(struct zis_object),
-    "struct _big_space_head"
-);
+#define big_space_block_of_obj(OBJ_PTR) \
+    ((struct big_space_block *)((char *)(OBJ_PTR) - sizeof(struct big_space_block)))
+
+#define big_space_block_obj(BLOCK_PTR) \
+    ((struct zis_object *)((char *)(BLOCK_PTR) + sizeof(struct big_space_block)))
+
+/// Check whether the block is from `zis_vmem_alloc()`.
+#define big_space_block_is_vmem(BLOCK_PTR) \
+    ((BLOCK_PTR)->size > sizeof(struct big_space_block) + NON_BIG_SPACE_MAX_ALLOC_SIZE)
 
 /// Big space manager.
 struct big_space {
     size_t allocated_size;
     size_t threshold_size;
-    struct _big_space_head _head; // Fake object.
+    size_t threshold_size_min;
+    size_t size_limit;
+    struct big_space_block _head; // Fake block, whose link is the first object.
+    size_t page_size;
+    size_t cached_size;
+    struct big_space_block *_cached_blocks[BIG_SPACE_CACHE_CLASS_COUNT];
 };
 
-zis_force_inline static struct zis_object *_big_space_head(struct big_space *space) {
-    return (struct zis_object *)&space->_head;
-}
-
-#define big_space_make_meta_ptr_data(NEXT_OBJ, YOUNG_REF) \
+#define big_space_make_link(NEXT_OBJ, YOUNG_REF) \
     ( assert(!((uintptr_t)NEXT_OBJ & 7)), ((uintptr_t)NEXT_OBJ | (YOUNG_REF ? 4 : 0)) )
 
-#define big_space_unpack_meta_ptr_data(PTR_DATA, NEXT_OBJ_VAR, YOUNG_REF_VAR) \
-    do {                                                                      \
-        NEXT_OBJ_VAR  = (struct zis_object *)(PTR_DATA & ~(uintptr_t)7);      \
-        YOUNG_REF_VAR = PTR_DATA & 7;                                         \
+#define big_space_unpack_link(LINK, NEXT_OBJ_VAR, YOUNG_REF_VAR) \
+    do {                                                         \
+        NEXT_OBJ_VAR  = (struct zis_object *)(LINK & ~(uintptr_t)7); \
+        YOUNG_REF_VAR = LINK & 7;                                \
     } while (0)
 
+/// The link field of an object, which is an lvalue.
+#define big_space_obj_link(OBJ_PTR) \
+    (big_space_block_of_obj(OBJ_PTR)->_link)
+
 /// Iterate over objects. Object will not be access after `STMT`.
 #define big_space_foreach(space, OBJ_VAR, OBJ_HAS_YOUNG_VAR, STMT) \
     do {                                                           \
         struct zis_object *__obj, *__next_obj;                     \
         bool __young_ref;                                          \
         for (__obj = _big_space_get_first((space)); __obj; __obj = __next_obj) { \
-            big_space_unpack_meta_ptr_data(                        \
-                zis_object_meta_get_gc_ptr(__obj->_meta, uintptr_t),             \
-                __next_obj, __young_ref                            \
+            big_space_unpack_link(                                 \
+                big_space_obj_link(__obj), __next_obj, __young_ref \
             );                                                     \
             {                                                      \
                 struct zis_object *const OBJ_VAR = __obj;          \
@@ -485,22 +665,22 @@ zis_force_inline static struct zis_object *_big_space_head(struct big_space *spa
     } while (0)                                                    \
 // ^^^ big_space_foreach() ^^^
 
-/// Iterate over objects. Providing the predecessors.
-#define big_space_foreach_2(space, PREV_OBJ_VAR, OBJ_VAR, STMT) \
+/// Iterate over objects. Providing the blocks of the predecessors.
+#define big_space_foreach_2(space, PREV_BLOCK_VAR, OBJ_VAR, STMT) \
     do {                                                        \
-        struct zis_object *__prev_obj, *__this_obj;             \
+        struct big_space_block *__prev_block;                   \
+        struct zis_object *__this_obj;                          \
         bool __young_ref;                                       \
-        for (__prev_obj = _big_space_head(space); ; __prev_obj = __this_obj) { \
-            big_space_unpack_meta_ptr_data(                     \
-                zis_object_meta_get_gc_ptr(__prev_obj->_meta, uintptr_t),      \
-                __this_obj, __young_ref                         \
+        for (__prev_block = &(space)->_head; ; __prev_block = big_space_block_of_obj(__this_obj)) { \
+            big_space_unpack_link(                              \
+                __prev_block->_link, __this_obj, __young_ref    \
             );                                                  \
             zis_unused_var(__young_ref);                        \
             if (zis_unlikely(!__this_obj))                      \
                 break;                                          \
             {                                                   \
-                struct zis_object *const PREV_OBJ_VAR = __prev_obj;            \
-                struct zis_object *const OBJ_VAR      = __this_obj;            \
+                struct big_space_block *const PREV_BLOCK_VAR = __prev_block;   \
+                struct zis_object *const OBJ_VAR = __this_obj;  \
                 STMT                                            \
             }                                                   \
         }                                                       \
@@ -508,24 +688,104 @@ zis_force_inline static struct zis_object *_big_space_head(struct big_space *spa
 // ^^^ big_space_foreach_2() ^^^
 
 static struct zis_object *_big_space_get_first(struct big_space *space) {
-    const uintptr_t ptr_data =
-        zis_object_meta_get_gc_ptr(space->_head._meta, uintptr_t);
-    assert(!(ptr_data & 7));
-    return (struct zis_object *)ptr_data;
+    const uintptr_t link = space->_head._link;
+    assert(!(link & 7));
+    return (struct zis_object *)link;
 }
 
 static void _big_space_set_first(struct big_space *space, struct zis_object *obj) {
-    zis_object_meta_set_gc_ptr(
-        space->_head._meta,
-        big_space_make_meta_ptr_data(obj, false)
-    );
+    space->_head._link = big_space_make_link(obj, false);
 }
 
 /// Initialize space.
 static void big_space_init(struct big_space *space, const struct objmem_config *conf) {
     space->allocated_size = 0U;
     space->threshold_size = conf->big_spc_threshold_init;
-    zis_object_meta_init(space->_head._meta, ZIS_OBJMEM_OBJ_BIG, 0U, NULL);
+    space->threshold_size_min = conf->big_spc_threshold_init;
+    space->size_limit = conf->big_spc_size_limit;
+    space->_head.size = 0, space->_head.map_size = 0;
+    space->_head._link = 0U;
+    space->page_size = zis_vmem_pagesize();
+    space->cached_size = 0;
+    for (size_t i = 0; i < BIG_SPACE_CACHE_CLASS_COUNT; i++)
+        space->_cached_blocks[i] = NULL;
+}
+
+/// Round up a size to its size class. Returns the class index, which may be
+/// greater than or equal to `BIG_SPACE_CACHE_CLASS_COUNT` for huge sizes.
+static size_t big_space_size_class(struct big_space *space, size_t *size) {
+    const size_t page_size = space->page_size;
+    size_t pages = (*size + page_size - 1) / page_size;
+    size_t index;
+    if (pages <= 8) {
+        index = pages - 1;
+    } else {
+        const unsigned int width = // Bit width of `pages - 1`, >= 4.
+            (unsigned int)(sizeof(size_t) * 8) - zis_bits_count_lz(pages - 1);
+        const unsigned int shift = width - 3;
+        pages = ((pages - 1) >> shift) + 1; // 5 ~ 8
+        index = pages == 8 ?
+            7 + (width - 3) * 4 : // (4 << (shift + 1))
+            7 + (width - 4) * 4 + (pages - 4);
+        pages <<= shift;
+    }
+    *size = pages * page_size;
+    return index;
+}
+
+/// Allocate a block of `size` bytes from vmem or the cache, in a mapping of at least `map_size` bytes.
+static struct big_space_block *big_space_alloc_vmem_block(
+    struct big_space *space, size_t size, size_t map_size
+) {
+    assert(map_size >= size);
+    const size_t class_index = big_space_size_class(space, &map_size);
+    struct big_space_block *block;
+    if (class_index < BIG_SPACE_CACHE_CLASS_COUNT && (block = space->_cached_blocks[class_index])) {
+        assert(block->map_size == map_size);
+        space->_cached_blocks[class_index] = block->_next_cached;
+        space->cached_size -= map_size;
+    } else {
+        block = zis_vmem_alloc(map_size);
+        if (zis_unlikely(!block))
+            return NULL;
+        block->map_size = map_size;
+    }
+    block->size = zis_round_up_to_n_pow2(space->page_size, size);
+    return block;
+}
+
+/// Deallocate a block. Blocks from vmem may be cached.
+static void big_space_free_block(struct big_space *space, struct big_space_block *block) {
+    if (!big_space_block_is_vmem(block)) {
+        zis_mem_free(block);
+        return;
+    }
+    size_t map_size = block->map_size;
+    const size_t class_index = big_space_size_class(space, &map_size);
+    assert(map_size == block->map_size);
+    if (class_index < BIG_SPACE_CACHE_CLASS_COUNT && space->cached_size + map_size <= BIG_SPACE_CACHE_SIZE_MAX) {
+        // The first page is kept, where the header is stored.
+        zis_vmem_discard((char *)block + space->page_size, map_size - space->page_size);
+        block->_next_cached = space->_cached_blocks[class_index];
+        space->_cached_blocks[class_index] = block;
+        space->cached_size += map_size;
+        return;
+    }
+    zis_vmem_free(block, map_size);
+}
+
+/// Unmap all cached blocks.
+static void big_space_release_cached_blocks(struct big_space *space) {
+    for (size_t i = 0; i < BIG_SPACE_CACHE_CLASS_COUNT; i++) {
+        struct big_space_block *block = space->_cached_blocks[i];
+        while (block) {
+            struct big_space_block *const next = block->_next_cached;
+            zis_vmem_free(block, block->map_size);
+            block = next;
+        }
+        space->_cached_blocks[i] = NULL;
+    }
+    space->cached_size = 0;
 }
 
 /// Finalize allocated objects and the space.
@@ -533,8 +793,9 @@ static void big_space_fini(struct big_space *space) {
     big_space_foreach(space, obj, has_young, {
         zis_unused_var(has_young);
         // NOTE: object terminates here.
-        zis_mem_free(obj);
+        big_space_free_block(space, big_space_block_of_obj(obj));
     });
+    big_space_release_cached_blocks(space);
 }
 
 #if ZIS_DEBUG
@@ -542,14 +803,16 @@ static void big_space_fini(struct big_space *space) {
 zis_unused_fn
 static void big_space_print_usage(struct big_space *space, FILE *stream) {
     fprintf(
-        stream, "<BigSpc threshold_size=\"%zu\" allocated_size=\"%zu\">\n",
-        space->threshold_size , space->allocated_size
+        stream, "<BigSpc threshold_size=\"%zu\" allocated_size=\"%zu\" cached_size=\"%zu\">\n",
+        space->threshold_size , space->allocated_size, space->cached_size
     );
     big_space_foreach(space, obj, has_young, {
         fprintf(
             stream,
-            "  <obj addr=\"%p\" has_young=\"%s\" />\n",
+            "  <obj addr=\"%p\" block_size=\"%zu\" map_size=\"%zu\" has_young=\"%s\" />\n",
             (void *)obj,
+            big_space_block_of_obj(obj)->size,
+            big_space_block_of_obj(obj)->map_size,
             has_young ? "yes" : "no"
         );
     });
@@ -562,33 +825,91 @@ static void big_space_print_usage(struct big_space *space, FILE *stream) {
 zis_force_inline static struct zis_object *
 big_space_alloc(struct big_space *space, void *type_ptr, size_t size) {
     assert(size >= sizeof(struct zis_object_meta));
-    const size_t new_allocated_size = space->allocated_size + size;
-    if (zis_unlikely(new_allocated_size > space->threshold_size))
+    if (zis_unlikely(size > SIZE_MAX / 2 / BIG_SPACE_EXTENDABLE_RESERVE))
+        return NULL; // The block size or its reserved mapping would not fit in `size_t`.
+    struct big_space_block *block;
+    size_t block_size = sizeof(struct big_space_block) + size;
+    if (zis_unlikely(space->allocated_size + block_size > space->threshold_size))
         return NULL;
-    space->allocated_size = new_allocated_size;
-    struct zis_object *const obj = zis_mem_alloc(size);
-    const uintptr_t ptr_data =
-        big_space_make_meta_ptr_data(_big_space_get_first(space), false);
+    if (size <= NON_BIG_SPACE_MAX_ALLOC_SIZE) {
+        block = zis_mem_alloc(block_size);
+        if (zis_unlikely(!block))
+            return NULL;
+        block->size = block_size;
+        block->map_size = 0;
+    } else {
+        struct zis_type_obj *const type = type_ptr;
+        const bool extendable = type && type->_slots_num == (size_t)-1 && type->_bytes_len == 0;
+        block = big_space_alloc_vmem_block(
+            space, block_size,
+            extendable ? block_size * BIG_SPACE_EXTENDABLE_RESERVE : block_size
+        );
+        if (zis_unlikely(!block))
+            return NULL;
+        block_size = block->size;
+    }
+    assert(big_space_block_is_vmem(block) == (size > NON_BIG_SPACE_MAX_ALLOC_SIZE));
+    space->allocated_size += block_size;
+    struct zis_object *const obj = big_space_block_obj(block);
+    block->_link = big_space_make_link(_big_space_get_first(space), false);
     _big_space_set_first(space, obj);
-    zis_object_meta_assert_ptr_fits(ptr_data);
     zis_object_meta_assert_ptr_fits(type_ptr);
-    zis_object_meta_init(obj->_meta, ZIS_OBJMEM_OBJ_BIG, ptr_data, type_ptr);
+    zis_object_meta_init(obj->_meta, ZIS_OBJMEM_OBJ_BIG, 0U, type_ptr);
     return obj;
 }
 
+/// Enlarge the storage of an object without moving it, which is possible only
+/// for objects in vmem. Returns whether successful. The object size is not updated.
+static bool big_space_try_extend(struct big_space *space, struct zis_object *obj, size_t new_size) {
+    struct big_space_block *const block = big_space_block_of_obj(obj);
+    if (!big_space_block_is_vmem(block))
+        return false;
+    const size_t new_block_size =
+        zis_round_up_to_n_pow2(space->page_size, sizeof(struct big_space_block) + new_size);
+    if (new_block_size <= block->size)
+        return true;
+    const size_t increased_size = new_block_size - block->size;
+    if (new_block_size > block->map_size) {
+        size_t new_map_size = new_block_size;
+        big_space_size_class(space, &new_map_size);
+        if (!zis_vmem_grow(block, block->map_size, new_map_size))
+            return false;
+        block->map_size = new_map_size;
+    }
+    block->size = new_block_size;
+    // The object is alive; a GC would not help. Keep the headroom instead.
+    space->allocated_size += increased_size;
+    space->threshold_size += increased_size;
+    return true;
+}
+
+/// Set the threshold according to the size of survivors and the size to be allocated.
+static void _big_space_update_threshold(struct big_space *space, size_t extra_size) {
+    const size_t size = space->allocated_size + extra_size;
+    size_t n = size * BIG_SPACE_GROWTH_FACTOR;
+    if (n < space->threshold_size_min)
+        n = space->threshold_size_min;
+    if (n > space->size_limit)
+        n = space->size_limit > size ? space->size_limit : size;
+    space->threshold_size = n;
+}
+
+/// Raise the threshold so that an object of `obj_size` bytes can be allocated.
+static void big_space_raise_threshold(struct big_space *space, size_t obj_size) {
+    size_t block_size = sizeof(struct big_space_block) + obj_size;
+    if (obj_size > NON_BIG_SPACE_MAX_ALLOC_SIZE)
+        block_size = zis_round_up_to_n_pow2(space->page_size, block_size);
+    _big_space_update_threshold(space, block_size);
+}
+
+/// Full GC: set the threshold according to the size of survivors.
+static void big_space_update_threshold(struct big_space *space) {
+    _big_space_update_threshold(space, 0);
+}
+
 /// Write barrier: mark object containing young reference.
 zis_force_inline static void big_space_remember_object(struct zis_object *obj) {
-    struct zis_object *next_obj;
-    bool orig_young_ref;
-    big_space_unpack_meta_ptr_data(
-        zis_object_meta_get_gc_ptr(obj->_meta, uintptr_t),
-        next_obj, orig_young_ref
-    );
-    if (!orig_young_ref) {
-        uintptr_t new_ptr_data = big_space_make_meta_ptr_data(next_obj, true);
-        zis_object_meta_assert_ptr_fits(new_ptr_data);
-        zis_object_meta_set_gc_ptr(obj->_meta, new_ptr_data);
-    }
+    big_space_obj_link(obj) |= 4;
 }
 
 /// Fast GC: mark young slots of remembered objects. Return number of found objects.
@@ -620,10 +941,7 @@ static size_t big_space_update_remembered_objects_references_and_forget_remember
             _zis_objmem_move_object_slots(obj);
             // Clear remembered flag.
             void *const next_obj = __next_obj; // `__next_obj` is defined in `big_space_foreach()`.
-            zis_object_meta_set_gc_ptr(
-                obj->_meta,
-                big_space_make_meta_ptr_data(next_obj, false)
-            );
+            big_space_obj_link(obj) = big_space_make_link(next_obj, false);
         }
     });
     return count;
@@ -636,36 +954,29 @@ static void big_space_delete_unreachable_objects_and_reset_reachable_objects(
 ) {
     size_t deleted_size = 0;
 
-    big_space_foreach_2(space, prev_obj, obj, {
+    // Cached blocks that have not been reused since the last GC are not likely to be needed.
+    big_space_release_cached_blocks(space);
+
+    big_space_foreach_2(space, prev_block, obj, {
         void *next_obj;
         bool obj_has_young;
-        big_space_unpack_meta_ptr_data(
-            zis_object_meta_get_gc_ptr(obj->_meta, uintptr_t),
-            next_obj, obj_has_young
-        );
+        big_space_unpack_link(big_space_obj_link(obj), next_obj, obj_has_young);
         if (zis_likely(zis_object_meta_test_gc_mark(obj->_meta))) {
             // Clear mark.
             zis_object_meta_reset_gc_mark(obj->_meta);
             // Clear remembered flag.
-            if (zis_unlikely(obj_has_young)) {
-                zis_object_meta_set_gc_ptr(
-                    obj->_meta,
-                    big_space_make_meta_ptr_data(next_obj, false)
-                );
-            }
+            if (zis_unlikely(obj_has_young))
+                big_space_obj_link(obj) = big_space_make_link(next_obj, false);
         } else {
             // Delete object.
-            const size_t obj_size = zis_object_size(obj);
+            struct big_space_block *const block = big_space_block_of_obj(obj);
             // NOTE: object terminates here.
-            deleted_size += obj_size;
-            zis_mem_free(obj);
+            deleted_size += block->size;
+            big_space_free_block(space, block);
             // Remove list node.
-            zis_object_meta_set_gc_ptr(
-                prev_obj->_meta,
-                big_space_make_meta_ptr_data(next_obj, false)
-            );
+            prev_block->_link = big_space_make_link(next_obj, false);
             // Backward.
-            __this_obj = __prev_obj; // `__this_obj` and `__prev_obj` are define in `big_space_foreach_2()`.
+            __this_obj = big_space_block_obj(prev_block); // `__this_obj` is defined in `big_space_foreach_2()`.
             // FIXME: This is ugly.
         }
     });
@@ -705,6 +1016,8 @@ static int big_space_post_gc_check(struct big_space *space) {
  * In old space, mark-compact GC algorithm is used.
  * Object storage is allocated from chunks, while the chunks are put in a list.
  * The GC_PTR in object meta stores a pointer to chunk meta when GC is not running.
+ * With compact object meta, chunks are aligned to `OLD_SPACE_CHUNK_ALIGN`
+ * instead, so that the chunk meta can be found from the object address.
  * A remembered set is available for each chunk (a pointer at the beginning of chunk)
  * indicating which objects in this chunk contains references to young objects.
  */
@@ -804,34 +1117,68 @@ zis_force_inline static void old_space_chunk_remembered_set_record(
 /// Old space manager.
 struct old_space {
     struct mem_chunk_list _chunks;
+    struct mem_chunk *_spare_chunks; // Unused chunks kept for reuse, linked by `_next`.
+    size_t spare_chunk_count;
     size_t chunk_size;
+    size_t chunk_count;
+    size_t chunk_count_threshold; // Grow beyond this only in full GC.
+    size_t chunk_count_limit;
 };
 
+/// Max number of unused chunks to keep after a full GC.
+#define OLD_SPACE_SPARE_CHUNK_MAX 8
+
 /// Meta data of a old space chunk.
 /// Must be the first block of memory allocated from the chunk.
 struct old_space_chunk_meta {
     struct old_space_chunk_remembered_set *remembered_set; // Nullable.
     void *iter_visited_end; // Nullable.
+#if ZIS_USE_GC_SIDE_MARKS
+    struct zis_bitset *mark_bits; // GC marks of objects, indexed by offset in words.
+    size_t mark_bits_size;
+#endif // ZIS_USE_GC_SIDE_MARKS
 };
 
 /// Initialize chunk meta.
-static void old_space_chunk_meta_init(struct old_space_chunk_meta *meta) {
+static void old_space_chunk_meta_init(struct old_space_chunk_meta *meta, size_t chunk_size) {
     meta->remembered_set = NULL;
     meta->iter_visited_end = NULL;
+#if ZIS_USE_GC_SIDE_MARKS
+    // The bitmap is allocated outside the chunk, so that marking objects
+    // does not write to the pages that hold them.
+    meta->mark_bits_size = zis_bitset_required_size(chunk_size / sizeof(void *));
+    meta->mark_bits = zis_mem_alloc(meta->mark_bits_size);
+    zis_bitset_clear(meta->mark_bits, meta->mark_bits_size);
+#else // !ZIS_USE_GC_SIDE_MARKS
+    zis_unused_var(chunk_size);
+#endif // ZIS_USE_GC_SIDE_MARKS
 }
 
 /// Finalize chunk meta.
 static void old_space_chunk_meta_fini(struct old_space_chunk_meta *meta) {
     if (meta->remembered_set)
         old_space_chunk_remembered_set_destroy(meta->remembered_set);
+#if ZIS_USE_GC_SIDE_MARKS
+    zis_mem_free(meta->mark_bits);
+#endif // ZIS_USE_GC_SIDE_MARKS
 }
 
 #define old_space_chunk_meta_addr(CHUNK_PTR) \
     ((struct old_space_chunk_meta *)&((CHUNK_PTR)->_mem[0]))
 
+#if !ZIS_USE_COMPACT_OBJECT_META
+
 #define old_space_chunk_meta_of_obj(OBJ_PTR) \
     (zis_object_meta_get_gc_ptr((OBJ_PTR)->_meta, struct old_space_chunk_meta *))
 
+#else // ZIS_USE_COMPACT_OBJECT_META
+
+#define old_space_chunk_meta_of_obj(OBJ_PTR) \
+    old_space_chunk_meta_addr((struct mem_chunk *) \
+        ((uintptr_t)(OBJ_PTR) & ~(uintptr_t)(OLD_SPACE_CHUNK_ALIGN - 1)))
+
+#endif // ZIS_USE_COMPACT_OBJECT_META
+
 #define old_space_chunk_of_meta(META_PTR) \
     ((struct mem_chunk *)((char *)(META_PTR) - offsetof(struct mem_chunk, _mem)))
 
@@ -840,6 +1187,44 @@ static void old_space_chunk_meta_fini(struct old_space_chunk_meta *meta) {
         ((char *)old_space_chunk_meta_addr(CHUNK_PTR) \
             + sizeof(struct old_space_chunk_meta)))
 
+#if ZIS_USE_GC_SIDE_MARKS
+
+#define _old_space_chunk_mark_bit_index(META_PTR, OBJ_PTR) \
+    ((size_t)((char *)(OBJ_PTR) - (char *)(META_PTR)) / sizeof(void *))
+
+/// Check the GC mark of an object in the chunk.
+zis_force_inline static bool old_space_chunk_test_mark(
+    struct old_space_chunk_meta *meta, struct zis_object *obj
+) {
+    return zis_bitset_test_bit(meta->mark_bits, _old_space_chunk_mark_bit_index(meta, obj));
+}
+
+/// Set the GC mark of an object in the chunk. Returns the old mark.
+zis_force_inline static bool old_space_chunk_test_and_set_mark(
+    struct old_space_chunk_meta *meta, struct zis_object *obj
+) {
+    const size_t bit_index = _old_space_chunk_mark_bit_index(meta, obj);
+    if (zis_bitset_test_bit(meta->mark_bits, bit_index))
+        return true;
+    zis_bitset_set_bit(meta->mark_bits, bit_index);
+    return false;
+}
+
+/// Reset all GC marks in the chunk.
+static void old_space_chunk_clear_marks(struct old_space_chunk_meta *meta) {
+    zis_bitset_clear(meta->mark_bits, meta->mark_bits_size);
+}
+
+#else // !ZIS_USE_GC_SIDE_MARKS
+
+#define old_space_chunk_test_mark(META_PTR, OBJ_PTR) \
+    (zis_unused_var(META_PTR), zis_object_meta_test_gc_mark((OBJ_PTR)->_meta))
+
+#define old_space_chunk_clear_marks(META_PTR) \
+    zis_unused_var(META_PTR)
+
+#endif // ZIS_USE_GC_SIDE_MARKS
+
 /// Old space storage iterator. Invalidated after de-allocations in old space.
 struct old_space_iterator {
     struct mem_chunk *chunk;
@@ -904,6 +1289,11 @@ static struct mem_chunk *old_space_add_chunk(struct old_space *);
 static void old_space_init(struct old_space *space, const struct objmem_config *conf) {
     space->chunk_size = conf->old_spc_chunk_size;
     mem_chunk_list_init(&space->_chunks);
+    space->_spare_chunks = NULL;
+    space->spare_chunk_count = 0;
+    space->chunk_count = 0;
+    space->chunk_count_limit = conf->old_spc_size_limit / conf->old_spc_chunk_size;
+    space->chunk_count_threshold = OLD_SPACE_THRESHOLD_MIN_CHUNKS;
     old_space_add_chunk(space);
 }
 
@@ -925,35 +1315,105 @@ static void old_space_pre_fini(struct old_space *space) {
 /// Finalize space. `old_space_pre_fini()` must have been called.
 static void old_space_fini(struct old_space *space) {
     mem_chunk_list_fini(&space->_chunks);
+    _mem_chunk_list_del_from(space->_spare_chunks);
 }
 
-/// Add a chunk to the end of list.
-zis_noinline static struct mem_chunk *old_space_add_chunk(struct old_space *space) {
-    const size_t chunk_size = space->chunk_size;
-    struct  mem_chunk *const chunk =
-        mem_chunk_list_append_created(&space->_chunks, chunk_size);
+/// Count a chunk that has just been appended to the list, and allocate the chunk meta.
+static void old_space_init_added_chunk(struct old_space *space, struct mem_chunk *chunk) {
+    space->chunk_count++;
     struct old_space_chunk_meta *const chunk_meta =
         mem_chunk_alloc(chunk, sizeof(struct old_space_chunk_meta));
     assert(chunk_meta);
     assert(chunk_meta == old_space_chunk_meta_addr(chunk));
-    old_space_chunk_meta_init(chunk_meta);
+    // Not always `space->chunk_size`; see `old_space_add_large_chunk()`.
+    old_space_chunk_meta_init(chunk_meta, (size_t)(chunk->_end - (char *)chunk));
+}
+
+/// Add a chunk to the end of list.
+zis_noinline static struct mem_chunk *old_space_add_chunk(struct old_space *space) {
+    struct mem_chunk *chunk = space->_spare_chunks;
+    if (chunk) {
+        space->_spare_chunks = chunk->_next;
+        space->spare_chunk_count--;
+        chunk->_free = chunk->_mem;
+        chunk->_next = NULL;
+        mem_chunk_list_append(&space->_chunks, chunk);
+    } else {
+        chunk = ZIS_USE_COMPACT_OBJECT_META ?
+            mem_chunk_create_aligned(space->chunk_size, OLD_SPACE_CHUNK_ALIGN) :
+            mem_chunk_create(space->chunk_size);
+        mem_chunk_list_append(&space->_chunks, chunk);
+    }
+    old_space_init_added_chunk(space, chunk);
     return chunk;
 }
 
-/// Delete chunks after the given one.
+/// Add a chunk to the end of list, which is large enough to allocate `size` bytes
+/// at a time. Returns `NULL` if the size exceeds the max chunk size.
+static struct mem_chunk *old_space_add_large_chunk(struct old_space *space, size_t size) {
+    const size_t chunk_size = zis_round_up_to_n_pow2(
+        SIZE_KiB(4), sizeof(struct mem_chunk) + sizeof(struct old_space_chunk_meta) + size + 1
+    );
+    if (ZIS_USE_COMPACT_OBJECT_META && chunk_size > OLD_SPACE_CHUNK_ALIGN)
+        return NULL;
+    struct mem_chunk *const chunk = ZIS_USE_COMPACT_OBJECT_META ?
+        mem_chunk_create_aligned(chunk_size, OLD_SPACE_CHUNK_ALIGN) :
+        mem_chunk_create(chunk_size);
+    mem_chunk_list_append(&space->_chunks, chunk);
+    old_space_init_added_chunk(space, chunk);
+    return chunk;
+}
+
+/// Remove chunks after the given one. Some of them are kept as spare chunks
+/// so that the memory can be reused without mapping again; the rest are deleted.
 static void old_space_remove_chunks_after(
     struct old_space *space, struct mem_chunk *after_chunk
 ) {
-    for (struct mem_chunk *chunk = after_chunk->_next; chunk; chunk = chunk->_next)
+    struct mem_chunk *chunk = after_chunk->_next;
+    mem_chunk_list_pop_after(&space->_chunks, after_chunk);
+    while (chunk) {
+        struct mem_chunk *const next = chunk->_next;
+        assert(space->chunk_count > 1);
+        space->chunk_count--;
         old_space_chunk_meta_fini(old_space_chunk_meta_addr(chunk));
-    mem_chunk_list_destroy_after(&space->_chunks, after_chunk);
+        if (space->spare_chunk_count < OLD_SPACE_SPARE_CHUNK_MAX) {
+            chunk->_next = space->_spare_chunks;
+            space->_spare_chunks = chunk;
+            space->spare_chunk_count++;
+        } else {
+            mem_chunk_destroy(chunk);
+        }
+        chunk = next;
+    }
+}
+
+/// Add a chunk unless the number of chunks has reached the threshold, in which
+/// case returns `NULL` and the space shall not grow until the next full GC.
+static struct mem_chunk *old_space_try_add_chunk(struct old_space *space) {
+    if (space->chunk_count >= space->chunk_count_threshold)
+        return NULL;
+    return old_space_add_chunk(space);
+}
+
+/// Full GC: set the growth threshold according to the size of survivors.
+static void old_space_update_threshold(struct old_space *space) {
+    size_t n = space->chunk_count * OLD_SPACE_GROWTH_FACTOR;
+    if (n < OLD_SPACE_THRESHOLD_MIN_CHUNKS)
+        n = OLD_SPACE_THRESHOLD_MIN_CHUNKS;
+    if (n > space->chunk_count_limit)
+        n = space->chunk_count_limit > space->chunk_count ?
+            space->chunk_count_limit : space->chunk_count;
+    space->chunk_count_threshold = n;
 }
 
 #if ZIS_DEBUG
 
 zis_unused_fn
 static void old_space_print_usage(struct old_space *space, FILE *stream) {
-    fputs("<OldSpc>\n", stream);
+    fprintf(
+        stream, "<OldSpc chunk_count=\"%zu\" chunk_count_threshold=\"%zu\">\n",
+        space->chunk_count, space->chunk_count_threshold
+    );
     size_t chunk_index = 0;
     mem_chunk_list_foreach(&space->_chunks, chunk, {
         const size_t chunk_mem_size = (size_t)(chunk->_end - chunk->_mem);
@@ -1017,7 +1477,6 @@ zis_force_inline static void *old_space_pre_alloc(
 static void old_space_truncate(
     struct old_space *space, struct old_space_iterator trunc_from
 ) {
-    // TODO: cache unused chunks instead of deleting them.
     old_space_remove_chunks_after(space, trunc_from.chunk);
 
     assert(space->_chunks._tail == trunc_from.chunk);
@@ -1038,10 +1497,11 @@ static void old_space_truncate(
 
 /// Full GC: reallocate storages for survivors and clear remembered set.
 /// Reallocated objects are neither initialized nor moved. Pointer to new storage
-/// is written to the GC_PTR of object meta. Also call finalizers of dead
+/// is recorded with `gc_forward_object()`. Also call finalizers of dead
 /// objects if there are.
 static void old_space_realloc_survivors_and_forget_remembered_objects(
-    struct old_space *space, struct old_space_iterator *realloc_iter
+    struct old_space *space, struct old_space_iterator *realloc_iter,
+    struct fwd_table *fwd_table
 ) {
     // To avoid overlapping and minimize movements, the iterator must be at the
     // beginning of available spaces.
@@ -1060,15 +1520,22 @@ static void old_space_realloc_survivors_and_forget_remembered_objects(
             chunk, sizeof(struct old_space_chunk_meta), obj, obj_type, obj_size,
         {
             zis_unused_var(obj_type);
-            if (zis_unlikely(!zis_object_meta_test_gc_mark(obj->_meta))) {
+            if (zis_unlikely(!old_space_chunk_test_mark(chunk_meta, obj))) {
                 // NOTE: object terminates here.
                 continue;
             }
             void *const new_mem =
                 old_space_pre_alloc(space, realloc_iter, obj_size);
             assert(new_mem);
-            zis_object_meta_assert_ptr_fits(new_mem);
-            zis_object_meta_set_gc_ptr(obj->_meta, new_mem);
+            if (ZIS_USE_GC_SIDE_MARKS || ZIS_USE_COMPACT_OBJECT_META) {
+                // Only objects to be moved are forwarded. With side marks, the
+                // mark in the object meta means the object has been forwarded.
+                if (new_mem == (void *)obj)
+                    continue;
+                if (ZIS_USE_GC_SIDE_MARKS)
+                    zis_object_meta_set_gc_mark(obj->_meta);
+            }
+            gc_forward_object(fwd_table, obj, new_mem);
         });
     });
 }
@@ -1094,9 +1561,12 @@ zis_force_inline static void old_space_add_remembered_object(
 }
 
 /// Fast GC: mark young slots of recorded objects in remembered set.
-/// Return the number of involved chunks.
-static size_t old_space_mark_remembered_objects_young_slots(struct old_space *space) {
-    size_t count = 0;
+/// Return the number of involved chunks. The number of recorded objects is
+/// stored to `*obj_count`.
+static size_t old_space_mark_remembered_objects_young_slots(
+    struct old_space *space, size_t *obj_count
+) {
+    size_t count = 0, n_objs = 0;
     mem_chunk_list_foreach(&space->_chunks, chunk, {
         struct old_space_chunk_meta *const chunk_meta =
             old_space_chunk_meta_addr(chunk);
@@ -1110,8 +1580,10 @@ static size_t old_space_mark_remembered_objects_young_slots(struct old_space *sp
                 (struct zis_object *)((char *)chunk_meta + obj_offset);
             assert(zis_object_meta_is_not_young(obj->_meta));
             _zis_objmem_mark_object_slots_rec_o2y(obj);
+            n_objs++;
         });
     });
+    *obj_count = n_objs;
     return count;
 }
 
@@ -1170,11 +1642,12 @@ static size_t old_space_update_remembered_objects_references_and_forget_remember
 /// Full GC: update references to objects. References in unmarked objects are skipped.
 static void old_space_update_references(struct old_space *space) {
     mem_chunk_list_foreach(&space->_chunks, chunk, {
+        struct old_space_chunk_meta *const chunk_meta = old_space_chunk_meta_addr(chunk);
         mem_chunk_foreach_allocated_object(
             chunk, sizeof(struct old_space_chunk_meta), obj, obj_type, obj_size,
         {
             (zis_unused_var(obj_type), zis_unused_var(obj_size));
-            if (zis_unlikely(!zis_object_meta_test_gc_mark(obj->_meta)))
+            if (zis_unlikely(!old_space_chunk_test_mark(chunk_meta, obj)))
                 continue;
             _zis_objmem_move_object_slots(obj);
         });
@@ -1261,13 +1734,15 @@ static void old_space_move_reallocated_objects(
         mem_chunk_foreach_allocated_object(
             chunk, sizeof(struct old_space_chunk_meta), obj, obj_type, obj_size,
         {
+            // With side marks, only the moved objects are marked in their meta
+            // (see `old_space_realloc_survivors_and_forget_remembered_objects()`).
+            // The others, either dead or not moved, are left untouched.
             if (zis_unlikely(!zis_object_meta_test_gc_mark(obj->_meta)))
                 continue;
 
-            zis_object_meta_reset_gc_mark(obj->_meta);
+            struct zis_object *const new_obj = _zis_objmem_forwarded_object(obj);
 
-            struct zis_object *const new_obj =
-                zis_object_meta_get_gc_ptr(obj->_meta, struct zis_object *);
+            zis_object_meta_reset_gc_mark(obj->_meta);
 
             if (obj == new_obj) {
                 // The storage address is not changed. There is no doubt that
@@ -1287,6 +1762,7 @@ static void old_space_move_reallocated_objects(
                 obj_size - ZIS_OBJECT_HEAD_SIZE
             );
         });
+        old_space_chunk_clear_marks(old_space_chunk_meta_addr(chunk));
     });
 }
 
@@ -1322,11 +1798,21 @@ static int old_space_post_gc_check(struct old_space *space) {
 /*
  * In new space, mark-copy GC algorithm is used.
  * The GC_PTR in object meta is not used.
+ *
+ * The size of the chunks adapts to the workload. After a fast GC, the preferred
+ * size is doubled if many objects survived or if fast GCs are frequent, and
+ * halved if few objects survived and fast GCs are rare. The free chunk is
+ * re-created with the preferred size when it is about to receive survivors.
  */
 
 /// New space manager.
 struct new_space {
     struct mem_chunk *_working_chunk, *_free_chunk;
+    size_t chunk_size; // Preferred chunk size.
+    size_t chunk_size_min, chunk_size_max;
+    size_t last_allocated_size, last_survived_size; // Of the last GC.
+    size_t last_promoted_size; // Of the last GC.
+    size_t kept_size; // Size of objects in the working chunk right after the last GC.
 };
 
 /// Initialize space.
@@ -1337,6 +1823,13 @@ static void new_space_init(
     const size_t chunk_size = conf->new_spc_chunk_size;
     space->_working_chunk = mem_chunk_create(chunk_size);
     space->_free_chunk    = mem_chunk_create(chunk_size);
+    space->chunk_size = chunk_size;
+    space->chunk_size_min = conf->new_spc_chunk_size_min;
+    space->chunk_size_max = conf->new_spc_chunk_size_max;
+    space->last_allocated_size = 0;
+    space->last_survived_size = 0;
+    space->last_promoted_size = 0;
+    space->kept_size = 0;
 }
 
 /// Finalize allocated objects and the space.
@@ -1357,7 +1850,7 @@ static void new_space_fini(struct new_space *space) {
 
 zis_unused_fn
 static void new_space_print_usage(struct new_space *space, FILE *stream) {
-    fputs("<NewSpc>\n", stream);
+    fprintf(stream, "<NewSpc chunk_size=\"%zu\">\n", space->chunk_size);
     struct mem_chunk *const chunks[2] = {space->_working_chunk, space->_free_chunk};
     for (int i = 0; i < 2; i++) {
         struct mem_chunk *const chunk = chunks[i];
@@ -1389,21 +1882,92 @@ new_space_alloc(struct new_space *space, void *type_ptr, size_t size) {
     return obj;
 }
 
+/// Get the size of objects allocated in the working chunk since the last GC.
+static size_t new_space_allocated_size_since_gc(const struct new_space *space) {
+    const struct mem_chunk *const chunk = space->_working_chunk;
+    return (size_t)(chunk->_free - chunk->_mem) - space->kept_size;
+}
+
+/// GC: record the size of objects in the working chunk after GC.
+static void new_space_update_kept_size(struct new_space *space) {
+    const struct mem_chunk *const chunk = space->_working_chunk;
+    space->kept_size = (size_t)(chunk->_free - chunk->_mem);
+}
+
+/// GC: get the free chunk, where survivors are to be copied to. The chunk is
+/// re-created if its size is not the preferred one, as long as the survivors fit.
+static struct mem_chunk *new_space_prepare_to_chunk(struct new_space *space) {
+    struct mem_chunk *const from_chunk = space->_working_chunk;
+    struct mem_chunk *to_chunk = space->_free_chunk;
+    const size_t from_chunk_size = (size_t)(from_chunk->_end - (char *)from_chunk);
+    const size_t to_chunk_size = (size_t)(to_chunk->_end - (char *)to_chunk);
+    const size_t min_size = // `mem_chunk_alloc()` never fills a chunk up.
+        sizeof(struct mem_chunk) + (size_t)(from_chunk->_free - from_chunk->_mem) + 1;
+    if (zis_unlikely(to_chunk_size != space->chunk_size || to_chunk_size < min_size)) {
+        const size_t new_size =
+            space->chunk_size >= min_size ? space->chunk_size : from_chunk_size;
+        if (new_size != to_chunk_size) {
+            mem_chunk_destroy(to_chunk);
+            to_chunk = mem_chunk_create(new_size);
+            space->_free_chunk = to_chunk;
+        }
+    }
+    mem_chunk_forget(to_chunk);
+    return to_chunk;
+}
+
+/// Fast GC: adjust the preferred chunk size, according to the statistics of the
+/// GC that has just finished and the mutator time (in nanoseconds) before it.
+static void new_space_adjust_chunk_size(struct new_space *space, uint64_t mutator_time) {
+    const size_t allocated_size = space->last_allocated_size;
+    const size_t survived_size = space->last_survived_size;
+    const size_t working_chunk_size =
+        (size_t)(space->_working_chunk->_end - (char *)space->_working_chunk);
+    if (allocated_size < working_chunk_size / 2)
+        return; // Not caused by a full chunk (e.g., requested by user).
+
+    size_t new_chunk_size = space->chunk_size;
+    if (
+        survived_size > allocated_size / NEW_SPACE_GROW_SURVIVAL_DIV ||
+        mutator_time < (uint64_t)NEW_SPACE_GROW_INTERVAL_MS * 1000000U
+    ) {
+        new_chunk_size *= 2;
+        if (new_chunk_size > space->chunk_size_max)
+            new_chunk_size = space->chunk_size_max;
+    } else if (
+        survived_size < allocated_size / NEW_SPACE_SHRINK_SURVIVAL_DIV &&
+        mutator_time > (uint64_t)NEW_SPACE_SHRINK_INTERVAL_MS * 1000000U
+    ) {
+        new_chunk_size /= 2;
+        if (new_chunk_size < space->chunk_size_min)
+            new_chunk_size = space->chunk_size_min;
+    }
+
+    if (new_chunk_size != space->chunk_size) {
+        zis_debug_log(
+            TRACE, "ObjMem", "new space chunk size: %zu -> %zu (%zu/%zu survived)",
+            space->chunk_size, new_chunk_size, survived_size, allocated_size
+        );
+        space->chunk_size = new_chunk_size;
+    }
+}
+
 /// Fast GC: reallocate and copy objects that are marked alive in new space.
 /// For objects that survived only once, new storages are in the other chunk,
 /// which are still in new space. But the `MID` flag in object meta is set.
 /// For other (older) objects, new storages are allocated in old space.
-/// If the old space fails to allocate storage, they are kept in new space,
+/// If the old space fails to allocate storage and is not allowed to grow (see
+/// `old_space_try_add_chunk()`), they are kept in new space,
 /// and `false` will be returned at the end of function.
-/// New storage address is written to the GC_PTR of object meta.
+/// New storage address is recorded with `gc_forward_object()`.
 /// Dead objects are finalized.
 static bool new_space_realloc_and_copy_survivors(
-    struct new_space *space, struct old_space *old_space
+    struct new_space *space, struct old_space *old_space, struct fwd_table *fwd_table
 ) {
-    struct mem_chunk *const to_chunk = space->_free_chunk;
-    mem_chunk_forget(to_chunk);
+    struct mem_chunk *const to_chunk = new_space_prepare_to_chunk(space);
 
     bool old_space_is_full = false;
+    size_t survived_size = 0, promoted_size = 0;
     mem_chunk_foreach_allocated_object(
         space->_working_chunk, 0, obj, obj_type, obj_size,
     {
@@ -1413,6 +1977,7 @@ static bool new_space_realloc_and_copy_survivors(
             continue;
         }
 
+        survived_size += obj_size;
         struct zis_object *new_obj;
         if (zis_object_meta_young_is_new(obj->_meta)) {
         alloc_in_new_space:
@@ -1424,13 +1989,18 @@ static bool new_space_realloc_and_copy_survivors(
                 goto alloc_in_new_space;
             new_obj = old_space_alloc(old_space, obj_type, obj_size);
             if (zis_unlikely(!new_obj)) {
-                old_space_is_full = true;
-                goto alloc_in_new_space;
+                if (old_space_try_add_chunk(old_space)) {
+                    new_obj = old_space_alloc(old_space, obj_type, obj_size);
+                    assert(new_obj);
+                } else {
+                    old_space_is_full = true;
+                    goto alloc_in_new_space;
+                }
             }
+            promoted_size += obj_size;
         }
 
-        zis_object_meta_assert_ptr_fits(new_obj);
-        zis_object_meta_set_gc_ptr(obj->_meta, new_obj);
+        gc_forward_object(fwd_table, obj, new_obj);
         assert((char *)new_obj < (char *)obj || (char *)new_obj >= (char *)obj + obj_size);
         memcpy(
             (char *)new_obj + ZIS_OBJECT_HEAD_SIZE,
@@ -1439,19 +2009,25 @@ static bool new_space_realloc_and_copy_survivors(
         );
     });
 
+    space->last_allocated_size =
+        (size_t)(space->_working_chunk->_free - space->_working_chunk->_mem);
+    space->last_survived_size = survived_size;
+    space->last_promoted_size = promoted_size;
+
     return !old_space_is_full;
 }
 
 /// Full GC: reallocate storages for survivors. Objects are neither initialized
-/// nor moved. Pointer to new storage is written to the GC_PTR of object meta.
+/// nor moved. Pointer to new storage is recorded with `gc_forward_object()`.
 /// The rules are same with that in function `new_space_realloc_and_copy_survivors()`.
 static void new_space_realloc_survivors(
     struct new_space *space,
-    struct old_space *old_space, struct old_space_iterator *old_space_realloc_iter
+    struct old_space *old_space, struct old_space_iterator *old_space_realloc_iter,
+    struct fwd_table *fwd_table
 ) {
-    struct mem_chunk *const to_chunk = space->_free_chunk;
-    mem_chunk_forget(to_chunk);
+    struct mem_chunk *const to_chunk = new_space_prepare_to_chunk(space);
 
+    size_t promoted_size = 0;
     mem_chunk_foreach_allocated_object(
         space->_working_chunk, 0, obj, obj_type, obj_size,
     {
@@ -1471,11 +2047,13 @@ static void new_space_realloc_survivors(
                 old_space, old_space_realloc_iter, obj_size
             );
             assert(new_mem);
+            promoted_size += obj_size;
         }
 
-        zis_object_meta_assert_ptr_fits(new_mem);
-        zis_object_meta_set_gc_ptr(obj->_meta, new_mem);
+        gc_forward_object(fwd_table, obj, new_mem);
     });
+
+    space->last_promoted_size = promoted_size;
 }
 
 /// GC: swap two chunks.
@@ -1521,12 +2099,12 @@ static void new_space_move_marked_objects(
         if (zis_likely(!zis_object_meta_test_gc_mark(obj->_meta)))
             continue;
 
-        zis_object_meta_reset_gc_mark(obj->_meta);
+        struct zis_object *const new_obj = _zis_objmem_forwarded_object(obj);
+        const bool young_is_new = zis_object_meta_young_is_new(*gc_object_meta_ref(obj));
 
-        struct zis_object *const new_obj =
-            zis_object_meta_get_gc_ptr(obj->_meta, struct zis_object *);
+        zis_object_meta_reset_gc_mark(obj->_meta);
 
-        if (zis_object_meta_young_is_new(obj->_meta)) {
+        if (young_is_new) {
             zis_object_meta_init(new_obj->_meta, ZIS_OBJMEM_OBJ_MID, 0, obj_type);
         } else {
             old_space_init_reallocated_obj_meta(ctx, new_obj, obj_type);
@@ -1559,6 +2137,101 @@ static int new_space_post_gc_check(struct new_space *space) {
 
 #endif // ZIS_DEBUG
 
+/* ----- Allocation sites --------------------------------------------------- */
+
+/*
+ * Allocation-site feedback decides whether objects from a site (an allocating
+ * instruction, or any other code with a stable address as its key) are likely
+ * to survive and shall be allocated in old space directly (pretenuring).
+ * For each site, the first object allocated after a GC is taken as a sample.
+ * The next GC checks whether the sample has survived. After `SAMPLE_COUNT`
+ * samples, the site is switched to pretenuring if at least `PRETENURE_MIN`
+ * samples survived, and back to normal if less than `NORMAL_MAX` survived.
+ * Samples of pretenured sites are old objects, which are checked in full GCs only.
+ * The sites are kept in a direct-mapped table. Colliding sites evict each other.
+ */
+
+#define ALLOC_SITE_TABLE_SIZE        256
+#define ALLOC_SITE_SAMPLE_COUNT      8
+#define ALLOC_SITE_PRETENURE_MIN     7
+#define ALLOC_SITE_NORMAL_MAX        4
+
+static_assert(!(ALLOC_SITE_TABLE_SIZE & (ALLOC_SITE_TABLE_SIZE - 1)), "");
+
+/// Feedback of an allocation site.
+struct alloc_site {
+    const void        *key; // NULL if unused.
+    struct zis_object *sample; // Nullable.
+    uint8_t            sample_count;
+    uint8_t            survivor_count;
+    bool               pretenure;
+};
+
+/// Allocation site table.
+struct alloc_site_table {
+    struct alloc_site sites[ALLOC_SITE_TABLE_SIZE];
+};
+
+/// Initialize the table.
+static void alloc_site_table_init(struct alloc_site_table *table) {
+    memset(table, 0, sizeof *table);
+}
+
+/// Get the site of a key. Evict the old site if the slot is taken by another key.
+zis_force_inline static struct alloc_site *
+alloc_site_table_get(struct alloc_site_table *table, const void *key) {
+    assert(key);
+    const size_t index =
+        (size_t)(((uintptr_t)key >> 2) * UINT32_C(2654435761)) & (ALLOC_SITE_TABLE_SIZE - 1);
+    struct alloc_site *const site = &table->sites[index];
+    if (zis_unlikely(site->key != key)) {
+        site->key = key;
+        site->sample = NULL;
+        site->sample_count = 0;
+        site->survivor_count = 0;
+        site->pretenure = false;
+    }
+    return site;
+}
+
+/// Record whether the sample has survived and update the decision.
+static void alloc_site_update(struct alloc_site *site, bool survived) {
+    site->sample = NULL;
+    site->sample_count++;
+    if (survived)
+        site->survivor_count++;
+    if (site->sample_count < ALLOC_SITE_SAMPLE_COUNT)
+        return;
+    const bool pretenure = site->pretenure ?
+        site->survivor_count >= ALLOC_SITE_NORMAL_MAX :
+        site->survivor_count >= ALLOC_SITE_PRETENURE_MIN;
+    if (pretenure != site->pretenure) {
+        zis_debug_log(
+            TRACE, "ObjMem", "alloc site %p: %s (%u/%u survived)", site->key,
+            pretenure ? "pretenure" : "stop pretenuring",
+            (unsigned)site->survivor_count, (unsigned)site->sample_count
+        );
+        site->pretenure = pretenure;
+    }
+    site->sample_count = 0;
+    site->survivor_count = 0;
+}
+
+/// GC: check the samples. Must be called after marking and before moving objects.
+/// In a fast GC, only samples in young space are checked.
+static void alloc_site_table_check_samples(struct alloc_site_table *table, bool full_gc) {
+    for (size_t i = 0; i < ALLOC_SITE_TABLE_SIZE; i++) {
+        struct alloc_site *const site = &table->sites[i];
+        struct zis_object *const obj = site->sample;
+        if (!obj)
+            continue;
+        if (full_gc)
+            alloc_site_update(site, _zis_objmem_test_gc_mark(obj));
+        else if (zis_object_meta_is_young(obj->_meta))
+            alloc_site_update(site, zis_object_meta_test_gc_mark(obj->_meta));
+    }
+}
+
 /* ----- Public functions --------------------------------------------------- */
 
 struct zis_objmem_context {
@@ -1570,7 +2243,20 @@ struct zis_objmem_context {
     struct big_space big_space;
 
     struct mem_span_set gc_roots;
+    struct mem_span_set dependent_gc_roots;
     struct mem_span_set weak_refs;
+
+    struct alloc_site *alloc_site; // The current allocation site. Nullable.
+    struct alloc_site_table alloc_sites;
+
+    zis_objmem_alloc_sampler_t alloc_sampler; // Nullable.
+    size_t alloc_sampler_interval, alloc_sampler_bytes_left;
+
+    struct fwd_table fwd_table;
+
+    uint64_t last_gc_end_time; // See `objmem_clock_ns()`.
+
+    struct zis_objmem_stats stats;
 };
 
 struct zis_objmem_context *zis_objmem_context_create(const struct zis_objmem_options *opts) {
@@ -1584,12 +2270,21 @@ struct zis_objmem_context *zis_objmem_context_create(const struct zis_objmem_opt
     old_space_init(&ctx->old_space, &conf);
     big_space_init(&ctx->big_space, &conf);
     mem_span_set_init(&ctx->gc_roots);
+    mem_span_set_init(&ctx->dependent_gc_roots);
     mem_span_set_init(&ctx->weak_refs);
+    ctx->alloc_site = NULL;
+    alloc_site_table_init(&ctx->alloc_sites);
+    ctx->alloc_sampler = NULL;
+    ctx->alloc_sampler_interval = 0, ctx->alloc_sampler_bytes_left = 0;
+    fwd_table_init(&ctx->fwd_table);
+    ctx->last_gc_end_time = objmem_clock_ns();
+    memset(&ctx->stats, 0, sizeof ctx->stats);
     return ctx;
 }
 
 void zis_objmem_context_destroy(struct zis_objmem_context *ctx) {
     mem_span_set_fini(&ctx->weak_refs);
+    mem_span_set_fini(&ctx->dependent_gc_roots);
     mem_span_set_fini(&ctx->gc_roots);
 
     big_space_fini(&ctx->big_space);
@@ -1601,6 +2296,8 @@ void zis_objmem_context_destroy(struct zis_objmem_context *ctx) {
      * so that the types are accessible when finalizing all objects.
      */
 
+    fwd_table_fini(&ctx->fwd_table);
+
     zis_mem_free(ctx);
 }
 
@@ -1614,6 +2311,21 @@ zis_noreturn zis_noinline static void objmem_error_oom(struct zis_context *z) {
     zis_context_panic(z, ZIS_CONTEXT_PANIC_OOM);
 }
 
+/// Count an allocation of `obj_size` bytes and call the sampler if it is due.
+zis_noinline static void objmem_sample_alloc(
+    struct zis_context *z, struct zis_type_obj *obj_type, size_t obj_size
+) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    assert(ctx->alloc_sampler);
+    if (ctx->alloc_sampler_bytes_left > obj_size) {
+        ctx->alloc_sampler_bytes_left -= obj_size;
+        return;
+    }
+    ctx->alloc_sampler_bytes_left = ctx->alloc_sampler_interval;
+    const void *const site = ctx->alloc_site ? ctx->alloc_site->key : NULL;
+    ctx->alloc_sampler(z, obj_type, obj_size, site);
+}
+
 struct zis_object *zis_objmem_alloc(
     struct zis_context *z, struct zis_type_obj *obj_type
 ) {
@@ -1625,6 +2337,10 @@ struct zis_object *zis_objmem_alloc(
 
     unsigned int retry_count = 0;
     if (zis_likely(obj_size <= NON_BIG_SPACE_MAX_ALLOC_SIZE)) {
+        if (zis_unlikely(ctx->alloc_site))
+            return zis_objmem_alloc_ex(z, ZIS_OBJMEM_ALLOC_AUTO, obj_type, 0, 0);
+        if (zis_unlikely(ctx->alloc_sampler))
+            objmem_sample_alloc(z, obj_type, obj_size);
     alloc_small:
         obj = new_space_alloc(&ctx->new_space, obj_type, obj_size);
         if (zis_unlikely(!obj)) {
@@ -1634,6 +2350,8 @@ struct zis_object *zis_objmem_alloc(
             goto alloc_small;
         }
     } else {
+        if (zis_unlikely(ctx->alloc_sampler))
+            objmem_sample_alloc(z, obj_type, obj_size);
     alloc_large:
         obj = big_space_alloc(&ctx->big_space, obj_type, obj_size);
         if (zis_unlikely(!obj)) {
@@ -1642,6 +2360,7 @@ struct zis_object *zis_objmem_alloc(
             zis_objmem_gc(z, ZIS_OBJMEM_GC_FULL);
             goto alloc_large;
         }
+        ctx->stats.big_space_allocated += obj_size;
     }
 
     assert(!zis_object_is_smallint(obj));
@@ -1682,11 +2401,22 @@ struct zis_object *zis_objmem_alloc_ex(
         }
     }
 
+    if (zis_unlikely(ctx->alloc_sampler))
+        objmem_sample_alloc(z, obj_type, obj_size);
+
     unsigned int retry_count = 0;
+    struct alloc_site *sample_site = NULL;
     if (zis_likely(alloc_type == ZIS_OBJMEM_ALLOC_AUTO)) {
     alloc_type_auto:
         if (zis_unlikely(obj_size > NON_BIG_SPACE_MAX_ALLOC_SIZE))
             goto alloc_type_huge;
+        if (zis_unlikely(ctx->alloc_site)) {
+            struct alloc_site *const site = ctx->alloc_site;
+            if (!site->sample)
+                sample_site = site;
+            if (site->pretenure)
+                goto alloc_type_surv;
+        }
     alloc_small:
         obj = new_space_alloc(&ctx->new_space, obj_type, obj_size);
         if (zis_unlikely(!obj)) {
@@ -1703,26 +2433,38 @@ struct zis_object *zis_objmem_alloc_ex(
         if (zis_unlikely(!obj)) {
             if (retry_count++ > 1)
                 objmem_error_oom(z);
-            zis_objmem_gc(z, ZIS_OBJMEM_GC_FULL);
+            // Like a failed promotion in fast GC, grow the space now and run a
+            // full GC next time if the threshold has been reached.
+            if (!old_space_try_add_chunk(&ctx->old_space)) {
+                old_space_add_chunk(&ctx->old_space);
+                ctx->force_full_gc = true;
+            }
             goto alloc_type_surv;
         }
+        ctx->stats.old_space_allocated += obj_size;
     } else if (zis_likely(alloc_type == ZIS_OBJMEM_ALLOC_HUGE)) {
     alloc_type_huge:
         obj = big_space_alloc(&ctx->big_space, obj_type, obj_size);
         if (zis_unlikely(!obj)) {
-            if (retry_count++)
-                ctx->big_space.threshold_size =
-                    ctx->big_space.allocated_size + obj_size; // TODO: check heap limit.
-            else
+            if (retry_count == 0)
                 zis_objmem_gc(z, ZIS_OBJMEM_GC_FULL);
+            else if (retry_count == 1)
+                big_space_raise_threshold(&ctx->big_space, obj_size); // TODO: check heap limit.
+            else
+                objmem_error_oom(z);
+            retry_count++;
             goto alloc_type_huge;
         }
+        ctx->stats.big_space_allocated += obj_size;
     } else {
         goto alloc_type_auto;
     }
     assert(!zis_object_is_smallint(obj));
     assert(zis_object_type(obj) == obj_type);
 
+    if (zis_unlikely(sample_site))
+        sample_site->sample = obj;
+
     if (has_ext) {
         if (has_ext_slots) {
             const zis_smallint_t n = (zis_smallint_t)ext_slots;
@@ -1739,6 +2481,94 @@ struct zis_object *zis_objmem_alloc_ex(
     return obj;
 }
 
+void *zis_objmem_alloc_restored_block(
+    struct zis_context *z, size_t size, void **gc_ptr
+) {
+    struct old_space *const space = &z->objmem_context->old_space;
+
+    assert(size > 0 && !(size & (sizeof(void *) - 1)));
+    assert(zis_objmem_current_gc(z) == ZIS_OBJMEM_GC_NONE);
+
+    struct mem_chunk *chunk = mem_chunk_list_back(&space->_chunks);
+    void *block = mem_chunk_alloc(chunk, size);
+    if (!block) {
+        const size_t chunk_capacity =
+            space->chunk_size - sizeof(struct mem_chunk) - sizeof(struct old_space_chunk_meta);
+        chunk = size < chunk_capacity ?
+            old_space_add_chunk(space) : old_space_add_large_chunk(space, size);
+        if (zis_unlikely(!chunk))
+            return NULL;
+        block = mem_chunk_alloc(chunk, size);
+        assert(block);
+    }
+    *gc_ptr = old_space_chunk_meta_addr(chunk);
+    zis_object_meta_assert_ptr_fits(*gc_ptr);
+    zis_vmem_prefault(block, size); // It is to be filled up right away.
+
+    return block;
+}
+
+struct zis_object *zis_objmem_alloc_restored_big(struct zis_context *z, size_t size) {
+    struct big_space *const space = &z->objmem_context->big_space;
+
+    assert(size >= ZIS_OBJECT_HEAD_SIZE && !(size & (sizeof(void *) - 1)));
+    assert(zis_objmem_current_gc(z) == ZIS_OBJMEM_GC_NONE);
+
+    struct zis_object *obj = big_space_alloc(space, NULL, size);
+    if (zis_unlikely(!obj)) {
+        big_space_raise_threshold(space, size);
+        obj = big_space_alloc(space, NULL, size);
+        if (zis_unlikely(!obj))
+            objmem_error_oom(z);
+    }
+
+    return obj;
+}
+
+bool zis_objmem_try_extend_slots(
+    struct zis_context *z, struct zis_object *obj, size_t ext_slots
+) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    struct zis_type_obj *const obj_type = zis_object_type(obj);
+    assert(obj_type->_slots_num == (size_t)-1 && obj_type->_bytes_len == 0);
+    zis_unused_var(obj_type);
+
+    assert(ext_slots >= (size_t)zis_smallint_from_ptr(zis_object_get_slot(obj, 0)));
+    if (zis_object_meta_get_gc_state(obj->_meta) != ZIS_OBJMEM_OBJ_BIG)
+        return false;
+    const size_t new_size = ZIS_OBJECT_HEAD_SIZE + ext_slots * sizeof(void *);
+    if (!big_space_try_extend(&ctx->big_space, obj, new_size))
+        return false;
+
+    const zis_smallint_t n = (zis_smallint_t)ext_slots;
+    assert(0 < n && n <= ZIS_SMALLINT_MAX);
+    zis_object_set_slot(obj, 0, zis_smallint_to_ptr(n));
+    assert(zis_object_size(obj) == new_size);
+    return true;
+}
+
+void zis_objmem_enter_alloc_site(struct zis_context *z, const void *site) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    assert(!ctx->alloc_site);
+    ctx->alloc_site = alloc_site_table_get(&ctx->alloc_sites, site);
+}
+
+void zis_objmem_leave_alloc_site(struct zis_context *z) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    assert(ctx->alloc_site);
+    ctx->alloc_site = NULL;
+}
+
+void zis_objmem_set_alloc_sampler(
+    struct zis_context *z, zis_objmem_alloc_sampler_t fn, size_t interval
+) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    assert(!fn || interval);
+    ctx->alloc_sampler = fn;
+    ctx->alloc_sampler_interval = fn ? interval : 0;
+    ctx->alloc_sampler_bytes_left = ctx->alloc_sampler_interval;
+}
+
 void zis_objmem_add_gc_root(
     struct zis_context *z,
     void *root, zis_objmem_object_visitor_t fn
@@ -1760,6 +2590,19 @@ bool zis_objmem_remove_gc_root(struct zis_context *z, void *root) {
     return mem_span_set_remove(&ctx->gc_roots, root);
 }
 
+void zis_objmem_add_dependent_gc_root(
+    struct zis_context *z,
+    void *root, zis_objmem_object_visitor_t fn
+) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    mem_span_set_add(&ctx->dependent_gc_roots, root, (void(*)(void))fn);
+}
+
+bool zis_objmem_remove_dependent_gc_root(struct zis_context *z, void *root) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    return mem_span_set_remove(&ctx->dependent_gc_roots, root);
+}
+
 void zis_objmem_register_weak_ref_collection(
     struct zis_context *z,
     void *ref_container, zis_objmem_weak_refs_visitor_t fn
@@ -1792,12 +2635,25 @@ static void gc_fast(struct zis_objmem_context *ctx) {
     // ### 1.2  Scan remembered sets and mark referred young objects.
 
     const size_t old_spc_cnt_hint =
-        old_space_mark_remembered_objects_young_slots(&ctx->old_space);
+        old_space_mark_remembered_objects_young_slots(
+            &ctx->old_space, &ctx->stats.old_space_remembered
+        );
 
     // ### 1.3  Scan big space and mark referred young objects.
 
     const size_t big_spc_cnt_hint =
         big_space_mark_remembered_objects_young_slots(&ctx->big_space);
+    ctx->stats.big_space_remembered = big_spc_cnt_hint;
+
+    // ### 1.4  Mark young objects in dependent GC roots.
+
+    mem_span_set_foreach(
+        &ctx->dependent_gc_roots,
+        void *, gc_root,
+        zis_objmem_object_visitor_t, visitor,
+    {
+        visitor(gc_root, ZIS_OBJMEM_OBJ_VISIT_MARK_Y);
+    });
 
     // ## 2  Clean up unused weak references.
 
@@ -1809,12 +2665,14 @@ static void gc_fast(struct zis_objmem_context *ctx) {
         visitor(weak_ref, ZIS_OBJMEM_WEAK_REF_VISIT_FINI_Y);
     });
 
+    alloc_site_table_check_samples(&ctx->alloc_sites, false);
+
     // ## 3  Re-allocate storage for survived objects, then copy them to new places.
 
     const struct old_space_iterator old_spc_orig_end =
         old_space_allocated_end(&ctx->old_space);
 
-    if (!new_space_realloc_and_copy_survivors(&ctx->new_space, &ctx->old_space))
+    if (!new_space_realloc_and_copy_survivors(&ctx->new_space, &ctx->old_space, &ctx->fwd_table))
         ctx->force_full_gc = true; // Run full GC next time.
 
     /* `_zis_objmem_mark_object_slots_rec_o2y()` is used when marking
@@ -1853,6 +2711,14 @@ static void gc_fast(struct zis_objmem_context *ctx) {
         visitor(gc_root, ZIS_OBJMEM_OBJ_VISIT_MOVE);
     });
 
+    mem_span_set_foreach(
+        &ctx->dependent_gc_roots,
+        void *, gc_root,
+        zis_objmem_object_visitor_t, visitor,
+    {
+        visitor(gc_root, ZIS_OBJMEM_OBJ_VISIT_MOVE);
+    });
+
     //### 4.6  Update references in weak references.
 
     mem_span_set_foreach(
@@ -1862,11 +2728,13 @@ static void gc_fast(struct zis_objmem_context *ctx) {
     {
         visitor(weak_ref, ZIS_OBJMEM_WEAK_REF_VISIT_MOVE);
     });
+
+    fwd_table_reset(&ctx->fwd_table);
 }
 
 /// Full (young + old) GC implementation.
 static void gc_full(struct zis_objmem_context *ctx) {
-    // ## 1  Mark reachable objects in GC roots.
+    // ## 1  Mark reachable objects in GC roots, and then in dependent GC roots.
 
     mem_span_set_foreach(
         &ctx->gc_roots,
@@ -1876,6 +2744,14 @@ static void gc_full(struct zis_objmem_context *ctx) {
         visitor(gc_root, ZIS_OBJMEM_OBJ_VISIT_MARK);
     });
 
+    mem_span_set_foreach(
+        &ctx->dependent_gc_roots,
+        void *, gc_root,
+        zis_objmem_object_visitor_t, visitor,
+    {
+        visitor(gc_root, ZIS_OBJMEM_OBJ_VISIT_MARK);
+    });
+
     // ## 2  Clean up unused weak references.
 
     mem_span_set_foreach(
@@ -1886,6 +2762,8 @@ static void gc_full(struct zis_objmem_context *ctx) {
         visitor(weak_ref, ZIS_OBJMEM_WEAK_REF_VISIT_FINI);
     });
 
+    alloc_site_table_check_samples(&ctx->alloc_sites, true);
+
     // ## 3  Re-allocate storage for survived objects. Remove dead ones.
 
     // ### 3.1  Finalize and delete unreachable objects in big space. No re-allocation.
@@ -1895,11 +2773,11 @@ static void gc_full(struct zis_objmem_context *ctx) {
     // ### 3.2  Re-allocations in old space. Finalize dead ones.
 
     struct old_space_iterator old_spc_realloc_iter = old_space_allocated_begin(&ctx->old_space);
-    old_space_realloc_survivors_and_forget_remembered_objects(&ctx->old_space, &old_spc_realloc_iter);
+    old_space_realloc_survivors_and_forget_remembered_objects(&ctx->old_space, &old_spc_realloc_iter, &ctx->fwd_table);
 
     // ### 3.3  Re-allocations in new space. Finalize dead ones.
 
-    new_space_realloc_survivors(&ctx->new_space, &ctx->old_space, &old_spc_realloc_iter);
+    new_space_realloc_survivors(&ctx->new_space, &ctx->old_space, &old_spc_realloc_iter, &ctx->fwd_table);
 
     // ## 4  Update references.
 
@@ -1925,6 +2803,14 @@ static void gc_full(struct zis_objmem_context *ctx) {
         visitor(gc_root, ZIS_OBJMEM_OBJ_VISIT_MOVE);
     });
 
+    mem_span_set_foreach(
+        &ctx->dependent_gc_roots,
+        void *, gc_root,
+        zis_objmem_object_visitor_t, visitor,
+    {
+        visitor(gc_root, ZIS_OBJMEM_OBJ_VISIT_MOVE);
+    });
+
     //### 4.6  Update references in weak references.
 
     mem_span_set_foreach(
@@ -1951,8 +2837,25 @@ static void gc_full(struct zis_objmem_context *ctx) {
     // ### 5.3  Clean up unused old space chunks.
 
     old_space_truncate(&ctx->old_space, old_spc_realloc_iter);
+    fwd_table_reset(&ctx->fwd_table);
+
+    // ## 6  Decide when to run the next full GC.
+
+    old_space_update_threshold(&ctx->old_space);
+    big_space_update_threshold(&ctx->big_space);
+}
 
-    // TODO: adjust big space threshold.
+/// Record a GC pause of `time_ns` nanoseconds.
+static void objmem_stats_add_pause(struct zis_objmem_stats *stats, uint64_t time_ns) {
+    stats->pause_time_total_ns += time_ns;
+    if (stats->pause_time_max_ns < time_ns)
+        stats->pause_time_max_ns = time_ns;
+    const uint64_t time_us = time_ns / 1000U;
+    unsigned int bucket = time_us ?
+        63U - zis_bits_count_lz((unsigned long long)time_us) : 0U;
+    if (bucket >= ZIS_OBJMEM_STATS_PAUSE_BUCKETS)
+        bucket = ZIS_OBJMEM_STATS_PAUSE_BUCKETS - 1;
+    stats->pause_histogram[bucket]++;
 }
 
 int zis_objmem_gc(struct zis_context *z, enum zis_objmem_gc_type type) {
@@ -1966,31 +2869,37 @@ int zis_objmem_gc(struct zis_context *z, enum zis_objmem_gc_type type) {
     }
     ctx->current_gc_type = (int8_t)type;
 
-#if ZIS_DEBUG
     zis_debug_log(
         INFO, "ObjMem", "%s GC starts",
         type == ZIS_OBJMEM_GC_FAST ? "fast" : "full"
     );
-    struct timespec tp0;
-    zis_debug_time(&tp0);
-#endif // ZIS_DEBUG
+    const uint64_t gc_start_time = objmem_clock_ns();
 
-    if (type == ZIS_OBJMEM_GC_FAST)
+    ctx->stats.new_space_allocated += new_space_allocated_size_since_gc(&ctx->new_space);
+    if (type == ZIS_OBJMEM_GC_FAST) {
         gc_fast(ctx);
-    else if (type == ZIS_OBJMEM_GC_FULL)
+        new_space_adjust_chunk_size(
+            &ctx->new_space, gc_start_time - ctx->last_gc_end_time
+        );
+        ctx->stats.fast_gc_count++;
+    } else if (type == ZIS_OBJMEM_GC_FULL) {
         gc_full(ctx);
-    else
+        ctx->stats.full_gc_count++;
+    } else {
         type = ZIS_OBJMEM_GC_NONE; // Illegal type.
+    }
+    new_space_update_kept_size(&ctx->new_space);
+
+    const uint64_t gc_end_time = objmem_clock_ns();
+    const uint64_t gc_time = gc_end_time - gc_start_time;
+    ctx->last_gc_end_time = gc_end_time;
+    if (type != ZIS_OBJMEM_GC_NONE) {
+        ctx->stats.promoted += ctx->new_space.last_promoted_size;
+        objmem_stats_add_pause(&ctx->stats, gc_time);
+    }
 
 #if ZIS_DEBUG
-    struct timespec tp1;
-    zis_debug_time(&tp1);
-    double dt_ms =
-        (double)(tp1.tv_sec - tp0.tv_sec) * 1e3 +
-        (double)(tp1.tv_nsec - tp0.tv_nsec) / 1e6;
-    zis_unused_var(dt_ms);
-
-    zis_debug_log(INFO, "ObjMem", "GC ends, %.2lf ms", dt_ms);
+    zis_debug_log(INFO, "ObjMem", "GC ends, %.2lf ms", (double)gc_time / 1e6);
     zis_debug_log_1(DUMP, "ObjMem", "zis_objmem_print_usage()", fp, {
         zis_objmem_print_usage(ctx, fp);
     });
@@ -2010,6 +2919,14 @@ enum zis_objmem_gc_type zis_objmem_current_gc(struct zis_context *z) {
     return (enum zis_objmem_gc_type)(int)ctx->current_gc_type;
 }
 
+void zis_objmem_read_stats(struct zis_context *z, struct zis_objmem_stats *stats) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    *stats = ctx->stats;
+    // Objects in new space are counted at GC. Add the ones allocated since the last GC.
+    stats->new_space_allocated += new_space_allocated_size_since_gc(&ctx->new_space);
+    stats->new_space_size = ctx->new_space.chunk_size * 2;
+}
+
 zis_noinline void zis_objmem_record_o2y_ref(struct zis_object *obj) {
     assert(zis_object_meta_is_not_young(obj->_meta));
     if (zis_likely(zis_object_meta_old_is_not_big(obj->_meta))) // ZIS_OBJMEM_OBJ_OLD
@@ -2018,6 +2935,58 @@ zis_noinline void zis_objmem_record_o2y_ref(struct zis_object *obj) {
         big_space_remember_object(obj);
 }
 
+void zis_objmem_walk_heap(
+    struct zis_context *z, bool with_roots, zis_objmem_heap_walker_t fn, void *arg
+) {
+    struct zis_objmem_context *const ctx = z->objmem_context;
+    assert(ctx->current_gc_type == ZIS_OBJMEM_GC_NONE);
+
+    // Objects referred to by the roots are marked, and the marks are reset
+    // when the objects are visited.
+
+    if (with_roots) {
+        mem_span_set_foreach(
+            &ctx->gc_roots,
+            void *, gc_root,
+            zis_objmem_object_visitor_t, visitor,
+        {
+            visitor(gc_root, ZIS_OBJMEM_OBJ_VISIT_MARK_1);
+        });
+    }
+
+    mem_chunk_foreach_allocated_object(
+        ctx->new_space._working_chunk, 0, obj, obj_type, obj_size,
+    {
+        const bool is_root = zis_object_meta_test_gc_mark(obj->_meta);
+        if (is_root)
+            zis_object_meta_reset_gc_mark(obj->_meta);
+        fn(arg, obj, obj_type, obj_size, is_root);
+    });
+
+    mem_chunk_list_foreach(&ctx->old_space._chunks, chunk, {
+        struct old_space_chunk_meta *const chunk_meta = old_space_chunk_meta_addr(chunk);
+        mem_chunk_foreach_allocated_object(
+            chunk, sizeof(struct old_space_chunk_meta), obj, obj_type, obj_size,
+        {
+            const bool is_root = old_space_chunk_test_mark(chunk_meta, obj);
+            if (is_root)
+                zis_object_meta_reset_gc_mark(obj->_meta);
+            fn(arg, obj, obj_type, obj_size, is_root);
+        });
+        if (with_roots)
+            old_space_chunk_clear_marks(chunk_meta);
+    });
+
+    big_space_foreach(&ctx->big_space, obj, has_young, {
+        zis_unused_var(has_young);
+        const bool is_root = zis_object_meta_test_gc_mark(obj->_meta);
+        if (is_root) // A marked BIG object looks forwarded with compact object meta.
+            zis_object_meta_reset_gc_mark(obj->_meta);
+        struct zis_type_obj *const obj_type = gc_object_type(obj);
+        fn(arg, obj, obj_type, zis_object_size_by_type(obj, obj_type), is_root);
+    });
+}
+
 void zis_objmem_print_usage(struct zis_objmem_context *ctx, void *FILE_ptr) {
 #if ZIS_DEBUG
 
@@ -2042,6 +3011,22 @@ void zis_objmem_print_usage(struct zis_objmem_context *ctx, void *FILE_ptr) {
 #endif
 }
 
+#if ZIS_USE_GC_SIDE_MARKS
+
+zis_noinline bool _zis_objmem_old_object_test_mark(struct zis_object *obj) {
+    assert(zis_object_meta_get_gc_state(obj->_meta) == ZIS_OBJMEM_OBJ_OLD);
+    assert(!zis_object_meta_test_gc_mark(obj->_meta));
+    return old_space_chunk_test_mark(old_space_chunk_meta_of_obj(obj), obj);
+}
+
+zis_noinline bool _zis_objmem_old_object_test_and_set_mark(struct zis_object *obj) {
+    assert(zis_object_meta_get_gc_state(obj->_meta) == ZIS_OBJMEM_OBJ_OLD);
+    assert(!zis_object_meta_test_gc_mark(obj->_meta));
+    return old_space_chunk_test_and_set_mark(old_space_chunk_meta_of_obj(obj), obj);
+}
+
+#endif // ZIS_USE_GC_SIDE_MARKS
+
 #define MARK_OBJ_IMPL__RET_IF_MARKED(obj) \
     if (zis_object_meta_test_gc_mark(obj->_meta)) \
         return;
@@ -2053,11 +3038,14 @@ void zis_objmem_print_usage(struct zis_objmem_context *ctx, void *FILE_ptr) {
 #define MARK_OBJ_IMPL__MARK_SELF(obj) \
     zis_object_meta_set_gc_mark(obj->_meta);
 
+#define MARK_OBJ_IMPL__RET_IF_MARKED_ELSE_MARK_SELF(obj) \
+    if (_zis_objmem_test_and_set_gc_mark(obj)) \
+        return;
+
 zis_static_force_inline void _zis_objmem_mark_object_rec_x(struct zis_object *obj) {
     assert(!zis_object_is_smallint(obj));
 
-    MARK_OBJ_IMPL__RET_IF_MARKED(obj)
-    MARK_OBJ_IMPL__MARK_SELF(obj)
+    MARK_OBJ_IMPL__RET_IF_MARKED_ELSE_MARK_SELF(obj)
 
     if (zis_object_meta_get_gc_state(obj->_meta) == ZIS_OBJMEM_OBJ_NEW)
         _zis_objmem_mark_object_slots_rec_x(obj);
@@ -2080,11 +3068,16 @@ zis_static_force_inline void _zis_objmem_mark_object_rec_y(struct zis_object *ob
 zis_static_force_inline void _zis_objmem_mark_object_rec_o2x(struct zis_object *obj) {
     assert(!zis_object_is_smallint(obj));
 
-    if (zis_object_meta_get_gc_state(obj->_meta) == ZIS_OBJMEM_OBJ_NEW) // Make NEW object MID, and it will become OLD after GC.
+    if (zis_object_meta_get_gc_state(obj->_meta) == ZIS_OBJMEM_OBJ_NEW) { // Make NEW object MID, and it will become OLD after GC.
         zis_object_meta_set_gc_state(obj->_meta, ZIS_OBJMEM_OBJ_MID); // TODO: meta_word &= 1
+        if (zis_object_meta_test_gc_mark(obj->_meta)) {
+            // Its slots have been marked as those of a NEW object and would stay young. Mark them again.
+            _zis_objmem_mark_object_slots_rec_o2x(obj);
+            return;
+        }
+    }
 
-    MARK_OBJ_IMPL__RET_IF_MARKED(obj)
-    MARK_OBJ_IMPL__MARK_SELF(obj)
+    MARK_OBJ_IMPL__RET_IF_MARKED_ELSE_MARK_SELF(obj)
 
     _zis_objmem_mark_object_slots_rec_o2x(obj);
 }
@@ -2095,8 +3088,14 @@ zis_static_force_inline void _zis_objmem_mark_object_rec_o2y(struct zis_object *
     if (zis_object_meta_is_not_young(obj->_meta))
         return;
 
-    if (zis_object_meta_young_is_new(obj->_meta))
+    if (zis_object_meta_young_is_new(obj->_meta)) {
         zis_object_meta_set_gc_state(obj->_meta, ZIS_OBJMEM_OBJ_MID); // TODO: meta_word &= 1
+        if (zis_object_meta_test_gc_mark(obj->_meta)) {
+            // Its slots have been marked as those of a NEW object and would stay young. Mark them again.
+            _zis_objmem_mark_object_slots_rec_o2y(obj);
+            return;
+        }
+    }
 
     MARK_OBJ_IMPL__RET_IF_MARKED(obj) // MARK_OBJ_IMPL__RET_IF_OLD_OR_MARKED(obj)
     MARK_OBJ_IMPL__MARK_SELF(obj)
@@ -2107,6 +3106,7 @@ zis_static_force_inline void _zis_objmem_mark_object_rec_o2y(struct zis_object *
 #undef MARK_OBJ_IMPL__RET_IF_MARKED
 #undef MARK_OBJ_IMPL__RET_IF_OLD_OR_MARKED
 #undef MARK_OBJ_IMPL__MARK_SELF
+#undef MARK_OBJ_IMPL__RET_IF_MARKED_ELSE_MARK_SELF
 
 #define MARK_OBJ_SLOT_IMPL__MARK_TYPE_OBJ(obj_type, MARK_FN_SUFFIX) \
     _zis_objmem_mark_object_rec_##MARK_FN_SUFFIX(zis_object_from(obj_type));
@@ -2173,8 +3173,8 @@ zis_static_force_inline bool _zis_objmem_move_object(struct zis_object **obj_ref
     if (!zis_object_meta_test_gc_mark(obj->_meta))
         return false;
 
-    // Pointer to the new storage shall have been stored in GC_PTR in object meta.
-    *obj_ref = zis_object_meta_get_gc_ptr(obj->_meta, struct zis_object *);
+    // Pointer to the new storage shall have been recorded with `gc_forward_object()`.
+    *obj_ref = _zis_objmem_forwarded_object(obj);
 
     // This operation is not recursive, so `_zis_objmem_move_object_slots()`
     // is not going to be called.
@@ -2184,11 +3184,12 @@ zis_static_force_inline bool _zis_objmem_move_object(struct zis_object **obj_ref
 
 /// Update the references to moved slots of an object.
 zis_noinline void _zis_objmem_move_object_slots(struct zis_object *obj) {
-    struct zis_type_obj *obj_type = zis_object_type(obj);
+    struct zis_object_meta *const obj_meta = gc_object_meta_ref(obj);
+    struct zis_type_obj *obj_type = zis_object_meta_get_type_ptr(*obj_meta);
     size_t slot_n = obj_type->_slots_num; // Get size before type ptr updated.
 
     if (zis_unlikely(_zis_objmem_move_object((struct zis_object **)&obj_type)))
-        zis_object_meta_set_type_ptr(obj->_meta, obj_type);
+        zis_object_meta_set_type_ptr(*obj_meta, obj_type);
 
     size_t slot_i = 0;
     if (zis_unlikely(slot_n == (size_t)-1)) { /* See `zis_object_slot_count()`. */
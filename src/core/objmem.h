@@ -5,12 +5,15 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "algorithm.h" // zis_unreachable()
 #include "attributes.h"
 #include "object.h"
 #include "smallint.h"
 
+#include "zis_config.h"
+
 struct zis_context;
 struct zis_object;
 struct zis_type_obj;
@@ -116,6 +119,7 @@ void _zis_object_write_barrier_n(struct zis_object *, struct zis_object *[], siz
 /// Object memory configuration.
 struct zis_objmem_options {
     size_t new_space_size;
+    size_t new_space_size_max;
     size_t old_space_size_new;
     size_t old_space_size_max;
     size_t big_space_size_new;
@@ -137,6 +141,9 @@ void zis_objmem_print_usage(struct zis_objmem_context *ctx, void *FILE_ptr);
 
 /* ----- object allocation -------------------------------------------------- */
 
+/// Max size of an object that is not allocated in big space.
+#define ZIS_OBJMEM_NON_BIG_SIZE_MAX (sizeof(struct zis_object *) * 1024)
+
 /// Memory allocation options.
 enum zis_objmem_alloc_type {
     ZIS_OBJMEM_ALLOC_AUTO, ///< Decide automatically.
@@ -160,6 +167,55 @@ struct zis_object *zis_objmem_alloc_ex(
     struct zis_type_obj *obj_type, size_t ext_slots, size_t ext_bytes
 );
 
+/// Try to enlarge an object with extendable slots (and no bytes) to `ext_slots`
+/// slots without moving it, which is possible only for some large objects.
+/// On success, the slot count is updated and the new slots are left uninitialized.
+/// GC is never triggered.
+bool zis_objmem_try_extend_slots(
+    struct zis_context *z, struct zis_object *obj, size_t ext_slots
+);
+
+/// Allocate storage of `size` bytes in old space for objects restored from a heap
+/// snapshot, which are to be placed one after another, filling it up. Each object
+/// shall be no larger than `ZIS_OBJMEM_NON_BIG_SIZE_MAX`, and its meta shall be
+/// initialized with `zis_object_meta_init()`, the state `ZIS_OBJMEM_OBJ_OLD`, and
+/// the GC_PTR stored to `gc_ptr`, before any other allocation. GC is never triggered.
+/// Returns `NULL` if the size exceeds the max size of an old space chunk.
+void *zis_objmem_alloc_restored_block(
+    struct zis_context *z, size_t size, void **gc_ptr
+);
+
+/// Allocate storage of `size` bytes in big space for a pinned or large object
+/// restored from a heap snapshot. GC is never triggered. The object type is left
+/// NULL and must be set before any other allocation.
+struct zis_object *zis_objmem_alloc_restored_big(struct zis_context *z, size_t size);
+
+/// Start allocating at an allocation site, which is identified by a stable
+/// address like the address of an allocating instruction. Until calling
+/// `zis_objmem_leave_alloc_site()`, objects allocated with `zis_objmem_alloc()`
+/// or `ZIS_OBJMEM_ALLOC_AUTO` are sampled to see whether they survive GCs; and
+/// if most of them do, they will be allocated in old space directly. So the
+/// code in between must not assume the new objects are young (use write barriers).
+/// Allocation sites cannot be nested.
+void zis_objmem_enter_alloc_site(struct zis_context *z, const void *site);
+
+/// Stop allocating at the allocation site. See `zis_objmem_enter_alloc_site()`.
+void zis_objmem_leave_alloc_site(struct zis_context *z);
+
+/// Allocation sampler. See `zis_objmem_set_alloc_sampler()`. Parameter `site` is the
+/// current allocation site (see `zis_objmem_enter_alloc_site()`) or NULL.
+/// The function must not allocate objects.
+typedef void (*zis_objmem_alloc_sampler_t)(
+    struct zis_context *z, struct zis_type_obj *obj_type, size_t obj_size, const void *site
+);
+
+/// Install an allocation sampler, which is called before allocating an object
+/// whenever `interval` bytes of object memory have been requested since the last call.
+/// Set `fn` to NULL to remove the sampler. Objects restored from snapshots are not counted.
+void zis_objmem_set_alloc_sampler(
+    struct zis_context *z, zis_objmem_alloc_sampler_t fn, size_t interval
+);
+
 /* ----- garbage collection ------------------------------------------------- */
 
 /// GC options.
@@ -176,6 +232,25 @@ int zis_objmem_gc(struct zis_context *z, enum zis_objmem_gc_type type);
 /// Get current GC type. Returning `ZIS_OBJMEM_GC_NONE` means GC is not running.
 enum zis_objmem_gc_type zis_objmem_current_gc(struct zis_context *z);
 
+/// Number of buckets in `zis_objmem_stats::pause_histogram`.
+#define ZIS_OBJMEM_STATS_PAUSE_BUCKETS 24
+
+/// GC statistics, counted since the memory context was created.
+struct zis_objmem_stats {
+    size_t   fast_gc_count, full_gc_count;
+    uint64_t pause_time_total_ns, pause_time_max_ns;
+    /// Numbers of GC pauses. Bucket `i` counts pauses that take [2^i, 2^(i+1))
+    /// microseconds; the first one also counts shorter pauses, and the last one longer ones.
+    size_t   pause_histogram[ZIS_OBJMEM_STATS_PAUSE_BUCKETS];
+    uint64_t new_space_allocated, old_space_allocated, big_space_allocated; ///< Bytes allocated by the mutator in each space.
+    uint64_t promoted; ///< Bytes of objects moved from new space to old space.
+    size_t   old_space_remembered, big_space_remembered; ///< Sizes of remembered sets (number of objects) scanned by the last fast GC.
+    size_t   new_space_size; ///< Current size of new space (two chunks), which adapts to the workload.
+};
+
+/// Read GC statistics.
+void zis_objmem_read_stats(struct zis_context *z, struct zis_objmem_stats *stats);
+
 /* ----- GC roots and weak-ref containers ----------------------------------- */
 
 /// See `zis_objmem_object_visitor_t`.
@@ -183,6 +258,7 @@ enum zis_objmem_obj_visit_op {
     ZIS_OBJMEM_OBJ_VISIT_MARK, ///< mark reachable object and its slots recursively
     ZIS_OBJMEM_OBJ_VISIT_MARK_Y, ///< mark reachable young object and its slots recursively
     ZIS_OBJMEM_OBJ_VISIT_MOVE, ///< update reference to moved object
+    ZIS_OBJMEM_OBJ_VISIT_MARK_1, ///< mark reachable object but not its slots (see `zis_objmem_walk_heap()`)
 };
 
 /// GC: object scanning function used by a GC root. Visit each object in the
@@ -203,6 +279,8 @@ do {                                     \
         _zis_objmem_move_object_((struct zis_object **)&(obj));     \
     else if (op == ZIS_OBJMEM_OBJ_VISIT_MARK)                       \
         _zis_objmem_mark_object_rec_x_((struct zis_object *)(obj)); \
+    else if (op == ZIS_OBJMEM_OBJ_VISIT_MARK_1)                     \
+        _zis_objmem_test_and_set_gc_mark((struct zis_object *)(obj)); \
     else                                 \
         zis_unreachable();               \
 } while (0)                              \
@@ -222,6 +300,26 @@ void zis_objmem_add_gc_root(
 /// Remove a GC root added with `zis_objmem_add_gc_root()`.
 bool zis_objmem_remove_gc_root(struct zis_context *z, void *root);
 
+/// Add a dependent GC root, which holds objects that are reachable only if their
+/// owners are, like the call stack of a suspended coroutine. It is visited after
+/// the other GC roots have been marked. When visited to mark objects, the function
+/// shall visit the objects of an owner only if the owner has been marked (see
+/// `zis_objmem_object_is_marked()`), and repeat until no more owners are found.
+/// Dependent roots are not visited by `zis_objmem_walk_heap()`.
+void zis_objmem_add_dependent_gc_root(
+    struct zis_context *z, void *root, zis_objmem_object_visitor_t fn
+);
+
+/// Remove a GC root added with `zis_objmem_add_dependent_gc_root()`.
+bool zis_objmem_remove_dependent_gc_root(struct zis_context *z, void *root);
+
+/// GC: check whether an object has been found reachable, when visiting a dependent
+/// GC root with operation `op` (`ZIS_OBJMEM_OBJ_VISIT_MARK` or `..._MARK_Y`).
+/// In a fast GC, old objects are all taken as reachable.
+#define zis_objmem_object_is_marked(obj, op) \
+    (((op) == ZIS_OBJMEM_OBJ_VISIT_MARK_Y && zis_object_meta_is_not_young((obj)->_meta)) || \
+        _zis_objmem_test_gc_mark(zis_object_from(obj)))
+
 /// See `zis_objmem_weak_refs_visitor_t`.
 enum zis_objmem_weak_ref_visit_op {
     ZIS_OBJMEM_WEAK_REF_VISIT_FINI, ///< finalize reference
@@ -245,7 +343,7 @@ do {                                       \
         assert(op == ZIS_OBJMEM_WEAK_REF_VISIT_FINI || op == ZIS_OBJMEM_WEAK_REF_VISIT_FINI_Y); \
         if (op == ZIS_OBJMEM_WEAK_REF_VISIT_FINI_Y && zis_object_meta_is_not_young(obj->_meta)) \
             break;                         \
-        if (!zis_object_meta_test_gc_mark(obj->_meta))     \
+        if (!_zis_objmem_test_gc_mark(zis_object_from(obj))) \
             WEAK_REF_FINI( (obj) );        \
     } else {                               \
         _zis_objmem_move_object_((struct zis_object **)&(obj));                                 \
@@ -262,8 +360,53 @@ void zis_objmem_register_weak_ref_collection(
 /// Remove a weak reference container record.
 bool zis_objmem_unregister_weak_ref_collection(struct zis_context *z, void *ref_container);
 
+/* ----- heap walking ------------------------------------------------------- */
+
+/// Heap walker. See `zis_objmem_walk_heap()`.
+typedef void (*zis_objmem_heap_walker_t)(
+    void *arg, struct zis_object *obj, struct zis_type_obj *obj_type, size_t obj_size, bool is_root
+);
+
+/// Call `fn` for each allocated object in new space, old space, and big space,
+/// including unreachable ones that have not been collected yet (run a full GC
+/// before to skip them). If `with_roots` is true, parameter `is_root` tells whether
+/// the object is referred to directly by a GC root; otherwise it is always false.
+/// The function must not allocate objects.
+void zis_objmem_walk_heap(
+    struct zis_context *z, bool with_roots, zis_objmem_heap_walker_t fn, void *arg
+);
+
 /* -------------------------------------------------------------------------- */
 
+#if ZIS_USE_GC_SIDE_MARKS
+
+zis_noinline bool _zis_objmem_old_object_test_mark(struct zis_object *);
+zis_noinline bool _zis_objmem_old_object_test_and_set_mark(struct zis_object *);
+
+#endif // ZIS_USE_GC_SIDE_MARKS
+
+/// Check the GC mark of an object. When `ZIS_USE_GC_SIDE_MARKS` is on, the marks
+/// of objects in the old space are stored in side bitmaps instead of the object meta.
+zis_static_force_inline bool _zis_objmem_test_gc_mark(struct zis_object *obj) {
+#if ZIS_USE_GC_SIDE_MARKS
+    if (zis_object_meta_get_gc_state(obj->_meta) == ZIS_OBJMEM_OBJ_OLD)
+        return _zis_objmem_old_object_test_mark(obj);
+#endif // ZIS_USE_GC_SIDE_MARKS
+    return zis_object_meta_test_gc_mark(obj->_meta);
+}
+
+/// Set the GC mark of an object. Returns whether it has already been marked.
+zis_static_force_inline bool _zis_objmem_test_and_set_gc_mark(struct zis_object *obj) {
+#if ZIS_USE_GC_SIDE_MARKS
+    if (zis_object_meta_get_gc_state(obj->_meta) == ZIS_OBJMEM_OBJ_OLD)
+        return _zis_objmem_old_object_test_and_set_mark(obj);
+#endif // ZIS_USE_GC_SIDE_MARKS
+    if (zis_object_meta_test_gc_mark(obj->_meta))
+        return true;
+    zis_object_meta_set_gc_mark(obj->_meta);
+    return false;
+}
+
 zis_noinline void _zis_objmem_mark_object_slots_rec_x(struct zis_object *);
 zis_noinline void _zis_objmem_mark_object_slots_rec_y(struct zis_object *);
 zis_noinline void _zis_objmem_mark_object_slots_rec_o2x(struct zis_object *);
@@ -274,9 +417,8 @@ zis_noinline void _zis_objmem_move_object_slots(struct zis_object *);
 #define _zis_objmem_mark_object_rec_x_(obj) \
 do {                                        \
     struct zis_object *__obj = (obj);       \
-    if (zis_object_meta_test_gc_mark(__obj->_meta)) \
+    if (_zis_objmem_test_and_set_gc_mark(__obj))    \
         break;                              \
-    zis_object_meta_set_gc_mark(__obj->_meta);      \
     if (zis_object_meta_get_gc_state(__obj->_meta) == ZIS_OBJMEM_OBJ_NEW) \
         _zis_objmem_mark_object_slots_rec_x(__obj); \
     else                                    \
@@ -298,13 +440,35 @@ do {                                        \
 } while (0)                                 \
 // ^^^ _zis_objmem_mark_object_rec_y_() ^^^
 
+#if ZIS_USE_COMPACT_OBJECT_META
+
+/// GC: forwarding record of a moved object. See `zis_object_meta_set_forwarding()`.
+struct _zis_objmem_fwd_record {
+    struct zis_object     *new_obj;
+    struct zis_object_meta orig_meta;
+};
+
+#endif // ZIS_USE_COMPACT_OBJECT_META
+
+/// GC: get the new storage of a marked object, which has been forwarded.
+zis_static_force_inline struct zis_object *_zis_objmem_forwarded_object(struct zis_object *obj) {
+    assert(zis_object_meta_test_gc_mark(obj->_meta));
+#if ZIS_USE_COMPACT_OBJECT_META
+    if (zis_likely(zis_object_meta_is_forwarded(obj->_meta)))
+        return zis_object_meta_get_forwarding(obj->_meta, struct _zis_objmem_fwd_record *)->new_obj;
+    return obj; // Not moved, thus not forwarded.
+#else // !ZIS_USE_COMPACT_OBJECT_META
+    return zis_object_meta_get_gc_ptr(obj->_meta, struct zis_object *);
+#endif // ZIS_USE_COMPACT_OBJECT_META
+}
+
 // See `_zis_objmem_move_object()`.
 #define _zis_objmem_move_object_(obj_ref) \
 do {                                      \
     struct zis_object *__obj = *(obj_ref);\
     if (!zis_object_meta_test_gc_mark(__obj->_meta)) \
         break;                            \
-    *(obj_ref) = zis_object_meta_get_gc_ptr(__obj->_meta, struct zis_object *); \
+    *(obj_ref) = _zis_objmem_forwarded_object(__obj); \
 } while (0)                               \
 // ^^^ _zis_objmem_move_object_()^^^
 
@@ -20,8 +20,8 @@ zis_static_force_inline void zis_object_vec_copy(
 
 /// Copy a vector of object pointers like `memmove()`.
 zis_static_force_inline void zis_object_vec_move(
-    struct zis_object **restrict dst,
-    struct zis_object *const *restrict src, size_t n
+    struct zis_object **dst,
+    struct zis_object *const *src, size_t n
 ) {
     memmove(dst, src, n * sizeof(struct zis_object *));
 }
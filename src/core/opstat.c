@@ -0,0 +1,256 @@
+#include "opstat.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attributes.h"
+#include "context.h"
+#include "debug.h"
+#include "memory.h"
+#include "objmem.h"
+#include "profiler.h" // zis_prof_obj_table
+
+#include "funcobj.h"
+#include "stringobj.h"
+
+#if ZIS_FEATURE_OPSTAT
+
+/* ----- trace -------------------------------------------------------------- */
+
+/*
+ * Trace file format. All numbers are 32-bit words in the native byte order.
+ *
+ * +---------------+----------+-------------+------------+----------------+
+ * | "ZISOPTR\0"   | version  | records ... | 0xffffffff | func names ... |
+ * | (8 bytes)     | (=1)     |             |            |                |
+ * +---------------+----------+-------------+------------+----------------+
+ *
+ * A record is either `0x80000000 | FUNC_INDEX`, meaning the following
+ * instructions are in another function, or the offset of an executed
+ * instruction in the current function (`0x7fffffff` if unknown).
+ * Function names are in the order of their indices, each of which is the
+ * name length followed by the name bytes padded to a multiple of 4.
+ */
+
+#define OPSTAT_TRACE_FUNC_BIT      UINT32_C(0x80000000)
+#define OPSTAT_TRACE_OFFSET_NONE   UINT32_C(0x7fffffff)
+#define OPSTAT_TRACE_END           UINT32_C(0xffffffff)
+#define OPSTAT_TRACE_BUFFER_WORDS  (64 * 1024)
+
+struct zis_opstat_trace {
+    zis_file_handle_t file;
+    bool failed;
+    /// Traced functions. GC root.
+    struct zis_prof_obj_table funcs;
+    /// The function of the last record, for a fast check. Reset when objects move.
+    struct zis_object *last_func;
+    uint32_t last_func_index;
+    size_t length;
+    uint32_t buffer[OPSTAT_TRACE_BUFFER_WORDS];
+};
+
+static void opstat_trace_flush(struct zis_opstat_trace *t) {
+    if (t->length && !t->failed) {
+        if (zis_file_write(t->file, (const char *)t->buffer, t->length * sizeof t->buffer[0]) != 0)
+            t->failed = true;
+    }
+    t->length = 0;
+}
+
+static void opstat_trace_put(struct zis_opstat_trace *t, uint32_t word) {
+    if (zis_unlikely(t->length == OPSTAT_TRACE_BUFFER_WORDS))
+        opstat_trace_flush(t);
+    t->buffer[t->length++] = word;
+}
+
+static void opstat_trace_gc_visitor(void *_t, enum zis_objmem_obj_visit_op op) {
+    struct zis_opstat_trace *const t = _t;
+    zis_prof_obj_table_gc_visit(&t->funcs, op);
+    if (op == ZIS_OBJMEM_OBJ_VISIT_MOVE)
+        t->last_func = NULL;
+}
+
+static struct zis_opstat_trace *opstat_trace_create(
+    struct zis_context *z, const zis_path_char_t *file
+) {
+    const zis_file_handle_t fh = zis_file_open(file, ZIS_FILE_MODE_WR);
+    if (!fh) {
+        zis_debug_log(WARN, "OpStat", "cannot open the trace file");
+        return NULL;
+    }
+    struct zis_opstat_trace *const t = zis_mem_alloc(sizeof(struct zis_opstat_trace));
+    t->file = fh;
+    t->failed = false;
+    zis_prof_obj_table_init(&t->funcs);
+    t->last_func = NULL;
+    t->last_func_index = (uint32_t)-1;
+    t->length = 0;
+    const char magic[8] = "ZISOPTR";
+    memcpy(t->buffer, magic, sizeof magic);
+    t->buffer[2] = 1; // version
+    t->length = 3;
+    zis_objmem_add_gc_root(z, t, opstat_trace_gc_visitor);
+    return t;
+}
+
+/// Write the function names and close the trace.
+static void opstat_trace_destroy(struct zis_opstat_trace *t, struct zis_context *z) {
+    opstat_trace_put(t, OPSTAT_TRACE_END);
+    for (size_t i = 0; i < t->funcs.count; i++) {
+        char name[80];
+        struct zis_string_obj *const name_obj = zis_context_guess_variable_name(
+            z, t->funcs.objs[i] // may trigger GC
+        );
+        size_t n = name_obj ? zis_string_obj_to_u8str(name_obj, name, sizeof name - 1) : (size_t)-1;
+        if (n == (size_t)-1)
+            n = (size_t)snprintf(name, sizeof name, "??@%zu", i);
+        memset(name + n, 0, sizeof name - n);
+        opstat_trace_put(t, (uint32_t)n);
+        for (size_t j = 0; j < n; j += 4) {
+            uint32_t w;
+            memcpy(&w, name + j, 4);
+            opstat_trace_put(t, w);
+        }
+    }
+    opstat_trace_flush(t);
+    if (t->failed)
+        zis_debug_log(WARN, "OpStat", "failed to write the trace file");
+    zis_objmem_remove_gc_root(z, t);
+    zis_file_close(t->file);
+    zis_prof_obj_table_fini(&t->funcs);
+    zis_mem_free(t);
+}
+
+void zis_opstat_trace(struct zis_opstat *os, struct zis_func_obj *func, const void *ip) {
+    struct zis_opstat_trace *const t = os->trace;
+    assert(t);
+    if (zis_unlikely(zis_object_from(func) != t->last_func)) {
+        t->last_func = zis_object_from(func);
+        const uint32_t index = zis_prof_obj_table_index(&t->funcs, t->last_func);
+        if (index != t->last_func_index) {
+            t->last_func_index = index;
+            opstat_trace_put(t, OPSTAT_TRACE_FUNC_BIT | index);
+        }
+    }
+    const uint32_t offset = zis_prof_func_ip_offset(func, ip);
+    opstat_trace_put(t, offset < OPSTAT_TRACE_OFFSET_NONE ? offset : OPSTAT_TRACE_OFFSET_NONE);
+}
+
+/* ----- summary ------------------------------------------------------------ */
+
+#define OPSTAT_SUMMARY_MAX_PAIRS   100
+
+static const char *const opstat_op_names[ZIS_OP_LIST_MAX_LEN] = {
+#define E(CODE, NAME)  [CODE] = #NAME ,
+    ZIS_OP_LIST
+#undef E
+};
+
+struct opstat_summary_entry {
+    uint64_t count;
+    unsigned int op, op2;
+};
+
+static int opstat_summary_entry_compare(const void *_a, const void *_b) {
+    const struct opstat_summary_entry *const a = _a, *const b = _b;
+    if (a->count != b->count)
+        return a->count > b->count ? -1 : 1;
+    if (a->op != b->op)
+        return a->op < b->op ? -1 : 1;
+    return a->op2 < b->op2 ? -1 : a->op2 > b->op2;
+}
+
+/// Write the summary: executed opcodes, and the most frequent opcode pairs,
+/// in descending order of counts.
+static void opstat_write_summary(struct zis_opstat *os, zis_file_handle_t file) {
+    char line[96];
+    int line_len;
+    struct opstat_summary_entry *const entries = zis_mem_alloc(
+        ZIS_OP_LIST_MAX_LEN * ZIS_OP_LIST_MAX_LEN * sizeof(struct opstat_summary_entry)
+    );
+    size_t n = 0;
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < ZIS_OP_LIST_MAX_LEN; i++) {
+        if (!os->op_counts[i])
+            continue;
+        total += os->op_counts[i];
+        entries[n++] = (struct opstat_summary_entry){os->op_counts[i], i, 0};
+    }
+    qsort(entries, n, sizeof entries[0], opstat_summary_entry_compare);
+    const double pct = total ? 100.0 / (double)total : 0.0;
+    line_len = snprintf(line, sizeof line, "# opcodes: %" PRIu64 " instructions executed\n", total);
+    zis_file_write(file, line, (size_t)line_len);
+    for (size_t i = 0; i < n; i++) {
+        const struct opstat_summary_entry *const e = &entries[i];
+        line_len = snprintf(
+            line, sizeof line, "%-8s %14" PRIu64 " %6.2f%%\n",
+            opstat_op_names[e->op] ? opstat_op_names[e->op] : "??", e->count, (double)e->count * pct
+        );
+        zis_file_write(file, line, (size_t)line_len);
+    }
+
+    n = 0;
+    for (unsigned int i = 0; i < ZIS_OP_LIST_MAX_LEN; i++) {
+        for (unsigned int j = 0; j < ZIS_OP_LIST_MAX_LEN; j++) {
+            const uint64_t c = os->op_pair_counts[i][j];
+            if (c)
+                entries[n++] = (struct opstat_summary_entry){c, i, j};
+        }
+    }
+    qsort(entries, n, sizeof entries[0], opstat_summary_entry_compare);
+    line_len = snprintf(line, sizeof line, "# opcode pairs: %zu different pairs\n", n);
+    zis_file_write(file, line, (size_t)line_len);
+    for (size_t i = 0; i < n && i < OPSTAT_SUMMARY_MAX_PAIRS; i++) {
+        const struct opstat_summary_entry *const e = &entries[i];
+        line_len = snprintf(
+            line, sizeof line, "%-8s %-8s %14" PRIu64 " %6.2f%%\n",
+            opstat_op_names[e->op] ? opstat_op_names[e->op] : "??",
+            opstat_op_names[e->op2] ? opstat_op_names[e->op2] : "??",
+            e->count, (double)e->count * pct
+        );
+        zis_file_write(file, line, (size_t)line_len);
+    }
+
+    zis_mem_free(entries);
+}
+
+/* ----- opcode statistics -------------------------------------------------- */
+
+struct zis_opstat *zis_opstat_create(
+    struct zis_context *z,
+    const zis_path_char_t *summary_file, const zis_path_char_t *trace_file
+) {
+    struct zis_opstat *const os = zis_mem_alloc(sizeof(struct zis_opstat));
+    memset(os->op_counts, 0, sizeof os->op_counts);
+    memset(os->op_pair_counts, 0, sizeof os->op_pair_counts);
+    os->last_op = 0;
+    os->trace = trace_file ? opstat_trace_create(z, trace_file) : NULL;
+    os->summary_file = summary_file ? zis_path_dup(summary_file) : NULL;
+    return os;
+}
+
+void zis_opstat_destroy(struct zis_opstat *os, struct zis_context *z) {
+    if (os->trace)
+        opstat_trace_destroy(os->trace, z);
+
+    if (os->summary_file && !os->summary_file[0]) {
+        opstat_write_summary(os, zis_file_stdio(ZIS_FILE_STDERR));
+    } else if (os->summary_file) {
+        const zis_file_handle_t file = zis_file_open(os->summary_file, ZIS_FILE_MODE_WR);
+        if (file) {
+            opstat_write_summary(os, file);
+            zis_file_close(file);
+        } else {
+            zis_debug_log(WARN, "OpStat", "cannot open the summary file");
+        }
+    }
+    zis_mem_free(os->summary_file);
+
+    zis_mem_free(os);
+}
+
+#endif // ZIS_FEATURE_OPSTAT
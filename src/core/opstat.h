@@ -0,0 +1,43 @@
+/// Opcode statistics.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "fsutil.h" // zis_path_char_t
+#include "oplist.h" // ZIS_OP_LIST_MAX_LEN
+
+#include "zis_config.h" // ZIS_FEATURE_OPSTAT
+
+struct zis_context;
+struct zis_func_obj;
+struct zis_opstat_trace;
+
+#if ZIS_FEATURE_OPSTAT
+
+/// Opcode statistics of a context. The interpreter counts each instruction
+/// before executing it, and calls `zis_opstat_trace()` if `trace` is not NULL.
+struct zis_opstat {
+    uint64_t op_counts[ZIS_OP_LIST_MAX_LEN];
+    uint64_t op_pair_counts[ZIS_OP_LIST_MAX_LEN][ZIS_OP_LIST_MAX_LEN]; ///< `[previous][current]`
+    unsigned int last_op;
+    struct zis_opstat_trace *trace; ///< Nullable.
+    zis_path_char_t *summary_file; ///< Nullable.
+};
+
+/// Create opcode statistics for context `z`. When the statistics are destroyed,
+/// a summary is written to `summary_file` (stderr if it is empty, or nowhere if
+/// it is NULL). If `trace_file` is not NULL, a trace of executed instructions is
+/// written to it; see the comments in "opstat.c" for the file format.
+struct zis_opstat *zis_opstat_create(
+    struct zis_context *z,
+    const zis_path_char_t *summary_file, const zis_path_char_t *trace_file
+);
+
+/// Write the summary (and finish the trace), and then delete the statistics.
+void zis_opstat_destroy(struct zis_opstat *os, struct zis_context *z);
+
+/// Write a trace record for the instruction at `ip` in function `func`.
+void zis_opstat_trace(struct zis_opstat *os, struct zis_func_obj *func, const void *ip);
+
+#endif // ZIS_FEATURE_OPSTAT
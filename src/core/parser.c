@@ -653,14 +653,6 @@ static void parse_list(
     enum zis_token_type beginning_tok /*=NTOK*/, enum zis_token_type end_tok, const bool pairs,
     struct zis_array_obj *_elements_out, struct zis_ast_node_obj_location *restrict loc_out
 ) {
-    zis_lexer_ignore_eol_begin(&p->lexer);
-
-    if (beginning_tok != NTOK) {
-        const struct zis_token *tok = this_token(p);
-        loc_out->line0 = tok->line0, loc_out->column0 = tok->column0;
-        check_token_type_and_ignore(p, beginning_tok);
-    }
-
     struct zis_context *const z = parser_z(p);
     zis_locals_decl(
         p, var,
@@ -668,9 +660,19 @@ static void parse_list(
         struct zis_array_obj *elements;
     );
     zis_locals_zero(var);
+    // Reading the next token may allocate objects, so `_elements_out` must be
+    // stored in `var` before consuming `beginning_tok`.
     var.elements = _elements_out;
     expr_builder_init(&var.expr_builder, z);
 
+    zis_lexer_ignore_eol_begin(&p->lexer);
+
+    if (beginning_tok != NTOK) {
+        const struct zis_token *tok = this_token(p);
+        loc_out->line0 = tok->line0, loc_out->column0 = tok->column0;
+        check_token_type_and_ignore(p, beginning_tok);
+    }
+
     while (true) {
         if (this_token(p)->type == end_tok)
             break;
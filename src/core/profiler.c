@@ -0,0 +1,738 @@
+#include "profiler.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "algorithm.h"
+#include "attributes.h"
+#include "context.h"
+#include "debug.h"
+#include "globals.h"
+#include "memory.h"
+#include "objmem.h"
+#include "platform.h"
+#include "smallint.h"
+#include "stack.h"
+
+#include "arrayobj.h"
+#include "funcobj.h"
+#include "intobj.h"
+#include "stringobj.h"
+#include "tupleobj.h"
+
+#if ZIS_FEATURE_PROF && ZIS_SYSTEM_POSIX
+#    include <sys/time.h>
+#    define PROF_USE_SETITIMER 1
+#else
+#    define PROF_USE_SETITIMER 0
+#endif
+
+#if ZIS_FEATURE_PROF
+
+#define PROF_DEFAULT_INTERVAL_US    1000
+#define PROF_MAX_DEPTH              128
+#define PROF_DEFAULT_ALLOC_INTERVAL (64 * 1024)
+
+#endif // ZIS_FEATURE_PROF
+
+#if ZIS_FEATURE_PROF || ZIS_FEATURE_OPSTAT
+
+/* ----- object table ------------------------------------------------------- */
+
+void zis_prof_obj_table_init(struct zis_prof_obj_table *t) {
+    memset(t, 0, sizeof *t);
+}
+
+void zis_prof_obj_table_fini(struct zis_prof_obj_table *t) {
+    zis_mem_free(t->objs);
+    zis_mem_free(t->table);
+}
+
+void zis_prof_obj_table_gc_visit(struct zis_prof_obj_table *t, enum zis_objmem_obj_visit_op op) {
+    zis_objmem_visit_object_vec(t->objs, t->objs + t->count, op);
+    if (op == ZIS_OBJMEM_OBJ_VISIT_MOVE)
+        t->table_dirty = true;
+}
+
+static void prof_obj_table_rebuild(struct zis_prof_obj_table *t, size_t size) {
+    assert(size && !(size & (size - 1)) && size > t->count);
+    zis_mem_free(t->table);
+    t->table = zis_mem_alloc(size * sizeof t->table[0]);
+    memset(t->table, 0, size * sizeof t->table[0]);
+    t->table_size = size;
+    for (size_t i = 0; i < t->count; i++) {
+        size_t j = zis_hash_pointer(t->objs[i]) & (size - 1);
+        while (t->table[j])
+            j = (j + 1) & (size - 1);
+        t->table[j] = (uint32_t)(i + 1);
+    }
+    t->table_dirty = false;
+}
+
+uint32_t zis_prof_obj_table_index(struct zis_prof_obj_table *t, struct zis_object *obj) {
+    if (zis_unlikely(t->table_dirty))
+        prof_obj_table_rebuild(t, t->table_size);
+
+    const size_t mask = t->table_size - 1;
+    size_t j = 0;
+    if (t->table_size) {
+        j = zis_hash_pointer(obj) & mask;
+        for (uint32_t x; (x = t->table[j]); j = (j + 1) & mask) {
+            if (t->objs[x - 1] == obj)
+                return x - 1;
+        }
+    }
+
+    if (t->count == t->capacity) {
+        t->capacity = t->capacity ? t->capacity * 2 : 64;
+        t->objs = zis_mem_realloc(t->objs, t->capacity * sizeof t->objs[0]);
+    }
+    const size_t index = t->count++;
+    t->objs[index] = obj;
+    if (t->count * 4 > t->table_size * 3) {
+        prof_obj_table_rebuild(t, t->table_size ? t->table_size * 2 : 128);
+    } else {
+        while (t->table[j])
+            j = (j + 1) & mask;
+        t->table[j] = (uint32_t)(index + 1);
+    }
+    return (uint32_t)index;
+}
+
+uint32_t zis_prof_func_ip_offset(const struct zis_func_obj *func_obj, const void *ip) {
+    const zis_func_obj_bytecode_word_t *const func_p = func_obj->bytecode;
+    const zis_func_obj_bytecode_word_t *const func_p_end =
+        func_p + zis_func_obj_bytecode_length(func_obj);
+    if (ip >= (const void *)func_p && ip < (const void *)func_p_end)
+        return (uint32_t)((const zis_func_obj_bytecode_word_t *)ip - func_p);
+    return (uint32_t)-1;
+}
+
+#endif // ZIS_FEATURE_PROF || ZIS_FEATURE_OPSTAT
+
+#if ZIS_FEATURE_PROF && PROF_USE_SETITIMER
+
+/* ----- CPU profiler: timer ------------------------------------------------ */
+
+volatile sig_atomic_t zis_profiler_pending_ticks = 0;
+
+/// The context being profiled, or NULL.
+static struct zis_context *prof_active_context = NULL;
+
+static struct sigaction prof_old_sigaction;
+
+static void prof_signal_handler(int sig) {
+    zis_unused_var(sig);
+    zis_profiler_pending_ticks++;
+}
+
+static bool prof_timer_start(unsigned int interval_us) {
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = prof_signal_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, &prof_old_sigaction) != 0)
+        return false;
+
+    struct itimerval tv;
+    tv.it_interval.tv_sec = (time_t)(interval_us / 1000000);
+    tv.it_interval.tv_usec = (suseconds_t)(interval_us % 1000000);
+    tv.it_value = tv.it_interval;
+    if (setitimer(ITIMER_PROF, &tv, NULL) != 0) {
+        sigaction(SIGPROF, &prof_old_sigaction, NULL);
+        return false;
+    }
+    return true;
+}
+
+static void prof_timer_stop(void) {
+    struct itimerval tv;
+    memset(&tv, 0, sizeof tv);
+    setitimer(ITIMER_PROF, &tv, NULL);
+    sigaction(SIGPROF, &prof_old_sigaction, NULL);
+    zis_profiler_pending_ticks = 0;
+}
+
+/* ----- CPU profiler: data ------------------------------------------------- */
+
+struct prof_frame {
+    uint32_t func_index; ///< Index in `zis_profiler::funcs`.
+    uint32_t ip_offset;
+};
+
+struct prof_stack {
+    size_t hash;
+    size_t frames_offset; ///< Index of the first (leaf) frame in `zis_profiler::frame_pool`.
+    size_t depth; ///< Number of frames. 0 means an empty table slot.
+    size_t count; ///< Number of ticks.
+};
+
+/// Profiler data. Samples are aggregated in place, so that memory usage grows
+/// with the number of different stacks rather than the number of samples.
+struct zis_profiler {
+    /// Sampled functions. GC root.
+    struct zis_prof_obj_table funcs;
+
+    /// Frames of all the stacks, leaf first.
+    struct prof_frame *frame_pool;
+    size_t frame_pool_length, frame_pool_capacity;
+    /// Open-addressing hash table of stacks.
+    struct prof_stack *stacks;
+    size_t stack_count, stack_table_size; // power of 2
+
+    size_t sample_count, tick_count;
+
+    struct prof_frame walk_buffer[PROF_MAX_DEPTH];
+};
+
+static void prof_gc_visitor(void *_prof, enum zis_objmem_obj_visit_op op) {
+    struct zis_profiler *const prof = _prof;
+    zis_prof_obj_table_gc_visit(&prof->funcs, op);
+}
+
+static struct zis_profiler *prof_create(struct zis_context *z) {
+    struct zis_profiler *const prof = zis_mem_alloc(sizeof(struct zis_profiler));
+    memset(prof, 0, sizeof *prof);
+    zis_prof_obj_table_init(&prof->funcs);
+    zis_objmem_add_gc_root(z, prof, prof_gc_visitor);
+    return prof;
+}
+
+static void prof_destroy(struct zis_profiler *prof, struct zis_context *z) {
+    zis_objmem_remove_gc_root(z, prof);
+    zis_prof_obj_table_fini(&prof->funcs);
+    zis_mem_free(prof->frame_pool);
+    zis_mem_free(prof->stacks);
+    zis_mem_free(prof);
+}
+
+static void prof_stack_table_grow(struct zis_profiler *prof) {
+    const size_t old_size = prof->stack_table_size;
+    struct prof_stack *const old_stacks = prof->stacks;
+    const size_t new_size = old_size ? old_size * 2 : 256;
+    struct prof_stack *const new_stacks = zis_mem_alloc(new_size * sizeof new_stacks[0]);
+    memset(new_stacks, 0, new_size * sizeof new_stacks[0]);
+    for (size_t i = 0; i < old_size; i++) {
+        const struct prof_stack *const s = &old_stacks[i];
+        if (!s->depth)
+            continue;
+        size_t j = s->hash & (new_size - 1);
+        while (new_stacks[j].depth)
+            j = (j + 1) & (new_size - 1);
+        new_stacks[j] = *s;
+    }
+    zis_mem_free(old_stacks);
+    prof->stacks = new_stacks;
+    prof->stack_table_size = new_size;
+}
+
+static void prof_add_stack(
+    struct zis_profiler *prof,
+    const struct prof_frame *frames, size_t depth, size_t ticks
+) {
+    assert(depth);
+    const size_t frames_size = depth * sizeof frames[0];
+    const size_t hash = zis_hash_bytes(frames, frames_size);
+
+    if ((prof->stack_count + 1) * 4 > prof->stack_table_size * 3)
+        prof_stack_table_grow(prof);
+    const size_t mask = prof->stack_table_size - 1;
+    size_t j = hash & mask;
+    for (struct prof_stack *s; (s = &prof->stacks[j])->depth; j = (j + 1) & mask) {
+        if (
+            s->hash == hash && s->depth == depth &&
+            !memcmp(prof->frame_pool + s->frames_offset, frames, frames_size)
+        ) {
+            s->count += ticks;
+            return;
+        }
+    }
+
+    if (prof->frame_pool_capacity - prof->frame_pool_length < depth) {
+        size_t new_cap = prof->frame_pool_capacity ? prof->frame_pool_capacity * 2 : 1024;
+        while (new_cap - prof->frame_pool_length < depth)
+            new_cap *= 2;
+        prof->frame_pool = zis_mem_realloc(prof->frame_pool, new_cap * sizeof frames[0]);
+        prof->frame_pool_capacity = new_cap;
+    }
+    memcpy(prof->frame_pool + prof->frame_pool_length, frames, frames_size);
+
+    struct prof_stack *const s = &prof->stacks[j];
+    s->hash = hash;
+    s->frames_offset = prof->frame_pool_length;
+    s->depth = depth;
+    s->count = ticks;
+    prof->frame_pool_length += depth;
+    prof->stack_count++;
+}
+
+/* ----- CPU profiler: sampling --------------------------------------------- */
+
+struct prof_walk_state {
+    struct zis_profiler *prof;
+    struct zis_type_obj *type_Function;
+    const void *ip;
+    size_t depth;
+};
+
+static int prof_walk_frame(struct zis_callstack_foreach_frame_fn_arg *x) {
+    struct prof_walk_state *const state = x->func_arg;
+    const struct zis_callstack_frame_info *const fi = x->frame_info;
+    const void *const ip = state->ip;
+    state->ip = fi->caller_ip;
+
+    struct zis_object *const func = fi->prev_frame[0];
+    if (!zis_object_type_is(func, state->type_Function))
+        return 0; // Not a function, like the frame of a native block.
+    uint32_t ip_offset = zis_prof_func_ip_offset(zis_object_cast(func, struct zis_func_obj), ip);
+    if (ip_offset == (uint32_t)-1)
+        ip_offset = 0;
+
+    struct zis_profiler *const prof = state->prof;
+    struct prof_frame *const frame = &prof->walk_buffer[state->depth];
+    frame->func_index = zis_prof_obj_table_index(&prof->funcs, func);
+    frame->ip_offset = ip_offset;
+    return ++state->depth == PROF_MAX_DEPTH;
+}
+
+void zis_profiler_sample(struct zis_context *z, const void *ip) {
+    struct zis_profiler *const prof = z->profiler;
+    if (!prof)
+        return; // Another context is being profiled.
+
+    const size_t ticks = (size_t)zis_profiler_pending_ticks;
+    zis_profiler_pending_ticks = 0;
+    if (!ticks)
+        return;
+
+    struct prof_walk_state state;
+    state.prof = prof;
+    state.type_Function = z->globals->type_Function;
+    state.ip = ip;
+    state.depth = 0;
+    for (struct zis_callstack *cs = z->callstack; cs; cs = cs->resumer) {
+        if (zis_callstack_empty(cs))
+            continue;
+        if (zis_callstack_foreach_frame(cs, prof_walk_frame, &state))
+            break;
+        state.ip = NULL;
+    }
+
+    prof->sample_count++;
+    prof->tick_count += ticks;
+    if (state.depth)
+        prof_add_stack(prof, prof->walk_buffer, state.depth, ticks);
+}
+
+/* ----- CPU profiler: output ----------------------------------------------- */
+
+struct prof_output {
+    zis_file_handle_t file;
+    char  *buffer;
+    size_t length, capacity;
+    bool   failed;
+};
+
+static void prof_output_flush(struct prof_output *out) {
+    if (out->length && !out->failed) {
+        if (zis_file_write(out->file, out->buffer, out->length) != 0)
+            out->failed = true;
+    }
+    out->length = 0;
+}
+
+static void prof_output_write(struct prof_output *out, const char *s, size_t n) {
+    if (out->capacity - out->length < n) {
+        prof_output_flush(out);
+        if (out->capacity < n) {
+            out->buffer = zis_mem_realloc(out->buffer, n);
+            out->capacity = n;
+        }
+    }
+    memcpy(out->buffer + out->length, s, n);
+    out->length += n;
+}
+
+/// Get the name of the function of a frame, which is cached in `func_names`.
+/// Characters that have special meanings in the folded format are replaced.
+static const char *prof_func_name(
+    struct zis_context *z, struct zis_profiler *prof,
+    const struct prof_frame *frame, char **func_names
+) {
+    char **const name_p = &func_names[frame->func_index];
+    if (!*name_p) {
+        char buffer[80];
+        struct zis_string_obj *const name = zis_context_guess_variable_name(
+            z, prof->funcs.objs[frame->func_index] // may trigger GC
+        );
+        size_t n = name ? zis_string_obj_to_u8str(name, buffer, sizeof buffer - 1) : (size_t)-1;
+        if (n == (size_t)-1)
+            n = (size_t)snprintf(buffer, sizeof buffer, "??@%u", (unsigned int)frame->func_index);
+        buffer[n] = 0;
+        for (char *p = buffer; *p; p++) {
+            if (*p == ';' || *p == ' ' || *p == '\n')
+                *p = '_';
+        }
+        *name_p = zis_mem_alloc(n + 1);
+        memcpy(*name_p, buffer, n + 1);
+    }
+    return *name_p;
+}
+
+static bool prof_write_folded(
+    struct zis_context *z, struct zis_profiler *prof, const zis_path_char_t *file
+) {
+    struct prof_output out;
+    out.file = zis_file_open(file, ZIS_FILE_MODE_WR);
+    if (!out.file)
+        return false;
+    out.capacity = 4096;
+    out.buffer = zis_mem_alloc(out.capacity);
+    out.length = 0;
+    out.failed = false;
+
+    const size_t func_count = prof->funcs.count;
+    char **const func_names = zis_mem_alloc(func_count * sizeof(char *) + 1);
+    memset(func_names, 0, func_count * sizeof(char *));
+
+    for (size_t i = 0; i < prof->stack_table_size; i++) {
+        const struct prof_stack *const s = &prof->stacks[i];
+        if (!s->depth)
+            continue;
+        for (size_t j = s->depth; j-- > 0; ) {
+            const struct prof_frame *const frame = &prof->frame_pool[s->frames_offset + j];
+            const char *const name = prof_func_name(z, prof, frame, func_names);
+            struct zis_func_obj *const func_obj =
+                zis_object_cast(prof->funcs.objs[frame->func_index], struct zis_func_obj);
+            const unsigned int line = zis_func_obj_line_number(z, func_obj, frame->ip_offset);
+            char buffer[24];
+            int n;
+            if (line)
+                n = snprintf(buffer, sizeof buffer, ":%u%s", line, j ? ";" : " ");
+            else
+                n = snprintf(buffer, sizeof buffer, "+%u%s", (unsigned int)frame->ip_offset, j ? ";" : " ");
+            prof_output_write(&out, name, strlen(name));
+            prof_output_write(&out, buffer, (size_t)n);
+        }
+        char buffer[24];
+        const int n = snprintf(buffer, sizeof buffer, "%zu\n", s->count);
+        prof_output_write(&out, buffer, (size_t)n);
+    }
+    prof_output_flush(&out);
+
+    for (size_t i = 0; i < func_count; i++)
+        zis_mem_free(func_names[i]);
+    zis_mem_free(func_names);
+    zis_mem_free(out.buffer);
+    zis_file_close(out.file);
+    return !out.failed;
+}
+
+/* ----- CPU profiler: public functions ------------------------------------- */
+
+bool zis_profiler_start(struct zis_context *z, unsigned int interval_us) {
+    if (prof_active_context)
+        return false;
+    assert(!z->profiler);
+    if (!interval_us)
+        interval_us = PROF_DEFAULT_INTERVAL_US;
+    zis_profiler_pending_ticks = 0;
+    if (!prof_timer_start(interval_us))
+        return false;
+    z->profiler = prof_create(z);
+    prof_active_context = z;
+    zis_debug_log(INFO, "Prof", "profiler started, interval=%uus", interval_us);
+    return true;
+}
+
+bool zis_profiler_stop(struct zis_context *z, const zis_path_char_t *file) {
+    struct zis_profiler *const prof = z->profiler;
+    if (!prof)
+        return false;
+    assert(prof_active_context == z);
+    prof_timer_stop();
+    prof_active_context = NULL;
+    zis_debug_log(
+        INFO, "Prof", "profiler stopped, %zu samples (%zu ticks), %zu stacks, %zu functions",
+        prof->sample_count, prof->tick_count, prof->stack_count, prof->funcs.count
+    );
+    bool ok = true;
+    if (file)
+        ok = prof_write_folded(z, prof, file);
+    z->profiler = NULL;
+    prof_destroy(prof, z);
+    return ok;
+}
+
+#else // !(ZIS_FEATURE_PROF && PROF_USE_SETITIMER)
+
+#if ZIS_FEATURE_PROF
+
+volatile sig_atomic_t zis_profiler_pending_ticks = 0;
+
+void zis_profiler_sample(struct zis_context *z, const void *ip) {
+    zis_unused_var(z), zis_unused_var(ip);
+    zis_profiler_pending_ticks = 0;
+}
+
+#endif // ZIS_FEATURE_PROF
+
+bool zis_profiler_start(struct zis_context *z, unsigned int interval_us) {
+    zis_unused_var(z), zis_unused_var(interval_us);
+    return false;
+}
+
+bool zis_profiler_stop(struct zis_context *z, const zis_path_char_t *file) {
+    zis_unused_var(z), zis_unused_var(file);
+    return false;
+}
+
+#endif // ZIS_FEATURE_PROF && PROF_USE_SETITIMER
+
+#if ZIS_FEATURE_PROF
+
+/* ----- allocation profiler ------------------------------------------------ */
+
+/// Allocation site in the allocation profiler.
+struct alloc_prof_site {
+    uint32_t type_index; ///< Index in `zis_alloc_profiler::types`.
+    uint32_t func_index; ///< Index in `zis_alloc_profiler::funcs`, or `(uint32_t)-1`.
+    uint32_t ip_offset;  ///< Instruction offset, or `(uint32_t)-1` if unknown.
+    size_t   count;      ///< Estimated number of objects. 0 means an empty table slot.
+    size_t   bytes;      ///< Estimated number of bytes.
+};
+
+/// Allocation profiler data.
+struct zis_alloc_profiler {
+    struct zis_prof_obj_table types, funcs; // GC root
+    struct alloc_prof_site *sites; // open-addressing hash table
+    size_t site_count, site_table_size; // power of 2
+    size_t interval;
+};
+
+static void alloc_prof_gc_visitor(void *_prof, enum zis_objmem_obj_visit_op op) {
+    struct zis_alloc_profiler *const prof = _prof;
+    zis_prof_obj_table_gc_visit(&prof->types, op);
+    zis_prof_obj_table_gc_visit(&prof->funcs, op);
+}
+
+static size_t alloc_prof_site_hash(uint32_t type_index, uint32_t func_index, uint32_t ip_offset) {
+    size_t h = (size_t)type_index * 0x9e3779b1U;
+    zis_hash_combine(&h, (size_t)func_index * 0x85ebca6bU);
+    zis_hash_combine(&h, (size_t)ip_offset);
+    return h;
+}
+
+static void alloc_prof_site_table_grow(struct zis_alloc_profiler *prof) {
+    const size_t old_size = prof->site_table_size;
+    struct alloc_prof_site *const old_sites = prof->sites;
+    const size_t new_size = old_size ? old_size * 2 : 256;
+    struct alloc_prof_site *const new_sites = zis_mem_alloc(new_size * sizeof new_sites[0]);
+    memset(new_sites, 0, new_size * sizeof new_sites[0]);
+    for (size_t i = 0; i < old_size; i++) {
+        const struct alloc_prof_site *const s = &old_sites[i];
+        if (!s->count)
+            continue;
+        size_t j = alloc_prof_site_hash(s->type_index, s->func_index, s->ip_offset) & (new_size - 1);
+        while (new_sites[j].count)
+            j = (j + 1) & (new_size - 1);
+        new_sites[j] = *s;
+    }
+    zis_mem_free(old_sites);
+    prof->sites = new_sites;
+    prof->site_table_size = new_size;
+}
+
+static struct alloc_prof_site *alloc_prof_site_get(
+    struct zis_alloc_profiler *prof,
+    uint32_t type_index, uint32_t func_index, uint32_t ip_offset
+) {
+    if ((prof->site_count + 1) * 4 > prof->site_table_size * 3)
+        alloc_prof_site_table_grow(prof);
+    const size_t mask = prof->site_table_size - 1;
+    size_t j = alloc_prof_site_hash(type_index, func_index, ip_offset) & mask;
+    struct alloc_prof_site *s;
+    for (; (s = &prof->sites[j])->count; j = (j + 1) & mask) {
+        if (s->type_index == type_index && s->func_index == func_index && s->ip_offset == ip_offset)
+            return s;
+    }
+    s->type_index = type_index;
+    s->func_index = func_index;
+    s->ip_offset = ip_offset;
+    s->bytes = 0;
+    prof->site_count++;
+    return s;
+}
+
+struct alloc_prof_walk_state {
+    struct zis_type_obj *type_Function;
+    const void *ip;
+    struct zis_object *func;
+    uint32_t ip_offset;
+};
+
+/// Find the innermost bytecode function.
+static int alloc_prof_walk_frame(struct zis_callstack_foreach_frame_fn_arg *x) {
+    struct alloc_prof_walk_state *const state = x->func_arg;
+    const struct zis_callstack_frame_info *const fi = x->frame_info;
+    const void *const ip = state->ip;
+    state->ip = fi->caller_ip;
+
+    struct zis_object *const func = fi->prev_frame[0];
+    if (!zis_object_type_is(func, state->type_Function))
+        return 0;
+    const struct zis_func_obj *const func_obj = zis_object_cast(func, struct zis_func_obj);
+    if (func_obj->native)
+        return 0;
+    state->func = func;
+    state->ip_offset = zis_prof_func_ip_offset(func_obj, ip);
+    return 1;
+}
+
+static void alloc_prof_sampler(
+    struct zis_context *z, struct zis_type_obj *obj_type, size_t obj_size, const void *site
+) {
+    struct zis_alloc_profiler *const prof = z->alloc_profiler;
+    assert(prof);
+
+    // An allocation made by a bytecode instruction has the instruction address
+    // as its site. Otherwise, the offset is known only if the allocation is made
+    // by a native function called from the bytecode function.
+    struct alloc_prof_walk_state state;
+    state.type_Function = z->globals->type_Function;
+    state.ip = site;
+    state.func = NULL;
+    state.ip_offset = (uint32_t)-1;
+    for (struct zis_callstack *cs = z->callstack; cs; cs = cs->resumer) {
+        if (zis_callstack_empty(cs))
+            continue;
+        if (zis_callstack_foreach_frame(cs, alloc_prof_walk_frame, &state))
+            break;
+        state.ip = NULL;
+    }
+
+    const uint32_t type_index = zis_prof_obj_table_index(&prof->types, zis_object_from(obj_type));
+    const uint32_t func_index =
+        state.func ? zis_prof_obj_table_index(&prof->funcs, state.func) : (uint32_t)-1;
+    struct alloc_prof_site *const s =
+        alloc_prof_site_get(prof, type_index, func_index, state.ip_offset);
+    // Each sample stands for `interval` bytes, or the object itself if it is larger.
+    const size_t weight_bytes = obj_size > prof->interval ? obj_size : prof->interval;
+    s->count += weight_bytes / obj_size;
+    s->bytes += weight_bytes;
+}
+
+static int alloc_prof_site_compare(const void *_a, const void *_b) {
+    const struct alloc_prof_site *const a = *(const struct alloc_prof_site *const *)_a;
+    const struct alloc_prof_site *const b = *(const struct alloc_prof_site *const *)_b;
+    return a->bytes < b->bytes ? 1 : a->bytes > b->bytes ? -1 : 0;
+}
+
+bool zis_alloc_profiler_start(struct zis_context *z, size_t interval) {
+    if (z->alloc_profiler)
+        return false;
+    if (!interval)
+        interval = PROF_DEFAULT_ALLOC_INTERVAL;
+    struct zis_alloc_profiler *const prof = zis_mem_alloc(sizeof(struct zis_alloc_profiler));
+    memset(prof, 0, sizeof *prof);
+    zis_prof_obj_table_init(&prof->types);
+    zis_prof_obj_table_init(&prof->funcs);
+    prof->interval = interval;
+    zis_objmem_add_gc_root(z, prof, alloc_prof_gc_visitor);
+    z->alloc_profiler = prof;
+    zis_objmem_set_alloc_sampler(z, alloc_prof_sampler, interval);
+    zis_debug_log(INFO, "Prof", "allocation profiler started, interval=%zuB", interval);
+    return true;
+}
+
+bool zis_alloc_profiler_stop(struct zis_context *z) {
+    struct zis_alloc_profiler *const prof = z->alloc_profiler;
+    if (!prof)
+        return false;
+    zis_objmem_set_alloc_sampler(z, NULL, 0);
+    zis_debug_log(
+        INFO, "Prof", "allocation profiler stopped, %zu sites, %zu types, %zu functions",
+        prof->site_count, prof->types.count, prof->funcs.count
+    );
+    z->alloc_profiler = NULL;
+    zis_objmem_remove_gc_root(z, prof);
+    zis_prof_obj_table_fini(&prof->types);
+    zis_prof_obj_table_fini(&prof->funcs);
+    zis_mem_free(prof->sites);
+    zis_mem_free(prof);
+    return true;
+}
+
+struct zis_array_obj *zis_alloc_profiler_report(struct zis_context *z) {
+    struct zis_alloc_profiler *const prof = z->alloc_profiler;
+    if (!prof)
+        return NULL;
+
+    // The objects allocated here are not sampled, and the sites do not change.
+    zis_objmem_set_alloc_sampler(z, NULL, 0);
+
+    const size_t n = prof->site_count;
+    const struct alloc_prof_site **const sites = zis_mem_alloc(n * sizeof(void *) + 1);
+    for (size_t i = 0, j = 0; i < prof->site_table_size; i++) {
+        if (prof->sites[i].count)
+            sites[j++] = &prof->sites[i];
+    }
+    qsort((void *)sites, n, sizeof(void *), alloc_prof_site_compare);
+
+    // tmp_regs = { result, type, func, offset, line, count, bytes }
+    struct zis_object **const tmp_regs = zis_callstack_frame_alloc_temp(z, 7);
+    tmp_regs[0] = zis_object_from(zis_array_obj_new2(z, n, NULL, 0));
+    for (size_t i = 0; i < n; i++) {
+        const struct alloc_prof_site *const s = sites[i];
+        struct zis_object *const nil = zis_object_from(z->globals->val_nil);
+        tmp_regs[1] = prof->types.objs[s->type_index];
+        tmp_regs[2] = nil, tmp_regs[3] = nil, tmp_regs[4] = nil;
+        if (s->func_index != (uint32_t)-1) {
+            tmp_regs[2] = prof->funcs.objs[s->func_index];
+            if (s->ip_offset != (uint32_t)-1) {
+                struct zis_func_obj *const func_obj =
+                    zis_object_cast(tmp_regs[2], struct zis_func_obj);
+                const unsigned int line = zis_func_obj_line_number(z, func_obj, s->ip_offset);
+                tmp_regs[3] = zis_smallint_to_ptr((zis_smallint_t)s->ip_offset);
+                if (line)
+                    tmp_regs[4] = zis_smallint_to_ptr((zis_smallint_t)line);
+            }
+        }
+        tmp_regs[5] = zis_int_obj_or_smallint(z, (int64_t)s->count);
+        tmp_regs[6] = zis_int_obj_or_smallint(z, (int64_t)s->bytes);
+        struct zis_tuple_obj *const tuple = zis_tuple_obj_new(z, tmp_regs + 1, 6);
+        assert(zis_object_type_is(tmp_regs[0], z->globals->type_Array));
+        zis_array_obj_append(
+            z, zis_object_cast(tmp_regs[0], struct zis_array_obj), zis_object_from(tuple)
+        );
+    }
+    struct zis_array_obj *const result = zis_object_cast(tmp_regs[0], struct zis_array_obj);
+    zis_callstack_frame_free_temp(z, 7);
+    zis_mem_free((void *)sites);
+
+    zis_objmem_set_alloc_sampler(z, alloc_prof_sampler, prof->interval);
+    return result;
+}
+
+#else // !ZIS_FEATURE_PROF
+
+bool zis_alloc_profiler_start(struct zis_context *z, size_t interval) {
+    zis_unused_var(z), zis_unused_var(interval);
+    return false;
+}
+
+bool zis_alloc_profiler_stop(struct zis_context *z) {
+    zis_unused_var(z);
+    return false;
+}
+
+struct zis_array_obj *zis_alloc_profiler_report(struct zis_context *z) {
+    zis_unused_var(z);
+    return NULL;
+}
+
+#endif // ZIS_FEATURE_PROF
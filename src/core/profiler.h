@@ -0,0 +1,94 @@
+/// Sampling profilers (the CPU profiler and the allocation profiler).
+
+#pragma once
+
+#include <signal.h> // sig_atomic_t
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "fsutil.h" // zis_path_char_t
+#include "objmem.h" // enum zis_objmem_obj_visit_op
+
+#include "zis_config.h" // ZIS_FEATURE_PROF, ZIS_FEATURE_OPSTAT
+
+struct zis_array_obj;
+struct zis_context;
+struct zis_func_obj;
+struct zis_object;
+struct zis_profiler;
+
+#if ZIS_FEATURE_PROF || ZIS_FEATURE_OPSTAT
+
+/// A list of objects (functions or types) that samples refer to by indices,
+/// with a hash table to find the index of an object. The objects must be
+/// visited by the GC root visitor of the owner with `zis_prof_obj_table_gc_visit()`.
+struct zis_prof_obj_table {
+    struct zis_object **objs;
+    size_t count, capacity;
+    /// Hash table from object pointers to indices plus 1. Rebuilt after the
+    /// objects are moved by the GC.
+    uint32_t *table;
+    size_t table_size; // power of 2
+    bool table_dirty;
+};
+
+/// Initialize an empty table.
+void zis_prof_obj_table_init(struct zis_prof_obj_table *t);
+
+/// Free the table.
+void zis_prof_obj_table_fini(struct zis_prof_obj_table *t);
+
+/// Visit the objects in the table. To be called by the GC root visitor of the owner.
+void zis_prof_obj_table_gc_visit(struct zis_prof_obj_table *t, enum zis_objmem_obj_visit_op op);
+
+/// Get the index of an object, adding it if missing.
+uint32_t zis_prof_obj_table_index(struct zis_prof_obj_table *t, struct zis_object *obj);
+
+/// Get the instruction offset of `ip` in a function, or `(uint32_t)-1`
+/// if `ip` is not in the function.
+uint32_t zis_prof_func_ip_offset(const struct zis_func_obj *func_obj, const void *ip);
+
+#endif // ZIS_FEATURE_PROF || ZIS_FEATURE_OPSTAT
+
+#if ZIS_FEATURE_PROF
+
+/// Number of timer ticks since the last sample. Increased by the signal handler.
+/// The interpreter checks it at calls and jumps and calls `zis_profiler_sample()`
+/// if it is not zero, so that the call stack is only walked at safe points.
+extern volatile sig_atomic_t zis_profiler_pending_ticks;
+
+/// Record the current call stack, weighted by the pending ticks.
+/// `ip` is the instruction pointer of the running bytecode function, or NULL.
+void zis_profiler_sample(struct zis_context *z, const void *ip);
+
+#endif // ZIS_FEATURE_PROF
+
+/// Start profiling context `z`, taking a sample every `interval_us` microseconds
+/// of CPU time (0 for the default interval). Only one context in a process can be
+/// profiled at a time. Returns false if the profiler is not available or is busy.
+bool zis_profiler_start(struct zis_context *z, unsigned int interval_us);
+
+/// Stop profiling context `z`, and write the collected stacks to `file` in the
+/// folded-stack format (one "FRAME;FRAME;...;FRAME COUNT" line per stack, root
+/// frame first). `file` can be NULL to drop the samples. Returns false if the
+/// profiler is not running on `z` or the file cannot be written.
+bool zis_profiler_stop(struct zis_context *z, const zis_path_char_t *file);
+
+/// Start sampling object allocations in context `z`, once every `interval` bytes
+/// of allocated object memory (0 for the default interval). Returns false if
+/// the allocation profiler is not available or is running.
+bool zis_alloc_profiler_start(struct zis_context *z, size_t interval);
+
+/// Stop sampling object allocations and drop the samples.
+/// Returns false if the allocation profiler is not running.
+bool zis_alloc_profiler_stop(struct zis_context *z);
+
+/// Make a report of the sampled allocations without stopping the profiler:
+/// an `Array` of `(type, func, offset, line, count, bytes)` tuples, one for each
+/// allocation site, in descending order of `bytes`. `func` is the innermost
+/// bytecode function on the call stack, or nil; `offset` and `line` are the
+/// instruction offset and line number in `func`, or nil if unknown; `count`
+/// and `bytes` are estimated from the samples.
+/// Returns NULL if the allocation profiler is not running.
+struct zis_array_obj *zis_alloc_profiler_report(struct zis_context *z);
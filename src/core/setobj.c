@@ -0,0 +1,695 @@
+#include "setobj.h"
+
+#include <string.h>
+
+#include "context.h"
+#include "globals.h"
+#include "locals.h"
+#include "ndefutil.h"
+#include "objmem.h"
+#include "objvec.h"
+#include "smallint.h"
+#include "stack.h"
+
+#include "arrayobj.h"
+#include "bytesobj.h"
+#include "exceptobj.h"
+#include "stringobj.h"
+
+/* ----- keys --------------------------------------------------------------- */
+
+// Values in the `_hashes` table. Hash codes of elements have the highest bit set.
+#define SET_SLOT_EMPTY    ((size_t)0)
+#define SET_SLOT_DELETED  ((size_t)1)
+#define SET_SLOT_HASH_BIT ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+/// Keys that can be hashed and compared without calling methods.
+enum set_key_kind {
+    SET_KEY_OTHER,
+    SET_KEY_SMALLINT,
+    SET_KEY_SYMBOL,
+    SET_KEY_STRING,
+};
+
+zis_static_force_inline enum set_key_kind
+set_key_kind(struct zis_context_globals *g, struct zis_object *key) {
+    if (zis_object_is_smallint(key))
+        return SET_KEY_SMALLINT;
+    struct zis_type_obj *const type = zis_object_type(key);
+    if (type == g->type_String)
+        return SET_KEY_STRING;
+    if (type == g->type_Symbol)
+        return SET_KEY_SYMBOL;
+    return SET_KEY_OTHER;
+}
+
+/// Compute the hash code of a key to be stored in `_hashes`.
+/// On failure, returns false (throw REG-0).
+static bool set_key_hash(size_t *restrict hash_code, struct zis_context *z, struct zis_object *key) {
+    size_t h;
+    if (zis_object_is_smallint(key)) {
+        h = zis_smallint_hash(zis_smallint_from_ptr(key));
+    } else if (zis_object_type(key) == z->globals->type_String) {
+        h = zis_string_obj_hash(zis_object_cast(key, struct zis_string_obj));
+    } else if (zis_unlikely(!zis_object_hash(&h, z, key))) {
+        return false;
+    }
+    // Small integers hash to themselves. Mix the bits, so that the table index
+    // (the low bits) does not depend on the low bits of the integer only.
+    h *= (size_t)UINT64_C(0x9e3779b97f4a7c15);
+    h ^= h >> (sizeof(size_t) * 4);
+    *hash_code = h | SET_SLOT_HASH_BIT;
+    return true;
+}
+
+/// Compare two keys that have the same hash code.
+static bool set_key_equals(struct zis_context *z, struct zis_object *a, struct zis_object *b) {
+    if (a == b)
+        return true;
+    struct zis_context_globals *const g = z->globals;
+    const enum set_key_kind a_kind = set_key_kind(g, a), b_kind = set_key_kind(g, b);
+    if (a_kind != SET_KEY_OTHER && b_kind != SET_KEY_OTHER) {
+        if (a_kind != SET_KEY_STRING || b_kind != SET_KEY_STRING)
+            return false;
+        return zis_string_obj_equals(
+            zis_object_cast(a, struct zis_string_obj),
+            zis_object_cast(b, struct zis_string_obj)
+        );
+    }
+    return zis_object_equals(z, a, b);
+}
+
+/* ----- table -------------------------------------------------------------- */
+
+zis_static_force_inline size_t set_obj_capacity(const struct zis_set_obj *self) {
+    return zis_array_slots_obj_length(self->_keys);
+}
+
+zis_static_force_inline size_t *set_obj_hashes(const struct zis_set_obj *self) {
+    size_t *const hashes = (size_t *)(void *)self->_hashes->_data;
+    assert((uintptr_t)hashes % sizeof(size_t) == 0);
+    assert(zis_bytes_obj_size(self->_hashes) == set_obj_capacity(self) * sizeof(size_t));
+    return hashes;
+}
+
+/// Max number of non-empty slots in a table of `cap` slots.
+zis_static_force_inline size_t set_obj_max_used(size_t cap) {
+    return cap / 4 * 3;
+}
+
+/// Get the table size for `n` elements.
+static size_t set_obj_capacity_for(size_t n) {
+    size_t cap = 8;
+    while (n > set_obj_max_used(cap))
+        cap *= 2;
+    return cap;
+}
+
+/// Find the slot holding `*key_ref`, whose hash code is `hash`.
+/// Returns the slot index, or -1 if not found. `self_ref` and `key_ref` must be
+/// GC-visible, for comparing the keys may call methods.
+static size_t set_obj_find(
+    struct zis_context *z,
+    struct zis_set_obj *const *self_ref, struct zis_object *const *key_ref, size_t hash
+) {
+    size_t cap;
+restart:
+    cap = set_obj_capacity(*self_ref);
+    if (!cap)
+        return (size_t)-1;
+    for (size_t i = hash & (cap - 1); ; i = (i + 1) & (cap - 1)) {
+        struct zis_set_obj *const self = *self_ref;
+        const size_t h = set_obj_hashes(self)[i];
+        if (h == hash) {
+            struct zis_object *const k = zis_array_slots_obj_get(self->_keys, i);
+            if (set_key_equals(z, k, *key_ref))
+                return i;
+            if (zis_unlikely(set_obj_capacity(*self_ref) != cap))
+                goto restart; // Modified by an `==` method.
+        } else if (h == SET_SLOT_EMPTY) {
+            return (size_t)-1;
+        }
+    }
+}
+
+/// Put a key that is not in the table, assuming the table is large enough.
+static void set_obj_put(struct zis_set_obj *self, struct zis_object *key, size_t hash) {
+    const size_t cap = set_obj_capacity(self);
+    size_t *const hashes = set_obj_hashes(self);
+    assert(self->_used < set_obj_max_used(cap));
+    size_t i = hash & (cap - 1);
+    while (hashes[i] > SET_SLOT_DELETED)
+        i = (i + 1) & (cap - 1);
+    if (hashes[i] == SET_SLOT_EMPTY)
+        self->_used++;
+    hashes[i] = hash;
+    zis_array_slots_obj_set(self->_keys, i, key);
+    self->count++;
+}
+
+/// Rebuild the table with `new_cap` slots, dropping deleted ones.
+/// The stored hash codes are reused. Returns `self`, which may have been moved.
+static struct zis_set_obj *set_obj_rehash(
+    struct zis_context *z, struct zis_set_obj *self, size_t new_cap
+) {
+    assert(new_cap >= 8 && !(new_cap & (new_cap - 1)));
+    assert(self->count <= set_obj_max_used(new_cap));
+
+    zis_locals_decl(
+        z, var,
+        struct zis_set_obj *self;
+        struct zis_array_slots_obj *new_keys;
+    );
+    var.self = self;
+    var.new_keys = (struct zis_array_slots_obj *)zis_smallint_to_ptr(0);
+    var.new_keys = zis_array_slots_obj_new(z, NULL, new_cap);
+    struct zis_bytes_obj *const new_hashes = zis_bytes_obj_new(z, NULL, new_cap * sizeof(size_t));
+    struct zis_array_slots_obj *const new_keys = var.new_keys;
+    self = var.self;
+    zis_locals_drop(z, var);
+
+    size_t *const new_hash_vec = (size_t *)(void *)new_hashes->_data;
+    memset(new_hash_vec, 0, new_cap * sizeof(size_t));
+    const size_t old_cap = set_obj_capacity(self);
+    const size_t *const old_hash_vec = set_obj_hashes(self);
+    for (size_t i = 0; i < old_cap; i++) {
+        const size_t h = old_hash_vec[i];
+        if (h <= SET_SLOT_DELETED)
+            continue;
+        size_t j = h & (new_cap - 1);
+        while (new_hash_vec[j] != SET_SLOT_EMPTY)
+            j = (j + 1) & (new_cap - 1);
+        new_hash_vec[j] = h;
+        zis_array_slots_obj_set(new_keys, j, zis_array_slots_obj_get(self->_keys, i));
+    }
+
+    self->_keys = new_keys;
+    zis_object_write_barrier(self, new_keys);
+    self->_hashes = new_hashes;
+    zis_object_write_barrier(self, new_hashes);
+    self->_used = self->count;
+    return self;
+}
+
+/// Insert a key that is not in the set, enlarging the table if needed.
+/// `self_ref` and `key_ref` must be GC-visible.
+static void set_obj_insert_new(
+    struct zis_context *z,
+    struct zis_set_obj *const *self_ref, struct zis_object *const *key_ref, size_t hash
+) {
+    struct zis_set_obj *self = *self_ref;
+    if (zis_unlikely(self->_used >= set_obj_max_used(set_obj_capacity(self))))
+        self = set_obj_rehash(z, self, set_obj_capacity_for(self->count + 1));
+    set_obj_put(self, *key_ref, hash);
+}
+
+/* ----- set object --------------------------------------------------------- */
+
+struct zis_set_obj *zis_set_obj_new(struct zis_context *z, size_t reserve) {
+    struct zis_set_obj *self = zis_object_cast(
+        zis_objmem_alloc(z, z->globals->type_Set),
+        struct zis_set_obj
+    );
+    self->_keys = z->globals->val_empty_array_slots;
+    self->_hashes = z->globals->val_empty_bytes;
+    zis_object_assert_no_write_barrier_2(self, zis_object_from(self->_keys));
+    zis_object_assert_no_write_barrier_2(self, zis_object_from(self->_hashes));
+    self->count = 0;
+    self->_used = 0;
+    if (reserve)
+        self = set_obj_rehash(z, self, set_obj_capacity_for(reserve));
+    return self;
+}
+
+void zis_set_obj_reserve(struct zis_context *z, struct zis_set_obj *self, size_t n) {
+    if (n > set_obj_max_used(set_obj_capacity(self)))
+        set_obj_rehash(z, self, set_obj_capacity_for(n));
+}
+
+void zis_set_obj_clear(struct zis_set_obj *self) {
+    const size_t cap = set_obj_capacity(self);
+    if (!cap)
+        return;
+    zis_object_vec_zero(self->_keys->_data, cap);
+    memset(set_obj_hashes(self), 0, cap * sizeof(size_t));
+    self->count = 0;
+    self->_used = 0;
+}
+
+int zis_set_obj_rehash_keys(struct zis_context *z, struct zis_set_obj *_self) {
+    zis_locals_decl_1(z, var, struct zis_set_obj *self);
+    var.self = _self;
+
+    int status = ZIS_OK;
+    for (size_t i = 0; i < set_obj_capacity(var.self); i++) {
+        if (set_obj_hashes(var.self)[i] <= SET_SLOT_DELETED)
+            continue;
+        size_t hash;
+        if (zis_unlikely(!set_key_hash(&hash, z, zis_array_slots_obj_get(var.self->_keys, i)))) {
+            status = ZIS_THR;
+            break;
+        }
+        set_obj_hashes(var.self)[i] = hash;
+    }
+
+    const size_t cap = set_obj_capacity(var.self);
+    if (cap)
+        set_obj_rehash(z, var.self, cap);
+
+    zis_locals_drop(z, var);
+    return status;
+}
+
+int zis_set_obj_contains(
+    struct zis_context *z,
+    struct zis_set_obj *_self, struct zis_object *_key
+) {
+    zis_locals_decl(z, var, struct zis_set_obj *self; struct zis_object *key;);
+    var.self = _self, var.key = _key;
+
+    int status;
+    size_t hash;
+    if (zis_unlikely(!set_key_hash(&hash, z, var.key)))
+        status = ZIS_THR;
+    else if (set_obj_find(z, &var.self, &var.key, hash) != (size_t)-1)
+        status = ZIS_OK;
+    else
+        status = ZIS_E_ARG;
+
+    zis_locals_drop(z, var);
+    return status;
+}
+
+int zis_set_obj_add(
+    struct zis_context *z,
+    struct zis_set_obj *_self, struct zis_object *_key
+) {
+    zis_locals_decl(z, var, struct zis_set_obj *self; struct zis_object *key;);
+    var.self = _self, var.key = _key;
+
+    size_t hash;
+    if (zis_unlikely(!set_key_hash(&hash, z, var.key))) {
+        zis_locals_drop(z, var);
+        return ZIS_THR;
+    }
+    if (set_obj_find(z, &var.self, &var.key, hash) == (size_t)-1)
+        set_obj_insert_new(z, &var.self, &var.key, hash);
+
+    zis_locals_drop(z, var);
+    return ZIS_OK;
+}
+
+int zis_set_obj_remove(
+    struct zis_context *z,
+    struct zis_set_obj *_self, struct zis_object *_key
+) {
+    zis_locals_decl(z, var, struct zis_set_obj *self; struct zis_object *key;);
+    var.self = _self, var.key = _key;
+
+    size_t hash;
+    if (zis_unlikely(!set_key_hash(&hash, z, var.key))) {
+        zis_locals_drop(z, var);
+        return ZIS_THR;
+    }
+    const size_t i = set_obj_find(z, &var.self, &var.key, hash);
+    struct zis_set_obj *const self = var.self;
+    zis_locals_drop(z, var);
+    if (i == (size_t)-1)
+        return ZIS_E_ARG;
+
+    const size_t cap = set_obj_capacity(self);
+    size_t *const hashes = set_obj_hashes(self);
+    // A probe sequence never passes an empty slot, so the slot can be
+    // emptied instead of marked deleted if the next one is empty.
+    if (hashes[(i + 1) & (cap - 1)] == SET_SLOT_EMPTY) {
+        hashes[i] = SET_SLOT_EMPTY;
+        self->_used--;
+    } else {
+        hashes[i] = SET_SLOT_DELETED;
+    }
+    self->_keys->_data[i] = (void *)(uintptr_t)-1;
+    assert(zis_object_is_smallint(self->_keys->_data[i]));
+    self->count--;
+    return ZIS_OK;
+}
+
+struct zis_object *zis_set_obj_slot(const struct zis_set_obj *self, size_t i) {
+    if (i >= set_obj_capacity(self) || set_obj_hashes(self)[i] <= SET_SLOT_DELETED)
+        return NULL;
+    return zis_array_slots_obj_get(self->_keys, i);
+}
+
+struct zis_set_obj *zis_set_obj_union(
+    struct zis_context *z, struct zis_set_obj *operands[2]
+) {
+    zis_locals_decl(
+        z, var,
+        struct zis_set_obj *result;
+        struct zis_object *key;
+    );
+    zis_locals_zero(var);
+    var.result = zis_set_obj_new(z, operands[0]->count + operands[1]->count);
+
+    {
+        // The elements of the first set are distinct. No need to compare them.
+        struct zis_set_obj *const a = operands[0], *const result = var.result;
+        const size_t *const a_hashes = set_obj_hashes(a);
+        for (size_t i = 0, n = set_obj_capacity(a); i < n; i++) {
+            if (a_hashes[i] > SET_SLOT_DELETED)
+                set_obj_put(result, zis_array_slots_obj_get(a->_keys, i), a_hashes[i]);
+        }
+    }
+    for (size_t i = 0; ; i++) {
+        struct zis_set_obj *const b = operands[1];
+        if (i >= set_obj_capacity(b))
+            break;
+        const size_t h = set_obj_hashes(b)[i];
+        if (h <= SET_SLOT_DELETED)
+            continue;
+        var.key = zis_array_slots_obj_get(b->_keys, i);
+        if (set_obj_find(z, &var.result, &var.key, h) == (size_t)-1)
+            set_obj_insert_new(z, &var.result, &var.key, h);
+    }
+
+    zis_locals_drop(z, var);
+    return var.result;
+}
+
+struct zis_set_obj *zis_set_obj_intersection(
+    struct zis_context *z, struct zis_set_obj *operands[2]
+) {
+    // Iterate over the smaller set and look up in the larger one.
+    const bool swap = operands[0]->count > operands[1]->count;
+    struct zis_set_obj **const small_ref = &operands[swap ? 1 : 0];
+    struct zis_set_obj **const large_ref = &operands[swap ? 0 : 1];
+
+    zis_locals_decl(
+        z, var,
+        struct zis_set_obj *result;
+        struct zis_object *key;
+    );
+    zis_locals_zero(var);
+    var.result = zis_set_obj_new(z, (*small_ref)->count);
+
+    for (size_t i = 0; ; i++) {
+        struct zis_set_obj *const s = *small_ref;
+        if (i >= set_obj_capacity(s))
+            break;
+        const size_t h = set_obj_hashes(s)[i];
+        if (h <= SET_SLOT_DELETED)
+            continue;
+        var.key = zis_array_slots_obj_get(s->_keys, i);
+        if (set_obj_find(z, large_ref, &var.key, h) != (size_t)-1)
+            set_obj_insert_new(z, &var.result, &var.key, h);
+    }
+
+    zis_locals_drop(z, var);
+    return var.result;
+}
+
+struct zis_set_obj *zis_set_obj_difference(
+    struct zis_context *z, struct zis_set_obj *operands[2]
+) {
+    zis_locals_decl(
+        z, var,
+        struct zis_set_obj *result;
+        struct zis_object *key;
+    );
+    zis_locals_zero(var);
+    var.result = zis_set_obj_new(z, operands[0]->count);
+
+    for (size_t i = 0; ; i++) {
+        struct zis_set_obj *const a = operands[0];
+        if (i >= set_obj_capacity(a))
+            break;
+        const size_t h = set_obj_hashes(a)[i];
+        if (h <= SET_SLOT_DELETED)
+            continue;
+        var.key = zis_array_slots_obj_get(a->_keys, i);
+        if (set_obj_find(z, &operands[1], &var.key, h) == (size_t)-1)
+            set_obj_insert_new(z, &var.result, &var.key, h);
+    }
+
+    zis_locals_drop(z, var);
+    return var.result;
+}
+
+#define assert_arg1_Set(__z) \
+    (assert(zis_object_type_is((__z)->callstack->frame[1], (__z)->globals->type_Set)))
+
+/// Check that `frame[2]` is a `Set` for binary operator `op`. Otherwise, throws.
+static bool set_check_operand(struct zis_context *z, const char *op) {
+    struct zis_object **frame = z->callstack->frame;
+    if (zis_likely(zis_object_type_is(frame[2], z->globals->type_Set)))
+        return true;
+    frame[0] = zis_object_from(zis_exception_obj_format_common(
+        z, ZIS_EXC_FMT_UNSUPPORTED_OPERATION_BIN,
+        op, frame[1], frame[2]
+    ));
+    return false;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_operator_or, z, {2, 0, 2}) {
+    /*#DOCSTR# func Set:\'|'(other :: Set) :: Set
+    Union of two sets. */
+    assert_arg1_Set(z);
+    if (zis_unlikely(!set_check_operand(z, "|")))
+        return ZIS_THR;
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_set_obj *result = zis_set_obj_union(z, (struct zis_set_obj **)(frame + 1));
+    frame[0] = zis_object_from(result);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_operator_and, z, {2, 0, 2}) {
+    /*#DOCSTR# func Set:\'&'(other :: Set) :: Set
+    Intersection of two sets. */
+    assert_arg1_Set(z);
+    if (zis_unlikely(!set_check_operand(z, "&")))
+        return ZIS_THR;
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_set_obj *result = zis_set_obj_intersection(z, (struct zis_set_obj **)(frame + 1));
+    frame[0] = zis_object_from(result);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_operator_sub, z, {2, 0, 2}) {
+    /*#DOCSTR# func Set:\'-'(other :: Set) :: Set
+    Difference of two sets, the elements in this set but not in `other`. */
+    assert_arg1_Set(z);
+    if (zis_unlikely(!set_check_operand(z, "-")))
+        return ZIS_THR;
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_set_obj *result = zis_set_obj_difference(z, (struct zis_set_obj **)(frame + 1));
+    frame[0] = zis_object_from(result);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_operator_equ, z, {2, 0, 3}) {
+    /*#DOCSTR# func Set:\'=='(other :: Set) :: Bool
+    Operator ==. */
+    assert_arg1_Set(z);
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+
+    bool equals;
+    if (zis_unlikely(!zis_object_type_is(frame[2], g->type_Set))) {
+        equals = false;
+    } else if (
+        zis_set_obj_length(zis_object_cast(frame[1], struct zis_set_obj)) !=
+        zis_set_obj_length(zis_object_cast(frame[2], struct zis_set_obj))
+    ) {
+        equals = false;
+    } else {
+        equals = true;
+        for (size_t i = 0; ; i++) {
+            struct zis_set_obj *const self = zis_object_cast(frame[1], struct zis_set_obj);
+            if (i >= set_obj_capacity(self))
+                break;
+            const size_t h = set_obj_hashes(self)[i];
+            if (h <= SET_SLOT_DELETED)
+                continue;
+            frame[3] = zis_array_slots_obj_get(self->_keys, i);
+            if (set_obj_find(z, (struct zis_set_obj **)(frame + 2), frame + 3, h) == (size_t)-1) {
+                equals = false;
+                break;
+            }
+        }
+    }
+
+    frame[0] = zis_object_from(equals ? g->val_true : g->val_false);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_length, z, {1, 0, 1}) {
+    /*#DOCSTR# func Set:length() :: Int
+    Returns the number of elements. */
+    assert_arg1_Set(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_set_obj *self = zis_object_cast(frame[1], struct zis_set_obj);
+    const size_t len = zis_set_obj_length(self);
+    assert(len <= ZIS_SMALLINT_MAX);
+    frame[0] = zis_smallint_to_ptr((zis_smallint_t)(zis_smallint_unsigned_t)len);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_to_string, z, {1, 1, 4}) {
+    /*#DOCSTR# func Set:to_string(?fmt) :: String
+    Returns a string representation. */
+    assert_arg1_Set(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    struct zis_string_builder_obj **str_builder_p = (struct zis_string_builder_obj **)(frame + 3);
+    struct zis_string_obj **comma_str_p = (struct zis_string_obj **)(frame + 4);
+    *str_builder_p = zis_string_builder_obj_new(z);
+    *comma_str_p = zis_string_obj_new(z, "Set{", 4);
+    zis_string_builder_obj_append(z, *str_builder_p, *comma_str_p);
+    *comma_str_p = zis_string_obj_new(z, ", ", 2);
+
+    bool is_first = true;
+    for (size_t i = 0; ; i++) {
+        struct zis_set_obj *const self = zis_object_cast(frame[1], struct zis_set_obj);
+        if (i >= set_obj_capacity(self))
+            break;
+        struct zis_object *const elem = zis_set_obj_slot(self, i);
+        if (!elem)
+            continue;
+        if (is_first)
+            is_first = false;
+        else
+            zis_string_builder_obj_append(z, *str_builder_p, *comma_str_p);
+        struct zis_string_obj *elem_str = zis_object_to_string(z, elem, true, NULL);
+        zis_string_builder_obj_append(z, *str_builder_p, elem_str);
+    }
+    zis_string_builder_obj_append_char(z, *str_builder_p, '}');
+
+    frame[0] = zis_object_from(zis_string_builder_obj_string(z, *str_builder_p));
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_to_array, z, {1, 0, 1}) {
+    /*#DOCSTR# func Set:to_array() :: Array
+    Returns an array of the elements, in no particular order. */
+    assert_arg1_Set(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    const size_t n = zis_set_obj_length(zis_object_cast(frame[1], struct zis_set_obj));
+    struct zis_array_obj *const array = zis_array_obj_new(z, NULL, n);
+    struct zis_set_obj *const self = zis_object_cast(frame[1], struct zis_set_obj);
+    size_t j = 0;
+    for (size_t i = 0, cap = set_obj_capacity(self); i < cap; i++) {
+        struct zis_object *const elem = zis_set_obj_slot(self, i);
+        if (elem)
+            zis_array_obj_set(array, j++, elem);
+    }
+    assert(j == n);
+    frame[0] = zis_object_from(array);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_contains, z, {2, 0, 2}) {
+    /*#DOCSTR# func Set:contains(value :: Any) :: Bool
+    Checks whether the given value is in the set. */
+    assert_arg1_Set(z);
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_set_obj *self = zis_object_cast(frame[1], struct zis_set_obj);
+    const int status = zis_set_obj_contains(z, self, frame[2]);
+    if (status == ZIS_THR)
+        return ZIS_THR;
+    frame[0] = zis_object_from(status == ZIS_OK ? g->val_true : g->val_false);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_add, z, {2, 0, 2}) {
+    /*#DOCSTR# func Set:add(value :: Any)
+    Adds an element. */
+    assert_arg1_Set(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_set_obj *self = zis_object_cast(frame[1], struct zis_set_obj);
+    if (zis_unlikely(zis_set_obj_add(z, self, frame[2]) == ZIS_THR))
+        return ZIS_THR;
+    frame[0] = zis_object_from(z->globals->val_nil);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_remove, z, {2, 0, 2}) {
+    /*#DOCSTR# func Set:remove(value :: Any) :: Bool
+    Deletes an element and returns whether succeeded. */
+    assert_arg1_Set(z);
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_set_obj *self = zis_object_cast(frame[1], struct zis_set_obj);
+    const int status = zis_set_obj_remove(z, self, frame[2]);
+    if (status == ZIS_THR)
+        return ZIS_THR;
+    frame[0] = zis_object_from(status == ZIS_OK ? g->val_true : g->val_false);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_M_clear, z, {1, 0, 1}) {
+    /*#DOCSTR# func Set:clear()
+    Deletes all elements. */
+    assert_arg1_Set(z);
+    struct zis_object **frame = z->callstack->frame;
+    zis_set_obj_clear(zis_object_cast(frame[1], struct zis_set_obj));
+    frame[0] = zis_object_from(z->globals->val_nil);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Set_F_new, z, {0, 1, 2}) {
+    /*#DOCSTR# func Set.new(?values :: Array) :: Set
+    Creates a set, empty or holding the given values. */
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+
+    size_t n = 0;
+    if (frame[1] != zis_object_from(g->val_nil)) {
+        if (zis_unlikely(!zis_object_type_is(frame[1], g->type_Array))) {
+            frame[0] = zis_object_from(zis_exception_obj_format_common(
+                z, ZIS_EXC_FMT_WRONG_ARGUMENT_TYPE, "values", frame[1]
+            ));
+            return ZIS_THR;
+        }
+        n = zis_array_obj_length(zis_object_cast(frame[1], struct zis_array_obj));
+    }
+
+    frame[2] = zis_object_from(zis_set_obj_new(z, n));
+    for (size_t i = 0; i < n; i++) {
+        struct zis_array_obj *const values = zis_object_cast(frame[1], struct zis_array_obj);
+        struct zis_object *const v = zis_array_obj_get_checked(values, i);
+        if (!v)
+            break;
+        struct zis_set_obj *const self = zis_object_cast(frame[2], struct zis_set_obj);
+        if (zis_unlikely(zis_set_obj_add(z, self, v) == ZIS_THR))
+            return ZIS_THR;
+    }
+    frame[0] = frame[2];
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF_LIST(
+    T_Set_D_methods,
+    { "|"           , &T_Set_M_operator_or       },
+    { "&"           , &T_Set_M_operator_and      },
+    { "-"           , &T_Set_M_operator_sub      },
+    { "=="          , &T_Set_M_operator_equ      },
+    { "length"      , &T_Set_M_length            },
+    { "to_string"   , &T_Set_M_to_string         },
+    { "to_array"    , &T_Set_M_to_array          },
+    { "contains"    , &T_Set_M_contains          },
+    { "add"         , &T_Set_M_add               },
+    { "remove"      , &T_Set_M_remove            },
+    { "clear"       , &T_Set_M_clear             },
+);
+
+ZIS_NATIVE_VAR_DEF_LIST(
+    T_Set_D_statics,
+    { "new"         , { '^', .F = &T_Set_F_new } },
+);
+
+ZIS_NATIVE_TYPE_DEF(
+    Set,
+    struct zis_set_obj, count,
+    NULL, T_Set_D_methods, T_Set_D_statics
+);
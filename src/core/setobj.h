@@ -0,0 +1,83 @@
+/// The `Set` type.
+
+#pragma once
+
+#include "attributes.h"
+#include "object.h"
+
+struct zis_array_slots_obj;
+struct zis_bytes_obj;
+struct zis_context;
+
+/// `Set` object. Hash set with open addressing (linear probing).
+struct zis_set_obj {
+    ZIS_OBJECT_HEAD
+    // --- SLOTS ---
+    struct zis_array_slots_obj *_keys; ///< The table. Its length is 0 or a power of 2.
+    struct zis_bytes_obj *_hashes; ///< Hash codes of the slots in `_keys`, an array of `size_t`.
+    // --- BYTES ---
+    size_t count; ///< Number of elements.
+    size_t _used; ///< Number of non-empty slots, including deleted ones.
+};
+
+/// Create an empty `Set` with room for `reserve` elements.
+struct zis_set_obj *zis_set_obj_new(struct zis_context *z, size_t reserve);
+
+/// Get number of elements.
+zis_static_force_inline size_t zis_set_obj_length(const struct zis_set_obj *self) {
+    return self->count;
+}
+
+/// Make room for `n` elements in total.
+void zis_set_obj_reserve(struct zis_context *z, struct zis_set_obj *self, size_t n);
+
+/// Delete all elements.
+void zis_set_obj_clear(struct zis_set_obj *self);
+
+/// Recompute the hash codes of the elements and rebuild the table. Needed when the hash
+/// codes may have changed, like those made from addresses after a heap snapshot is restored.
+/// Returns `ZIS_OK` or `ZIS_THR` (throw REG-0). On failure, the remaining elements keep
+/// their old hash codes.
+int zis_set_obj_rehash_keys(struct zis_context *z, struct zis_set_obj *self);
+
+/// Check whether an element is in the set.
+/// Returns `ZIS_OK`, `ZIS_THR` (throw REG-0), or `ZIS_E_ARG` (not found).
+int zis_set_obj_contains(
+    struct zis_context *z,
+    struct zis_set_obj *self, struct zis_object *key
+);
+
+/// Add an element to the set.
+/// Returns `ZIS_OK` or `ZIS_THR` (throw REG-0).
+int zis_set_obj_add(
+    struct zis_context *z,
+    struct zis_set_obj *self, struct zis_object *key
+);
+
+/// Delete an element in the set.
+/// Returns `ZIS_OK`, `ZIS_THR` (throw REG-0), or `ZIS_E_ARG` (not found).
+int zis_set_obj_remove(
+    struct zis_context *z,
+    struct zis_set_obj *self, struct zis_object *key
+);
+
+/// Get the i-th slot of the table. Returns NULL if the slot is empty or `i` is out of range.
+struct zis_object *zis_set_obj_slot(const struct zis_set_obj *self, size_t i);
+
+/// Create a set of elements in either `operands[0]` or `operands[1]`.
+/// `operands` must be GC-visible (a frame or locals).
+struct zis_set_obj *zis_set_obj_union(
+    struct zis_context *z, struct zis_set_obj *operands[2]
+);
+
+/// Create a set of elements in both `operands[0]` and `operands[1]`.
+/// `operands` must be GC-visible (a frame or locals).
+struct zis_set_obj *zis_set_obj_intersection(
+    struct zis_context *z, struct zis_set_obj *operands[2]
+);
+
+/// Create a set of elements in `operands[0]` but not in `operands[1]`.
+/// `operands` must be GC-visible (a frame or locals).
+struct zis_set_obj *zis_set_obj_difference(
+    struct zis_context *z, struct zis_set_obj *operands[2]
+);
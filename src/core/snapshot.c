@@ -0,0 +1,949 @@
+#include "snapshot.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "algorithm.h"
+#include "bits.h"
+#include "context.h"
+#include "debug.h"
+#include "globals.h"
+#include "loader.h"
+#include "memory.h"
+#include "ndefutil.h"
+#include "objmem.h"
+
+#include "coroutineobj.h"
+#include "exceptobj.h"
+#include "funcobj.h"
+#include "mapobj.h"
+#include "setobj.h"
+#include "symbolobj.h"
+#include "tupleobj.h"
+#include "typeobj.h"
+
+#include <zis.h> // zis_build_info
+
+/*
+ * Snapshot file layout:
+ *
+ * ```
+ * +-------------+
+ * | HEADER      |  struct snapshot_header
+ * +-------------+
+ * | ROOTS       |  globals (struct zis_context_globals), loaded modules (1 word)
+ * +-------------+
+ * | RECORDS     |  records of objects to restore in old space, one after another
+ * +-------------+
+ * | BIG RECORDS |  records of objects to restore in big space, one after another
+ * +-------------+
+ * ```
+ *
+ * An object record is the object memory copied verbatim, except that:
+ * the meta holds the reference to the type record and the record size
+ * (see `SNAPSHOT_RECORD_META()`);
+ * object references in the SLOTS part and in ROOTS are replaced with record
+ * positions (see `SNAPSHOT_REF_ENCODE()`), while small integers are kept as is;
+ * the native function pointer of a `Function` is replaced with an index
+ * in the native function table (plus 1, or 0 for NULL); and the registry link
+ * of a `Symbol` is cleared. The native function table is not stored in the file
+ * but is rebuilt from the built-in types and the embedded modules, which is why
+ * a snapshot can only be used by the same build that made it.
+ *
+ * RECORDS is an image of the objects as they are laid out in memory. It is read
+ * into a block of old space (see `zis_objmem_alloc_restored_block()`) directly,
+ * and the objects are restored in place, so that the position of a record is
+ * its offset in RECORDS and a reference is relocated by adding the block address.
+ * Pinned objects (like bytecode functions) and large objects are saved as
+ * BIG RECORDS instead, which are copied to big space one by one; the position
+ * of the N-th big record is the size of RECORDS plus N words.
+ *
+ * Restored objects have new addresses, so the hash codes made from addresses
+ * (like those of functions) change. The hash tables of maps and sets with such
+ * keys are rebuilt after restoring (see `zis_snapshot_rebuild_hash_tables()`).
+ */
+
+#define SNAPSHOT_MAGIC  "ZISHEAP"
+
+struct snapshot_header {
+    char     magic[8];
+    uint32_t timestamp;
+    uint8_t  version[3];
+    uint8_t  word_size;
+    uint32_t native_count;
+    uint32_t root_count;
+    uint64_t records_size;
+    uint64_t big_record_count;
+    uint64_t big_records_size;
+};
+
+#define SNAPSHOT_GLOBALS_WORD_COUNT \
+    (sizeof(struct zis_context_globals) / sizeof(struct zis_object *))
+
+#define SNAPSHOT_ROOT_COUNT (SNAPSHOT_GLOBALS_WORD_COUNT + 1)
+
+static_assert(sizeof(struct zis_context_globals) % sizeof(struct zis_object *) == 0, "");
+static_assert(sizeof(struct snapshot_header) % sizeof(void *) == 0, "");
+static_assert(sizeof(zis_native_func_t) == sizeof(uintptr_t), "");
+
+/// Encode a record position as an object reference, whose LSB is 0.
+#define SNAPSHOT_REF_ENCODE(POS) \
+    ((struct zis_object *)(uintptr_t)(POS))
+/// Get the position of a big record.
+#define SNAPSHOT_BIG_RECORD_POS(RECORDS_SIZE, BIG_INDEX) \
+    ((uintptr_t)(RECORDS_SIZE) + (uintptr_t)(BIG_INDEX) * sizeof(void *))
+
+#if !ZIS_USE_COMPACT_OBJECT_META
+
+/// Make the meta of a record.
+#define SNAPSHOT_RECORD_META(REC, TYPE_REF, SIZE) \
+    do { (REC)->_meta._1 = (uintptr_t)(TYPE_REF), (REC)->_meta._2 = (uintptr_t)(SIZE); } while (0)
+/// Get the encoded type reference in the meta of a record.
+#define SNAPSHOT_RECORD_META_TYPE_REF(REC) \
+    ((uintptr_t)(REC)->_meta._1)
+/// Get the size in the meta of a record.
+#define SNAPSHOT_RECORD_META_SIZE(REC) \
+    ((size_t)(REC)->_meta._2)
+/// Check whether an object can be described by a record meta.
+#define SNAPSHOT_RECORD_META_FITS(TYPE_POS, SIZE) \
+    ((void)(TYPE_POS), (void)(SIZE), true)
+
+#else // ZIS_USE_COMPACT_OBJECT_META
+
+// The lower 32 bits hold the type reference; the upper 32 bits hold the size.
+
+#define SNAPSHOT_RECORD_META(REC, TYPE_REF, SIZE) \
+    do { (REC)->_meta._1 = (uintptr_t)(TYPE_REF) | (uintptr_t)(SIZE) << 32; } while (0)
+#define SNAPSHOT_RECORD_META_TYPE_REF(REC) \
+    ((REC)->_meta._1 & (uintptr_t)UINT32_C(0xffffffff))
+#define SNAPSHOT_RECORD_META_SIZE(REC) \
+    ((size_t)((REC)->_meta._1 >> 32))
+#define SNAPSHOT_RECORD_META_FITS(TYPE_POS, SIZE) \
+    ((uintptr_t)(TYPE_POS) <= UINT32_MAX && (SIZE) <= UINT32_MAX)
+
+#endif // ZIS_USE_COMPACT_OBJECT_META
+
+/// Index of a global variable in ROOTS.
+#define SNAPSHOT_GLOBAL_INDEX(NAME) \
+    (offsetof(struct zis_context_globals, NAME) / sizeof(struct zis_object *))
+
+/* ----- native function table ---------------------------------------------- */
+
+#define E(NAME)  extern const struct zis_native_type_def ZIS_NATIVE_TYPE_VAR(NAME);
+_ZIS_BUILTIN_TYPE_LIST0
+_ZIS_BUILTIN_TYPE_LIST1
+_ZIS_BUILTIN_TYPE_LIST2
+#undef E
+
+/// List of native functions that a snapshot can refer to.
+struct native_table {
+    zis_native_func_t *funcs;
+    size_t count, capacity;
+};
+
+static void native_table_add(struct native_table *t, zis_native_func_t f) {
+    if (zis_unlikely(t->count == t->capacity)) {
+        t->capacity = t->capacity ? t->capacity * 2 : 256;
+        t->funcs = zis_mem_realloc(t->funcs, t->capacity * sizeof t->funcs[0]);
+    }
+    t->funcs[t->count++] = f;
+}
+
+static void native_table_add_value_defs(struct native_table *t, const struct zis_native_value_def *defs);
+
+static void native_table_add_func_def(struct native_table *t, const struct zis_native_func_def *def) {
+    const struct zis_native_func_def_ex *const def_ex = (const struct zis_native_func_def_ex *)def;
+    if (def_ex->code_type >> 1) {
+        native_table_add(t, def->code);
+        return;
+    }
+    if (def_ex->code_type == 1)
+        native_table_add(t, def_ex->code.native);
+    if (def_ex->constants)
+        native_table_add_value_defs(t, def_ex->constants);
+}
+
+static void native_table_add_value_def(struct native_table *t, const struct zis_native_value_def *def) {
+    switch (def->type) {
+    case '(':
+        native_table_add_value_defs(t, def->T);
+        break;
+    case '[':
+        native_table_add_value_defs(t, def->A);
+        break;
+    case '{':
+        native_table_add_value_defs(t, def->M);
+        break;
+    case '^':
+        native_table_add_func_def(t, def->F);
+        break;
+    default:
+        break;
+    }
+}
+
+static void native_table_add_value_defs(struct native_table *t, const struct zis_native_value_def *defs) {
+    for (; defs->type; defs++)
+        native_table_add_value_def(t, defs);
+}
+
+static void native_table_add_type_def(struct native_table *t, const struct zis_native_type_def *def) {
+    if (def->methods) {
+        for (const struct zis_native_func_def__named_ref *p = def->methods; p->def; p++)
+            native_table_add_func_def(t, p->def);
+    }
+    if (def->statics) {
+        for (const struct zis_native_value_def__named *p = def->statics; p->name; p++)
+            native_table_add_value_def(t, &p->value);
+    }
+}
+
+static void native_table_add_module_def(struct native_table *t, const struct zis_native_module_def *def) {
+    if (def->functions) {
+        for (const struct zis_native_func_def__named_ref *p = def->functions; p->def; p++)
+            native_table_add_func_def(t, p->def);
+    }
+    if (def->types) {
+        for (const struct zis_native_type_def__named_ref *p = def->types; p->def; p++)
+            native_table_add_type_def(t, p->def);
+    }
+    if (def->variables) {
+        for (const struct zis_native_value_def__named *p = def->variables; p->name; p++)
+            native_table_add_value_def(t, &p->value);
+    }
+}
+
+/// Collect native functions from built-in types and embedded modules, in a fixed order.
+static void native_table_init(struct native_table *t) {
+    t->funcs = NULL, t->count = 0, t->capacity = 0;
+#define E(NAME)  native_table_add_type_def(t, &ZIS_NATIVE_TYPE_VAR(NAME));
+    _ZIS_BUILTIN_TYPE_LIST0
+    _ZIS_BUILTIN_TYPE_LIST1
+    _ZIS_BUILTIN_TYPE_LIST2
+#undef E
+    for (size_t i = 0; ; i++) {
+        const struct zis_native_module_def *const def = zis_module_loader_embedded_module(i);
+        if (!def)
+            break;
+        native_table_add_module_def(t, def);
+    }
+}
+
+static void native_table_fini(struct native_table *t) {
+    zis_mem_free(t->funcs);
+}
+
+/// Find a native function. Returns its index plus 1, or 0 if not found.
+static size_t native_table_find(const struct native_table *t, zis_native_func_t f) {
+    for (size_t i = 0, n = t->count; i < n; i++) {
+        if (t->funcs[i] == f)
+            return i + 1;
+    }
+    return 0;
+}
+
+/* ----- snapshot writing --------------------------------------------------- */
+
+struct snapshot_writer {
+    struct zis_context *z;
+    struct native_table natives;
+    struct zis_object **objects; // Objects in record order.
+    size_t object_count, object_capacity;
+    struct zis_object **index_keys; // Hash table: object -> index.
+    size_t *index_values;
+    size_t index_capacity; // Power of 2.
+    uintptr_t *positions; // Record positions, indexed like `objects`.
+    size_t records_size;
+    size_t big_record_count, big_records_size;
+};
+
+static void snapshot_writer_init(struct snapshot_writer *w, struct zis_context *z) {
+    w->z = z;
+    native_table_init(&w->natives);
+    w->objects = NULL;
+    w->object_count = 0, w->object_capacity = 0;
+    w->index_capacity = 1024;
+    w->index_keys = zis_mem_alloc(w->index_capacity * sizeof w->index_keys[0]);
+    memset(w->index_keys, 0, w->index_capacity * sizeof w->index_keys[0]);
+    w->index_values = zis_mem_alloc(w->index_capacity * sizeof w->index_values[0]);
+    w->positions = NULL;
+    w->records_size = 0;
+    w->big_record_count = 0, w->big_records_size = 0;
+}
+
+static void snapshot_writer_fini(struct snapshot_writer *w) {
+    native_table_fini(&w->natives);
+    zis_mem_free(w->objects);
+    zis_mem_free(w->index_keys);
+    zis_mem_free(w->index_values);
+    zis_mem_free(w->positions);
+}
+
+static void snapshot_writer_rehash(struct snapshot_writer *w) {
+    const size_t new_capacity = w->index_capacity * 2;
+    struct zis_object **const new_keys = zis_mem_alloc(new_capacity * sizeof new_keys[0]);
+    memset(new_keys, 0, new_capacity * sizeof new_keys[0]);
+    size_t *const new_values = zis_mem_alloc(new_capacity * sizeof new_values[0]);
+    for (size_t i = 0; i < w->index_capacity; i++) {
+        struct zis_object *const obj = w->index_keys[i];
+        if (!obj)
+            continue;
+        size_t j = zis_hash_pointer(obj) & (new_capacity - 1);
+        while (new_keys[j])
+            j = (j + 1) & (new_capacity - 1);
+        new_keys[j] = obj, new_values[j] = w->index_values[i];
+    }
+    zis_mem_free(w->index_keys);
+    zis_mem_free(w->index_values);
+    w->index_keys = new_keys, w->index_values = new_values;
+    w->index_capacity = new_capacity;
+}
+
+/// Get the record index of an object, which is appended to the record list if not seen.
+static size_t snapshot_writer_index(struct snapshot_writer *w, struct zis_object *obj) {
+    assert(!zis_object_is_smallint(obj));
+    size_t i = zis_hash_pointer(obj) & (w->index_capacity - 1);
+    for (struct zis_object *k; (k = w->index_keys[i]); i = (i + 1) & (w->index_capacity - 1)) {
+        if (k == obj)
+            return w->index_values[i];
+    }
+
+    const size_t index = w->object_count;
+    if (zis_unlikely(index == w->object_capacity)) {
+        w->object_capacity = w->object_capacity ? w->object_capacity * 2 : 1024;
+        w->objects = zis_mem_realloc(w->objects, w->object_capacity * sizeof w->objects[0]);
+    }
+    w->objects[index] = obj;
+    w->object_count++;
+    w->index_keys[i] = obj, w->index_values[i] = index;
+    if (w->object_count * 2 > w->index_capacity)
+        snapshot_writer_rehash(w);
+    return index;
+}
+
+/// Encode a reference. Small integers are kept as is. Records must have been placed.
+static struct zis_object *snapshot_writer_ref(struct snapshot_writer *w, struct zis_object *obj) {
+    if (zis_object_is_smallint(obj))
+        return obj;
+    return SNAPSHOT_REF_ENCODE(w->positions[snapshot_writer_index(w, obj)]);
+}
+
+/// Check whether an object is to be saved as a big record.
+static bool snapshot_writer_is_big(struct zis_object *obj) {
+    return zis_object_meta_get_gc_state(obj->_meta) == ZIS_OBJMEM_OBJ_BIG;
+}
+
+/// Check whether the object can be saved, and visit the objects it references.
+static bool snapshot_writer_scan(struct snapshot_writer *w, struct zis_object *obj) {
+    struct zis_context_globals *const g = w->z->globals;
+    struct zis_type_obj *const type = zis_object_type(obj);
+
+    if (type == g->type_Function) {
+        struct zis_func_obj *const func = zis_object_cast(obj, struct zis_func_obj);
+        if (func->native && !native_table_find(&w->natives, func->native)) {
+            zis_debug_log(ERROR, "Snapshot", "Function@%p: unknown native function", (void *)obj);
+            return false;
+        }
+    } else if (type == g->type_Stream) {
+        zis_debug_log(ERROR, "Snapshot", "Stream@%p: cannot be saved", (void *)obj);
+        return false;
+    } else if (type == g->type_Coroutine) {
+        if (zis_object_cast(obj, struct zis_coroutine_obj)->_stack) {
+            zis_debug_log(ERROR, "Snapshot", "Coroutine@%p: running or suspended", (void *)obj);
+            return false;
+        }
+    } else if (type->_bytes_len != 0) {
+        bool builtin = false;
+#define E(NAME)  if (type == g->type_##NAME) builtin = true;
+        _ZIS_BUILTIN_TYPE_LIST0
+        _ZIS_BUILTIN_TYPE_LIST1
+        _ZIS_BUILTIN_TYPE_LIST2
+#undef E
+        if (!builtin) {
+            // The BYTES part may hold native data.
+            zis_debug_log(ERROR, "Snapshot", "object@%p: non-built-in type with BYTES", (void *)obj);
+            return false;
+        }
+    }
+
+    snapshot_writer_index(w, zis_object_from(type));
+    for (size_t i = 0, n = zis_object_slot_count(obj); i < n; i++) {
+        struct zis_object *const v = zis_object_get_slot(obj, i);
+        if (!zis_object_is_smallint(v))
+            snapshot_writer_index(w, v);
+    }
+    return true;
+}
+
+/// Decide the positions of the records. Returns false if they do not fit in the record metas.
+static bool snapshot_writer_place(struct snapshot_writer *w) {
+    const size_t count = w->object_count;
+    w->positions = zis_mem_alloc(count * sizeof w->positions[0]);
+
+    for (size_t i = 0; i < count; i++) {
+        struct zis_object *const obj = w->objects[i];
+        const size_t size = zis_object_size(obj);
+        if (snapshot_writer_is_big(obj)) {
+            w->positions[i] = w->big_record_count++; // Index for now.
+            w->big_records_size += size;
+        } else {
+            w->positions[i] = w->records_size;
+            w->records_size += size;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        struct zis_object *const obj = w->objects[i];
+        if (snapshot_writer_is_big(obj))
+            w->positions[i] = SNAPSHOT_BIG_RECORD_POS(w->records_size, w->positions[i]);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        struct zis_object *const obj = w->objects[i];
+        struct zis_object *const type = zis_object_from(zis_object_type(obj));
+        if (snapshot_writer_is_big(type)) {
+            zis_debug_log(ERROR, "Snapshot", "object@%p: type in big space", (void *)obj);
+            return false;
+        }
+        const uintptr_t type_pos = w->positions[snapshot_writer_index(w, type)];
+        if (!SNAPSHOT_RECORD_META_FITS(type_pos, zis_object_size(obj))) {
+            zis_debug_log(ERROR, "Snapshot", "object@%p: too large or too many objects", (void *)obj);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// Write an object record to `buffer`. Returns the record size.
+static size_t snapshot_writer_emit(struct snapshot_writer *w, struct zis_object *obj, char *buffer) {
+    struct zis_context_globals *const g = w->z->globals;
+    struct zis_type_obj *const type = zis_object_type(obj);
+    const size_t size = zis_object_size(obj);
+    struct zis_object *const rec = (struct zis_object *)buffer;
+
+    memcpy(rec, obj, size);
+    SNAPSHOT_RECORD_META(rec, snapshot_writer_ref(w, zis_object_from(type)), size);
+
+    struct zis_object **const slots = (struct zis_object **)rec->_body;
+    for (size_t i = 0, n = zis_object_slot_count(obj); i < n; i++)
+        slots[i] = snapshot_writer_ref(w, slots[i]);
+
+    if (type == g->type_Function) {
+        struct zis_func_obj *const func = zis_object_cast(obj, struct zis_func_obj);
+        const uintptr_t native_index =
+            func->native ? (uintptr_t)native_table_find(&w->natives, func->native) : 0;
+        memcpy(buffer + offsetof(struct zis_func_obj, native), &native_index, sizeof native_index);
+    } else if (type == g->type_Symbol) {
+        memset(buffer + offsetof(struct zis_symbol_obj, _registry_next), 0, sizeof(void *));
+    }
+
+    return size;
+}
+
+int zis_snapshot_save(struct zis_context *z, const zis_path_char_t *file) {
+    struct zis_context_globals *const g = z->globals;
+    struct snapshot_writer w;
+    struct zis_object *roots[SNAPSHOT_ROOT_COUNT];
+    int status = ZIS_OK;
+    char *buffer = NULL;
+
+    // Buffered stack traces are not saved otherwise.
+    zis_exception_trace_buffer_flush(z);
+
+    snapshot_writer_init(&w, z);
+
+    // Collect roots. The standard streams are recreated when restoring.
+    memcpy(roots, g, sizeof *g);
+    roots[SNAPSHOT_GLOBALS_WORD_COUNT] = zis_module_loader_loaded_modules(z->module_loader);
+    for (size_t i = 0; i < SNAPSHOT_ROOT_COUNT; i++) {
+        struct zis_object *const v = roots[i];
+        if (zis_object_is_smallint(v))
+            continue;
+        if (zis_object_type(v) == g->type_Stream) {
+            roots[i] = zis_smallint_to_ptr(0);
+            continue;
+        }
+        snapshot_writer_index(&w, v);
+    }
+
+    // Find reachable objects.
+    for (size_t i = 0; i < w.object_count; i++) {
+        if (!snapshot_writer_scan(&w, w.objects[i])) {
+            status = ZIS_E_TYPE;
+            goto do_return;
+        }
+    }
+
+    // Place the records.
+    if (!snapshot_writer_place(&w)) {
+        status = ZIS_E_TYPE;
+        goto do_return;
+    }
+    for (size_t i = 0; i < SNAPSHOT_ROOT_COUNT; i++)
+        roots[i] = snapshot_writer_ref(&w, roots[i]);
+
+    // Build the image.
+    const size_t roots_offset = sizeof(struct snapshot_header);
+    const size_t records_offset = roots_offset + sizeof roots;
+    const size_t big_records_offset = records_offset + w.records_size;
+    const size_t total_size = big_records_offset + w.big_records_size;
+    buffer = zis_mem_alloc(total_size);
+    struct snapshot_header *const header = (struct snapshot_header *)buffer;
+    memset(header, 0, sizeof *header);
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof SNAPSHOT_MAGIC);
+    header->timestamp = zis_build_info.timestamp;
+    memcpy(header->version, zis_build_info.version, sizeof header->version);
+    header->word_size = (uint8_t)sizeof(void *);
+    header->native_count = (uint32_t)w.natives.count;
+    header->root_count = (uint32_t)SNAPSHOT_ROOT_COUNT;
+    header->records_size = w.records_size;
+    header->big_record_count = w.big_record_count;
+    header->big_records_size = w.big_records_size;
+    memcpy(buffer + roots_offset, roots, sizeof roots);
+    char *p = buffer + records_offset, *big_p = buffer + big_records_offset;
+    for (size_t i = 0; i < w.object_count; i++) {
+        struct zis_object *const obj = w.objects[i];
+        if (snapshot_writer_is_big(obj))
+            big_p += snapshot_writer_emit(&w, obj, big_p);
+        else
+            p += snapshot_writer_emit(&w, obj, p);
+    }
+    assert(p == buffer + big_records_offset && big_p == buffer + total_size);
+
+    // Write the file.
+    zis_file_handle_t f = zis_file_open(file, ZIS_FILE_MODE_WR);
+    if (!f) {
+        status = ZIS_E_ARG;
+        goto do_return;
+    }
+    if (zis_file_write(f, buffer, total_size) != 0)
+        status = ZIS_E_ARG;
+    zis_file_close(f);
+
+    zis_debug_log(
+        INFO, "Snapshot", "saved %zu objects (%zu + %zu bytes), %zu native functions",
+        w.object_count, w.records_size, w.big_records_size, w.natives.count
+    );
+
+do_return:
+    zis_mem_free(buffer);
+    snapshot_writer_fini(&w);
+    return status;
+}
+
+/* ----- snapshot reading --------------------------------------------------- */
+
+struct zis_snapshot {
+    zis_file_handle_t file; // Positioned at RECORDS after opening.
+    size_t records_size;
+    size_t big_record_count, big_records_size;
+    struct zis_object *roots[SNAPSHOT_ROOT_COUNT];
+    struct native_table natives;
+    struct zis_object **rehash_list; // Restored hash tables to rebuild. A GC root when not empty.
+    size_t rehash_count, rehash_capacity;
+};
+
+/// Read `size` bytes from the file. Returns whether successful.
+static bool snapshot_read(zis_file_handle_t f, void *buffer, size_t size) {
+    for (char *p = buffer; size; ) {
+        const size_t n = zis_file_read(f, p, size);
+        if (n == 0 || n == (size_t)-1)
+            return false;
+        p += n, size -= n;
+    }
+    return true;
+}
+
+struct zis_snapshot *zis_snapshot_open(const zis_path_char_t *file) {
+    zis_file_handle_t f = zis_file_open(file, ZIS_FILE_MODE_RD);
+    if (!f)
+        return NULL;
+
+    struct zis_snapshot *const s = zis_mem_alloc(sizeof(struct zis_snapshot));
+    s->file = f;
+    native_table_init(&s->natives);
+    s->rehash_list = NULL;
+    s->rehash_count = 0, s->rehash_capacity = 0;
+
+    // Header.
+    struct snapshot_header header;
+    if (!snapshot_read(f, &header, sizeof header))
+        goto fail;
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof SNAPSHOT_MAGIC) != 0)
+        goto fail;
+    if (
+        header.timestamp != zis_build_info.timestamp ||
+        memcmp(header.version, zis_build_info.version, sizeof header.version) != 0 ||
+        header.word_size != sizeof(void *) ||
+        header.native_count != s->natives.count ||
+        header.root_count != SNAPSHOT_ROOT_COUNT
+    ) {
+        zis_debug_log(WARN, "Snapshot", "made by another build");
+        goto fail;
+    }
+    const zis_ssize_t file_size = zis_file_seek(f, 0, SEEK_END);
+    const size_t records_offset = sizeof header + sizeof s->roots;
+    if (
+        file_size < 0 || (size_t)file_size < records_offset ||
+        header.records_size > (size_t)file_size || header.big_records_size > (size_t)file_size ||
+        header.records_size + header.big_records_size != (size_t)file_size - records_offset ||
+        header.records_size < ZIS_OBJECT_HEAD_SIZE || header.records_size & (sizeof(void *) - 1) ||
+        header.big_record_count > header.big_records_size / ZIS_OBJECT_HEAD_SIZE
+    ) {
+        goto fail;
+    }
+    s->records_size = (size_t)header.records_size;
+    s->big_record_count = (size_t)header.big_record_count;
+    s->big_records_size = (size_t)header.big_records_size;
+
+    // Roots. The records are read when restoring.
+    if (zis_file_seek(f, (zis_ssize_t)sizeof header, SEEK_SET) < 0 || !snapshot_read(f, s->roots, sizeof s->roots))
+        goto fail;
+
+    return s;
+
+fail:
+    zis_debug_log(WARN, "Snapshot", "invalid snapshot file");
+    zis_snapshot_close(s);
+    return NULL;
+}
+
+void zis_snapshot_close(struct zis_snapshot *s) {
+    assert(!s->rehash_count);
+    zis_mem_free(s->rehash_list);
+    native_table_fini(&s->natives);
+    zis_file_close(s->file);
+    zis_mem_free(s);
+}
+
+/// Check whether the hash code of an object is made from its contents only, so
+/// that it does not change when the object is restored at another address.
+static bool snapshot_hash_stable(
+    struct zis_context_globals *g, struct zis_object *obj, unsigned int depth
+) {
+    if (zis_object_is_smallint(obj))
+        return true;
+    struct zis_type_obj *const type = zis_object_type(obj);
+    if (
+        type == g->type_Symbol || type == g->type_String || type == g->type_Int ||
+        type == g->type_Float || type == g->type_Bool || type == g->type_Nil
+    ) {
+        return true;
+    }
+    if (type == g->type_Tuple && depth < 4) {
+        struct zis_tuple_obj *const tuple = zis_object_cast(obj, struct zis_tuple_obj);
+        for (size_t i = 0, n = zis_tuple_obj_length(tuple); i < n; i++) {
+            if (!snapshot_hash_stable(g, zis_tuple_obj_get(tuple, i), depth + 1))
+                return false;
+        }
+        return true;
+    }
+    // Hash codes of functions are made from addresses. Other types may define
+    // `hash()` methods that depend on them.
+    return false;
+}
+
+/// Check whether the hash codes of all keys in a restored map are stable.
+static bool snapshot_map_keys_stable(struct zis_context_globals *g, struct zis_object *map) {
+    struct zis_object *const buckets = zis_object_from(zis_object_cast(map, struct zis_map_obj)->_buckets);
+    struct zis_object *next;
+    bool stable = true;
+    zis_hashmap_buckets_foreach_node_r(buckets, next, node, {
+        if (!snapshot_hash_stable(g, node->_key, 0)) {
+            stable = false;
+            break;
+        }
+    });
+    return stable;
+}
+
+/// Check whether the hash codes of all elements in a restored set are stable.
+static bool snapshot_set_keys_stable(struct zis_context_globals *g, struct zis_object *set) {
+    struct zis_set_obj *const set_obj = zis_object_cast(set, struct zis_set_obj);
+    for (size_t i = 0, n = zis_array_slots_obj_length(set_obj->_keys); i < n; i++) {
+        struct zis_object *const key = zis_set_obj_slot(set_obj, i);
+        if (key && !snapshot_hash_stable(g, key, 0))
+            return false;
+    }
+    return true;
+}
+
+static void snapshot_rehash_list_gc_visitor(void *_s, enum zis_objmem_obj_visit_op op) {
+    struct zis_snapshot *const s = _s;
+    zis_objmem_visit_object_vec(s->rehash_list, s->rehash_list + s->rehash_count, op);
+}
+
+/// States of restoring objects.
+struct snapshot_reader {
+    struct zis_snapshot *snapshot;
+    struct zis_context *z;
+    char *records; // RECORDS read into old space.
+    size_t records_size;
+    void *records_gc_ptr; // See `zis_objmem_alloc_restored_block()`.
+    char *big_records; // BIG RECORDS read into a buffer.
+    struct zis_object **big_objects;
+    size_t big_count;
+    struct zis_bitset *record_starts; // Whether a record starts at a word in RECORDS.
+    struct zis_bitset *type_records; // Whether a `Type` record starts at a word in RECORDS.
+    struct zis_type_obj *type_Function, *type_Symbol, *type_Map, *type_Set;
+};
+
+/// Decode a reference to a restored object. Returns NULL if it is not valid.
+static struct zis_object *snapshot_reader_ref(const struct snapshot_reader *r, uintptr_t ref) {
+    const size_t records_size = r->records_size;
+    if (ref & (sizeof(void *) - 1))
+        return NULL;
+    if (ref < records_size) {
+        if (!zis_bitset_test_bit(r->record_starts, ref / sizeof(void *)))
+            return NULL;
+        return (struct zis_object *)(r->records + ref);
+    }
+    const uintptr_t big_index = (ref - records_size) / sizeof(void *);
+    if (big_index >= r->big_count)
+        return NULL;
+    return r->big_objects[big_index];
+}
+
+/// Restore an object from a record, whose body has been copied to `obj`: check
+/// the size, relocate the references, set the type, and so on. Returns whether the record is valid.
+static bool snapshot_reader_restore(
+    struct snapshot_reader *r, struct zis_object *obj,
+    uintptr_t type_ref, size_t size, bool big
+) {
+    // Type.
+    if (
+        type_ref >= r->records_size || type_ref & (sizeof(void *) - 1) ||
+        !zis_bitset_test_bit(r->type_records, type_ref / sizeof(void *))
+    ) {
+        return false;
+    }
+    struct zis_type_obj *const type = (struct zis_type_obj *)(r->records + type_ref);
+
+    // Size.
+    size_t slot_count = type->_slots_num, bytes_size = type->_bytes_len;
+    if (slot_count == (size_t)-1) {
+        if (size < ZIS_OBJECT_HEAD_SIZE + sizeof(void *))
+            return false;
+        struct zis_object *const vn = ((struct zis_object *const *)obj->_body)[0];
+        if (!zis_object_is_smallint(vn) || zis_smallint_from_ptr(vn) < 1)
+            return false;
+        slot_count = (size_t)zis_smallint_from_ptr(vn);
+    }
+    if (slot_count > (size - ZIS_OBJECT_HEAD_SIZE) / sizeof(void *))
+        return false;
+    if (bytes_size == (size_t)-1) {
+        const size_t bytes_offset = ZIS_OBJECT_HEAD_SIZE + slot_count * sizeof(void *);
+        if (size < bytes_offset + sizeof(size_t))
+            return false;
+        memcpy(&bytes_size, (const char *)obj + bytes_offset, sizeof bytes_size);
+    }
+    if (ZIS_OBJECT_HEAD_SIZE + slot_count * sizeof(void *) + bytes_size != size)
+        return false;
+
+    // Slots.
+    struct zis_object **const slots = (struct zis_object **)obj->_body;
+    for (size_t i = 0; i < slot_count; i++) {
+        struct zis_object *const v = slots[i];
+        if (zis_object_is_smallint(v))
+            continue;
+        struct zis_object *const v_obj = snapshot_reader_ref(r, (uintptr_t)v);
+        if (!v_obj)
+            return false;
+        slots[i] = v_obj;
+    }
+
+    // Meta.
+    if (big)
+        zis_object_meta_set_type_ptr(obj->_meta, type);
+    else
+        zis_object_meta_init(obj->_meta, ZIS_OBJMEM_OBJ_OLD, r->records_gc_ptr, type);
+
+    // Special types.
+    if (type == r->type_Function) {
+        if (size < sizeof(struct zis_func_obj))
+            return false;
+        struct zis_func_obj *const func = zis_object_cast(obj, struct zis_func_obj);
+        uintptr_t native_index;
+        memcpy(&native_index, &func->native, sizeof native_index);
+        if (native_index > r->snapshot->natives.count)
+            return false;
+        func->native = native_index ? r->snapshot->natives.funcs[native_index - 1] : NULL;
+    } else if (type == r->type_Symbol) {
+        if (size < sizeof(struct zis_symbol_obj))
+            return false;
+        zis_symbol_registry_add(r->z, zis_object_cast(obj, struct zis_symbol_obj));
+    } else if (type == r->type_Map || type == r->type_Set) {
+        // Checked later, when all objects are restored. See `snapshot_map_keys_stable()`.
+        struct zis_snapshot *const s = r->snapshot;
+        if (s->rehash_count == s->rehash_capacity) {
+            s->rehash_capacity = s->rehash_capacity ? s->rehash_capacity * 2 : 64;
+            s->rehash_list = zis_mem_realloc(s->rehash_list, s->rehash_capacity * sizeof s->rehash_list[0]);
+        }
+        s->rehash_list[s->rehash_count++] = obj;
+    }
+
+    return true;
+}
+
+/// Restore the objects. See `zis_snapshot_restore()`.
+static bool snapshot_reader_run(struct snapshot_reader *r, struct zis_object **loaded_modules) {
+    struct zis_snapshot *const s = r->snapshot;
+    struct zis_context *const z = r->z;
+    const size_t records_size = r->records_size;
+    const size_t big_count = r->big_count;
+
+    // Read RECORDS into old space.
+    r->records = zis_objmem_alloc_restored_block(z, records_size, &r->records_gc_ptr);
+    if (!r->records || !snapshot_read(s->file, r->records, records_size))
+        return false;
+
+    // Find records and type records.
+    const size_t bitset_size = zis_bitset_required_size(records_size / sizeof(void *));
+    r->record_starts = zis_mem_alloc(bitset_size * 2);
+    r->type_records = (struct zis_bitset *)((char *)r->record_starts + bitset_size);
+    zis_bitset_clear(r->record_starts, bitset_size * 2);
+    const uintptr_t type_Type_ref = (uintptr_t)s->roots[SNAPSHOT_GLOBAL_INDEX(type_Type)];
+    for (size_t offset = 0, size; offset < records_size; offset += size) {
+        const struct zis_object *const rec = (const struct zis_object *)(r->records + offset);
+        size = SNAPSHOT_RECORD_META_SIZE(rec);
+        if (
+            size < ZIS_OBJECT_HEAD_SIZE || size & (sizeof(void *) - 1) ||
+            size > records_size - offset || size > ZIS_OBJMEM_NON_BIG_SIZE_MAX
+        ) {
+            return false;
+        }
+        zis_bitset_set_bit(r->record_starts, offset / sizeof(void *));
+        if (SNAPSHOT_RECORD_META_TYPE_REF(rec) == type_Type_ref) {
+            if (size < sizeof(struct zis_type_obj))
+                return false;
+            zis_bitset_set_bit(r->type_records, offset / sizeof(void *));
+        }
+    }
+
+    // Read BIG RECORDS and allocate the big objects.
+    const size_t big_records_size = s->big_records_size;
+    r->big_records = zis_mem_alloc(big_records_size);
+    r->big_objects = zis_mem_alloc(big_count * sizeof r->big_objects[0]);
+    if (!snapshot_read(s->file, r->big_records, big_records_size))
+        return false;
+    size_t big_offset = 0;
+    for (size_t i = 0; i < big_count; i++) {
+        if (big_records_size - big_offset < ZIS_OBJECT_HEAD_SIZE)
+            return false;
+        const struct zis_object *const rec = (const struct zis_object *)(r->big_records + big_offset);
+        const size_t size = SNAPSHOT_RECORD_META_SIZE(rec);
+        if (size < ZIS_OBJECT_HEAD_SIZE || size & (sizeof(void *) - 1) || size > big_records_size - big_offset)
+            return false;
+        struct zis_object *const obj = zis_objmem_alloc_restored_big(z, size);
+        memcpy(obj->_body, rec->_body, size - ZIS_OBJECT_HEAD_SIZE);
+        r->big_objects[i] = obj;
+        big_offset += size;
+    }
+    if (big_offset != big_records_size)
+        return false;
+
+    // Roots.
+    for (size_t i = 0; i < SNAPSHOT_ROOT_COUNT; i++) {
+        struct zis_object *const v = s->roots[i];
+        if (zis_object_is_smallint(v))
+            continue;
+        struct zis_object *const v_obj = snapshot_reader_ref(r, (uintptr_t)v);
+        if (!v_obj)
+            return false;
+        s->roots[i] = v_obj;
+    }
+    if (zis_object_is_smallint(s->roots[SNAPSHOT_GLOBAL_INDEX(type_Type)]))
+        return false;
+    struct zis_context_globals *const restored_globals = (struct zis_context_globals *)s->roots;
+    r->type_Function = restored_globals->type_Function;
+    r->type_Symbol = restored_globals->type_Symbol;
+    r->type_Map = restored_globals->type_Map;
+    r->type_Set = restored_globals->type_Set;
+
+    // Restore objects.
+    for (size_t offset = 0, size; offset < records_size; offset += size) {
+        struct zis_object *const obj = (struct zis_object *)(r->records + offset);
+        size = SNAPSHOT_RECORD_META_SIZE(obj);
+        if (!snapshot_reader_restore(r, obj, SNAPSHOT_RECORD_META_TYPE_REF(obj), size, false))
+            return false;
+    }
+    big_offset = 0;
+    for (size_t i = 0; i < big_count; i++) {
+        const struct zis_object *const rec = (const struct zis_object *)(r->big_records + big_offset);
+        const size_t size = SNAPSHOT_RECORD_META_SIZE(rec);
+        if (!snapshot_reader_restore(r, r->big_objects[i], SNAPSHOT_RECORD_META_TYPE_REF(rec), size, true))
+            return false;
+        big_offset += size;
+    }
+
+    // Keep the maps and sets with keys whose hash codes may be made from addresses.
+    struct zis_context_globals *const g = restored_globals;
+    size_t rehash_count = 0;
+    for (size_t i = 0; i < s->rehash_count; i++) {
+        struct zis_object *const obj = s->rehash_list[i];
+        const bool stable =
+            zis_object_type(obj) == g->type_Map ?
+            snapshot_map_keys_stable(g, obj) : snapshot_set_keys_stable(g, obj);
+        if (!stable)
+            s->rehash_list[rehash_count++] = obj;
+    }
+    s->rehash_count = rehash_count;
+
+    memcpy(z->globals, s->roots, sizeof *z->globals);
+    *loaded_modules = s->roots[SNAPSHOT_GLOBALS_WORD_COUNT];
+    return true;
+}
+
+bool zis_snapshot_restore(
+    struct zis_snapshot *s, struct zis_context *z,
+    struct zis_object **loaded_modules
+) {
+    struct snapshot_reader r;
+    memset(&r, 0, sizeof r);
+    r.snapshot = s, r.z = z;
+    r.records_size = s->records_size, r.big_count = s->big_record_count;
+
+    // No GC would happen until the restoring is finished.
+    const bool ok = snapshot_reader_run(&r, loaded_modules);
+    zis_mem_free(r.record_starts);
+    zis_mem_free(r.big_records);
+    zis_mem_free(r.big_objects);
+    if (!ok) {
+        zis_debug_log(WARN, "Snapshot", "invalid snapshot file");
+        s->rehash_count = 0;
+        return false;
+    }
+
+    if (s->rehash_count)
+        zis_objmem_add_gc_root(z, s, snapshot_rehash_list_gc_visitor);
+
+    zis_debug_log(
+        INFO, "Snapshot", "restored %zu + %zu bytes of objects",
+        s->records_size, s->big_records_size
+    );
+    return true;
+}
+
+bool zis_snapshot_rebuild_hash_tables(struct zis_snapshot *s, struct zis_context *z) {
+    if (!s->rehash_count)
+        return true;
+    bool ok = true;
+    for (size_t i = 0; i < s->rehash_count; i++) {
+        struct zis_object *const obj = s->rehash_list[i];
+        const int status =
+            zis_object_type(obj) == z->globals->type_Map ?
+            zis_map_obj_rehash_keys(z, zis_object_cast(obj, struct zis_map_obj)) :
+            zis_set_obj_rehash_keys(z, zis_object_cast(obj, struct zis_set_obj));
+        if (status != ZIS_OK) {
+            zis_debug_log(ERROR, "Snapshot", "object@%p: cannot rebuild the hash table", (void *)obj);
+            ok = false;
+            break;
+        }
+    }
+    zis_debug_log(INFO, "Snapshot", "rebuilt %zu hash tables", s->rehash_count);
+    zis_objmem_remove_gc_root(z, s);
+    s->rehash_count = 0;
+    return ok;
+}
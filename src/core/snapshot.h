@@ -0,0 +1,47 @@
+/// Heap snapshots.
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "fsutil.h" // zis_path_char_t
+
+struct zis_context;
+struct zis_object;
+
+/// Save a heap snapshot to a file. The objects reachable from the globals and
+/// the map of loaded modules (see `zis_module_loader_loaded_modules()`)
+/// are written, while the callstack and the locals are ignored.
+/// Returns `ZIS_OK`; `ZIS_E_ARG` if the file cannot be written; or `ZIS_E_TYPE`
+/// if there are objects that cannot be saved (like native functions that are
+/// not from built-in types or embedded modules, and streams other than the standard ones).
+int zis_snapshot_save(struct zis_context *z, const zis_path_char_t *file);
+
+/// An opened heap snapshot.
+struct zis_snapshot;
+
+/// Open a snapshot file and check the header. Returns NULL if the file cannot be read,
+/// or is not a snapshot made by this build.
+struct zis_snapshot *zis_snapshot_open(const zis_path_char_t *file);
+
+/// Close a snapshot file.
+void zis_snapshot_close(struct zis_snapshot *snapshot);
+
+/// Restore the objects in a snapshot into a context, whose globals must be empty
+/// (see `zis_context_globals_create_empty()`). The globals are then restored
+/// except for those made by `zis_context_globals_post_restore()`, and the symbols
+/// are added to the symbol registry. The map of loaded modules is stored to
+/// `loaded_modules`, which must be passed to `zis_module_loader_create_restored()` before any allocation.
+/// Then `zis_snapshot_rebuild_hash_tables()` must be called before closing the snapshot.
+/// Returns false if the records are not valid, in which case the globals are
+/// left empty and the context can only be destroyed.
+bool zis_snapshot_restore(
+    struct zis_snapshot *snapshot, struct zis_context *z,
+    struct zis_object **loaded_modules
+);
+
+/// Rebuild the hash tables of the restored maps and sets with keys whose hash
+/// codes may depend on addresses (like functions), which change after restoring.
+/// Hash functions are called, so the context must be ready to run code. Returns
+/// whether successful. On failure, the exception is left in REG-0.
+bool zis_snapshot_rebuild_hash_tables(struct zis_snapshot *snapshot, struct zis_context *z);
@@ -71,11 +71,7 @@ zis_static_force_inline void fi_list_pop(struct _zis_callstack_fi_list *fi_list)
 
 /// GC objects visitor. See `zis_objmem_object_visitor_t`.
 static void callstack_gc_visitor(void *_cs, enum zis_objmem_obj_visit_op op) {
-    struct zis_callstack *const cs = _cs;
-    struct zis_object **const bp = cs->_data;
-    struct zis_object **const sp_p1 = cs->top + 1;
-    assert(sp_p1 <= cs->_data_end);
-    zis_objmem_visit_object_vec(bp, sp_p1, op);
+    zis_callstack_gc_visit(_cs, op);
 }
 
 /// Fill slots with known objects.
@@ -95,7 +91,7 @@ static size_t callstack_struct_size(const struct zis_callstack *cs) {
     return (size_t)((char *)cs->_data_end - (char *)cs);
 }
 
-struct zis_callstack *zis_callstack_create(struct zis_context *z, size_t cs_size) {
+struct zis_callstack *zis_callstack_create(struct zis_context *z, size_t cs_size, bool gc_root) {
     if (cs_size == 0)
         cs_size = ZIS_CALLSTACK_SIZE_DFL;
     else if (cs_size < ZIS_CALLSTACK_SIZE_MIN)
@@ -105,10 +101,12 @@ struct zis_callstack *zis_callstack_create(struct zis_context *z, size_t cs_size
     cs->top = cs->_data;
     cs->frame = cs->_data;
     fi_list_init(&cs->_fi_list);
+    cs->resumer = NULL;
     cs->z = z;
     cs->_data_end = cs->_data + (cs_size - sizeof(struct zis_callstack)) / sizeof(void *);
     cs->frame[0] = zis_smallint_to_ptr(0);
-    zis_objmem_add_gc_root(z, cs, callstack_gc_visitor);
+    if (gc_root)
+        zis_objmem_add_gc_root(z, cs, callstack_gc_visitor);
     zis_debug_log(
         INFO, "Stack", "new stack @%p: size=%zu,n_slots=%zu",
         (void *)cs, cs_size, (cs_size - sizeof(struct zis_callstack)) / sizeof(void *)
@@ -119,13 +117,29 @@ struct zis_callstack *zis_callstack_create(struct zis_context *z, size_t cs_size
 
 void zis_callstack_destroy(struct zis_callstack *cs, struct zis_context *z) {
     zis_debug_log(INFO, "Stack", "deleting stack @%p", (void *)cs);
-    const bool ok = zis_objmem_remove_gc_root(z, cs);
-    assert(ok); zis_unused_var(ok);
+    zis_objmem_remove_gc_root(z, cs); // Unless created with `gc_root=false`.
     fi_list_fini(&cs->_fi_list);
     assert(cs->z == z);
     zis_vmem_free(cs, callstack_struct_size(cs));
 }
 
+void zis_callstack_clear(struct zis_callstack *cs) {
+    while (cs->_fi_list._list)
+        fi_list_pop(&cs->_fi_list);
+    cs->top = cs->_data;
+    cs->frame = cs->_data;
+    cs->frame[0] = zis_smallint_to_ptr(0);
+    assert(!cs->resumer);
+    zis_debug_log(TRACE, "Stack", "stack@%p cleared", (void *)cs);
+}
+
+void zis_callstack_gc_visit(struct zis_callstack *cs, enum zis_objmem_obj_visit_op op) {
+    struct zis_object **const bp = cs->_data;
+    struct zis_object **const sp_p1 = cs->top + 1;
+    assert(sp_p1 <= cs->_data_end);
+    zis_objmem_visit_object_vec(bp, sp_p1, op);
+}
+
 void zis_callstack_enter(struct zis_callstack *cs, size_t frame_size, void *caller_ip, struct zis_object **ret_val_reg) {
     assert(ret_val_reg);
     struct zis_object **const old_sp = cs->top, **const old_fp = cs->frame;
@@ -7,6 +7,7 @@
 #include <stddef.h>
 
 #include "attributes.h"
+#include "objmem.h" // enum zis_objmem_obj_visit_op
 
 struct zis_context;
 struct zis_object;
@@ -66,16 +67,24 @@ struct zis_callstack {
     struct zis_object **frame;     ///< Base of top frame (FP).
     struct zis_object **_data_end; ///< End of `_data[]` (max of SP+1).
     struct _zis_callstack_fi_list _fi_list;
+    struct zis_callstack *resumer; ///< For a running coroutine stack, the stack that resumed it; otherwise NULL.
     struct zis_context *z; // just for panic
     struct zis_object  *_data[];   ///< Base of the stack (BP).
 };
 
-/// Crate a call stack.
-zis_nodiscard struct zis_callstack *zis_callstack_create(struct zis_context *z, size_t sz);
+/// Crate a call stack. If `gc_root` is false, the stack is not a GC root, and its
+/// objects shall be visited by its owner with `zis_callstack_gc_visit()`.
+zis_nodiscard struct zis_callstack *zis_callstack_create(struct zis_context *z, size_t sz, bool gc_root);
 
 /// Destroy a call stack.
 void zis_callstack_destroy(struct zis_callstack *cs, struct zis_context *z);
 
+/// Pop all the frames. The stack can then be reused like a new one.
+void zis_callstack_clear(struct zis_callstack *cs);
+
+/// GC: visit the objects on the stack. See `zis_objmem_object_visitor_t`.
+void zis_callstack_gc_visit(struct zis_callstack *cs, enum zis_objmem_obj_visit_op op);
+
 /// Push a new frame.
 void zis_callstack_enter(struct zis_callstack *cs, size_t frame_size, void *caller_ip, struct zis_object **ret_val_reg);
 
@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "context.h"
+#include "debug.h"
 #include "fsutil.h"
 #include "globals.h"
 #include "memory.h"
@@ -31,17 +32,6 @@ static int sop_none_write(void *_data, const char *restrict data, size_t size) {
     return 0;
 }
 
-static void sop_none_close(void *data) {
-    zis_unused_var(data);
-}
-
-static const struct zis_stream_obj_operations sop_none = {
-    .seek  = sop_none_seek,
-    .read  = sop_none_read,
-    .write = sop_none_write,
-    .close = sop_none_close,
-};
-
 /* ----- stream backend: file ----------------------------------------------- */
 
 static void *sop_file_open(const zis_path_char_t *restrict path, int mode) {
@@ -55,79 +45,261 @@ static const struct zis_stream_obj_operations sop_file = {
     .close = zis_file_close,
 };
 
-/* ----- stream backend: immutable string ----------------------------------- */
+/* ----- stream backend: in-memory data ----------------------------------- */
 
-struct sop_str_state {
-    const char *current;
-    const char *data_ptr;
-    const char *data_end;
-    char        _data[];
-};
+// The data is used as the stream buffer directly (see `ZIS_STREAM_OBJ_DIRECT`).
+// The operation data is the memory block to free on closing, or NULL.
 
-static void *sop_str_alloc_state(size_t data_size) {
-    struct sop_str_state *state =
-        zis_mem_alloc(sizeof(struct sop_str_state) + data_size);
-    state->data_ptr = state->_data;
-    state->current  = state->data_ptr;
-    state->data_end = state->_data + data_size;
-    return state;
+static void sop_mem_close(void *_data) {
+    if (_data)
+        zis_mem_free(_data);
 }
 
-static void sop_str_use_state_for_static_str(
-    struct sop_str_state *restrict state, const char *restrict str, size_t sz
+static const struct zis_stream_obj_operations sop_mem = {
+    .seek  = sop_none_seek,
+    .read  = sop_none_read,
+    .write = sop_none_write,
+    .close = sop_mem_close,
+};
+
+/* ----- stream backend: memory-mapped file --------------------------------- */
+
+// The mapped file is used as the stream buffer directly (see `ZIS_STREAM_OBJ_DIRECT`),
+// but only a window of it is exposed at a time (see `stream_obj_mmap_move_window()`).
+// The operation data is a `struct sop_mmap_data`.
+
+struct sop_mmap_data {
+    zis_file_handle_t file;
+    char  *addr;
+    size_t size; // Size of the mapping.
+    size_t window_size;
+};
+
+static struct sop_mmap_data *sop_mmap_open(
+    const zis_path_char_t *restrict path, size_t min_size, size_t window_size
 ) {
-    state->data_ptr = str;
-    state->current  = str;
-    state->data_end = str + sz;
-}
-
-static zis_ssize_t sop_str_seek(void *_data, zis_ssize_t offset, int whence) {
-    struct sop_str_state *const restrict state = _data;
-    const char *new_cur;
-    switch (whence) {
-    case SEEK_SET:
-        new_cur = state->data_ptr;
-        break;
-    case SEEK_CUR:
-        new_cur = state->current;
-        break;
-    case SEEK_END:
-        new_cur = state->data_end;
-        break;
-    default:
+    zis_file_handle_t f = zis_file_open(path, ZIS_FILE_MODE_RD);
+    if (!f)
+        return NULL;
+    size_t size;
+    void *const addr = zis_file_map(f, min_size, &size);
+    if (!addr) {
+        zis_file_close(f);
+        return NULL;
+    }
+    struct sop_mmap_data *const data = zis_mem_alloc(sizeof(struct sop_mmap_data));
+    data->file = f;
+    data->addr = addr, data->size = size;
+    data->window_size = window_size;
+    return data;
+}
+
+/// Get the size of the file that can be read through the mapping now. The file
+/// may have been truncated or extended by others. A file that has grown is
+/// mapped again. Returns 0 if the size is unknown.
+static size_t sop_mmap_readable_size(struct sop_mmap_data *data) {
+    const zis_ssize_t file_size = zis_file_seek(data->file, 0, SEEK_END);
+    if (file_size < 0)
         return 0;
+    if ((size_t)file_size > data->size) {
+        size_t new_size;
+        void *const new_addr = zis_file_map(data->file, 0, &new_size);
+        if (new_addr) {
+            zis_file_unmap(data->addr, data->size);
+            data->addr = new_addr, data->size = new_size;
+        }
     }
-    new_cur += offset;
-    if (new_cur < state->data_ptr)
-        new_cur = state->data_ptr;
-    else if (new_cur > state->data_end)
-        new_cur = state->data_end;
-    state->current = new_cur;
-    return new_cur - state->data_ptr;
-}
-
-static size_t sop_str_read(void *_data, char *restrict buffer, size_t size) {
-    struct sop_str_state *const state = _data;
-    const size_t rest_size = (size_t)(state->data_end - state->current);
-    if (rest_size < size)
-        size = rest_size;
-    memcpy(buffer, state->current, size);
-    state->current += size;
-    return size;
+    return (size_t)file_size < data->size ? (size_t)file_size : data->size;
+}
+
+/// Check the position for `SEEK_SET` or `SEEK_END` against the current file size.
+/// `SEEK_CUR` is not supported, because the position is kept by the stream.
+static zis_ssize_t sop_mmap_seek(void *_data, zis_ssize_t offset, int whence) {
+    struct sop_mmap_data *const data = _data;
+    const zis_ssize_t size = (zis_ssize_t)sop_mmap_readable_size(data);
+    zis_ssize_t pos;
+    if (whence == SEEK_SET)
+        pos = offset;
+    else if (whence == SEEK_END)
+        pos = size + offset;
+    else
+        return -1;
+    if (pos < 0 || pos > size)
+        return -1;
+    return pos;
 }
 
-static void sop_str_close(void *_data) {
-    struct sop_str_state *const state = _data;
-    zis_mem_free(state);
+static void sop_mmap_close(void *_data) {
+    struct sop_mmap_data *const data = _data;
+    zis_file_unmap(data->addr, data->size);
+    zis_file_close(data->file);
+    zis_mem_free(data);
 }
 
-static const struct zis_stream_obj_operations sop_str = {
-    .seek  = sop_str_seek,
-    .read  = sop_str_read,
-    .write = NULL,
-    .close = sop_str_close,
+static const struct zis_stream_obj_operations sop_mmap = {
+    .seek  = sop_mmap_seek,
+    .read  = sop_none_read,
+    .write = sop_none_write,
+    .close = sop_mmap_close,
+};
+
+/* ----- stream buffer pool ------------------------------------------------- */
+
+/// Buffer size of the smallest pooled size class.
+#define STREAM_BUF_POOL_CLASS_MIN_SIZE  ZIS_STREAM_OBJ_BUF_SZ_MIN
+/// Number of pooled size classes. Sizes are powers of 2. Larger buffers are not pooled.
+#define STREAM_BUF_POOL_CLASS_COUNT     11 // 64 B ... 64 KiB
+/// Max number of free buffers kept in one size class.
+#define STREAM_BUF_POOL_CLASS_MAX_FREE  8
+
+static_assert(ZIS_STREAM_OBJ_BUF_SZ_MIN >= sizeof(void *), "");
+
+struct stream_buf_pool_free_node {
+    struct stream_buf_pool_free_node *next;
 };
 
+struct zis_stream_buf_pool {
+    struct stream_buf_pool_free_node *free_lists[STREAM_BUF_POOL_CLASS_COUNT];
+    unsigned int free_counts[STREAM_BUF_POOL_CLASS_COUNT];
+    struct zis_stream_obj **owners; // Streams that hold resources. Weak references.
+    size_t owner_count, owner_capacity;
+};
+
+/// Round the size up to a buffer size. Returns the pooled size class index
+/// through `class_index`, or `-1` if the size is not pooled.
+static size_t stream_buf_pool_size_class(size_t size, size_t *restrict class_index) {
+    size_t class_size = STREAM_BUF_POOL_CLASS_MIN_SIZE;
+    for (size_t i = 0; i < STREAM_BUF_POOL_CLASS_COUNT; i++, class_size <<= 1) {
+        if (size <= class_size) {
+            *class_index = i;
+            return class_size;
+        }
+    }
+    *class_index = (size_t)-1;
+    return size;
+}
+
+/// Allocate a buffer. `size` must be a value returned by `stream_buf_pool_size_class()`.
+static char *stream_buf_pool_alloc(
+    struct zis_stream_buf_pool *restrict pool, size_t size, size_t class_index
+) {
+    if (class_index != (size_t)-1) {
+        struct stream_buf_pool_free_node *const node = pool->free_lists[class_index];
+        if (node) {
+            pool->free_lists[class_index] = node->next;
+            pool->free_counts[class_index]--;
+            return (char *)node;
+        }
+    }
+    return zis_mem_alloc(size);
+}
+
+/// Return a buffer to the pool.
+static void stream_buf_pool_free(
+    struct zis_stream_buf_pool *restrict pool, char *buffer, size_t size
+) {
+    size_t class_index;
+    const size_t class_size = stream_buf_pool_size_class(size, &class_index);
+    if (
+        class_index != (size_t)-1 && class_size == size &&
+        pool->free_counts[class_index] < STREAM_BUF_POOL_CLASS_MAX_FREE
+    ) {
+        struct stream_buf_pool_free_node *const node = (void *)buffer;
+        node->next = pool->free_lists[class_index];
+        pool->free_lists[class_index] = node;
+        pool->free_counts[class_index]++;
+        return;
+    }
+    zis_mem_free(buffer);
+}
+
+/// Record a stream that holds a buffer or data.
+static void stream_buf_pool_add_owner(
+    struct zis_stream_buf_pool *restrict pool, struct zis_stream_obj *stream
+) {
+    assert(stream->_buf_pool_index == (size_t)-1);
+    if (pool->owner_count == pool->owner_capacity) {
+        const size_t new_cap = pool->owner_capacity ? pool->owner_capacity * 2 : 8;
+        pool->owners = zis_mem_realloc(pool->owners, new_cap * sizeof pool->owners[0]);
+        pool->owner_capacity = new_cap;
+    }
+    stream->_buf_pool_index = pool->owner_count;
+    pool->owners[pool->owner_count++] = stream;
+}
+
+/// Remove a stream recorded with `stream_buf_pool_add_owner()`.
+static void stream_buf_pool_remove_owner(
+    struct zis_stream_buf_pool *restrict pool, struct zis_stream_obj *stream
+) {
+    const size_t index = stream->_buf_pool_index;
+    assert(index < pool->owner_count && pool->owners[index] == stream);
+    struct zis_stream_obj *const last = pool->owners[--pool->owner_count];
+    pool->owners[index] = last;
+    last->_buf_pool_index = index;
+    stream->_buf_pool_index = (size_t)-1;
+}
+
+/// Free the buffer of a stream, or the in-memory data of a direct stream.
+/// Other resources (like open files) are kept.
+static void stream_buf_pool_release_resources(
+    struct zis_stream_buf_pool *restrict pool, struct zis_stream_obj *stream
+) {
+    if (stream->_flags & ZIS_STREAM_OBJ_DIRECT) {
+        if (stream->_ops_data)
+            stream->_ops->close(stream->_ops_data);
+    } else if (stream->_b_buf) {
+        stream_buf_pool_free(pool, stream->_b_buf, stream->_b_buf_size);
+    }
+}
+
+static void stream_buf_pool_wr_visitor(void *_pool, enum zis_objmem_weak_ref_visit_op op) {
+    struct zis_stream_buf_pool *const pool = _pool;
+
+    for (size_t i = 0; i < pool->owner_count; ) {
+        struct zis_stream_obj *const stream = pool->owners[i];
+        bool dead = false;
+
+#define WEAK_REF_FINI(the_obj)  (dead = true)
+        zis_objmem_visit_weak_ref(pool->owners[i], op);
+#undef WEAK_REF_FINI
+
+        if (zis_unlikely(dead)) {
+            zis_debug_log(TRACE, "Stream", "releasing buffer of unreachable stream %p", (void *)stream);
+            stream_buf_pool_release_resources(pool, stream);
+            stream_buf_pool_remove_owner(pool, stream);
+            continue; // The last one has been moved to index `i`.
+        }
+        i++;
+    }
+}
+
+struct zis_stream_buf_pool *zis_stream_buf_pool_create(struct zis_context *z) {
+    struct zis_stream_buf_pool *const pool = zis_mem_alloc(sizeof(struct zis_stream_buf_pool));
+    memset(pool, 0, sizeof *pool);
+    zis_objmem_register_weak_ref_collection(z, pool, stream_buf_pool_wr_visitor);
+    return pool;
+}
+
+void zis_stream_buf_pool_destroy(struct zis_stream_buf_pool *pool, struct zis_context *z) {
+    zis_objmem_unregister_weak_ref_collection(z, pool);
+    for (size_t i = 0; i < pool->owner_count; i++) {
+        struct zis_stream_obj *const stream = pool->owners[i];
+        stream_buf_pool_release_resources(pool, stream);
+        stream->_buf_pool_index = (size_t)-1;
+        stream->_b_buf = NULL, stream->_ops = NULL;
+    }
+    zis_mem_free(pool->owners);
+    for (size_t i = 0; i < STREAM_BUF_POOL_CLASS_COUNT; i++) {
+        struct stream_buf_pool_free_node *node = pool->free_lists[i];
+        while (node) {
+            struct stream_buf_pool_free_node *const next = node->next;
+            zis_mem_free(node);
+            node = next;
+        }
+    }
+    zis_mem_free(pool);
+}
+
 /* ----- stream object ------------------------------------------------------ */
 
 static void stream_obj_zero(struct zis_stream_obj *self) {
@@ -138,6 +310,8 @@ static void stream_obj_zero(struct zis_stream_obj *self) {
     self->_c_end = NULL;
     self->_c_cur = NULL;
     self->_b_cur = NULL;
+    self->_b_buf = NULL;
+    self->_b_buf_size = 0;
 }
 
 struct zis_stream_obj *zis_stream_obj_new(struct zis_context *z) {
@@ -146,41 +320,134 @@ struct zis_stream_obj *zis_stream_obj_new(struct zis_context *z) {
         struct zis_stream_obj
     );
     stream_obj_zero(self);
+    self->_buf_pool = z->stream_buf_pool;
+    self->_buf_pool_index = (size_t)-1;
     return self;
 }
 
+/// Set up the c-buffer pointers after the b-buffer is ready.
+static void stream_obj_init_c_buf(struct zis_stream_obj *self) {
+    if (self->_flags & ZIS_STREAM_OBJ_TEXT) {
+        if (self->_flags & ZIS_STREAM_OBJ_UTF8) {
+            self->_c_buf = self->_b_buf;
+            self->_c_cur = self->_b_cur;
+            self->_c_end = self->_b_end;
+        } else {
+            zis_context_panic(NULL, ZIS_CONTEXT_PANIC_IMPL);
+        }
+    }
+}
+
+/// Clamp the buffer size. See `zis_stream_obj_bind()`.
+static size_t stream_obj_buffer_size(size_t buffer_size) {
+    if (!buffer_size)
+        return ZIS_STREAM_OBJ_BUF_SZ;
+    if (buffer_size < ZIS_STREAM_OBJ_BUF_SZ_MIN)
+        return ZIS_STREAM_OBJ_BUF_SZ_MIN;
+    if (buffer_size > ZIS_STREAM_OBJ_BUF_SZ_MAX)
+        return ZIS_STREAM_OBJ_BUF_SZ_MAX;
+    return buffer_size;
+}
+
 void zis_stream_obj_bind(
     struct zis_stream_obj *self,
     const struct zis_stream_obj_operations *restrict ops,
     void *restrict ops_data,
-    int flags
+    int flags, size_t buffer_size /* = 0 */
 ) {
     if (self->_ops)
         zis_stream_obj_close(self);
 
+    assert(!(flags & ZIS_STREAM_OBJ_DIRECT));
     self->_flags = flags;
     self->_ops = ops;
     self->_ops_data = ops_data;
 
-    self->_b_end = zis_stream_obj_flag_readable(self) ? self->_b_buf : self->_b_buf + ZIS_STREAM_OBJ_BUF_SZ;
+    size_t class_index;
+    buffer_size = stream_buf_pool_size_class(stream_obj_buffer_size(buffer_size), &class_index);
+    self->_b_buf = stream_buf_pool_alloc(self->_buf_pool, buffer_size, class_index);
+    self->_b_buf_size = buffer_size;
+    stream_buf_pool_add_owner(self->_buf_pool, self);
+
+    self->_b_end = zis_stream_obj_flag_readable(self) ? self->_b_buf : self->_b_buf + buffer_size;
     self->_b_cur = self->_b_buf;
 
-    if (flags & ZIS_STREAM_OBJ_TEXT) {
-        if (flags & ZIS_STREAM_OBJ_UTF8) {
-            self->_c_buf = self->_b_buf;
-            self->_c_cur = self->_b_cur;
-            self->_c_end = self->_b_end;
-        } else {
-            zis_context_panic(NULL, ZIS_CONTEXT_PANIC_IMPL);
-        }
+    stream_obj_init_c_buf(self);
+}
+
+/// Bind the stream to in-memory data, which is used as the buffer directly.
+/// The `ops` shall be a backend that does nothing but releasing the data
+/// (`sop_mem` or `sop_mmap`). Nothing to release if `ops_data` is NULL.
+static void stream_obj_bind_direct(
+    struct zis_stream_obj *self,
+    const struct zis_stream_obj_operations *ops, void *ops_data,
+    const char *data, size_t data_size, int flags
+) {
+    if (self->_ops)
+        zis_stream_obj_close(self);
+
+    assert(!(flags & ZIS_STREAM_OBJ_MODE_OUT));
+    assert(ops == &sop_mem || ops == &sop_mmap);
+    self->_flags = flags | ZIS_STREAM_OBJ_DIRECT;
+    self->_ops = ops;
+    self->_ops_data = ops_data;
+
+    self->_b_buf = (char *)data;
+    self->_b_buf_size = data_size;
+    self->_b_end = self->_b_buf + data_size;
+    self->_b_cur = (flags & ZIS_STREAM_OBJ_TEXT) ? self->_b_end : self->_b_buf;
+    if (ops_data)
+        stream_buf_pool_add_owner(self->_buf_pool, self);
+
+    stream_obj_init_c_buf(self);
+    self->_c_cur = self->_c_buf;
+}
+
+/// Expose the window of a memory-mapped file stream (`sop_mmap`) that starts at
+/// offset `pos` as the buffer. The file size is checked first, so that a file
+/// truncated by others is not read beyond its new end (which raises SIGBUS on
+/// POSIX systems), and a file that has grown is read to its new end.
+static void stream_obj_mmap_move_window(struct zis_stream_obj *self, size_t pos) {
+    assert(self->_ops == &sop_mmap);
+    struct sop_mmap_data *const data = self->_ops_data;
+    const size_t size = sop_mmap_readable_size(data);
+    if (pos > size)
+        pos = size;
+    const size_t end = size - pos > data->window_size ? pos + data->window_size : size;
+
+    self->_b_buf = data->addr;
+    self->_b_buf_size = data->size;
+    self->_b_end = self->_b_buf + end;
+    if (self->_flags & ZIS_STREAM_OBJ_TEXT) {
+        self->_b_cur = self->_b_end;
+        stream_obj_init_c_buf(self);
+        self->_c_cur = self->_c_buf + pos;
+    } else {
+        self->_b_cur = self->_b_buf + pos;
     }
 }
 
 struct zis_stream_obj *zis_stream_obj_new_file(
     struct zis_context *z,
-    const zis_path_char_t *restrict file, int flags
+    const zis_path_char_t *restrict file, int flags, size_t buffer_size /* = 0 */
 ) {
     struct zis_stream_obj *self = zis_stream_obj_new(z);
+
+    // A read-only regular file that does not fit in the buffer can be mapped into
+    // memory, so that the data is read without copying. The buffer size is used
+    // as the window size (see `stream_obj_mmap_move_window()`).
+    const bool try_mmap = (flags & ZIS_STREAM_OBJ_MMAP) && !(flags & ZIS_STREAM_OBJ_MODE_OUT);
+    flags &= ~ZIS_STREAM_OBJ_MMAP;
+    if (try_mmap) {
+        const size_t window_size = stream_obj_buffer_size(buffer_size);
+        struct sop_mmap_data *const mmap_data = sop_mmap_open(file, window_size + 1, window_size);
+        if (mmap_data) {
+            stream_obj_bind_direct(self, &sop_mmap, mmap_data, mmap_data->addr, mmap_data->size, flags);
+            stream_obj_mmap_move_window(self, 0);
+            return self;
+        }
+    }
+
     void *data = sop_file_open(file, flags & ZIS_STREAM_OBJ_MODE_MASK);
     if (!data) {
         struct zis_path_obj *path_obj = zis_path_obj_new(z, file, (size_t)-1);
@@ -191,16 +458,16 @@ struct zis_stream_obj *zis_stream_obj_new_file(
         zis_context_set_reg0(z, zis_object_from(exc));
         return NULL;
     }
-    zis_stream_obj_bind(self, &sop_file, data, flags);
+    zis_stream_obj_bind(self, &sop_file, data, flags, buffer_size);
     return self;
 }
 
 struct zis_stream_obj *zis_stream_obj_new_file_native(
     struct zis_context *z,
-    zis_file_handle_t file, int flags
+    zis_file_handle_t file, int flags, size_t buffer_size /* = 0 */
 ) {
     struct zis_stream_obj *self = zis_stream_obj_new(z);
-    zis_stream_obj_bind(self, &sop_file, file, flags);
+    zis_stream_obj_bind(self, &sop_file, file, flags, buffer_size);
     return self;
 }
 
@@ -212,22 +479,12 @@ struct zis_stream_obj *zis_stream_obj_new_str(
         string_size = strlen(string);
     struct zis_stream_obj *self = zis_stream_obj_new(z);
     const int flags = ZIS_STREAM_OBJ_MODE_IN | ZIS_STREAM_OBJ_TEXT | ZIS_STREAM_OBJ_UTF8;
-    if (string_size <= ZIS_STREAM_OBJ_BUF_SZ) {
-        struct sop_str_state dummy_state;
-        sop_str_use_state_for_static_str(&dummy_state, string, string_size);
-        zis_stream_obj_bind(self, &sop_str, &dummy_state, flags);
-        zis_stream_obj_peek_char(self);
-        self->_ops = &sop_none, self->_ops_data = NULL;
+    if (static_string) {
+        stream_obj_bind_direct(self, &sop_mem, NULL, string, string_size, flags);
     } else {
-        struct sop_str_state *state;
-        if (static_string) {
-            state = sop_str_alloc_state(0);
-            sop_str_use_state_for_static_str(state, string, string_size);
-        } else {
-            state = sop_str_alloc_state(string_size);
-            memcpy(state->_data, string, string_size);
-        }
-        zis_stream_obj_bind(self, &sop_str, state, flags);
+        char *const data = zis_mem_alloc(string_size ? string_size : 1);
+        memcpy(data, string, string_size);
+        stream_obj_bind_direct(self, &sop_mem, data, data, string_size, flags);
     }
     return self;
 }
@@ -235,29 +492,82 @@ struct zis_stream_obj *zis_stream_obj_new_str(
 struct zis_stream_obj *zis_stream_obj_new_strob(
     struct zis_context *z, struct zis_string_obj *str_obj
 ) {
+    // The string object may be moved by the GC, and its representation may
+    // not be UTF-8. So the characters are converted into a separate block.
     const size_t data_size = zis_string_obj_to_u8str(str_obj, NULL, 0);
-    struct sop_str_state *state = sop_str_alloc_state(data_size);
-    const size_t n = zis_string_obj_to_u8str(str_obj, state->_data, data_size);
+    char *const data = zis_mem_alloc(data_size ? data_size : 1);
+    const size_t n = zis_string_obj_to_u8str(str_obj, data, data_size);
     assert(n == data_size), zis_unused_var(n);
     struct zis_stream_obj *self = zis_stream_obj_new(z);
     const int flags = ZIS_STREAM_OBJ_MODE_IN | ZIS_STREAM_OBJ_TEXT | ZIS_STREAM_OBJ_UTF8;
-    zis_stream_obj_bind(self, &sop_str, state, flags);
+    stream_obj_bind_direct(self, &sop_mem, data, data, data_size, flags);
     return self;
 }
 
 void zis_stream_obj_close(struct zis_stream_obj *self) {
-    if (self->_ops)
+    if (self->_ops) {
+        if (self->_buf_pool_index != (size_t)-1)
+            stream_buf_pool_remove_owner(self->_buf_pool, self);
+        if (self->_b_buf && !(self->_flags & ZIS_STREAM_OBJ_DIRECT))
+            stream_buf_pool_free(self->_buf_pool, self->_b_buf, self->_b_buf_size);
         self->_ops->close(self->_ops_data);
+    }
     stream_obj_zero(self);
 }
 
 #define assert_stream_valid(obj) \
     (assert(                     \
         obj->_ops &&             \
-        obj->_b_end >= obj->_b_buf && obj->_b_end <= &obj->_b_buf[ZIS_STREAM_OBJ_BUF_SZ] && \
+        obj->_b_end >= obj->_b_buf && obj->_b_end <= obj->_b_buf + obj->_b_buf_size && \
         obj->_b_cur >= obj->_b_buf && obj->_b_cur <= obj->_b_end                        \
     ))
 
+zis_ssize_t zis_stream_obj_seek(struct zis_stream_obj *self, zis_ssize_t offset, int whence) {
+    assert_stream_valid(self);
+    assert(zis_stream_obj_flag_readable(self));
+    assert(!zis_stream_obj_flag_text(self) || zis_stream_obj_flag_utf8(self));
+
+    const char *const cur = zis_stream_obj_flag_text(self) ? self->_c_cur : self->_b_cur;
+
+    if (!(self->_flags & ZIS_STREAM_OBJ_DIRECT)) {
+        // The data left in the buffer is dropped.
+        if (whence == SEEK_CUR)
+            offset -= (zis_ssize_t)(self->_b_end - cur);
+        const zis_ssize_t pos = self->_ops->seek(self->_ops_data, offset, whence);
+        if (pos < 0)
+            return -1;
+        self->_b_end = self->_b_buf;
+        self->_b_cur = self->_b_buf;
+        stream_obj_init_c_buf(self);
+        return pos;
+    }
+
+    if (whence == SEEK_CUR) {
+        offset += (zis_ssize_t)(cur - self->_b_buf);
+        whence = SEEK_SET;
+    }
+
+    if (self->_ops == &sop_mmap) {
+        const zis_ssize_t pos = sop_mmap_seek(self->_ops_data, offset, whence);
+        if (pos < 0)
+            return -1;
+        stream_obj_mmap_move_window(self, (size_t)pos);
+        return pos;
+    }
+
+    assert(self->_b_end == self->_b_buf + self->_b_buf_size);
+    const zis_ssize_t size = (zis_ssize_t)self->_b_buf_size;
+    const zis_ssize_t pos =
+        whence == SEEK_SET ? offset : whence == SEEK_END ? size + offset : -1;
+    if (pos < 0 || pos > size)
+        return -1;
+    if (zis_stream_obj_flag_text(self))
+        self->_c_cur = self->_c_buf + pos;
+    else
+        self->_b_cur = self->_b_buf + pos;
+    return pos;
+}
+
 size_t zis_stream_obj_read_bytes(
     struct zis_stream_obj *restrict self,
     void *restrict buffer, size_t size
@@ -278,6 +588,22 @@ size_t zis_stream_obj_read_bytes(
         size -= rest_size;
         self->_b_cur = self->_b_end;
     }
+    if (self->_ops == &sop_mmap) {
+        size_t n = rest_size;
+        while (size) {
+            stream_obj_mmap_move_window(self, (size_t)(self->_b_cur - self->_b_buf));
+            const size_t window_rest_size = (size_t)(self->_b_end - self->_b_cur);
+            if (!window_rest_size)
+                break;
+            const size_t copy_size = window_rest_size < size ? window_rest_size : size;
+            memcpy(buffer, self->_b_cur, copy_size);
+            buffer = (char *)buffer + copy_size;
+            size -= copy_size;
+            self->_b_cur += copy_size;
+            n += copy_size;
+        }
+        return n;
+    }
     const size_t newly_read_size = self->_ops->read(self->_ops_data, buffer, size);
     if (zis_unlikely(newly_read_size == (size_t)-1))
         return rest_size ? rest_size : (size_t)-1;
@@ -304,7 +630,7 @@ bool zis_stream_obj_write_bytes(
         size -= rest_size;
         // self->_b_cur = self->_b_end;
     }
-    if (self->_ops->write(self->_ops_data, self->_b_buf, ZIS_STREAM_OBJ_BUF_SZ) != 0)
+    if (self->_ops->write(self->_ops_data, self->_b_buf, self->_b_buf_size) != 0)
         return false;
     self->_b_cur = self->_b_buf;
     if (self->_ops->write(self->_ops_data, data, size) != 0)
@@ -318,7 +644,7 @@ bool zis_stream_obj_flush_chars(struct zis_stream_obj *restrict self) {
 
     if (zis_stream_obj_flag_utf8(self)) {
         assert(self->_b_buf == self->_c_buf && self->_b_end == self->_c_end);
-        assert(self->_b_cur == self->_b_buf && self->_b_end == self->_b_buf + ZIS_STREAM_OBJ_BUF_SZ);
+        assert(self->_b_cur == self->_b_buf && self->_b_end == self->_b_buf + self->_b_buf_size);
         const size_t size = (size_t)(self->_c_cur - self->_c_buf);
         const int r = self->_ops->write(self->_ops_data, self->_c_buf, size);
         if (r != 0)
@@ -337,7 +663,9 @@ static int32_t _stream_obj_peek_char_slow_impl(
     assert_stream_valid(self);
     assert(zis_stream_obj_flag_readable(self) && zis_stream_obj_flag_text(self));
 
-    if (self->_c_cur + 4 >= self->_c_end) {
+    if (self->_c_cur + 4 >= self->_c_end && self->_ops == &sop_mmap) {
+        stream_obj_mmap_move_window(self, (size_t)(self->_c_cur - self->_c_buf));
+    } else if (self->_c_cur + 4 >= self->_c_end && !(self->_flags & ZIS_STREAM_OBJ_DIRECT)) {
         if (zis_stream_obj_flag_utf8(self)) {
             assert(self->_b_buf == self->_c_buf && self->_b_end == self->_c_end);
             assert(self->_c_cur <= self->_b_cur);
@@ -346,7 +674,7 @@ static int32_t _stream_obj_peek_char_slow_impl(
                 memmove(self->_b_buf, self->_c_cur, rest_size);
             const size_t n = self->_ops->read(
                 self->_ops_data, self->_b_buf + rest_size,
-                ZIS_STREAM_OBJ_BUF_SZ - rest_size
+                self->_b_buf_size - rest_size
             );
             if (n == (size_t)-1) {
                 if (char_len)
@@ -362,6 +690,14 @@ static int32_t _stream_obj_peek_char_slow_impl(
         }
     }
 
+    // A direct stream is not refilled, and its buffer (or the window of a mapped
+    // file) ends right at `_c_end`.
+    if (zis_unlikely(self->_c_cur >= self->_c_end)) {
+        if (char_len)
+            *char_len = 0;
+        return -1;
+    }
+
     zis_wchar_t c;
     if (
         *self->_c_cur == '\r' && zis_stream_obj_flag_crlf(self) &&
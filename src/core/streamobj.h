@@ -12,11 +12,29 @@
 struct zis_context;
 struct zis_string_obj;
 
+/* ----- stream buffer pool ------------------------------------------------- */
+
+/// Stream buffer pool. Buffers of streams are allocated outside the GC heap and
+/// are reused. Buffers of unreachable streams are returned to the pool by the GC.
+struct zis_stream_buf_pool;
+
+/// Create a stream buffer pool.
+struct zis_stream_buf_pool *zis_stream_buf_pool_create(struct zis_context *z);
+
+/// Delete a stream buffer pool, freeing all the buffers including the ones in use.
+void zis_stream_buf_pool_destroy(struct zis_stream_buf_pool *pool, struct zis_context *z);
+
 /* ----- stream object ------------------------------------------------------ */
 
-/// Stream buffer size.
+/// Default stream buffer size.
 #define ZIS_STREAM_OBJ_BUF_SZ BUFSIZ
 
+/// Minimum stream buffer size.
+#define ZIS_STREAM_OBJ_BUF_SZ_MIN 64
+
+/// Maximum stream buffer size.
+#define ZIS_STREAM_OBJ_BUF_SZ_MAX (16 * 1024 * 1024)
+
 /// The `Stream` object. A byte or text stream.
 /// A stream is either read-only or write-only.
 /// This object will not be moved by the GC system.
@@ -29,7 +47,10 @@ struct zis_stream_obj {
     void *_ops_data;
     char *_c_buf, *_c_end, *_c_cur; // Characters: buffer, buffer-end, current.
     char *_b_end, *_b_cur; // Bytes (raw data): buffer-end, current.
-    char _b_buf[ZIS_STREAM_OBJ_BUF_SZ];
+    char *_b_buf; // Bytes buffer, from the buffer pool; or the data itself if `ZIS_STREAM_OBJ_DIRECT`.
+    size_t _b_buf_size;
+    struct zis_stream_buf_pool *_buf_pool;
+    size_t _buf_pool_index; // Index in the owner list of the pool, or -1.
 };
 
 /// Stream operation functions. See `zis_file_*()` functions.
@@ -48,31 +69,44 @@ struct zis_stream_obj_operations {
 #define ZIS_STREAM_OBJ_TEXT       0x10  ///< Open stream in text mode. Binary otherwise.
 #define ZIS_STREAM_OBJ_CRLF       0x20  ///< Use CRLF as the end of line. LF otherwise.
 #define ZIS_STREAM_OBJ_UTF8       0x40  ///< The backend uses UTF-8 encoding.
+#define ZIS_STREAM_OBJ_DIRECT     0x80  ///< (Internal) The buffer holds the whole input data. Nothing to read from the backend.
+#define ZIS_STREAM_OBJ_MMAP       0x100 ///< Map the file into memory if possible. See `zis_stream_obj_new_file()`.
 
 /// Create an empty `Stream` object without a backend bound.
 struct zis_stream_obj *zis_stream_obj_new(struct zis_context *z);
 
-/// Bind the stream to a backend.
+/// Bind the stream to a backend. Assign `buffer_size = 0` to use the default
+/// buffer size. The buffer size is clamped to
+/// [`ZIS_STREAM_OBJ_BUF_SZ_MIN`, `ZIS_STREAM_OBJ_BUF_SZ_MAX`].
 void zis_stream_obj_bind(
     struct zis_stream_obj *self,
     const struct zis_stream_obj_operations *restrict ops,
     void *restrict ops_data,
-    int flags
+    int flags, size_t buffer_size /* = 0 */
 );
 
 /// Open a file. On failure, throws an exception (REG-0) and returns NULL.
+/// See `zis_stream_obj_bind()` for `buffer_size`. With flag `ZIS_STREAM_OBJ_MMAP`,
+/// a read-only regular file larger than the buffer is mapped into memory and read
+/// directly, one buffer-sized window at a time. The file size is checked before
+/// moving to the next window, so a file that is truncated or extended by others
+/// is read to its current end; truncating the part in the current window still
+/// raises SIGBUS on POSIX systems (see `zis_file_map()`).
 struct zis_stream_obj *zis_stream_obj_new_file(
     struct zis_context *z,
-    const zis_path_char_t *restrict file, int flags
+    const zis_path_char_t *restrict file, int flags, size_t buffer_size /* = 0 */
 );
 
 /// Open a stream associated with a file.
+/// See `zis_stream_obj_bind()` for `buffer_size`.
 struct zis_stream_obj *zis_stream_obj_new_file_native(
     struct zis_context *z,
-    zis_file_handle_t file, int flags
+    zis_file_handle_t file, int flags, size_t buffer_size /* = 0 */
 );
 
 /// Open a read-only stream for string reading. `string_size` can be -1.
+/// The characters are read from the string directly. A non-static string is
+/// copied once; a static string is not copied at all.
 struct zis_stream_obj *zis_stream_obj_new_str(
     struct zis_context *z,
     const char *restrict string, size_t string_size, bool static_string
@@ -86,6 +120,10 @@ struct zis_stream_obj *zis_stream_obj_new_strob(
 /// Close a stream.
 void zis_stream_obj_close(struct zis_stream_obj *self);
 
+/// Set the position of a readable stream, like `fseek()`. Data left in the buffer
+/// is dropped. Returns the new position, or -1 on failure.
+zis_ssize_t zis_stream_obj_seek(struct zis_stream_obj *self, zis_ssize_t offset, int whence);
+
 zis_static_force_inline bool zis_stream_obj_flag_readable(const struct zis_stream_obj *self) {
     return !(self->_flags & ZIS_STREAM_OBJ_MODE_OUT);
 }
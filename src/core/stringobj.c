@@ -504,11 +504,15 @@ bool zis_string_obj_equals(struct zis_string_obj *lhs, struct zis_string_obj *rh
     return memcmp(string_obj_as_u8str(lhs), string_obj_as_u8str(rhs), lhs_size) == 0;
 }
 
+size_t zis_string_obj_hash(struct zis_string_obj *self) {
+    return zis_hash_bytes(string_obj_as_u8str(self), string_obj_size(self));
+}
+
 int zis_string_obj_compare(struct zis_string_obj *lhs, struct zis_string_obj *rhs) {
     const size_t lhs_size = string_obj_size(lhs), rhs_size = string_obj_size(rhs);
     if (lhs_size <= rhs_size) {
         const int x = memcmp(string_obj_as_u8str(lhs), string_obj_as_u8str(rhs), lhs_size);
-        return x != 0 ? x : -1;
+        return x != 0 || lhs_size == rhs_size ? x : -1;
     } else {
         const int x = memcmp(string_obj_as_u8str(lhs), string_obj_as_u8str(rhs), rhs_size);
         return x != 0 ? x : 1;
@@ -715,7 +719,7 @@ ZIS_NATIVE_FUNC_DEF(T_String_M_hash, z, {1, 0, 1}) {
     assert_arg1_String(z);
     struct zis_object **frame = z->callstack->frame;
     struct zis_string_obj *self = zis_object_cast(frame[1], struct zis_string_obj);
-    const size_t h = zis_hash_bytes(string_obj_as_u8str(self), string_obj_size(self));
+    const size_t h = zis_string_obj_hash(self);
     frame[0] = zis_smallint_to_ptr((zis_smallint_t)h);
     return ZIS_OK;
 }
@@ -110,6 +110,9 @@ struct zis_string_obj *zis_string_obj_concat2(
 /// Compare two strings.
 bool zis_string_obj_equals(struct zis_string_obj *lhs, struct zis_string_obj *rhs);
 
+/// Generate hash code, the same as `String:hash()` but not truncated.
+size_t zis_string_obj_hash(struct zis_string_obj *self);
+
 /// Compare two strings.
 int zis_string_obj_compare(struct zis_string_obj *lhs, struct zis_string_obj *rhs);
 
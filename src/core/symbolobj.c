@@ -404,3 +404,10 @@ struct zis_symbol_obj *zis_symbol_registry_find(
         n = strlen(s);
     return symbol_registry_find(sr, s, n);
 }
+
+void zis_symbol_registry_add(struct zis_context *z, struct zis_symbol_obj *sym) {
+    struct zis_symbol_registry *const sr = z->symbol_registry;
+    assert(!symbol_registry_find(sr, sym->data, zis_symbol_obj_data_size(sym)));
+    sym->_registry_next = NULL;
+    symbol_registry_add(sr, sym);
+}
@@ -74,3 +74,7 @@ struct zis_symbol_obj *zis_symbol_registry_find(
     struct zis_context *z,
     const char *s, size_t n /* = -1 */
 );
+
+/// Add an existing `Symbol` object that is not in the registry, like a symbol
+/// restored from a heap snapshot. Its string must not have been registered.
+void zis_symbol_registry_add(struct zis_context *z, struct zis_symbol_obj *sym);
@@ -0,0 +1,1268 @@
+#include "typedarrayobj.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "context.h"
+#include "globals.h"
+#include "ndefutil.h"
+#include "objmem.h"
+#include "stack.h"
+
+#include "arrayobj.h"
+#include "bytesobj.h"
+#include "exceptobj.h"
+#include "floatobj.h"
+#include "intobj.h"
+#include "stringobj.h"
+
+#include "zis_config.h" // ZIS_USE_GNUC_TARGET_CLONES
+
+#define TYPED_ARRAY_OBJ_BYTES_FIXED_SIZE \
+    ZIS_NATIVE_TYPE_STRUCT_XB_FIXED_SIZE(struct zis_typed_array_obj, _bytes_size)
+
+static const unsigned char typed_array_elem_sizes[] = {
+    [ZIS_TYPED_ARRAY_I64] = sizeof(int64_t),
+    [ZIS_TYPED_ARRAY_F64] = sizeof(double),
+    [ZIS_TYPED_ARRAY_F32] = sizeof(float),
+    [ZIS_TYPED_ARRAY_U8 ] = sizeof(uint8_t),
+};
+
+static const char *const typed_array_type_names[] = {
+    [ZIS_TYPED_ARRAY_I64] = "Int64Array",
+    [ZIS_TYPED_ARRAY_F64] = "Float64Array",
+    [ZIS_TYPED_ARRAY_F32] = "Float32Array",
+    [ZIS_TYPED_ARRAY_U8 ] = "UInt8Array",
+};
+
+static struct zis_type_obj *typed_array_kind_type(
+    struct zis_context *z, enum zis_typed_array_kind kind
+) {
+    struct zis_context_globals *g = z->globals;
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        return g->type_Int64Array;
+    case ZIS_TYPED_ARRAY_F64:
+        return g->type_Float64Array;
+    case ZIS_TYPED_ARRAY_F32:
+        return g->type_Float32Array;
+    case ZIS_TYPED_ARRAY_U8:
+        return g->type_UInt8Array;
+    default:
+        zis_context_panic(z, ZIS_CONTEXT_PANIC_IMPL);
+    }
+}
+
+int zis_typed_array_kind_of(struct zis_context *z, struct zis_type_obj *type) {
+    struct zis_context_globals *g = z->globals;
+    if (type == g->type_Float64Array)
+        return ZIS_TYPED_ARRAY_F64;
+    if (type == g->type_Int64Array)
+        return ZIS_TYPED_ARRAY_I64;
+    if (type == g->type_UInt8Array)
+        return ZIS_TYPED_ARRAY_U8;
+    if (type == g->type_Float32Array)
+        return ZIS_TYPED_ARRAY_F32;
+    return -1;
+}
+
+size_t zis_typed_array_kind_elem_size(enum zis_typed_array_kind kind) {
+    assert((unsigned)kind < sizeof typed_array_elem_sizes);
+    return typed_array_elem_sizes[kind];
+}
+
+/// Maximum number of elements. Half of the address space leaves room for the
+/// object head and the rounding in `zis_objmem_alloc_ex()`.
+static size_t typed_array_kind_length_max(enum zis_typed_array_kind kind) {
+    return (SIZE_MAX / 2 - TYPED_ARRAY_OBJ_BYTES_FIXED_SIZE) / zis_typed_array_kind_elem_size(kind);
+}
+
+struct zis_typed_array_obj *zis_typed_array_obj_new(
+    struct zis_context *z, enum zis_typed_array_kind kind,
+    const void *restrict data, size_t length
+) {
+    if (zis_unlikely(length > typed_array_kind_length_max(kind)))
+        return NULL;
+    const size_t data_size = length * zis_typed_array_kind_elem_size(kind);
+    struct zis_typed_array_obj *self = zis_object_cast(
+        zis_objmem_alloc_ex(
+            z, ZIS_OBJMEM_ALLOC_AUTO, typed_array_kind_type(z, kind),
+            0, TYPED_ARRAY_OBJ_BYTES_FIXED_SIZE + data_size
+        ),
+        struct zis_typed_array_obj
+    );
+    self->_length = length;
+    if (data)
+        memcpy(self->_data, data, data_size);
+    else
+        memset(self->_data, 0, data_size);
+    return self;
+}
+
+/* ----- kernels ------------------------------------------------------------ */
+
+// The kernels are plain loops, which compilers vectorize, with SSE2 on x86-64
+// by default. Where supported, each kernel is also compiled for AVX2, and the
+// better version is selected when the library is loaded.
+// Reductions keep 8 partial results, so that the floating-point results do
+// not depend on which version is selected.
+
+#if ZIS_USE_GNUC_TARGET_CLONES
+#    define TYPED_ARRAY_KERNEL __attribute__((target_clones("avx2", "default")))
+#else
+#    define TYPED_ARRAY_KERNEL
+#endif
+
+#define TYPED_ARRAY_LANES 8
+
+enum typed_array_op {
+    TYPED_ARRAY_OP_ADD,
+    TYPED_ARRAY_OP_SUB,
+    TYPED_ARRAY_OP_MUL,
+    TYPED_ARRAY_OP_DIV, // Float arrays only.
+    TYPED_ARRAY_OP_LT,
+    TYPED_ARRAY_OP_LE,
+    TYPED_ARRAY_OP_GT,
+    TYPED_ARRAY_OP_GE,
+    TYPED_ARRAY_OP_EQ,
+    TYPED_ARRAY_OP_NE,
+};
+
+#define TYPED_ARRAY_MAP(EXPR) \
+    do { for (size_t i = 0; i < n; i++) r[i] = (EXPR); } while (0)
+
+/// Define kernels for element type `T`. Arithmetic is done in type `U`
+/// (unsigned for integers, so that it wraps around). Sums are accumulated
+/// in type `A`.
+#define TYPED_ARRAY_DEF_KERNELS(SFX, T, U, A) \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_arith_##SFX(                       \
+    T *r, const T *a, const T *b, size_t n, enum typed_array_op op            \
+) {                                                                           \
+    switch (op) {                                                             \
+    case TYPED_ARRAY_OP_ADD: TYPED_ARRAY_MAP((T)((U)a[i] + (U)b[i])); break;  \
+    case TYPED_ARRAY_OP_SUB: TYPED_ARRAY_MAP((T)((U)a[i] - (U)b[i])); break;  \
+    case TYPED_ARRAY_OP_MUL: TYPED_ARRAY_MAP((T)((U)a[i] * (U)b[i])); break;  \
+    default: assert(0); break;                                                \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_arith_s_##SFX(                     \
+    T *r, const T *a, T b, size_t n, enum typed_array_op op                   \
+) {                                                                           \
+    switch (op) {                                                             \
+    case TYPED_ARRAY_OP_ADD: TYPED_ARRAY_MAP((T)((U)a[i] + (U)b)); break;     \
+    case TYPED_ARRAY_OP_SUB: TYPED_ARRAY_MAP((T)((U)a[i] - (U)b)); break;     \
+    case TYPED_ARRAY_OP_MUL: TYPED_ARRAY_MAP((T)((U)a[i] * (U)b)); break;     \
+    default: assert(0); break;                                                \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_cmp_##SFX(                         \
+    uint8_t *restrict r, const T *restrict a, const T *restrict b,            \
+    size_t n, enum typed_array_op op                                          \
+) {                                                                           \
+    switch (op) {                                                             \
+    case TYPED_ARRAY_OP_LT: TYPED_ARRAY_MAP(a[i] <  b[i]); break;             \
+    case TYPED_ARRAY_OP_LE: TYPED_ARRAY_MAP(a[i] <= b[i]); break;             \
+    case TYPED_ARRAY_OP_GT: TYPED_ARRAY_MAP(a[i] >  b[i]); break;             \
+    case TYPED_ARRAY_OP_GE: TYPED_ARRAY_MAP(a[i] >= b[i]); break;             \
+    case TYPED_ARRAY_OP_EQ: TYPED_ARRAY_MAP(a[i] == b[i]); break;             \
+    case TYPED_ARRAY_OP_NE: TYPED_ARRAY_MAP(a[i] != b[i]); break;             \
+    default: assert(0); break;                                                \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_cmp_s_##SFX(                       \
+    uint8_t *restrict r, const T *restrict a, T b,                            \
+    size_t n, enum typed_array_op op                                          \
+) {                                                                           \
+    switch (op) {                                                             \
+    case TYPED_ARRAY_OP_LT: TYPED_ARRAY_MAP(a[i] <  b); break;                \
+    case TYPED_ARRAY_OP_LE: TYPED_ARRAY_MAP(a[i] <= b); break;                \
+    case TYPED_ARRAY_OP_GT: TYPED_ARRAY_MAP(a[i] >  b); break;                \
+    case TYPED_ARRAY_OP_GE: TYPED_ARRAY_MAP(a[i] >= b); break;                \
+    case TYPED_ARRAY_OP_EQ: TYPED_ARRAY_MAP(a[i] == b); break;                \
+    case TYPED_ARRAY_OP_NE: TYPED_ARRAY_MAP(a[i] != b); break;                \
+    default: assert(0); break;                                                \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_fill_##SFX(                        \
+    T *restrict r, T v, size_t n                                              \
+) {                                                                           \
+    TYPED_ARRAY_MAP(v);                                                       \
+}                                                                             \
+                                                                              \
+TYPED_ARRAY_KERNEL static A typed_array_sum_##SFX(                            \
+    const T *restrict a, size_t n                                             \
+) {                                                                           \
+    A acc[TYPED_ARRAY_LANES] = { 0 };                                         \
+    size_t i = 0;                                                             \
+    for (; i + TYPED_ARRAY_LANES <= n; i += TYPED_ARRAY_LANES) {              \
+        for (size_t j = 0; j < TYPED_ARRAY_LANES; j++)                        \
+            acc[j] += (A)a[i + j];                                            \
+    }                                                                         \
+    for (size_t j = 0; i < n; i++, j++)                                       \
+        acc[j] += (A)a[i];                                                    \
+    A s = 0;                                                                  \
+    for (size_t j = 0; j < TYPED_ARRAY_LANES; j++)                            \
+        s += acc[j];                                                          \
+    return s;                                                                 \
+}                                                                             \
+                                                                              \
+TYPED_ARRAY_KERNEL static A typed_array_dot_##SFX(                            \
+    const T *restrict a, const T *restrict b, size_t n                        \
+) {                                                                           \
+    A acc[TYPED_ARRAY_LANES] = { 0 };                                         \
+    size_t i = 0;                                                             \
+    for (; i + TYPED_ARRAY_LANES <= n; i += TYPED_ARRAY_LANES) {              \
+        for (size_t j = 0; j < TYPED_ARRAY_LANES; j++)                        \
+            acc[j] += (A)a[i + j] * (A)b[i + j];                              \
+    }                                                                         \
+    for (size_t j = 0; i < n; i++, j++)                                       \
+        acc[j] += (A)a[i] * (A)b[i];                                          \
+    A s = 0;                                                                  \
+    for (size_t j = 0; j < TYPED_ARRAY_LANES; j++)                            \
+        s += acc[j];                                                          \
+    return s;                                                                 \
+}                                                                             \
+                                                                              \
+/* Returns false if there is a NaN. `n` must not be 0. */                     \
+TYPED_ARRAY_KERNEL static bool typed_array_min_max_##SFX(                     \
+    const T *restrict a, size_t n, T *restrict min_p, T *restrict max_p       \
+) {                                                                           \
+    T mn[TYPED_ARRAY_LANES], mx[TYPED_ARRAY_LANES];                           \
+    bool nan[TYPED_ARRAY_LANES];                                              \
+    for (size_t j = 0; j < TYPED_ARRAY_LANES; j++)                            \
+        mn[j] = a[0], mx[j] = a[0], nan[j] = false;                           \
+    size_t i = 0;                                                             \
+    for (; i + TYPED_ARRAY_LANES <= n; i += TYPED_ARRAY_LANES) {              \
+        for (size_t j = 0; j < TYPED_ARRAY_LANES; j++) {                      \
+            const T x = a[i + j];                                             \
+            mn[j] = x < mn[j] ? x : mn[j];                                    \
+            mx[j] = x > mx[j] ? x : mx[j];                                    \
+            nan[j] |= x != x;                                                 \
+        }                                                                     \
+    }                                                                         \
+    for (size_t j = 0; i < n; i++, j++) {                                     \
+        const T x = a[i];                                                     \
+        mn[j] = x < mn[j] ? x : mn[j];                                        \
+        mx[j] = x > mx[j] ? x : mx[j];                                        \
+        nan[j] |= x != x;                                                     \
+    }                                                                         \
+    T min = mn[0], max = mx[0];                                               \
+    bool has_nan = false;                                                     \
+    for (size_t j = 0; j < TYPED_ARRAY_LANES; j++) {                          \
+        min = mn[j] < min ? mn[j] : min;                                      \
+        max = mx[j] > max ? mx[j] : max;                                      \
+        has_nan |= nan[j];                                                    \
+    }                                                                         \
+    *min_p = min, *max_p = max;                                               \
+    return !has_nan;                                                          \
+}                                                                             \
+// ^^^ TYPED_ARRAY_DEF_KERNELS() ^^^
+
+TYPED_ARRAY_DEF_KERNELS(i64, int64_t, uint64_t, uint64_t)
+TYPED_ARRAY_DEF_KERNELS(f64, double , double  , double  )
+TYPED_ARRAY_DEF_KERNELS(f32, float  , float   , double  )
+TYPED_ARRAY_DEF_KERNELS(u8 , uint8_t, unsigned, uint64_t)
+
+/// Division of float arrays, which gives an array of the same type.
+#define TYPED_ARRAY_DEF_DIV_KERNELS(SFX, T) \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_div_##SFX(                         \
+    T *r, const T *a, const T *b, size_t n                                    \
+) {                                                                           \
+    TYPED_ARRAY_MAP(a[i] / b[i]);                                             \
+}                                                                             \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_div_s_##SFX(                       \
+    T *r, const T *a, T b, size_t n                                           \
+) {                                                                           \
+    TYPED_ARRAY_MAP(a[i] / b);                                                \
+}                                                                             \
+// ^^^ TYPED_ARRAY_DEF_DIV_KERNELS() ^^^
+
+TYPED_ARRAY_DEF_DIV_KERNELS(f64, double)
+TYPED_ARRAY_DEF_DIV_KERNELS(f32, float )
+
+/// Division of integer arrays, which gives an array of doubles.
+#define TYPED_ARRAY_DEF_FDIV_KERNELS(SFX, T) \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_fdiv_##SFX(                        \
+    double *restrict r, const T *restrict a, const T *restrict b, size_t n    \
+) {                                                                           \
+    TYPED_ARRAY_MAP((double)a[i] / (double)b[i]);                             \
+}                                                                             \
+                                                                              \
+TYPED_ARRAY_KERNEL static void typed_array_fdiv_s_##SFX(                      \
+    double *restrict r, const T *restrict a, double b, size_t n               \
+) {                                                                           \
+    TYPED_ARRAY_MAP((double)a[i] / b);                                        \
+}                                                                             \
+// ^^^ TYPED_ARRAY_DEF_FDIV_KERNELS() ^^^
+
+TYPED_ARRAY_DEF_FDIV_KERNELS(i64, int64_t)
+TYPED_ARRAY_DEF_FDIV_KERNELS(u8 , uint8_t)
+
+#undef TYPED_ARRAY_DEF_KERNELS
+#undef TYPED_ARRAY_DEF_DIV_KERNELS
+#undef TYPED_ARRAY_DEF_FDIV_KERNELS
+#undef TYPED_ARRAY_MAP
+
+/* ----- elements ----------------------------------------------------------- */
+
+/// A value of an element.
+union typed_array_scalar {
+    int64_t  i64;
+    double   f64;
+    float    f32;
+    uint8_t  u8;
+};
+
+/// Convert an object to an element value. Returns NULL, or an exception on failure.
+static struct zis_exception_obj *typed_array_scalar_from_object(
+    struct zis_context *z, enum zis_typed_array_kind kind,
+    struct zis_object *obj, const char *arg_name,
+    union typed_array_scalar *restrict result
+) {
+    struct zis_context_globals *g = z->globals;
+
+    if (zis_object_is_smallint(obj)) {
+        const zis_smallint_t v = zis_smallint_from_ptr(obj);
+        switch (kind) {
+        case ZIS_TYPED_ARRAY_I64:
+            result->i64 = v;
+            return NULL;
+        case ZIS_TYPED_ARRAY_F64:
+            result->f64 = (double)v;
+            return NULL;
+        case ZIS_TYPED_ARRAY_F32:
+            result->f32 = (float)v;
+            return NULL;
+        case ZIS_TYPED_ARRAY_U8:
+            if (v < 0 || v > UINT8_MAX)
+                break;
+            result->u8 = (uint8_t)v;
+            return NULL;
+        }
+        return zis_exception_obj_format(z, "value", obj, "%s out of range", arg_name);
+    }
+
+    struct zis_type_obj *const type = zis_object_type(obj);
+    if (type == g->type_Float) {
+        const double v = zis_float_obj_value(zis_object_cast(obj, struct zis_float_obj));
+        switch (kind) {
+        case ZIS_TYPED_ARRAY_F64:
+            result->f64 = v;
+            return NULL;
+        case ZIS_TYPED_ARRAY_F32:
+            result->f32 = (float)v;
+            return NULL;
+        default:
+            break;
+        }
+    } else if (type == g->type_Int) {
+        struct zis_int_obj *const int_obj = zis_object_cast(obj, struct zis_int_obj);
+        switch (kind) {
+        case ZIS_TYPED_ARRAY_I64:
+            errno = 0;
+            result->i64 = zis_int_obj_value_i(int_obj);
+            if (errno == ERANGE)
+                break;
+            return NULL;
+        case ZIS_TYPED_ARRAY_F64:
+            result->f64 = zis_int_obj_value_f(int_obj);
+            return NULL;
+        case ZIS_TYPED_ARRAY_F32:
+            result->f32 = (float)zis_int_obj_value_f(int_obj);
+            return NULL;
+        case ZIS_TYPED_ARRAY_U8:
+            break;
+        }
+        return zis_exception_obj_format(z, "value", obj, "%s out of range", arg_name);
+    }
+    return zis_exception_obj_format_common(z, ZIS_EXC_FMT_WRONG_ARGUMENT_TYPE, arg_name, obj);
+}
+
+/// Convert an element value to an object.
+static struct zis_object *typed_array_scalar_to_object(
+    struct zis_context *z, enum zis_typed_array_kind kind,
+    const union typed_array_scalar *restrict value
+) {
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        return zis_int_obj_or_smallint(z, value->i64);
+    case ZIS_TYPED_ARRAY_F64:
+        return zis_object_from(zis_float_obj_new(z, value->f64));
+    case ZIS_TYPED_ARRAY_F32:
+        return zis_object_from(zis_float_obj_new(z, (double)value->f32));
+    case ZIS_TYPED_ARRAY_U8:
+        return zis_smallint_to_ptr(value->u8);
+    default:
+        zis_context_panic(z, ZIS_CONTEXT_PANIC_IMPL);
+    }
+}
+
+/// Load element `i` from the array.
+static void typed_array_obj_get(
+    struct zis_typed_array_obj *self, enum zis_typed_array_kind kind,
+    size_t i, union typed_array_scalar *restrict value
+) {
+    assert(i < self->_length);
+    const size_t elem_size = zis_typed_array_kind_elem_size(kind);
+    memcpy(value, self->_data + i * elem_size, elem_size);
+}
+
+/// Store element `i` to the array.
+static void typed_array_obj_set(
+    struct zis_typed_array_obj *self, enum zis_typed_array_kind kind,
+    size_t i, const union typed_array_scalar *restrict value
+) {
+    assert(i < self->_length);
+    const size_t elem_size = zis_typed_array_kind_elem_size(kind);
+    memcpy(self->_data + i * elem_size, value, elem_size);
+}
+
+/* ----- methods ------------------------------------------------------------ */
+
+/// Get the element type of the typed array in REG-1.
+static enum zis_typed_array_kind typed_array_arg1_kind(struct zis_context *z) {
+    struct zis_object *const arg1 = z->callstack->frame[1];
+    const int kind = zis_typed_array_kind_of(z, zis_object_type_1(arg1));
+    assert(kind >= 0);
+    return (enum zis_typed_array_kind)kind;
+}
+
+#define typed_array_arg(__z, __i) \
+    zis_object_cast((__z)->callstack->frame[(__i)], struct zis_typed_array_obj)
+
+/// Check whether REG-2 is a typed array of the same type as REG-1 and of the same length.
+/// Returns 1 if so, 0 if it is not a typed array of the type, or -1 after throwing
+/// an exception for a different length.
+static int typed_array_arg2_is_peer(struct zis_context *z) {
+    struct zis_object **frame = z->callstack->frame;
+    if (zis_object_type_1(frame[2]) != zis_object_type(frame[1]))
+        return 0;
+    if (typed_array_arg(z, 1)->_length != typed_array_arg(z, 2)->_length) {
+        frame[0] = zis_object_from(zis_exception_obj_format(
+            z, "value", frame[2], "lengths of the arrays differ"
+        ));
+        return -1;
+    }
+    return 1;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_operator_get_elem, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:\'[]'(index :: Int) :: Int|Float
+    Gets an element by index. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_context_globals *g = z->globals;
+
+    struct zis_typed_array_obj *self = typed_array_arg(z, 1);
+    if (zis_object_is_smallint(frame[2])) {
+        const size_t index = zis_object_index_convert(
+            self->_length, zis_smallint_from_ptr(frame[2])
+        );
+        if (zis_unlikely(index == (size_t)-1))
+            goto thr_index_out_of_range;
+        union typed_array_scalar value;
+        typed_array_obj_get(self, kind, index, &value);
+        frame[0] = typed_array_scalar_to_object(z, kind, &value);
+        return ZIS_OK;
+    } else if (zis_object_type(frame[2]) == g->type_Int) {
+    thr_index_out_of_range:
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_INDEX_OUT_OF_RANGE, frame[2]
+        ));
+        return ZIS_THR;
+    } else {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_UNSUPPORTED_OPERATION_SUBS,
+            "[]", frame[1], frame[2]
+        ));
+        return ZIS_THR;
+    }
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_operator_set_elem, z, {3, 0, 3}) {
+    /*#DOCSTR# func TypedArray:\'[]='(index :: Int, value :: Int|Float)
+    Sets an element by index. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_context_globals *g = z->globals;
+
+    struct zis_typed_array_obj *self = typed_array_arg(z, 1);
+    if (zis_object_is_smallint(frame[2])) {
+        const size_t index = zis_object_index_convert(
+            self->_length, zis_smallint_from_ptr(frame[2])
+        );
+        if (zis_unlikely(index == (size_t)-1))
+            goto thr_index_out_of_range;
+        union typed_array_scalar value = { 0 };
+        struct zis_exception_obj *exc =
+            typed_array_scalar_from_object(z, kind, frame[3], "value", &value);
+        if (zis_unlikely(exc)) {
+            frame[0] = zis_object_from(exc);
+            return ZIS_THR;
+        }
+        typed_array_obj_set(self, kind, index, &value);
+    } else if (zis_object_type(frame[2]) == g->type_Int) {
+    thr_index_out_of_range:
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_INDEX_OUT_OF_RANGE, frame[2]
+        ));
+        return ZIS_THR;
+    } else {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_UNSUPPORTED_OPERATION_SUBS,
+            "[]=", frame[1], frame[2]
+        ));
+        return ZIS_THR;
+    }
+
+    frame[0] = frame[3];
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_operator_equ, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:\'=='(other :: TypedArray) :: Bool
+    Operator ==. Two typed arrays are equal if they are of the same type and
+    their elements are equal. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+
+    bool equals;
+    if (zis_object_type_1(frame[2]) != zis_object_type(frame[1])) {
+        equals = false;
+    } else {
+        struct zis_typed_array_obj *lhs = typed_array_arg(z, 1), *rhs = typed_array_arg(z, 2);
+        const size_t n = lhs->_length;
+        if (n != rhs->_length) {
+            equals = false;
+        } else if (kind == ZIS_TYPED_ARRAY_F64) {
+            // Not memcmp(), for NaNs and signed zeros.
+            const double *a = (const double *)lhs->_data, *b = (const double *)rhs->_data;
+            size_t i = 0;
+            while (i < n && a[i] == b[i])
+                i++;
+            equals = i == n;
+        } else if (kind == ZIS_TYPED_ARRAY_F32) {
+            const float *a = (const float *)lhs->_data, *b = (const float *)rhs->_data;
+            size_t i = 0;
+            while (i < n && a[i] == b[i])
+                i++;
+            equals = i == n;
+        } else {
+            equals = memcmp(lhs->_data, rhs->_data, n * zis_typed_array_kind_elem_size(kind)) == 0;
+        }
+    }
+
+    frame[0] = zis_object_from(equals ? g->val_true : g->val_false);
+    return ZIS_OK;
+}
+
+/// Implements the arithmetic operators.
+static int typed_array_arith(struct zis_context *z, const char *op_name, enum typed_array_op op) {
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    const int is_peer = typed_array_arg2_is_peer(z);
+    if (zis_unlikely(is_peer < 0))
+        return ZIS_THR;
+    const size_t n = typed_array_arg(z, 1)->_length;
+
+    // Division of integers gives floats.
+    const bool fdiv = op == TYPED_ARRAY_OP_DIV &&
+        (kind == ZIS_TYPED_ARRAY_I64 || kind == ZIS_TYPED_ARRAY_U8);
+
+    union typed_array_scalar scalar;
+    if (!is_peer) {
+        struct zis_type_obj *const other_type = zis_object_type_1(frame[2]);
+        if (zis_unlikely(
+            other_type && other_type != z->globals->type_Int && other_type != z->globals->type_Float
+        )) {
+            frame[0] = zis_object_from(zis_exception_obj_format_common(
+                z, ZIS_EXC_FMT_UNSUPPORTED_OPERATION_BIN, op_name, frame[1], frame[2]
+            ));
+            return ZIS_THR;
+        }
+        struct zis_exception_obj *exc = typed_array_scalar_from_object(
+            z, fdiv ? ZIS_TYPED_ARRAY_F64 : kind, frame[2], "other", &scalar
+        );
+        if (zis_unlikely(exc)) {
+            frame[0] = zis_object_from(exc);
+            return ZIS_THR;
+        }
+    }
+
+    struct zis_typed_array_obj *const result =
+        zis_typed_array_obj_new(z, fdiv ? ZIS_TYPED_ARRAY_F64 : kind, NULL, n);
+    void *const r = result->_data;
+    const void *const a = typed_array_arg(z, 1)->_data;
+    const void *const b = is_peer ? typed_array_arg(z, 2)->_data : NULL;
+    frame[0] = zis_object_from(result);
+
+    if (fdiv) {
+        if (kind == ZIS_TYPED_ARRAY_I64) {
+            if (is_peer)
+                typed_array_fdiv_i64(r, a, b, n);
+            else
+                typed_array_fdiv_s_i64(r, a, scalar.f64, n);
+        } else {
+            if (is_peer)
+                typed_array_fdiv_u8(r, a, b, n);
+            else
+                typed_array_fdiv_s_u8(r, a, scalar.f64, n);
+        }
+        return ZIS_OK;
+    }
+
+    if (op == TYPED_ARRAY_OP_DIV) {
+        if (kind == ZIS_TYPED_ARRAY_F64) {
+            if (is_peer)
+                typed_array_div_f64(r, a, b, n);
+            else
+                typed_array_div_s_f64(r, a, scalar.f64, n);
+        } else {
+            assert(kind == ZIS_TYPED_ARRAY_F32);
+            if (is_peer)
+                typed_array_div_f32(r, a, b, n);
+            else
+                typed_array_div_s_f32(r, a, scalar.f32, n);
+        }
+        return ZIS_OK;
+    }
+
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        if (is_peer)
+            typed_array_arith_i64(r, a, b, n, op);
+        else
+            typed_array_arith_s_i64(r, a, scalar.i64, n, op);
+        break;
+    case ZIS_TYPED_ARRAY_F64:
+        if (is_peer)
+            typed_array_arith_f64(r, a, b, n, op);
+        else
+            typed_array_arith_s_f64(r, a, scalar.f64, n, op);
+        break;
+    case ZIS_TYPED_ARRAY_F32:
+        if (is_peer)
+            typed_array_arith_f32(r, a, b, n, op);
+        else
+            typed_array_arith_s_f32(r, a, scalar.f32, n, op);
+        break;
+    case ZIS_TYPED_ARRAY_U8:
+        if (is_peer)
+            typed_array_arith_u8(r, a, b, n, op);
+        else
+            typed_array_arith_s_u8(r, a, scalar.u8, n, op);
+        break;
+    }
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_operator_add, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:\'+'(other :: TypedArray|Int|Float) :: TypedArray
+    Elementwise addition with an array of the same type and length, or with a
+    number. Integers wrap around on overflow. */
+    return typed_array_arith(z, "+", TYPED_ARRAY_OP_ADD);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_operator_sub, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:\'-'(other :: TypedArray|Int|Float) :: TypedArray
+    Elementwise subtraction. See `TypedArray:\'+'()`. */
+    return typed_array_arith(z, "-", TYPED_ARRAY_OP_SUB);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_operator_mul, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:\'*'(other :: TypedArray|Int|Float) :: TypedArray
+    Elementwise multiplication. See `TypedArray:\'+'()`. */
+    return typed_array_arith(z, "*", TYPED_ARRAY_OP_MUL);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_operator_div, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:\'/'(other :: TypedArray|Int|Float) :: TypedArray
+    Elementwise division. Dividing an `Int64Array` or a `UInt8Array` gives
+    a `Float64Array`. */
+    return typed_array_arith(z, "/", TYPED_ARRAY_OP_DIV);
+}
+
+/// Implements the comparison methods.
+static int typed_array_compare(struct zis_context *z, enum typed_array_op op) {
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    const int is_peer = typed_array_arg2_is_peer(z);
+    if (zis_unlikely(is_peer < 0))
+        return ZIS_THR;
+    const size_t n = typed_array_arg(z, 1)->_length;
+
+    union typed_array_scalar scalar;
+    if (!is_peer) {
+        struct zis_exception_obj *exc =
+            typed_array_scalar_from_object(z, kind, frame[2], "other", &scalar);
+        if (zis_unlikely(exc)) {
+            frame[0] = zis_object_from(exc);
+            return ZIS_THR;
+        }
+    }
+
+    struct zis_typed_array_obj *const result =
+        zis_typed_array_obj_new(z, ZIS_TYPED_ARRAY_U8, NULL, n);
+    uint8_t *const r = (uint8_t *)result->_data;
+    const void *const a = typed_array_arg(z, 1)->_data;
+    const void *const b = is_peer ? typed_array_arg(z, 2)->_data : NULL;
+    frame[0] = zis_object_from(result);
+
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        if (is_peer)
+            typed_array_cmp_i64(r, a, b, n, op);
+        else
+            typed_array_cmp_s_i64(r, a, scalar.i64, n, op);
+        break;
+    case ZIS_TYPED_ARRAY_F64:
+        if (is_peer)
+            typed_array_cmp_f64(r, a, b, n, op);
+        else
+            typed_array_cmp_s_f64(r, a, scalar.f64, n, op);
+        break;
+    case ZIS_TYPED_ARRAY_F32:
+        if (is_peer)
+            typed_array_cmp_f32(r, a, b, n, op);
+        else
+            typed_array_cmp_s_f32(r, a, scalar.f32, n, op);
+        break;
+    case ZIS_TYPED_ARRAY_U8:
+        if (is_peer)
+            typed_array_cmp_u8(r, a, b, n, op);
+        else
+            typed_array_cmp_s_u8(r, a, scalar.u8, n, op);
+        break;
+    }
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_lt, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:lt(other :: TypedArray|Int|Float) :: UInt8Array
+    Elementwise comparison with an array of the same type and length, or with
+    a number. Returns a mask, whose elements are 1 where `self[i] < other[i]`
+    and 0 elsewhere. */
+    return typed_array_compare(z, TYPED_ARRAY_OP_LT);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_le, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:le(other :: TypedArray|Int|Float) :: UInt8Array
+    Elementwise comparison (<=). See `TypedArray:lt()`. */
+    return typed_array_compare(z, TYPED_ARRAY_OP_LE);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_gt, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:gt(other :: TypedArray|Int|Float) :: UInt8Array
+    Elementwise comparison (>). See `TypedArray:lt()`. */
+    return typed_array_compare(z, TYPED_ARRAY_OP_GT);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_ge, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:ge(other :: TypedArray|Int|Float) :: UInt8Array
+    Elementwise comparison (>=). See `TypedArray:lt()`. */
+    return typed_array_compare(z, TYPED_ARRAY_OP_GE);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_eq, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:eq(other :: TypedArray|Int|Float) :: UInt8Array
+    Elementwise comparison (==). See `TypedArray:lt()`. */
+    return typed_array_compare(z, TYPED_ARRAY_OP_EQ);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_ne, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:ne(other :: TypedArray|Int|Float) :: UInt8Array
+    Elementwise comparison (!=). See `TypedArray:lt()`. */
+    return typed_array_compare(z, TYPED_ARRAY_OP_NE);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_length, z, {1, 0, 1}) {
+    /*#DOCSTR# func TypedArray:length() :: Int
+    Returns the number of elements. */
+    typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+    const size_t n = typed_array_arg(z, 1)->_length;
+    frame[0] = zis_smallint_to_ptr((zis_smallint_t)n);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_to_string, z, {1, 1, 4}) {
+    /*#DOCSTR# func TypedArray:to_string(?fmt) :: String
+    Returns string representation for this array, like `Int64Array[1, 2, 3]`. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    struct zis_string_builder_obj **str_builder_p = (struct zis_string_builder_obj **)(frame + 3);
+    *str_builder_p = zis_string_builder_obj_new(z);
+    const char *const type_name = typed_array_type_names[kind];
+    frame[4] = zis_object_from(zis_string_obj_new(z, type_name, strlen(type_name)));
+    zis_string_builder_obj_append(z, *str_builder_p, zis_object_cast(frame[4], struct zis_string_obj));
+    frame[4] = zis_object_from(zis_string_obj_new(z, ", ", 2));
+
+    zis_string_builder_obj_append_char(z, *str_builder_p, '[');
+    for (size_t i = 0; ; i++) {
+        struct zis_typed_array_obj *array = typed_array_arg(z, 1);
+        if (i >= array->_length)
+            break;
+        if (i)
+            zis_string_builder_obj_append(z, *str_builder_p, zis_object_cast(frame[4], struct zis_string_obj));
+        union typed_array_scalar value;
+        typed_array_obj_get(array, kind, i, &value);
+        frame[0] = typed_array_scalar_to_object(z, kind, &value);
+        struct zis_string_obj *item_str = zis_object_to_string(z, frame[0], true, NULL);
+        zis_string_builder_obj_append(z, *str_builder_p, item_str);
+    }
+    zis_string_builder_obj_append_char(z, *str_builder_p, ']');
+
+    frame[0] = zis_object_from(zis_string_builder_obj_string(z, *str_builder_p));
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_to_array, z, {1, 0, 2}) {
+    /*#DOCSTR# func TypedArray:to_array() :: Array
+    Returns an `Array` of the elements. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    const size_t n = typed_array_arg(z, 1)->_length;
+    frame[2] = zis_object_from(zis_array_obj_new(z, NULL, n));
+    for (size_t i = 0; i < n; i++) {
+        union typed_array_scalar value;
+        typed_array_obj_get(typed_array_arg(z, 1), kind, i, &value);
+        struct zis_object *const elem = typed_array_scalar_to_object(z, kind, &value);
+        zis_array_obj_set(zis_object_cast(frame[2], struct zis_array_obj), i, elem);
+    }
+    frame[0] = frame[2];
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_to_bytes, z, {1, 0, 1}) {
+    /*#DOCSTR# func TypedArray:to_bytes() :: Bytes
+    Returns the elements as `Bytes`, in the native byte order. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    const size_t size = typed_array_arg(z, 1)->_length * zis_typed_array_kind_elem_size(kind);
+    struct zis_bytes_obj *const result = zis_bytes_obj_new(z, NULL, size);
+    memcpy(result->_data, typed_array_arg(z, 1)->_data, size);
+    frame[0] = zis_object_from(result);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_sum, z, {1, 0, 1}) {
+    /*#DOCSTR# func TypedArray:sum() :: Int|Float
+    Returns the sum of the elements. The sum of an `Int64Array` wraps around
+    on overflow. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    struct zis_typed_array_obj *const self = typed_array_arg(z, 1);
+    const size_t n = self->_length;
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        frame[0] = zis_int_obj_or_smallint(z, (int64_t)typed_array_sum_i64((const int64_t *)self->_data, n));
+        break;
+    case ZIS_TYPED_ARRAY_F64:
+        frame[0] = zis_object_from(zis_float_obj_new(z, typed_array_sum_f64((const double *)self->_data, n)));
+        break;
+    case ZIS_TYPED_ARRAY_F32:
+        frame[0] = zis_object_from(zis_float_obj_new(z, typed_array_sum_f32((const float *)self->_data, n)));
+        break;
+    case ZIS_TYPED_ARRAY_U8:
+        frame[0] = zis_int_obj_or_smallint(z, (int64_t)typed_array_sum_u8((const uint8_t *)self->_data, n));
+        break;
+    }
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_dot, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:dot(other :: TypedArray) :: Int|Float
+    Returns the dot product with an array of the same type and length. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    const int is_peer = typed_array_arg2_is_peer(z);
+    if (zis_unlikely(is_peer <= 0)) {
+        if (is_peer == 0) {
+            frame[0] = zis_object_from(zis_exception_obj_format_common(
+                z, ZIS_EXC_FMT_WRONG_ARGUMENT_TYPE, "other", frame[2]
+            ));
+        }
+        return ZIS_THR;
+    }
+
+    const void *const a = typed_array_arg(z, 1)->_data, *const b = typed_array_arg(z, 2)->_data;
+    const size_t n = typed_array_arg(z, 1)->_length;
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        frame[0] = zis_int_obj_or_smallint(z, (int64_t)typed_array_dot_i64(a, b, n));
+        break;
+    case ZIS_TYPED_ARRAY_F64:
+        frame[0] = zis_object_from(zis_float_obj_new(z, typed_array_dot_f64(a, b, n)));
+        break;
+    case ZIS_TYPED_ARRAY_F32:
+        frame[0] = zis_object_from(zis_float_obj_new(z, typed_array_dot_f32(a, b, n)));
+        break;
+    case ZIS_TYPED_ARRAY_U8:
+        frame[0] = zis_int_obj_or_smallint(z, (int64_t)typed_array_dot_u8(a, b, n));
+        break;
+    }
+    return ZIS_OK;
+}
+
+/// Implements `min()` and `max()`.
+static int typed_array_min_max(struct zis_context *z, bool max) {
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    struct zis_typed_array_obj *const self = typed_array_arg(z, 1);
+    const size_t n = self->_length;
+    if (!n) {
+        frame[0] = zis_object_from(z->globals->val_nil);
+        return ZIS_OK;
+    }
+
+    union typed_array_scalar min_v, max_v;
+    bool no_nan;
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        no_nan = typed_array_min_max_i64((const int64_t *)self->_data, n, &min_v.i64, &max_v.i64);
+        break;
+    case ZIS_TYPED_ARRAY_F64:
+        no_nan = typed_array_min_max_f64((const double *)self->_data, n, &min_v.f64, &max_v.f64);
+        if (!no_nan)
+            min_v.f64 = max_v.f64 = (double)NAN;
+        break;
+    case ZIS_TYPED_ARRAY_F32:
+        no_nan = typed_array_min_max_f32((const float *)self->_data, n, &min_v.f32, &max_v.f32);
+        if (!no_nan)
+            min_v.f32 = max_v.f32 = NAN;
+        break;
+    case ZIS_TYPED_ARRAY_U8:
+        no_nan = typed_array_min_max_u8((const uint8_t *)self->_data, n, &min_v.u8, &max_v.u8);
+        break;
+    default:
+        zis_context_panic(z, ZIS_CONTEXT_PANIC_IMPL);
+    }
+    assert(no_nan || kind == ZIS_TYPED_ARRAY_F64 || kind == ZIS_TYPED_ARRAY_F32);
+    zis_unused_var(no_nan);
+    frame[0] = typed_array_scalar_to_object(z, kind, max ? &max_v : &min_v);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_min, z, {1, 0, 1}) {
+    /*#DOCSTR# func TypedArray:min() :: Int|Float|Nil
+    Returns the smallest element, NaN if there is a NaN, or nil if the array is empty. */
+    return typed_array_min_max(z, false);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_max, z, {1, 0, 1}) {
+    /*#DOCSTR# func TypedArray:max() :: Int|Float|Nil
+    Returns the largest element, NaN if there is a NaN, or nil if the array is empty. */
+    return typed_array_min_max(z, true);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_fill, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:fill(value :: Int|Float)
+    Sets all the elements to `value`. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    union typed_array_scalar value;
+    struct zis_exception_obj *exc = typed_array_scalar_from_object(z, kind, frame[2], "value", &value);
+    if (zis_unlikely(exc)) {
+        frame[0] = zis_object_from(exc);
+        return ZIS_THR;
+    }
+
+    struct zis_typed_array_obj *const self = typed_array_arg(z, 1);
+    const size_t n = self->_length;
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        typed_array_fill_i64((int64_t *)self->_data, value.i64, n);
+        break;
+    case ZIS_TYPED_ARRAY_F64:
+        typed_array_fill_f64((double *)self->_data, value.f64, n);
+        break;
+    case ZIS_TYPED_ARRAY_F32:
+        typed_array_fill_f32((float *)self->_data, value.f32, n);
+        break;
+    case ZIS_TYPED_ARRAY_U8:
+        typed_array_fill_u8((uint8_t *)self->_data, value.u8, n);
+        break;
+    }
+    frame[0] = zis_object_from(z->globals->val_nil);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_TypedArray_M_scale, z, {2, 0, 2}) {
+    /*#DOCSTR# func TypedArray:scale(factor :: Int|Float)
+    Multiplies all the elements by `factor` in place. Integers wrap around on
+    overflow. */
+    const enum zis_typed_array_kind kind = typed_array_arg1_kind(z);
+    struct zis_object **frame = z->callstack->frame;
+
+    union typed_array_scalar factor;
+    struct zis_exception_obj *exc = typed_array_scalar_from_object(z, kind, frame[2], "factor", &factor);
+    if (zis_unlikely(exc)) {
+        frame[0] = zis_object_from(exc);
+        return ZIS_THR;
+    }
+
+    struct zis_typed_array_obj *const self = typed_array_arg(z, 1);
+    void *const data = self->_data;
+    const size_t n = self->_length;
+    switch (kind) {
+    case ZIS_TYPED_ARRAY_I64:
+        typed_array_arith_s_i64(data, data, factor.i64, n, TYPED_ARRAY_OP_MUL);
+        break;
+    case ZIS_TYPED_ARRAY_F64:
+        typed_array_arith_s_f64(data, data, factor.f64, n, TYPED_ARRAY_OP_MUL);
+        break;
+    case ZIS_TYPED_ARRAY_F32:
+        typed_array_arith_s_f32(data, data, factor.f32, n, TYPED_ARRAY_OP_MUL);
+        break;
+    case ZIS_TYPED_ARRAY_U8:
+        typed_array_arith_s_u8(data, data, factor.u8, n, TYPED_ARRAY_OP_MUL);
+        break;
+    }
+    frame[0] = zis_object_from(z->globals->val_nil);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF_LIST(
+    T_TypedArray_D_methods,
+    { "+"           , &T_TypedArray_M_operator_add      },
+    { "-"           , &T_TypedArray_M_operator_sub      },
+    { "*"           , &T_TypedArray_M_operator_mul      },
+    { "/"           , &T_TypedArray_M_operator_div      },
+    { "[]"          , &T_TypedArray_M_operator_get_elem },
+    { "[]="         , &T_TypedArray_M_operator_set_elem },
+    { "=="          , &T_TypedArray_M_operator_equ      },
+    { "length"      , &T_TypedArray_M_length            },
+    { "to_string"   , &T_TypedArray_M_to_string         },
+    { "to_array"    , &T_TypedArray_M_to_array          },
+    { "to_bytes"    , &T_TypedArray_M_to_bytes          },
+    { "sum"         , &T_TypedArray_M_sum               },
+    { "dot"         , &T_TypedArray_M_dot               },
+    { "min"         , &T_TypedArray_M_min               },
+    { "max"         , &T_TypedArray_M_max               },
+    { "fill"        , &T_TypedArray_M_fill              },
+    { "scale"       , &T_TypedArray_M_scale             },
+    { "lt"          , &T_TypedArray_M_lt                },
+    { "le"          , &T_TypedArray_M_le                },
+    { "gt"          , &T_TypedArray_M_gt                },
+    { "ge"          , &T_TypedArray_M_ge                },
+    { "eq"          , &T_TypedArray_M_eq                },
+    { "ne"          , &T_TypedArray_M_ne                },
+);
+
+/* ----- constructors ------------------------------------------------------- */
+
+zis_cold_fn zis_noinline
+static int typed_array_too_long_error(struct zis_context *z, struct zis_object *what) {
+    z->callstack->frame[0] = zis_object_from(zis_exception_obj_format(
+        z, "value", what, "the length is too large"
+    ));
+    return ZIS_THR;
+}
+
+/// Implements `new()`. The argument is in REG-1.
+static int typed_array_new(struct zis_context *z, enum zis_typed_array_kind kind) {
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+
+    if (zis_object_is_smallint(frame[1])) {
+        const zis_smallint_t n = zis_smallint_from_ptr(frame[1]);
+        if (zis_unlikely(n < 0)) {
+            frame[0] = zis_object_from(zis_exception_obj_format(
+                z, "value", frame[1], "negative length"
+            ));
+            return ZIS_THR;
+        }
+        struct zis_typed_array_obj *const result =
+            zis_typed_array_obj_new(z, kind, NULL, (size_t)n);
+        if (zis_unlikely(!result))
+            return typed_array_too_long_error(z, frame[1]);
+        frame[0] = zis_object_from(result);
+        return ZIS_OK;
+    }
+
+    if (zis_unlikely(zis_object_type_is(frame[1], g->type_Int))) {
+        // Out of the small int range.
+        if (zis_int_obj_sign(zis_object_cast(frame[1], struct zis_int_obj))) {
+            frame[0] = zis_object_from(zis_exception_obj_format(
+                z, "value", frame[1], "negative length"
+            ));
+            return ZIS_THR;
+        }
+        return typed_array_too_long_error(z, frame[1]);
+    }
+
+    if (zis_unlikely(!zis_object_type_is(frame[1], g->type_Array))) {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_WRONG_ARGUMENT_TYPE, "length_or_values", frame[1]
+        ));
+        return ZIS_THR;
+    }
+    const size_t n = zis_array_obj_length(zis_object_cast(frame[1], struct zis_array_obj));
+    struct zis_typed_array_obj *const new_array = zis_typed_array_obj_new(z, kind, NULL, n);
+    if (zis_unlikely(!new_array))
+        return typed_array_too_long_error(z, frame[1]);
+    frame[0] = zis_object_from(new_array);
+    // No allocation below, unless an exception is thrown.
+    struct zis_typed_array_obj *const result = typed_array_arg(z, 0);
+    struct zis_array_obj *const values = zis_object_cast(frame[1], struct zis_array_obj);
+    for (size_t i = 0; i < n; i++) {
+        union typed_array_scalar value = { 0 };
+        struct zis_exception_obj *exc = typed_array_scalar_from_object(
+            z, kind, zis_array_obj_get(values, i), "value", &value
+        );
+        if (zis_unlikely(exc)) {
+            frame[0] = zis_object_from(exc);
+            return ZIS_THR;
+        }
+        typed_array_obj_set(result, kind, i, &value);
+    }
+    return ZIS_OK;
+}
+
+/// Implements `from_bytes()`. The argument is in REG-1.
+static int typed_array_from_bytes(struct zis_context *z, enum zis_typed_array_kind kind) {
+    struct zis_context_globals *g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+
+    if (zis_unlikely(!zis_object_type_is(frame[1], g->type_Bytes))) {
+        frame[0] = zis_object_from(zis_exception_obj_format_common(
+            z, ZIS_EXC_FMT_WRONG_ARGUMENT_TYPE, "bytes", frame[1]
+        ));
+        return ZIS_THR;
+    }
+    const size_t size = zis_bytes_obj_size(zis_object_cast(frame[1], struct zis_bytes_obj));
+    const size_t elem_size = zis_typed_array_kind_elem_size(kind);
+    if (zis_unlikely(size % elem_size)) {
+        frame[0] = zis_object_from(zis_exception_obj_format(
+            z, "value", frame[1], "size is not a multiple of %zu", elem_size
+        ));
+        return ZIS_THR;
+    }
+    struct zis_typed_array_obj *const result =
+        zis_typed_array_obj_new(z, kind, NULL, size / elem_size);
+    memcpy(result->_data, zis_bytes_obj_data(zis_object_cast(frame[1], struct zis_bytes_obj)), size);
+    frame[0] = zis_object_from(result);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Int64Array_F_new, z, {1, 0, 1}) {
+    /*#DOCSTR# func Int64Array.new(length_or_values :: Int|Array[Int]) :: Int64Array
+    Creates an array of 64-bit signed integers, either zero-filled of the given
+    length, or holding the given values. */
+    return typed_array_new(z, ZIS_TYPED_ARRAY_I64);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Int64Array_F_from_bytes, z, {1, 0, 1}) {
+    /*#DOCSTR# func Int64Array.from_bytes(bytes :: Bytes) :: Int64Array
+    Creates an array from bytes in the native byte order. */
+    return typed_array_from_bytes(z, ZIS_TYPED_ARRAY_I64);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Float64Array_F_new, z, {1, 0, 1}) {
+    /*#DOCSTR# func Float64Array.new(length_or_values :: Int|Array[Float|Int]) :: Float64Array
+    Creates an array of double-precision floating-point numbers, either
+    zero-filled of the given length, or holding the given values. */
+    return typed_array_new(z, ZIS_TYPED_ARRAY_F64);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Float64Array_F_from_bytes, z, {1, 0, 1}) {
+    /*#DOCSTR# func Float64Array.from_bytes(bytes :: Bytes) :: Float64Array
+    Creates an array from bytes in the native byte order. */
+    return typed_array_from_bytes(z, ZIS_TYPED_ARRAY_F64);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Float32Array_F_new, z, {1, 0, 1}) {
+    /*#DOCSTR# func Float32Array.new(length_or_values :: Int|Array[Float|Int]) :: Float32Array
+    Creates an array of single-precision floating-point numbers, either
+    zero-filled of the given length, or holding the given values. */
+    return typed_array_new(z, ZIS_TYPED_ARRAY_F32);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_Float32Array_F_from_bytes, z, {1, 0, 1}) {
+    /*#DOCSTR# func Float32Array.from_bytes(bytes :: Bytes) :: Float32Array
+    Creates an array from bytes in the native byte order. */
+    return typed_array_from_bytes(z, ZIS_TYPED_ARRAY_F32);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_UInt8Array_F_new, z, {1, 0, 1}) {
+    /*#DOCSTR# func UInt8Array.new(length_or_values :: Int|Array[Int]) :: UInt8Array
+    Creates an array of 8-bit unsigned integers, either zero-filled of the
+    given length, or holding the given values. */
+    return typed_array_new(z, ZIS_TYPED_ARRAY_U8);
+}
+
+ZIS_NATIVE_FUNC_DEF(T_UInt8Array_F_from_bytes, z, {1, 0, 1}) {
+    /*#DOCSTR# func UInt8Array.from_bytes(bytes :: Bytes) :: UInt8Array
+    Creates an array from bytes. */
+    return typed_array_from_bytes(z, ZIS_TYPED_ARRAY_U8);
+}
+
+ZIS_NATIVE_VAR_DEF_LIST(
+    T_Int64Array_D_statics,
+    { "new"         , { '^', .F = &T_Int64Array_F_new          } },
+    { "from_bytes"  , { '^', .F = &T_Int64Array_F_from_bytes   } },
+);
+
+ZIS_NATIVE_VAR_DEF_LIST(
+    T_Float64Array_D_statics,
+    { "new"         , { '^', .F = &T_Float64Array_F_new        } },
+    { "from_bytes"  , { '^', .F = &T_Float64Array_F_from_bytes } },
+);
+
+ZIS_NATIVE_VAR_DEF_LIST(
+    T_Float32Array_D_statics,
+    { "new"         , { '^', .F = &T_Float32Array_F_new        } },
+    { "from_bytes"  , { '^', .F = &T_Float32Array_F_from_bytes } },
+);
+
+ZIS_NATIVE_VAR_DEF_LIST(
+    T_UInt8Array_D_statics,
+    { "new"         , { '^', .F = &T_UInt8Array_F_new          } },
+    { "from_bytes"  , { '^', .F = &T_UInt8Array_F_from_bytes   } },
+);
+
+ZIS_NATIVE_TYPE_DEF_XB(
+    Int64Array,
+    struct zis_typed_array_obj, _bytes_size,
+    NULL, T_TypedArray_D_methods, T_Int64Array_D_statics
+);
+
+ZIS_NATIVE_TYPE_DEF_XB(
+    Float64Array,
+    struct zis_typed_array_obj, _bytes_size,
+    NULL, T_TypedArray_D_methods, T_Float64Array_D_statics
+);
+
+ZIS_NATIVE_TYPE_DEF_XB(
+    Float32Array,
+    struct zis_typed_array_obj, _bytes_size,
+    NULL, T_TypedArray_D_methods, T_Float32Array_D_statics
+);
+
+ZIS_NATIVE_TYPE_DEF_XB(
+    UInt8Array,
+    struct zis_typed_array_obj, _bytes_size,
+    NULL, T_TypedArray_D_methods, T_UInt8Array_D_statics
+);
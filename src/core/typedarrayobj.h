@@ -0,0 +1,54 @@
+/// Typed arrays: `Int64Array`, `Float64Array`, `Float32Array`, and `UInt8Array`.
+
+#pragma once
+
+#include <stddef.h>
+
+#include "attributes.h"
+#include "object.h"
+
+struct zis_context;
+struct zis_type_obj;
+
+/// Element type of a typed array.
+enum zis_typed_array_kind {
+    ZIS_TYPED_ARRAY_I64,
+    ZIS_TYPED_ARRAY_F64,
+    ZIS_TYPED_ARRAY_F32,
+    ZIS_TYPED_ARRAY_U8,
+};
+
+/// Typed array object. A fixed-length array of packed numbers.
+/// The element type is determined by the object type.
+struct zis_typed_array_obj {
+    ZIS_OBJECT_HEAD
+    // --- BYTES ---
+    const size_t _bytes_size;
+    size_t _length;
+    char   _data[];
+};
+
+/// Get the element type of typed arrays of type `type`.
+/// Returns -1 if `type` is not a typed array type.
+int zis_typed_array_kind_of(struct zis_context *z, struct zis_type_obj *type);
+
+/// Get the size of an element of the given kind.
+size_t zis_typed_array_kind_elem_size(enum zis_typed_array_kind kind);
+
+/// Create a typed array of `length` elements, copying from `data`
+/// (`length * elem_size` bytes) if `data` is not NULL or zero-filled otherwise.
+/// If `length` is too large, returns NULL.
+struct zis_typed_array_obj *zis_typed_array_obj_new(
+    struct zis_context *z, enum zis_typed_array_kind kind,
+    const void *restrict data, size_t length
+);
+
+/// Get the number of elements.
+zis_static_force_inline size_t zis_typed_array_obj_length(const struct zis_typed_array_obj *self) {
+    return self->_length;
+}
+
+/// Get the elements.
+zis_static_force_inline void *zis_typed_array_obj_data(struct zis_typed_array_obj *self) {
+    return self->_data;
+}
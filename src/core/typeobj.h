@@ -111,10 +111,11 @@ zis_static_force_inline size_t zis_object_bytes_size(const struct zis_object *ob
     return *(size_t *)zis_object_ref_bytes(obj, zis_object_slot_count(obj));
 }
 
-/// Object size in bytes.
-zis_static_force_inline size_t zis_object_size(const struct zis_object *obj) {
+/// Object size in bytes, given the type of the object.
+zis_static_force_inline size_t zis_object_size_by_type(
+    const struct zis_object *obj, const struct zis_type_obj *type
+) {
     assert(!zis_object_is_smallint(obj));
-    struct zis_type_obj *const type = zis_object_type(obj);
     const size_t obj_size = type->_obj_size;
     if (zis_likely(obj_size))
         return obj_size;
@@ -134,3 +135,9 @@ zis_static_force_inline size_t zis_object_size(const struct zis_object *obj) {
     // HEAD + SLOTS + BYTES
     return ZIS_OBJECT_HEAD_SIZE + (slot_count * sizeof(struct zis_object *)) + bytes_size;
 }
+
+/// Object size in bytes.
+zis_static_force_inline size_t zis_object_size(const struct zis_object *obj) {
+    assert(!zis_object_is_smallint(obj));
+    return zis_object_size_by_type(obj, zis_object_type(obj));
+}
@@ -0,0 +1,99 @@
+//%% [module]
+//%% name = heap
+//%% description = Heap dumps, object census, and GC statistics.
+
+#include <stdlib.h>
+
+#include <zis.h>
+
+ZIS_NATIVE_FUNC_DEF(F_dump, z, {1, 0, 1}) {
+    /*#DOCSTR# func dump(file :: String)
+    Collects garbage and writes a heap dump to `file`: every object with its
+    type, size, and references, and the objects referred to by GC roots. */
+    size_t file_sz;
+    zis_if_err (zis_read_string(z, 1, NULL, &file_sz)) {
+        zis_make_exception(z, 0, "type", 1, "not a string");
+        return ZIS_THR;
+    }
+    char *file = malloc(file_sz + 1);
+    zis_read_string(z, 1, file, &file_sz);
+    file[file_sz] = 0;
+    const int status = zis_dump_heap(z, file);
+    free(file);
+    zis_if_err (status) {
+        zis_make_exception(z, 0, NULL, 1, "cannot write the file");
+        return ZIS_THR;
+    }
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_census, z, {0, 1, 1}) {
+    /*#DOCSTR# func census(?live_only :: Bool) :: Array[Tuple]
+    Counts the objects in the heap by type, and returns an array of
+    `(type, count, bytes)` tuples in descending order of `bytes`. Garbage is
+    collected first unless `live_only` is false, in which case unreachable
+    objects that have not been collected are counted too. */
+    bool live_only = true;
+    if (zis_read_nil(z, 1) != ZIS_OK) {
+        zis_if_err (zis_read_bool(z, 1, &live_only)) {
+            zis_make_exception(z, 0, "type", 1, "not a boolean");
+            return ZIS_THR;
+        }
+    }
+    zis_read_heap_census(z, 0, live_only);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_gc_stats, z, {0, 0, 4}) {
+    /*#DOCSTR# func gc_stats() :: Map
+    Returns the garbage collection statistics since the start, a map whose keys
+    are strings: `fast_gc_count`, `full_gc_count`, `pause_time_total` and
+    `pause_time_max` (in nanoseconds), `pause_histogram` (an array, where the
+    element at index `i + 1` is the number of pauses that take [2^i, 2^(i+1))
+    microseconds; the first element also counts shorter pauses, and the last
+    one longer pauses), `new_space_allocated`, `old_space_allocated`,
+    `big_space_allocated`, and `promoted` (in bytes), `old_space_remembered` and
+    `big_space_remembered` (numbers of objects in the remembered sets at the
+    last fast GC), and `new_space_size` (the current size of new space, in
+    bytes). */
+    struct zis_gc_stats stats;
+    zis_gc_stats(z, &stats);
+    zis_make_values(z, 2, "[*]", (size_t)ZIS_GC_STATS_PAUSE_BUCKETS);
+    zis_make_int(z, 3, -1);
+    for (size_t i = 0; i < ZIS_GC_STATS_PAUSE_BUCKETS; i++) {
+        zis_make_int(z, 4, (int64_t)stats.pause_histogram[i]);
+        zis_insert_element(z, 2, 3, 4);
+    }
+    // Not building the map in REG-0, which is used when hashing the string keys.
+    zis_make_values(
+        z, 1, "{sisisisis%sisisisisisisi}",
+        "fast_gc_count", (size_t)-1, (int64_t)stats.fast_gc_count,
+        "full_gc_count", (size_t)-1, (int64_t)stats.full_gc_count,
+        "pause_time_total", (size_t)-1, (int64_t)stats.pause_time_total,
+        "pause_time_max", (size_t)-1, (int64_t)stats.pause_time_max,
+        "pause_histogram", (size_t)-1, 2U,
+        "new_space_allocated", (size_t)-1, (int64_t)stats.new_space_allocated,
+        "old_space_allocated", (size_t)-1, (int64_t)stats.old_space_allocated,
+        "big_space_allocated", (size_t)-1, (int64_t)stats.big_space_allocated,
+        "promoted", (size_t)-1, (int64_t)stats.promoted,
+        "old_space_remembered", (size_t)-1, (int64_t)stats.old_space_remembered,
+        "big_space_remembered", (size_t)-1, (int64_t)stats.big_space_remembered,
+        "new_space_size", (size_t)-1, (int64_t)stats.new_space_size
+    );
+    zis_move_local(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF_LIST(
+    D_functions,
+    { "dump"     , &F_dump     },
+    { "census"   , &F_census   },
+    { "gc_stats" , &F_gc_stats },
+);
+
+ZIS_NATIVE_MODULE(heap) = {
+    .functions = D_functions,
+    .types     = NULL,
+    .variables = NULL,
+};
@@ -0,0 +1,1129 @@
+/// The `io` module. An epoll-based event loop with non-blocking streams and timers.
+
+#define _GNU_SOURCE // pipe2(), accept4()
+
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <zis.h>
+
+#include <core/arrayobj.h>
+#include <core/bytesobj.h>
+#include <core/context.h>
+#include <core/globals.h>
+#include <core/mapobj.h>
+#include <core/memory.h>
+#include <core/object.h>
+#include <core/smallint.h>
+#include <core/stack.h>
+#include <core/streamobj.h>
+#include <core/stringobj.h>
+#include <core/strutil.h>
+#include <core/tupleobj.h>
+
+/* ----- non-blocking stream backend ---------------------------------------- */
+
+enum io_handle_kind {
+    IO_HANDLE_FILE,
+    IO_HANDLE_PIPE,
+    IO_HANDLE_SOCKET,
+};
+
+/// Operation data of an `io` stream.
+struct io_handle {
+    int      fd;
+    int      kind;       // enum io_handle_kind
+    int      error;      // errno of the last failed write, or 0
+    bool     eof;        // `read()` has returned 0
+    bool     unpollable; // not supported by epoll (regular files); always ready
+    uint32_t events;     // events registered to the epoll instance, or 0
+    char    *out_buf;    // data waiting to be written
+    size_t   out_size, out_cap;
+    char     in_tail[4]; // incomplete UTF-8 character left by `read()`
+    size_t   in_tail_size;
+};
+
+static zis_ssize_t io_handle_seek(void *_h, zis_ssize_t offset, int whence) {
+    struct io_handle *const h = _h;
+    return (zis_ssize_t)lseek(h->fd, (off_t)offset, whence);
+}
+
+/// Read without blocking. Returns 0 if no data is available now or at the end
+/// of file (see `io_handle::eof`), or -1 on error.
+static size_t io_handle_read(void *_h, char *restrict buffer, size_t size) {
+    struct io_handle *const h = _h;
+    while (true) {
+        const ssize_t n = read(h->fd, buffer, size);
+        if (n > 0)
+            return (size_t)n;
+        if (n == 0) {
+            if (size)
+                h->eof = true;
+            return 0;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+        return (size_t)-1;
+    }
+}
+
+/// Write as much data as possible without blocking.
+/// Returns the written size, or -1 on error (see `io_handle::error`).
+static size_t io_handle_write_some(struct io_handle *h, const char *data, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = h->kind == IO_HANDLE_SOCKET ?
+            send(h->fd, data + done, size - done, MSG_NOSIGNAL) :
+            write(h->fd, data + done, size - done);
+        if (n >= 0) {
+            done += (size_t)n;
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        h->error = errno;
+        return (size_t)-1;
+    }
+    return done;
+}
+
+/// Write the buffered output without blocking. On error, the buffered data is dropped.
+static bool io_handle_flush_some(struct io_handle *h) {
+    if (!h->out_size)
+        return true;
+    const size_t n = io_handle_write_some(h, h->out_buf, h->out_size);
+    if (n == (size_t)-1) {
+        h->out_size = 0;
+        return false;
+    }
+    h->out_size -= n;
+    memmove(h->out_buf, h->out_buf + n, h->out_size);
+    return true;
+}
+
+/// Write data after the buffered output. Data that cannot be written now is buffered.
+/// Returns false on error, with `errno` set.
+static bool io_handle_send(struct io_handle *h, const char *data, size_t size) {
+    if (h->error || !io_handle_flush_some(h)) {
+        errno = h->error;
+        return false;
+    }
+    if (!h->out_size) {
+        const size_t n = io_handle_write_some(h, data, size);
+        if (n == (size_t)-1) {
+            errno = h->error;
+            return false;
+        }
+        data += n, size -= n;
+    }
+    if (size) {
+        if (h->out_size + size > h->out_cap) {
+            size_t new_cap = h->out_cap ? h->out_cap : 256;
+            while (new_cap < h->out_size + size)
+                new_cap *= 2;
+            h->out_buf = zis_mem_realloc(h->out_buf, new_cap);
+            h->out_cap = new_cap;
+        }
+        memcpy(h->out_buf + h->out_size, data, size);
+        h->out_size += size;
+    }
+    return true;
+}
+
+/// Write all the data, blocking if necessary. This is what the `Stream` API expects.
+static int io_handle_write(void *_h, const char *restrict data, size_t size) {
+    struct io_handle *const h = _h;
+    if (!io_handle_send(h, data, size))
+        return -1;
+    while (h->out_size) {
+        struct pollfd pfd = { .fd = h->fd, .events = POLLOUT };
+        if (poll(&pfd, 1, -1) == -1 && errno != EINTR)
+            return -1;
+        if (!io_handle_flush_some(h))
+            return -1;
+    }
+    return 0;
+}
+
+static void io_handle_close(void *_h) {
+    struct io_handle *const h = _h;
+    close(h->fd);
+    zis_mem_free(h->out_buf);
+    zis_mem_free(h);
+}
+
+static const struct zis_stream_obj_operations io_handle_ops = {
+    .seek  = io_handle_seek,
+    .read  = io_handle_read,
+    .write = io_handle_write,
+    .close = io_handle_close,
+};
+
+/// Get the handle of an `io` stream. Returns NULL if it is not an open `io` stream.
+static struct io_handle *io_handle_of(zis_t z, struct zis_object *obj) {
+    if (!zis_object_type_is(obj, z->globals->type_Stream))
+        return NULL;
+    struct zis_stream_obj *const stream = zis_object_cast(obj, struct zis_stream_obj);
+    if (stream->_ops != &io_handle_ops)
+        return NULL;
+    return stream->_ops_data;
+}
+
+/// Create a stream for a non-blocking file descriptor and store it to `REG-reg`.
+static struct io_handle *io_make_stream(zis_t z, unsigned int reg, int fd, int kind, int mode) {
+    struct io_handle *const h = zis_mem_alloc(sizeof(struct io_handle));
+    memset(h, 0, sizeof *h);
+    h->fd = fd, h->kind = kind;
+    if (kind == IO_HANDLE_FILE) {
+        struct stat st;
+        h->unpollable = fstat(fd, &st) == 0 && (S_ISREG(st.st_mode) || S_ISDIR(st.st_mode));
+    }
+    // The stream buffer is not used by the `io` functions, so keep it small.
+    struct zis_stream_obj *const stream = zis_stream_obj_new(z);
+    zis_stream_obj_bind(stream, &io_handle_ops, h, mode, ZIS_STREAM_OBJ_BUF_SZ_MIN);
+    z->callstack->frame[reg] = zis_object_from(stream);
+    return h;
+}
+
+/* ----- event loop state --------------------------------------------------- */
+
+/// Name of the module variable that holds the loop state (an `Array`).
+#define IO_LOOP_VAR  "__io_loop__"
+
+/// Elements in the loop state.
+enum io_loop_field {
+    IO_LOOP_WATCHERS,  // Map { fd :: Int -> Array[stream, on_readable, on_writable] }
+    IO_LOOP_READY,     // Array[stream], watched streams that epoll does not support
+    IO_LOOP_TIMERS,    // Array[Tuple(deadline, id, period, callback)], sorted by (deadline, id)
+    IO_LOOP_EPOLL_FD,  // Int, the epoll instance during `run()`, or -1
+    IO_LOOP_TIMER_ID,  // Int, the last allocated timer ID
+    IO_LOOP_STOP,      // Bool, whether `stop()` has been called
+    IO_LOOP_FIELD_COUNT
+};
+
+enum io_watcher_field {
+    IO_WATCHER_STREAM,
+    IO_WATCHER_ON_READABLE,
+    IO_WATCHER_ON_WRITABLE,
+    IO_WATCHER_FIELD_COUNT
+};
+
+enum io_timer_field {
+    IO_TIMER_DEADLINE, // Int, milliseconds, see `io_now_ms()`
+    IO_TIMER_ID,
+    IO_TIMER_PERIOD,   // Int, milliseconds, 0 for one-shot timers
+    IO_TIMER_CALLBACK,
+    IO_TIMER_FIELD_COUNT
+};
+
+/// The maximum number of events to take from epoll at a time.
+#define IO_LOOP_MAX_EVENTS  64
+
+/// Monotonic clock in milliseconds, counted from the first call.
+static int64_t io_now_ms(void) {
+    static int64_t base_ms = -1;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    const int64_t ms = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    if (base_ms < 0)
+        base_ms = ms;
+    return ms - base_ms;
+}
+
+/// Load the loop state to `REG-reg`.
+static struct zis_array_obj *io_loop_load(zis_t z, unsigned int reg) {
+    zis_if_err (zis_load_global(z, reg, IO_LOOP_VAR, (size_t)-1))
+        zis_context_panic(z, ZIS_CONTEXT_PANIC_IMPL);
+    return zis_object_cast(z->callstack->frame[reg], struct zis_array_obj);
+}
+
+/// Get the loop state that has been loaded to `REG-reg`.
+static struct zis_array_obj *io_loop_at(zis_t z, unsigned int reg) {
+    return zis_object_cast(z->callstack->frame[reg], struct zis_array_obj);
+}
+
+static struct zis_map_obj *io_loop_watchers(struct zis_array_obj *loop) {
+    return zis_object_cast(zis_array_obj_get(loop, IO_LOOP_WATCHERS), struct zis_map_obj);
+}
+
+static struct zis_array_obj *io_loop_array(struct zis_array_obj *loop, enum io_loop_field field) {
+    assert(field == IO_LOOP_READY || field == IO_LOOP_TIMERS);
+    return zis_object_cast(zis_array_obj_get(loop, field), struct zis_array_obj);
+}
+
+static zis_smallint_t io_loop_int(struct zis_array_obj *loop, enum io_loop_field field) {
+    assert(field == IO_LOOP_EPOLL_FD || field == IO_LOOP_TIMER_ID);
+    return zis_smallint_from_ptr(zis_array_obj_get(loop, field));
+}
+
+static bool io_is_nil(zis_t z, struct zis_object *obj) {
+    return obj == zis_object_from(z->globals->val_nil);
+}
+
+/// Throw an exception describing `errno`.
+static int io_throw_errno(zis_t z, const char *what) {
+    zis_make_exception(z, 0, "sys", (unsigned int)-1, "%s: %s", what, strerror(errno));
+    return ZIS_THR;
+}
+
+/// Throw an exception saying that the argument in `REG-reg` is not an open `io` stream.
+static int io_throw_not_stream(zis_t z, unsigned int reg) {
+    zis_make_exception(z, 0, "type", reg, "not an open io stream");
+    return ZIS_THR;
+}
+
+/* ----- watchers ----------------------------------------------------------- */
+
+struct io_loop_find_closed_state {
+    zis_t z;
+    struct zis_object *key;
+};
+
+static int _io_loop_find_closed_fn(struct zis_object *key, struct zis_object *val, void *arg) {
+    struct io_loop_find_closed_state *const state = arg;
+    struct zis_array_obj *const watcher = zis_object_cast(val, struct zis_array_obj);
+    if (io_handle_of(state->z, zis_array_obj_get(watcher, IO_WATCHER_STREAM)))
+        return 0;
+    state->key = key;
+    return 1;
+}
+
+/// Forget the watchers of streams that have been closed with the `Stream` API
+/// instead of `close()`. The system removes closed file descriptors from epoll,
+/// so such watchers would keep `run()` waiting forever.
+/// The loop state shall have been loaded to `REG-loop_reg`.
+static void io_loop_forget_closed(zis_t z, unsigned int loop_reg) {
+    struct io_loop_find_closed_state state = { z, NULL };
+    while (zis_map_obj_foreach(z, io_loop_watchers(io_loop_at(z, loop_reg)), _io_loop_find_closed_fn, &state))
+        zis_map_obj_unset(z, io_loop_watchers(io_loop_at(z, loop_reg)), state.key);
+    for (size_t i = 0; ; ) {
+        struct zis_array_obj *const ready = io_loop_array(io_loop_at(z, loop_reg), IO_LOOP_READY);
+        if (i >= zis_array_obj_length(ready))
+            break;
+        if (io_handle_of(z, zis_array_obj_get(ready, i)))
+            i++;
+        else
+            zis_array_obj_remove(z, ready, i);
+    }
+}
+
+/// Find the watcher of the stream in `REG-stream_reg` and store it to `REG-watcher_reg`.
+/// If there is not one, creates it when `create` is true, or returns NULL otherwise.
+/// The loop state shall have been loaded to `REG-loop_reg`.
+static struct zis_array_obj *io_watcher_find(
+    zis_t z, unsigned int loop_reg, unsigned int stream_reg, unsigned int watcher_reg,
+    struct io_handle *h, bool create
+) {
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_object *const key = zis_smallint_to_ptr(h->fd);
+    struct zis_object *watcher_obj;
+    if (zis_map_obj_get(z, io_loop_watchers(io_loop_at(z, loop_reg)), key, &watcher_obj) == ZIS_OK) {
+        struct zis_array_obj *const watcher = zis_object_cast(watcher_obj, struct zis_array_obj);
+        if (zis_array_obj_get(watcher, IO_WATCHER_STREAM) == frame[stream_reg]) {
+            frame[watcher_reg] = watcher_obj;
+            return watcher;
+        }
+        // The file descriptor has been reused after the watched stream was closed.
+        io_loop_forget_closed(z, loop_reg);
+        frame = z->callstack->frame;
+    }
+    if (!create)
+        return NULL;
+
+    frame[watcher_reg] = zis_object_from(zis_array_obj_new(z, NULL, 0));
+    for (size_t i = 0; i < IO_WATCHER_FIELD_COUNT; i++) {
+        frame = z->callstack->frame;
+        struct zis_object *const v =
+            i == IO_WATCHER_STREAM ? frame[stream_reg] : zis_object_from(z->globals->val_nil);
+        zis_array_obj_append(z, zis_object_cast(frame[watcher_reg], struct zis_array_obj), v);
+    }
+    frame = z->callstack->frame;
+    const int status = zis_map_obj_set(
+        z, io_loop_watchers(io_loop_at(z, loop_reg)), key, frame[watcher_reg]
+    );
+    assert(status == ZIS_OK), zis_unused_var(status);
+    if (h->unpollable) {
+        frame = z->callstack->frame;
+        struct zis_array_obj *const ready = io_loop_array(io_loop_at(z, loop_reg), IO_LOOP_READY);
+        zis_array_obj_append(z, ready, frame[stream_reg]);
+    }
+    return zis_object_cast(z->callstack->frame[watcher_reg], struct zis_array_obj);
+}
+
+/// Register the handle to epoll (if the loop is running) for the events that
+/// the watcher is interested in. Forget the watcher if it watches nothing.
+/// Nothing is allocated here.
+static void io_watcher_update(
+    zis_t z, struct zis_array_obj *loop, struct zis_array_obj *watcher, struct io_handle *h
+) {
+    const bool on_readable = !io_is_nil(z, zis_array_obj_get(watcher, IO_WATCHER_ON_READABLE));
+    const bool on_writable = !io_is_nil(z, zis_array_obj_get(watcher, IO_WATCHER_ON_WRITABLE));
+    const uint32_t events = (on_readable ? EPOLLIN : 0) | (on_writable || h->out_size ? EPOLLOUT : 0);
+
+    const int epoll_fd = (int)io_loop_int(loop, IO_LOOP_EPOLL_FD);
+    if (epoll_fd != -1 && !h->unpollable && events != h->events) {
+        struct epoll_event ev = { .events = events, .data.fd = h->fd };
+        const int op = !h->events ? EPOLL_CTL_ADD : events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+        if (epoll_ctl(epoll_fd, op, h->fd, &ev) == 0)
+            h->events = events;
+    }
+
+    if (!events) {
+        struct zis_object *const stream = zis_array_obj_get(watcher, IO_WATCHER_STREAM);
+        zis_map_obj_unset(z, io_loop_watchers(loop), zis_smallint_to_ptr(h->fd));
+        if (h->unpollable) {
+            struct zis_array_obj *const ready = io_loop_array(loop, IO_LOOP_READY);
+            for (size_t i = 0, n = zis_array_obj_length(ready); i < n; i++) {
+                if (zis_array_obj_get(ready, i) == stream) {
+                    zis_array_obj_remove(z, ready, i);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/// Set a callback of the stream in `REG-1` to the value in `REG-2`.
+/// `REG-3` and `REG-4` are used.
+static int io_watch(zis_t z, enum io_watcher_field which) {
+    struct io_handle *const h = io_handle_of(z, z->callstack->frame[1]);
+    if (!h)
+        return io_throw_not_stream(z, 1);
+    io_loop_load(z, 3);
+    const bool callback_is_nil = io_is_nil(z, z->callstack->frame[2]);
+    struct zis_array_obj *watcher = io_watcher_find(z, 3, 1, 4, h, !callback_is_nil);
+    if (!watcher) {
+        zis_load_nil(z, 0, 1);
+        return ZIS_OK;
+    }
+    zis_array_obj_set(watcher, which, z->callstack->frame[2]);
+    io_watcher_update(z, io_loop_at(z, 3), watcher, h);
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+struct io_loop_foreach_state {
+    zis_t z;
+    struct zis_array_obj *loop;
+};
+
+static int _io_loop_register_all_fn(struct zis_object *key, struct zis_object *val, void *arg) {
+    zis_unused_var(key);
+    struct io_loop_foreach_state *const state = arg;
+    struct zis_array_obj *const watcher = zis_object_cast(val, struct zis_array_obj);
+    struct io_handle *const h =
+        io_handle_of(state->z, zis_array_obj_get(watcher, IO_WATCHER_STREAM));
+    if (h) {
+        h->events = 0;
+        // Watchers that watch nothing do not exist, so nothing is removed here.
+        io_watcher_update(state->z, state->loop, watcher, h);
+    }
+    return 0;
+}
+
+static int _io_loop_unregister_all_fn(struct zis_object *key, struct zis_object *val, void *arg) {
+    zis_unused_var(key);
+    struct io_loop_foreach_state *const state = arg;
+    struct zis_array_obj *const watcher = zis_object_cast(val, struct zis_array_obj);
+    struct io_handle *const h =
+        io_handle_of(state->z, zis_array_obj_get(watcher, IO_WATCHER_STREAM));
+    if (h)
+        h->events = 0;
+    return 0;
+}
+
+/// Handle events on a file descriptor. The loop state shall have been loaded
+/// to `REG-1`. `REG-2` to `REG-4` are used.
+static int io_loop_dispatch(zis_t z, int fd, uint32_t events) {
+    struct zis_object **frame = z->callstack->frame;
+    struct zis_object *watcher_obj;
+    if (zis_map_obj_get(z, io_loop_watchers(io_loop_at(z, 1)), zis_smallint_to_ptr(fd), &watcher_obj) != ZIS_OK)
+        return ZIS_OK;
+    frame[2] = watcher_obj;
+    frame[3] = zis_array_obj_get(zis_object_cast(watcher_obj, struct zis_array_obj), IO_WATCHER_STREAM);
+    struct io_handle *h = io_handle_of(z, frame[3]);
+    if (!h) // Closed with the `Stream` API.
+        return ZIS_OK;
+
+    if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+        io_handle_flush_some(h);
+
+    if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        frame[4] = zis_array_obj_get(zis_object_cast(frame[2], struct zis_array_obj), IO_WATCHER_ON_READABLE);
+        if (!io_is_nil(z, frame[4])) {
+            zis_if_thr (zis_invoke(z, (unsigned int[]){0, 4, 3}, 1))
+                return ZIS_THR;
+            frame = z->callstack->frame;
+            h = io_handle_of(z, frame[3]);
+            if (!h)
+                return ZIS_OK;
+            // The callback may have replaced the watcher.
+            struct zis_array_obj *const watcher = io_watcher_find(z, 1, 3, 2, h, false);
+            if (!watcher)
+                return ZIS_OK;
+        }
+    }
+
+    if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && !h->out_size) {
+        frame[4] = zis_array_obj_get(zis_object_cast(frame[2], struct zis_array_obj), IO_WATCHER_ON_WRITABLE);
+        if (!io_is_nil(z, frame[4])) {
+            zis_if_thr (zis_invoke(z, (unsigned int[]){0, 4, 3}, 1))
+                return ZIS_THR;
+            frame = z->callstack->frame;
+            h = io_handle_of(z, frame[3]);
+            if (!h)
+                return ZIS_OK;
+            struct zis_array_obj *const watcher = io_watcher_find(z, 1, 3, 2, h, false);
+            if (!watcher)
+                return ZIS_OK;
+        }
+    }
+
+    io_watcher_update(z, io_loop_at(z, 1), zis_object_cast(frame[2], struct zis_array_obj), h);
+    return ZIS_OK;
+}
+
+/* ----- timers ------------------------------------------------------------- */
+
+/// Insert the timer in `REG-timer_reg` to the sorted timer list.
+/// The loop state shall have been loaded to `REG-loop_reg`.
+static void io_timer_insert(zis_t z, unsigned int loop_reg, unsigned int timer_reg) {
+    struct zis_tuple_obj *const timer =
+        zis_object_cast(z->callstack->frame[timer_reg], struct zis_tuple_obj);
+    const zis_smallint_t deadline = zis_smallint_from_ptr(zis_tuple_obj_get(timer, IO_TIMER_DEADLINE));
+    const zis_smallint_t id = zis_smallint_from_ptr(zis_tuple_obj_get(timer, IO_TIMER_ID));
+    struct zis_array_obj *const timers = io_loop_array(io_loop_at(z, loop_reg), IO_LOOP_TIMERS);
+    size_t lo = 0, hi = zis_array_obj_length(timers);
+    while (lo < hi) {
+        const size_t mid = lo + (hi - lo) / 2;
+        struct zis_tuple_obj *const t =
+            zis_object_cast(zis_array_obj_get(timers, mid), struct zis_tuple_obj);
+        const zis_smallint_t t_deadline = zis_smallint_from_ptr(zis_tuple_obj_get(t, IO_TIMER_DEADLINE));
+        const zis_smallint_t t_id = zis_smallint_from_ptr(zis_tuple_obj_get(t, IO_TIMER_ID));
+        if (t_deadline < deadline || (t_deadline == deadline && t_id < id))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    zis_array_obj_insert(z, timers, lo, zis_object_from(timer));
+}
+
+/// Read a duration in milliseconds (`Int` or `Float`) from `REG-reg`.
+static int io_read_ms(zis_t z, unsigned int reg, zis_smallint_t *ms) {
+    int64_t i;
+    double f;
+    if (zis_read_int(z, reg, &i) == ZIS_OK) {
+    } else if (zis_read_float(z, reg, &f) == ZIS_OK) {
+        i = f < 0.0 ? 0 : f > (double)INT32_MAX ? INT32_MAX : (int64_t)f;
+    } else {
+        zis_make_exception(z, 0, "type", reg, "the duration must be an Int or a Float");
+        return ZIS_THR;
+    }
+    *ms = i < 0 ? 0 : i > INT32_MAX ? INT32_MAX : (zis_smallint_t)i;
+    return ZIS_OK;
+}
+
+/// Create a timer with delay in `REG-1` and callback in `REG-2`. `REG-3` to `REG-7` are used.
+static int io_timer_new(zis_t z, bool repeat) {
+    zis_smallint_t delay;
+    zis_if_thr (io_read_ms(z, 1, &delay))
+        return ZIS_THR;
+    struct zis_array_obj *const loop = io_loop_load(z, 3);
+    const zis_smallint_t id = io_loop_int(loop, IO_LOOP_TIMER_ID) + 1;
+    zis_array_obj_set(loop, IO_LOOP_TIMER_ID, zis_smallint_to_ptr(id));
+
+    struct zis_object **const frame = z->callstack->frame;
+    frame[4 + IO_TIMER_DEADLINE] = zis_smallint_to_ptr((zis_smallint_t)io_now_ms() + delay);
+    frame[4 + IO_TIMER_ID]       = zis_smallint_to_ptr(id);
+    frame[4 + IO_TIMER_PERIOD]   = zis_smallint_to_ptr(repeat ? (delay ? delay : 1) : 0);
+    frame[4 + IO_TIMER_CALLBACK] = frame[2];
+    frame[4] = zis_object_from(zis_tuple_obj_new(z, frame + 4, IO_TIMER_FIELD_COUNT));
+    io_timer_insert(z, 3, 4);
+
+    z->callstack->frame[0] = zis_smallint_to_ptr(id);
+    return ZIS_OK;
+}
+
+/// Run the timers that have expired. The loop state shall have been loaded to
+/// `REG-1`. `REG-2` to `REG-7` are used.
+static int io_loop_run_timers(zis_t z) {
+    const zis_smallint_t now = (zis_smallint_t)io_now_ms();
+    while (true) {
+        struct zis_array_obj *const timers = io_loop_array(io_loop_at(z, 1), IO_LOOP_TIMERS);
+        if (!zis_array_obj_length(timers))
+            break;
+        struct zis_tuple_obj *const timer =
+            zis_object_cast(zis_array_obj_get(timers, 0), struct zis_tuple_obj);
+        const zis_smallint_t deadline = zis_smallint_from_ptr(zis_tuple_obj_get(timer, IO_TIMER_DEADLINE));
+        if (deadline > now)
+            break;
+        zis_array_obj_remove(z, timers, 0);
+
+        struct zis_object **frame = z->callstack->frame;
+        frame[2] = zis_tuple_obj_get(timer, IO_TIMER_CALLBACK);
+        const zis_smallint_t period = zis_smallint_from_ptr(zis_tuple_obj_get(timer, IO_TIMER_PERIOD));
+        if (period) {
+            // Re-arm before calling back, so that the callback can clear the timer.
+            const zis_smallint_t next = deadline + period;
+            frame[4 + IO_TIMER_DEADLINE] = zis_smallint_to_ptr(next > now ? next : now + period);
+            frame[4 + IO_TIMER_ID]       = zis_tuple_obj_get(timer, IO_TIMER_ID);
+            frame[4 + IO_TIMER_PERIOD]   = zis_smallint_to_ptr(period);
+            frame[4 + IO_TIMER_CALLBACK] = frame[2];
+            frame[4] = zis_object_from(zis_tuple_obj_new(z, frame + 4, IO_TIMER_FIELD_COUNT));
+            io_timer_insert(z, 1, 4);
+        }
+
+        zis_if_thr (zis_invoke(z, (unsigned int[]){0, 2}, 0))
+            return ZIS_THR;
+        if (zis_array_obj_get(io_loop_at(z, 1), IO_LOOP_STOP) == zis_object_from(z->globals->val_true))
+            break;
+    }
+    return ZIS_OK;
+}
+
+/* ----- functions ---------------------------------------------------------- */
+
+ZIS_NATIVE_FUNC_DEF(F_init, z, {0, 0, 6}) {
+    /*#DOCSTR# func <module_init>()
+    Creates the event loop state. */
+    struct zis_context_globals *const g = z->globals;
+    struct zis_object **frame = z->callstack->frame;
+    frame[1 + IO_LOOP_WATCHERS] = zis_object_from(zis_map_obj_new(z, 0.0f, 0));
+    frame = z->callstack->frame;
+    frame[1 + IO_LOOP_READY]    = zis_object_from(zis_array_obj_new(z, NULL, 0));
+    frame = z->callstack->frame;
+    frame[1 + IO_LOOP_TIMERS]   = zis_object_from(zis_array_obj_new(z, NULL, 0));
+    frame = z->callstack->frame;
+    frame[1 + IO_LOOP_EPOLL_FD] = zis_smallint_to_ptr(-1);
+    frame[1 + IO_LOOP_TIMER_ID] = zis_smallint_to_ptr(0);
+    frame[1 + IO_LOOP_STOP]     = zis_object_from(g->val_false);
+    static_assert(IO_LOOP_FIELD_COUNT == 6, "");
+    frame[0] = zis_object_from(zis_array_obj_new(z, frame + 1, IO_LOOP_FIELD_COUNT));
+    zis_store_global(z, 0, IO_LOOP_VAR, (size_t)-1);
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_pipe, z, {0, 0, 2}) {
+    /*#DOCSTR# func pipe() :: Tuple[Stream, Stream]
+    Creates a non-blocking pipe. Returns the read end and the write end. */
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1)
+        return io_throw_errno(z, "pipe");
+    io_make_stream(z, 1, fds[0], IO_HANDLE_PIPE, ZIS_STREAM_OBJ_MODE_IN);
+    io_make_stream(z, 2, fds[1], IO_HANDLE_PIPE, ZIS_STREAM_OBJ_MODE_OUT);
+    zis_make_values(z, 0, "(%%)", 1, 2);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_open, z, {1, 1, 2}) {
+    /*#DOCSTR# func open(path :: String, ?mode :: String) :: Stream
+    Opens a file in non-blocking mode. The `mode` can be "r" (read, the default),
+    "w" (write, truncating the file) or "a" (append). Regular files are always
+    ready to read or write. */
+    char path[1024], mode[4] = "r";
+    size_t path_size = sizeof path - 1, mode_size = sizeof mode - 1;
+    zis_if_err (zis_read_string(z, 1, path, &path_size)) {
+        zis_make_exception(z, 0, "type", 1, "the path must be a String shorter than %zu", sizeof path);
+        return ZIS_THR;
+    }
+    path[path_size] = '\0';
+    if (zis_read_nil(z, 2) != ZIS_OK) {
+        zis_if_err (zis_read_string(z, 2, mode, &mode_size)) {
+            zis_make_exception(z, 0, "type", 2, "invalid mode");
+            return ZIS_THR;
+        }
+        mode[mode_size] = '\0';
+    }
+    int flags, stream_mode;
+    if (strcmp(mode, "r") == 0)
+        flags = O_RDONLY, stream_mode = ZIS_STREAM_OBJ_MODE_IN;
+    else if (strcmp(mode, "w") == 0)
+        flags = O_WRONLY | O_CREAT | O_TRUNC, stream_mode = ZIS_STREAM_OBJ_MODE_OUT;
+    else if (strcmp(mode, "a") == 0)
+        flags = O_WRONLY | O_CREAT | O_APPEND, stream_mode = ZIS_STREAM_OBJ_MODE_APP;
+    else {
+        zis_make_exception(z, 0, "value", 2, "invalid mode");
+        return ZIS_THR;
+    }
+    const int fd = open(path, flags | O_NONBLOCK | O_CLOEXEC, 0666);
+    if (fd == -1)
+        return io_throw_errno(z, path);
+    io_make_stream(z, 0, fd, IO_HANDLE_FILE, stream_mode);
+    return ZIS_OK;
+}
+
+/// Read an IPv4 address and a port from `REG-port_reg` and `REG-host_reg`.
+static int io_read_inet_addr(zis_t z, unsigned int port_reg, unsigned int host_reg, struct sockaddr_in *addr) {
+    int64_t port;
+    zis_if_err (zis_read_int(z, port_reg, &port)) {
+        zis_make_exception(z, 0, "type", port_reg, "the port must be an Int");
+        return ZIS_THR;
+    }
+    if (port < 0 || port > UINT16_MAX) {
+        zis_make_exception(z, 0, "value", port_reg, "invalid port");
+        return ZIS_THR;
+    }
+    char host[64] = "127.0.0.1";
+    size_t host_size = sizeof host - 1;
+    if (zis_read_nil(z, host_reg) != ZIS_OK) {
+        zis_if_err (zis_read_string(z, host_reg, host, &host_size)) {
+            zis_make_exception(z, 0, "type", host_reg, "the host must be a String");
+            return ZIS_THR;
+        }
+        host[host_size] = '\0';
+    }
+    memset(addr, 0, sizeof *addr);
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &addr->sin_addr) != 1) {
+        zis_make_exception(z, 0, "value", host_reg, "not an IPv4 address");
+        return ZIS_THR;
+    }
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_listen, z, {1, 1, 2}) {
+    /*#DOCSTR# func listen(port :: Int, ?host :: String) :: Stream
+    Creates a TCP server socket listening on an IPv4 address ("127.0.0.1" by
+    default). Port 0 picks a free port; see `port()`. The stream becomes
+    readable when there are connections to `accept()`. */
+    struct sockaddr_in addr;
+    zis_if_thr (io_read_inet_addr(z, 1, 2, &addr))
+        return ZIS_THR;
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+        return io_throw_errno(z, "socket");
+    const int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof addr) == -1 || listen(fd, SOMAXCONN) == -1) {
+        const int err = errno;
+        close(fd);
+        errno = err;
+        return io_throw_errno(z, "listen");
+    }
+    io_make_stream(z, 0, fd, IO_HANDLE_SOCKET, ZIS_STREAM_OBJ_MODE_IN);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_accept, z, {1, 0, 1}) {
+    /*#DOCSTR# func accept(server :: Stream) :: Stream | Nil
+    Accepts a connection on a server socket. Returns nil if there is no pending
+    connection now. */
+    struct io_handle *const h = io_handle_of(z, z->callstack->frame[1]);
+    if (!h)
+        return io_throw_not_stream(z, 1);
+    int fd;
+    do
+        fd = accept4(h->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    while (fd == -1 && errno == EINTR);
+    if (fd == -1) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED) {
+            zis_load_nil(z, 0, 1);
+            return ZIS_OK;
+        }
+        return io_throw_errno(z, "accept");
+    }
+    io_make_stream(z, 0, fd, IO_HANDLE_SOCKET, ZIS_STREAM_OBJ_MODE_IN);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_connect, z, {1, 1, 2}) {
+    /*#DOCSTR# func connect(port :: Int, ?host :: String) :: Stream
+    Starts connecting to a TCP server at an IPv4 address ("127.0.0.1" by
+    default). The stream becomes writable when the connection is established. */
+    struct sockaddr_in addr;
+    zis_if_thr (io_read_inet_addr(z, 1, 2, &addr))
+        return ZIS_THR;
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
+        return io_throw_errno(z, "socket");
+    if (connect(fd, (struct sockaddr *)&addr, sizeof addr) == -1 && errno != EINPROGRESS) {
+        const int err = errno;
+        close(fd);
+        errno = err;
+        return io_throw_errno(z, "connect");
+    }
+    io_make_stream(z, 0, fd, IO_HANDLE_SOCKET, ZIS_STREAM_OBJ_MODE_IN);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_port, z, {1, 0, 1}) {
+    /*#DOCSTR# func port(socket :: Stream) :: Int
+    Returns the local port of a socket. */
+    struct io_handle *const h = io_handle_of(z, z->callstack->frame[1]);
+    if (!h || h->kind != IO_HANDLE_SOCKET)
+        return io_throw_not_stream(z, 1);
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof addr;
+    if (getsockname(h->fd, (struct sockaddr *)&addr, &addr_len) == -1)
+        return io_throw_errno(z, "getsockname");
+    zis_make_int(z, 0, ntohs(addr.sin_port));
+    return ZIS_OK;
+}
+
+/// Read at most `REG-2` (default 64 KiB) bytes from the stream in `REG-1`, after
+/// the incomplete character left by `read()` (see `io_handle::in_tail`).
+/// The buffer is sized to the data that is available now.
+/// Returns the size, or -1 on EOF, or -2 on error (thrown).
+static size_t io_read_to_buffer(zis_t z, struct io_handle **handle, char **buffer) {
+    struct io_handle *const h = io_handle_of(z, z->callstack->frame[1]);
+    if (!h) {
+        io_throw_not_stream(z, 1);
+        return (size_t)-2;
+    }
+    *handle = h;
+    int64_t max_size = 64 * 1024;
+    if (zis_read_nil(z, 2) != ZIS_OK) {
+        zis_if_err (zis_read_int(z, 2, &max_size)) {
+            zis_make_exception(z, 0, "type", 2, "the size must be an Int");
+            return (size_t)-2;
+        }
+        if (max_size < 1)
+            max_size = 1;
+        else if (max_size > ZIS_STREAM_OBJ_BUF_SZ_MAX)
+            max_size = ZIS_STREAM_OBJ_BUF_SZ_MAX;
+    }
+    size_t size = (size_t)max_size;
+    int avail_size;
+    if (ioctl(h->fd, FIONREAD, &avail_size) == 0 && avail_size >= 0 && (size_t)avail_size < size)
+        size = avail_size ? (size_t)avail_size : 1; // Reading 1 byte tells EOF from no data.
+    const size_t tail_size = h->in_tail_size;
+    *buffer = zis_mem_alloc(tail_size + size);
+    memcpy(*buffer, h->in_tail, tail_size);
+    const size_t n = io_handle_read(h, *buffer + tail_size, size);
+    if (n == (size_t)-1) {
+        zis_mem_free(*buffer);
+        io_throw_errno(z, "read");
+        return (size_t)-2;
+    }
+    h->in_tail_size = 0;
+    if (!n && !tail_size && h->eof) {
+        zis_mem_free(*buffer);
+        return (size_t)-1;
+    }
+    return tail_size + n;
+}
+
+/// Get the size of the incomplete UTF-8 character at the end of the data, or 0.
+static size_t io_u8_incomplete_size(const char *data, size_t size) {
+    for (size_t i = 1; i <= 3 && i <= size; i++) {
+        const zis_char8_t c = (zis_char8_t)data[size - i];
+        if ((c & 0xc0) != 0x80)
+            return zis_u8char_len_1(c) > i ? i : 0;
+    }
+    return 0;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_read, z, {1, 1, 2}) {
+    /*#DOCSTR# func read(stream :: Stream, ?max_size :: Int) :: String | Nil
+    Reads available data as a UTF-8 string without blocking. Returns an empty
+    string if no data is available now, or nil at the end of the stream. A
+    character that has not been completely received is kept for the next call. */
+    struct io_handle *h;
+    char *buffer;
+    size_t n = io_read_to_buffer(z, &h, &buffer);
+    if (n == (size_t)-2)
+        return ZIS_THR;
+    if (n == (size_t)-1) {
+        zis_load_nil(z, 0, 1);
+        return ZIS_OK;
+    }
+    if (!h->eof) {
+        const size_t tail_size = io_u8_incomplete_size(buffer, n);
+        n -= tail_size;
+        memcpy(h->in_tail, buffer + n, tail_size);
+        h->in_tail_size = tail_size;
+    }
+    struct zis_string_obj *const str = zis_string_obj_new(z, buffer, n);
+    zis_mem_free(buffer);
+    if (!str) {
+        zis_make_exception(z, 0, "value", (unsigned int)-1, "invalid UTF-8 data; try read_bytes()");
+        return ZIS_THR;
+    }
+    z->callstack->frame[0] = zis_object_from(str);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_read_bytes, z, {1, 1, 2}) {
+    /*#DOCSTR# func read_bytes(stream :: Stream, ?max_size :: Int) :: Bytes | Nil
+    Reads available data as bytes without blocking. Returns empty bytes if no
+    data is available now, or nil at the end of the stream. */
+    struct io_handle *h;
+    char *buffer;
+    const size_t n = io_read_to_buffer(z, &h, &buffer);
+    if (n == (size_t)-2)
+        return ZIS_THR;
+    if (n == (size_t)-1) {
+        zis_load_nil(z, 0, 1);
+        return ZIS_OK;
+    }
+    struct zis_bytes_obj *const bytes = zis_bytes_obj_new(z, buffer, n);
+    zis_mem_free(buffer);
+    z->callstack->frame[0] = zis_object_from(bytes);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_write, z, {2, 0, 4}) {
+    /*#DOCSTR# func write(stream :: Stream, data :: String | Bytes)
+    Writes data without blocking. Data that cannot be written now is buffered and
+    will be written by the event loop, before the `on_writable()` callback is
+    called again. */
+    struct io_handle *const h = io_handle_of(z, z->callstack->frame[1]);
+    if (!h)
+        return io_throw_not_stream(z, 1);
+    bool ok;
+    struct zis_object *const data = z->callstack->frame[2];
+    if (zis_object_type_is(data, z->globals->type_Bytes)) {
+        struct zis_bytes_obj *const bytes = zis_object_cast(data, struct zis_bytes_obj);
+        ok = io_handle_send(h, zis_bytes_obj_data(bytes), zis_bytes_obj_size(bytes));
+    } else {
+        size_t size;
+        zis_if_err (zis_read_string(z, 2, NULL, &size)) {
+            zis_make_exception(z, 0, "type", 2, "the data must be a String or Bytes");
+            return ZIS_THR;
+        }
+        char *const buffer = zis_mem_alloc(size ? size : 1);
+        zis_read_string(z, 2, buffer, &size);
+        ok = io_handle_send(h, buffer, size);
+        zis_mem_free(buffer);
+    }
+    if (!ok)
+        return io_throw_errno(z, "write");
+    if (h->out_size) {
+        io_loop_load(z, 3);
+        struct zis_array_obj *const watcher = io_watcher_find(z, 3, 1, 4, h, true);
+        io_watcher_update(z, io_loop_at(z, 3), watcher, h);
+    }
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_close, z, {1, 0, 3}) {
+    /*#DOCSTR# func close(stream :: Stream)
+    Stops watching the stream and closes it. Buffered output that cannot be
+    written now is discarded. */
+    struct io_handle *const h = io_handle_of(z, z->callstack->frame[1]);
+    if (!h) {
+        zis_load_nil(z, 0, 1);
+        return ZIS_OK;
+    }
+    io_handle_flush_some(h);
+    h->out_size = 0;
+    io_loop_load(z, 2);
+    struct zis_array_obj *const watcher = io_watcher_find(z, 2, 1, 3, h, false);
+    if (watcher) {
+        struct zis_object *const nil = zis_object_from(z->globals->val_nil);
+        zis_array_obj_set(watcher, IO_WATCHER_ON_READABLE, nil);
+        zis_array_obj_set(watcher, IO_WATCHER_ON_WRITABLE, nil);
+        io_watcher_update(z, io_loop_at(z, 2), watcher, h);
+    }
+    zis_stream_obj_close(zis_object_cast(z->callstack->frame[1], struct zis_stream_obj));
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_on_readable, z, {2, 0, 4}) {
+    /*#DOCSTR# func on_readable(stream :: Stream, callback :: Callable | Nil)
+    Sets the function to call as `callback(stream)` when the stream becomes
+    readable, at the end of the stream, or on errors. Assign nil to stop. */
+    return io_watch(z, IO_WATCHER_ON_READABLE);
+}
+
+ZIS_NATIVE_FUNC_DEF(F_on_writable, z, {2, 0, 4}) {
+    /*#DOCSTR# func on_writable(stream :: Stream, callback :: Callable | Nil)
+    Sets the function to call as `callback(stream)` when the stream becomes
+    writable and the buffered output has been written. Assign nil to stop. */
+    return io_watch(z, IO_WATCHER_ON_WRITABLE);
+}
+
+ZIS_NATIVE_FUNC_DEF(F_set_timeout, z, {2, 0, 8}) {
+    /*#DOCSTR# func set_timeout(delay :: Int | Float, callback :: Callable) :: Int
+    Calls `callback()` once after `delay` milliseconds. Returns the timer ID. */
+    return io_timer_new(z, false);
+}
+
+ZIS_NATIVE_FUNC_DEF(F_set_interval, z, {2, 0, 8}) {
+    /*#DOCSTR# func set_interval(period :: Int | Float, callback :: Callable) :: Int
+    Calls `callback()` every `period` milliseconds. Returns the timer ID. */
+    return io_timer_new(z, true);
+}
+
+ZIS_NATIVE_FUNC_DEF(F_clear_timer, z, {1, 0, 2}) {
+    /*#DOCSTR# func clear_timer(id :: Int)
+    Cancels a timer. */
+    struct zis_object *const id = z->callstack->frame[1];
+    struct zis_array_obj *const timers = io_loop_array(io_loop_load(z, 2), IO_LOOP_TIMERS);
+    for (size_t i = 0, n = zis_array_obj_length(timers); i < n; i++) {
+        struct zis_tuple_obj *const t =
+            zis_object_cast(zis_array_obj_get(timers, i), struct zis_tuple_obj);
+        if (zis_tuple_obj_get(t, IO_TIMER_ID) == id) {
+            zis_array_obj_remove(z, timers, i);
+            break;
+        }
+    }
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_now, z, {0, 0, 0}) {
+    /*#DOCSTR# func now() :: Int
+    Returns the time of the monotonic clock that timers use, in milliseconds. */
+    zis_make_int(z, 0, io_now_ms());
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_stop, z, {0, 0, 1}) {
+    /*#DOCSTR# func stop()
+    Makes `run()` return after the current callback. */
+    zis_array_obj_set(io_loop_load(z, 1), IO_LOOP_STOP, zis_object_from(z->globals->val_true));
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_run, z, {0, 0, 8}) {
+    /*#DOCSTR# func run()
+    Runs the event loop, until there is nothing to watch and no timers, or until
+    `stop()` is called. Exceptions thrown by callbacks stop the loop and are
+    re-thrown. */
+    struct zis_array_obj *loop = io_loop_load(z, 1);
+    if (io_loop_int(loop, IO_LOOP_EPOLL_FD) != -1) {
+        zis_make_exception(z, 0, "sys", (unsigned int)-1, "the event loop is already running");
+        return ZIS_THR;
+    }
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1)
+        return io_throw_errno(z, "epoll_create1");
+    zis_array_obj_set(loop, IO_LOOP_EPOLL_FD, zis_smallint_to_ptr(epoll_fd));
+    zis_array_obj_set(loop, IO_LOOP_STOP, zis_object_from(z->globals->val_false));
+    struct io_loop_foreach_state foreach_state = { z, loop };
+    zis_map_obj_foreach(z, io_loop_watchers(loop), _io_loop_register_all_fn, &foreach_state);
+
+    struct epoll_event events[IO_LOOP_MAX_EVENTS];
+    int status = ZIS_OK;
+    while (true) {
+        loop = io_loop_at(z, 1);
+        if (zis_array_obj_get(loop, IO_LOOP_STOP) == zis_object_from(z->globals->val_true))
+            break;
+        if (!zis_array_obj_length(io_loop_array(loop, IO_LOOP_READY)) &&
+                !zis_array_obj_length(io_loop_array(loop, IO_LOOP_TIMERS))) {
+            // About to wait without a timeout.
+            io_loop_forget_closed(z, 1);
+            loop = io_loop_at(z, 1);
+        }
+        struct zis_array_obj *const timers = io_loop_array(loop, IO_LOOP_TIMERS);
+        const size_t ready_count = zis_array_obj_length(io_loop_array(loop, IO_LOOP_READY));
+        if (!zis_map_obj_length(io_loop_watchers(loop)) && !zis_array_obj_length(timers))
+            break;
+
+        int timeout = -1;
+        if (ready_count) {
+            timeout = 0;
+        } else if (zis_array_obj_length(timers)) {
+            struct zis_tuple_obj *const first =
+                zis_object_cast(zis_array_obj_get(timers, 0), struct zis_tuple_obj);
+            const int64_t dt =
+                zis_smallint_from_ptr(zis_tuple_obj_get(first, IO_TIMER_DEADLINE)) - io_now_ms();
+            timeout = dt <= 0 ? 0 : dt > INT32_MAX ? INT32_MAX : (int)dt;
+        }
+
+        const int n = epoll_wait(epoll_fd, events, IO_LOOP_MAX_EVENTS, timeout);
+        if (n == -1 && errno != EINTR) {
+            status = io_throw_errno(z, "epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n && status == ZIS_OK; i++)
+            status = io_loop_dispatch(z, events[i].data.fd, events[i].events);
+        if (status != ZIS_OK)
+            break;
+
+        if (ready_count) {
+            // Callbacks may change the list, so iterate over a copy.
+            struct zis_tuple_obj *const ready_copy = zis_tuple_obj_new(
+                z, NULL, zis_array_obj_length(io_loop_array(io_loop_at(z, 1), IO_LOOP_READY))
+            );
+            struct zis_array_obj *const ready = io_loop_array(io_loop_at(z, 1), IO_LOOP_READY);
+            for (size_t i = 0, n = zis_tuple_obj_length(ready_copy); i < n; i++)
+                ready_copy->_data[i] = zis_array_obj_get(ready, i);
+            zis_object_write_barrier_n(ready_copy, ready_copy->_data, zis_tuple_obj_length(ready_copy));
+            z->callstack->frame[5] = zis_object_from(ready_copy);
+            bool closed_found = false;
+            for (size_t i = 0; status == ZIS_OK; i++) {
+                struct zis_tuple_obj *const list =
+                    zis_object_cast(z->callstack->frame[5], struct zis_tuple_obj);
+                if (i >= zis_tuple_obj_length(list))
+                    break;
+                struct io_handle *const h = io_handle_of(z, zis_tuple_obj_get(list, i));
+                if (h)
+                    status = io_loop_dispatch(z, h->fd, EPOLLIN | EPOLLOUT);
+                else
+                    closed_found = true;
+            }
+            if (status != ZIS_OK)
+                break;
+            if (closed_found)
+                io_loop_forget_closed(z, 1);
+        }
+
+        status = io_loop_run_timers(z);
+        if (status != ZIS_OK)
+            break;
+    }
+
+    loop = io_loop_at(z, 1);
+    close(epoll_fd);
+    zis_array_obj_set(loop, IO_LOOP_EPOLL_FD, zis_smallint_to_ptr(-1));
+    foreach_state.loop = loop;
+    zis_map_obj_foreach(z, io_loop_watchers(loop), _io_loop_unregister_all_fn, &foreach_state);
+    if (status != ZIS_OK)
+        return status;
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF_LIST(
+    D_functions,
+    { NULL           , &F_init         },
+    { "pipe"         , &F_pipe         },
+    { "open"         , &F_open         },
+    { "listen"       , &F_listen       },
+    { "accept"       , &F_accept       },
+    { "connect"      , &F_connect      },
+    { "port"         , &F_port         },
+    { "read"         , &F_read         },
+    { "read_bytes"   , &F_read_bytes   },
+    { "write"        , &F_write        },
+    { "close"        , &F_close        },
+    { "on_readable"  , &F_on_readable  },
+    { "on_writable"  , &F_on_writable  },
+    { "set_timeout"  , &F_set_timeout  },
+    { "set_interval" , &F_set_interval },
+    { "clear_timer"  , &F_clear_timer  },
+    { "now"          , &F_now          },
+    { "stop"         , &F_stop         },
+    { "run"          , &F_run          },
+);
+
+ZIS_NATIVE_MODULE(io) = {
+    .functions = D_functions,
+    .types     = NULL,
+    .variables = NULL,
+};
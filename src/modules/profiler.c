@@ -0,0 +1,124 @@
+//%% [module]
+//%% name = profiler
+//%% description = CPU and allocation profilers.
+//%% when = ZIS_FEATURE_PROF
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <zis.h>
+
+/// Read an optional non-negative Int argument. Returns false if it is invalid.
+static bool read_opt_uint(zis_t z, unsigned int reg, uint64_t *value) {
+    int64_t v;
+    if (zis_read_nil(z, reg) == ZIS_OK) {
+        *value = 0;
+        return true;
+    }
+    if (zis_read_int(z, reg, &v) != ZIS_OK || v < 0)
+        return false;
+    *value = (uint64_t)v;
+    return true;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_start, z, {0, 1, 1}) {
+    /*#DOCSTR# func start(?interval_us :: Int)
+    Starts the CPU profiler, which samples the call stack every `interval_us`
+    microseconds of CPU time (1000 by default). */
+    uint64_t interval;
+    if (!read_opt_uint(z, 1, &interval) || interval > UINT32_MAX) {
+        zis_make_exception(z, 0, "value", 1, "illegal interval");
+        return ZIS_THR;
+    }
+    zis_if_err (zis_start_profiler(z, (unsigned int)interval)) {
+        zis_make_exception(z, 0, NULL, (unsigned)-1, "the profiler is not available");
+        return ZIS_THR;
+    }
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_stop, z, {0, 1, 1}) {
+    /*#DOCSTR# func stop(?file :: String)
+    Stops the CPU profiler and writes the sampled stacks to `file` in the
+    folded-stack format, which flame graph tools accept. The samples are
+    dropped if `file` is not given. */
+    int status;
+    if (zis_read_nil(z, 1) == ZIS_OK) {
+        status = zis_stop_profiler(z, NULL);
+    } else {
+        size_t file_sz;
+        zis_if_err (zis_read_string(z, 1, NULL, &file_sz)) {
+            zis_make_exception(z, 0, "type", 1, "not a string");
+            return ZIS_THR;
+        }
+        char *file = malloc(file_sz + 1);
+        zis_read_string(z, 1, file, &file_sz);
+        file[file_sz] = 0;
+        status = zis_stop_profiler(z, file);
+        free(file);
+    }
+    zis_if_err (status) {
+        zis_make_exception(z, 0, NULL, 1, "the profiler is not running or the file cannot be written");
+        return ZIS_THR;
+    }
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_start_alloc, z, {0, 1, 1}) {
+    /*#DOCSTR# func start_alloc(?interval :: Int)
+    Starts the allocation profiler, which samples object allocations about once
+    every `interval` bytes (64 KiB by default; 1 to record every allocation). */
+    uint64_t interval;
+    if (!read_opt_uint(z, 1, &interval) || interval > SIZE_MAX) {
+        zis_make_exception(z, 0, "value", 1, "illegal interval");
+        return ZIS_THR;
+    }
+    zis_if_err (zis_start_alloc_profiler(z, (size_t)interval)) {
+        zis_make_exception(z, 0, NULL, (unsigned)-1, "the allocation profiler is not available");
+        return ZIS_THR;
+    }
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_alloc_report, z, {0, 0, 0}) {
+    /*#DOCSTR# func alloc_report() :: Array[Tuple]
+    Returns the allocation sites sampled by the allocation profiler, as an array
+    of `(type, func, offset, line, count, bytes)` tuples in descending order of
+    `bytes`. `func` is the bytecode function that allocates the objects, and
+    `offset` and `line` are the position in it; they are nil if unknown. The
+    profiler keeps running. */
+    zis_if_err (zis_read_alloc_profile(z, 0)) {
+        zis_make_exception(z, 0, NULL, (unsigned)-1, "the allocation profiler is not running");
+        return ZIS_THR;
+    }
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF(F_stop_alloc, z, {0, 0, 0}) {
+    /*#DOCSTR# func stop_alloc()
+    Stops the allocation profiler and drops the samples. */
+    zis_if_err (zis_stop_alloc_profiler(z)) {
+        zis_make_exception(z, 0, NULL, (unsigned)-1, "the allocation profiler is not running");
+        return ZIS_THR;
+    }
+    zis_load_nil(z, 0, 1);
+    return ZIS_OK;
+}
+
+ZIS_NATIVE_FUNC_DEF_LIST(
+    D_functions,
+    { "start"       , &F_start        },
+    { "stop"        , &F_stop         },
+    { "start_alloc" , &F_start_alloc  },
+    { "alloc_report", &F_alloc_report },
+    { "stop_alloc"  , &F_stop_alloc   },
+);
+
+ZIS_NATIVE_MODULE(profiler) = {
+    .functions = D_functions,
+    .types     = NULL,
+    .variables = NULL,
+};
@@ -27,7 +27,7 @@ ZIS_NATIVE_FUNC_DEF(F_check_equal, z, {2, 1, 5}) {
         equals = zis_read_nil(z, 2) == ZIS_OK;
     } else if (zis_read_bool(z, 1, values.b + 0) == ZIS_OK) {
         equals =
-            zis_read_bool(z, 1, values.b + 1) == ZIS_OK &&
+            zis_read_bool(z, 2, values.b + 1) == ZIS_OK &&
             values.b[0] == values.b[1];
     } else if (zis_read_int(z, 2, values.i + 0) == ZIS_OK) {
         equals =
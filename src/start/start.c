@@ -15,12 +15,16 @@ static_assert(EXIT_BADARGS != EXIT_SUCCESS, "");
 static void oh_help(struct clopts_context *, const char *, void *);
 static void oh_version(struct clopts_context *, const char *, void *);
 static void oh_interactive(struct clopts_context *, const char *, void *);
+static void oh_snapshot(struct clopts_context *, const char *, void *);
+static void oh_profile(struct clopts_context *, const char *, void *);
 static void rest_args_handler(struct clopts_context *, const char *[], int, void *);
 
 static const struct clopts_option program_options[] = {
     {'h', NULL, oh_help, "Print help message and exit."},
     {'v', NULL, oh_version, "Print version and build information, and exit."},
     {'i', NULL, oh_interactive, "Enter the interactive mode."},
+    {'s', "FILE", oh_snapshot, "Start from the heap snapshot FILE; create it if it is missing or outdated."},
+    {'p', "FILE", oh_profile, "Profile the program and write the sampled stacks to FILE in the folded-stack format."},
     {0, 0, 0, 0},
 };
 
@@ -48,7 +52,7 @@ static const char *const program_environ_helps[] = {
     ZIS_ENVIRON_NAME_MEMS
     "\0Object memory configuration. "
     "Syntax: \"STACK_SZ;<heap_opts>\", "
-    "syntax for <heap_opts>: \"NEW_SPC,OLD_SPC_NEW:OLD_SPC_MAX,BIG_SPC_NEW:BIG_SPC_MAX\".",
+    "syntax for <heap_opts>: \"NEW_SPC[:NEW_SPC_MAX],OLD_SPC_NEW:OLD_SPC_MAX,BIG_SPC_NEW:BIG_SPC_MAX\".",
     // See "core/context.c"
 #endif // ZIS_ENVIRON_NAME_MEMS
 #if ZIS_DEBUG_LOGGING && defined(ZIS_ENVIRON_NAME_DEBUG_LOG)
@@ -62,6 +66,8 @@ static const char *const program_environ_helps[] = {
 struct command_line_args {
     const char **rest_args;
     size_t rest_args_num;
+    const char *snapshot_file;
+    const char *profile_file;
     bool force_interactive;
 };
 
@@ -103,6 +109,18 @@ static void oh_interactive(struct clopts_context *ctx, const char *arg, void *_d
     args->force_interactive = true;
 }
 
+static void oh_snapshot(struct clopts_context *ctx, const char *arg, void *_data) {
+    (void)ctx;
+    struct command_line_args *args = _data;
+    args->snapshot_file = arg;
+}
+
+static void oh_profile(struct clopts_context *ctx, const char *arg, void *_data) {
+    (void)ctx;
+    struct command_line_args *args = _data;
+    args->profile_file = arg;
+}
+
 static void rest_args_handler(
     struct clopts_context *ctx, const char *argv[], int argc, void *_data
 ) {
@@ -179,8 +197,23 @@ static int start(zis_t z, void *_args) {
 static int zis_main(int argc, char *argv[]) {
     struct command_line_args args;
     parse_command_line_args(argc, argv, &args);
-    struct zis_context *const z = zis_create();
+    struct zis_context *z;
+    if (args.snapshot_file) {
+        z = zis_create_from_snapshot(args.snapshot_file);
+        if (!z) {
+            z = zis_create();
+            zis_save_snapshot(z, args.snapshot_file);
+        }
+    } else {
+        z = zis_create();
+    }
+    if (args.profile_file && zis_start_profiler(z, 0) != ZIS_OK) {
+        fputs(ZIS_DISPLAY_NAME ": the profiler is not available\n", stderr);
+        args.profile_file = NULL;
+    }
     int exit_status = zis_native_block(z, 2, start, &args);
+    if (args.profile_file && zis_stop_profiler(z, args.profile_file) != ZIS_OK)
+        fprintf(stderr, ZIS_DISPLAY_NAME ": cannot write %s\n", args.profile_file);
     zis_destroy(z);
     return exit_status;
 }
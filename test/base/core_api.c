@@ -1,5 +1,6 @@
 #include "test.h"
 
+#include <errno.h>
 #include <float.h>
 #include <inttypes.h>
 #include <setjmp.h>
@@ -34,6 +35,121 @@ zis_test_define(at_panic, z) {
     zis_test_assert(panicked);
 }
 
+#define TEST_PROFILER_FILE "core_api_profiler.tmp"
+
+zis_test_define(profiler, z) {
+    const char *code =
+        "func f(n)\n"
+        "    i = 0\n"
+        "    while i < n\n"
+        "        i = i + 1\n"
+        "    end\n"
+        "    return i\n"
+        "end\n"
+        "n = f(3000000)\n";
+
+    int status = zis_start_profiler(z, 100);
+    if (status == ZIS_E_ARG) {
+        zis_test_log(ZIS_TEST_LOG_STATUS, "profiler not available");
+        zis_test_assert_eq(zis_stop_profiler(z, NULL), ZIS_E_ARG);
+        return;
+    }
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_test_assert_eq(zis_start_profiler(z, 100), ZIS_E_ARG); // already running
+    status = zis_import(z, 1, code, ZIS_IMP_CODE);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_stop_profiler(z, TEST_PROFILER_FILE);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_test_assert_eq(zis_stop_profiler(z, NULL), ZIS_E_ARG); // not running
+
+    // Each line looks like "FRAME;...;FRAME COUNT".
+    FILE *fp = fopen(TEST_PROFILER_FILE, "r");
+    zis_test_assert(fp);
+    char line[256];
+    unsigned long total = 0;
+    while (fgets(line, sizeof line, fp)) {
+        line[strcspn(line, "\n")] = 0;
+        const char *count_str = strrchr(line, ' ');
+        zis_test_assert(count_str);
+        zis_test_log(ZIS_TEST_LOG_TRACE, "%s", line);
+        total += strtoul(count_str + 1, NULL, 10);
+    }
+    fclose(fp);
+    remove(TEST_PROFILER_FILE);
+    zis_test_log(ZIS_TEST_LOG_STATUS, "%lu samples", total);
+    zis_test_assert(total > 0);
+}
+
+#define TEST_HEAP_DUMP_FILE "core_api_heap_dump.tmp"
+
+static int heap_dump_addr_compare(const void *a, const void *b) {
+    const uintptr_t x = *(const uintptr_t *)a, y = *(const uintptr_t *)b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+zis_test_define(heap_dump, z) {
+    int status = zis_import(z, 1, "kept = [[1, 2], (3, 4)]\n", ZIS_IMP_CODE);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_test_assert_eq(zis_dump_heap(z, TEST_HEAP_DUMP_FILE), ZIS_OK);
+
+    FILE *fp = fopen(TEST_HEAP_DUMP_FILE, "rb");
+    zis_test_assert(fp);
+    fseek(fp, 0, SEEK_END);
+    const size_t file_size = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    uintptr_t *const data = malloc(file_size);
+    zis_test_assert_eq(fread(data, 1, file_size, fp), file_size);
+    fclose(fp);
+    remove(TEST_HEAP_DUMP_FILE);
+
+    // Header: magic, version, word size, byte order, and the numbers of objects, roots, and types.
+    const char *const header = (const char *)data;
+    zis_test_assert_eq(memcmp(header, "ZISHDMP", 8), 0);
+    uint64_t counts[3];
+    memcpy(counts, header + 16, sizeof counts);
+    zis_test_log(
+        ZIS_TEST_LOG_STATUS, "%llu objects, %llu roots, %llu types",
+        (unsigned long long)counts[0], (unsigned long long)counts[1], (unsigned long long)counts[2]
+    );
+    zis_test_assert(counts[0] > 0 && counts[1] > 0 && counts[2] > 0);
+
+    // Objects: address, type, size, N, N references.
+    const uintptr_t *p = data + 40 / sizeof(uintptr_t);
+    const uintptr_t *const end = data + file_size / sizeof(uintptr_t);
+    uintptr_t *const addrs = malloc((size_t)counts[0] * sizeof(uintptr_t));
+    const uintptr_t *const objects_begin = p;
+    for (size_t i = 0; i < counts[0]; i++) {
+        zis_test_assert(p + 4 <= end);
+        addrs[i] = p[0];
+        zis_test_assert(p[2] > 0);
+        p += 4 + p[3];
+    }
+    qsort(addrs, (size_t)counts[0], sizeof(uintptr_t), heap_dump_addr_compare);
+    // Every type, reference, and root is an object in the dump.
+    for (const uintptr_t *q = objects_begin; q < p; q += 4 + q[3]) {
+        zis_test_assert(bsearch(&q[1], addrs, (size_t)counts[0], sizeof(uintptr_t), heap_dump_addr_compare));
+        for (size_t j = 0; j < q[3]; j++)
+            zis_test_assert(bsearch(&q[4 + j], addrs, (size_t)counts[0], sizeof(uintptr_t), heap_dump_addr_compare));
+    }
+    for (size_t i = 0; i < counts[1]; i++, p++)
+        zis_test_assert(bsearch(p, addrs, (size_t)counts[0], sizeof(uintptr_t), heap_dump_addr_compare));
+    // Types: address, name length, name.
+    bool found_array = false;
+    for (size_t i = 0; i < counts[2]; i++) {
+        zis_test_assert(p + 2 <= end);
+        zis_test_assert(bsearch(p, addrs, (size_t)counts[0], sizeof(uintptr_t), heap_dump_addr_compare));
+        const size_t name_len = p[1];
+        if (name_len == 5 && !memcmp(p + 2, "Array", 5))
+            found_array = true;
+        p += 2 + (name_len + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+    }
+    zis_test_assert_eq(p, end);
+    zis_test_assert(found_array);
+
+    free(addrs);
+    free(data);
+}
+
 // zis-api-natives //
 
 #define TEST_NATIVE_BLOCK_ARG   ((void *)1234)
@@ -111,9 +227,14 @@ static void do_test_int64(zis_t z, int64_t v) {
     zis_test_log(ZIS_TEST_LOG_TRACE, "v=%" PRIi64, v);
     status = zis_make_int(z, 0, v);
     zis_test_assert_eq(status, ZIS_OK);
+    errno = ERANGE; // A stale `errno` must not make INT64_MIN an error.
     status = zis_read_int(z, 0, &value);
     zis_test_assert_eq(status, ZIS_OK);
     zis_test_assert_eq(value, v);
+    errno = ERANGE;
+    status = zis_read_values(z, 0, "i", &value);
+    zis_test_assert_eq(status, 1);
+    zis_test_assert_eq(value, v);
 }
 
 static void do_test_int_str(zis_t z, int64_t v) {
@@ -172,6 +293,7 @@ zis_test_define(int_, z) {
         do_test_int64(z, i);
         do_test_int_str(z, i);
     }
+    do_test_int64(z, INT64_MIN);
     do_test_int64(z, INT64_MIN + 1);
     do_test_int64(z, INT64_MAX);
     do_test_int_str_2(z, "10000000000000000000000000000000000000000000000", 10);
@@ -752,6 +874,23 @@ zis_test_define(module, z) {
     }
 }
 
+zis_test_define(typed_array_length, z) {
+    // Lengths whose storage size does not fit in `size_t`, or that are out of range.
+    const char *const code_list[] = {
+        "Int64Array.new(2305843009213693952)",
+        "Int64Array.new(2305843009213693951)",
+        "Float64Array.new(1152921504606846976)",
+        "UInt8Array.new(0x7fffffffffffffff)",
+        "UInt8Array.new(-0x10000000000000000)",
+    };
+    for (size_t i = 0; i < sizeof code_list / sizeof code_list[0]; i++) {
+        zis_test_log(ZIS_TEST_LOG_TRACE, "%s", code_list[i]);
+        const int status = zis_import(z, 0, code_list[i], ZIS_IMP_CODE);
+        zis_test_assert_eq(status, ZIS_THR);
+        do_test_function__check_exception(z, 0, "value");
+    }
+}
+
 // zis-api-variables //
 
 ZIS_NATIVE_FUNC_DEF(F_test_load_store_global, z, {0, 0, 10}) {
@@ -1064,6 +1203,8 @@ zis_test_list(
     REG_MAX,
     // zis-api-context //
     zis_test_case(at_panic),
+    zis_test_case(profiler),
+    zis_test_case(heap_dump),
     // zis-api-native //
     zis_test_case(native_block),
     // zis-api-values //
@@ -1082,6 +1223,7 @@ zis_test_list(
     zis_test_case(function),
     zis_test_case(type),
     zis_test_case(module),
+    zis_test_case(typed_array_length),
     // zis-api-variables //
     zis_test_case(load_store_global),
     zis_test_case(load_element),
@@ -286,6 +286,182 @@ zis_test_define(crlf, z) {
     comp_wrong_code(z, "x = 1 \r \n x += 2");
 }
 
+/// Compiles the code from a non-static string stream, whose buffer ends right after the code.
+static void comp_and_exec_stream(zis_t z, const char *restrict code, bool from_str_obj) {
+    int status;
+    if (from_str_obj) {
+        status = zis_make_string(z, 1, code, (size_t)-1);
+        zis_test_assert_eq(status, ZIS_OK);
+        status = zis_make_stream(z, 0, ZIS_IOS_TEXT, NULL, 1);
+    } else {
+        status = zis_make_stream(z, 0, ZIS_IOS_TEXT, code, (size_t)-1);
+    }
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_import(z, 0, NULL, ZIS_IMP_CODE);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, 0, "x", (size_t)-1, 0);
+    zis_test_assert_eq(status, ZIS_OK);
+}
+
+zis_test_define(stream, z) {
+    const char *const code_list[] = {
+        "x = 12",
+        "x = 12\n",
+        "x = 12\r\n",
+        "x = 12 # comment",
+        "x = 0\r\nx += 12",
+    };
+    for (size_t i = 0; i < sizeof code_list / sizeof code_list[0]; i++) {
+        zis_test_log(ZIS_TEST_LOG_TRACE, "stream: %s", code_list[i]);
+        comp_and_exec_stream(z, code_list[i], false);
+        check_int_value(z, 12);
+        comp_and_exec_stream(z, code_list[i], true);
+        check_int_value(z, 12);
+    }
+}
+
+#define TEST_SOURCE_FILE "core_compile_source_tmp.zis"
+
+/// Writes a source file of `size` bytes that sets `x` to 12 and ends without a newline.
+static void write_large_source_file(size_t size) {
+    FILE *fp = fopen(TEST_SOURCE_FILE, "wb");
+    zis_test_assert(fp);
+    const char head[] = "x = 12\n";
+    fputs(head, fp);
+    size_t n = sizeof head - 1;
+    while (n < size) {
+        const size_t line_size = size - n < 64 ? size - n : 64;
+        fputc('#', fp);
+        for (size_t i = 1; i < line_size - 1; i++)
+            fputc('-', fp);
+        if (line_size > 1)
+            fputc(n + line_size < size ? '\n' : '-', fp);
+        n += line_size;
+    }
+    fclose(fp);
+}
+
+static void comp_and_exec_file_stream(zis_t z, size_t buffer_size) {
+    int status;
+    status = zis_make_stream(
+        z, 0, ZIS_IOS_FILE | ZIS_IOS_RDONLY | ZIS_IOS_BUFSZ,
+        TEST_SOURCE_FILE, "UTF-8", buffer_size
+    );
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_import(z, 0, NULL, ZIS_IMP_CODE);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, 0, "x", (size_t)-1, 0);
+    zis_test_assert_eq(status, ZIS_OK);
+    check_int_value(z, 12);
+}
+
+static void import_source_file(zis_t z) {
+    int status;
+    status = zis_import(z, 0, TEST_SOURCE_FILE, ZIS_IMP_PATH);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, 0, "x", (size_t)-1, 0);
+    zis_test_assert_eq(status, ZIS_OK);
+    check_int_value(z, 12);
+}
+
+zis_test_define(file_stream, z) {
+    // The loader maps a source file larger than its 64 KiB buffer into memory,
+    // and reads the mapping in 64 KiB windows. Sizes are multiples of the page
+    // size, so the mapping ends right after the code.
+    const size_t file_size_list[] = { 4096, 68 * 1024, 128 * 1024 };
+    for (size_t i = 0; i < sizeof file_size_list / sizeof file_size_list[0]; i++) {
+        const size_t file_size = file_size_list[i];
+        zis_test_log(ZIS_TEST_LOG_TRACE, "file_stream: file size %zu", file_size);
+        write_large_source_file(file_size);
+        comp_and_exec_file_stream(z, 1024);
+        comp_and_exec_file_stream(z, 0);
+        comp_and_exec_file_stream(z, file_size * 2);
+        import_source_file(z);
+    }
+    remove(TEST_SOURCE_FILE);
+}
+
+static void write_module_file(const char *name, const char *code) {
+    char file[64];
+    snprintf(file, sizeof file, "%s.zis", name);
+    FILE *fp = fopen(file, "w");
+    zis_test_assert(fp);
+    fputs(code, fp);
+    fclose(fp);
+}
+
+static void remove_module_file(const char *name) {
+    char file[64];
+    snprintf(file, sizeof file, "%s.zis", name);
+    remove(file);
+}
+
+zis_test_define(import, z) {
+    int status;
+    status = zis_import(z, 0, ".", ZIS_IMP_ADDP);
+    zis_test_assert_eq(status, ZIS_OK);
+
+    // Modules are initialized in the order in which they are imported.
+    write_module_file(
+        "core_compile_m_log",
+        "log = []\n"
+    );
+    write_module_file(
+        "core_compile_m_a",
+        "import core_compile_m_log\n"
+        "core_compile_m_log.log:append('a1')\n"
+        "import core_compile_m_b\n"
+        "core_compile_m_log.log:append('a2')\n"
+        "import core_compile_m_c\n"
+        "log = core_compile_m_log.log\n"
+        "order = log[1] + log[2] + log[3] + log[4]\n"
+    );
+    write_module_file(
+        "core_compile_m_b",
+        "import core_compile_m_log\n"
+        "core_compile_m_log.log:append('b')\n"
+    );
+    write_module_file(
+        "core_compile_m_c",
+        "import core_compile_m_log\n"
+        "core_compile_m_log.log:append('c')\n"
+    );
+    status = zis_import(z, 0, "core_compile_m_a", ZIS_IMP_NAME);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, 0, "order", (size_t)-1, 0);
+    zis_test_assert_eq(status, ZIS_OK);
+    char order[16];
+    size_t order_size = sizeof order;
+    status = zis_read_string(z, 0, order, &order_size);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_test_assert_eq(order_size, 6U);
+    zis_test_assert(!memcmp(order, "a1ba2c", 6));
+
+    // A module that has failed to compile is compiled again on the next import.
+    write_module_file(
+        "core_compile_m_d",
+        "x = (\n"
+    );
+    status = zis_import(z, 0, "core_compile_m_d", ZIS_IMP_NAME);
+    zis_test_assert_eq(status, ZIS_THR);
+    write_module_file(
+        "core_compile_m_d",
+        "x = 12\n"
+    );
+    status = zis_import(z, 0, "core_compile_m_d", ZIS_IMP_NAME);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, 0, "x", (size_t)-1, 0);
+    zis_test_assert_eq(status, ZIS_OK);
+    check_int_value(z, 12);
+
+    const char *const module_list[] = {
+        "core_compile_m_log", "core_compile_m_a", "core_compile_m_b",
+        "core_compile_m_c", "core_compile_m_d",
+    };
+    for (size_t i = 0; i < sizeof module_list / sizeof module_list[0]; i++)
+        remove_module_file(module_list[i]);
+}
+
 zis_test_list(
     core_compile,
     100,
@@ -302,4 +478,7 @@ zis_test_list(
     zis_test_case(while_stmt),
     zis_test_case(func_stmt),
     zis_test_case(crlf),
+    zis_test_case(stream),
+    zis_test_case(file_stream),
+    zis_test_case(import),
 )
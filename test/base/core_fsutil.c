@@ -213,6 +213,30 @@ zis_test0_define(path_with_extension) {
 #undef DO_TEST2
 }
 
+zis_test0_define(file_map) {
+#if ZIS_FS_POSIX
+    const char *const path = __FILE__; // This source file.
+    FILE *fp = fopen(path, "rb");
+    zis_test_assert(fp);
+    char buffer[256];
+    const size_t head_size = fread(buffer, 1, sizeof buffer, fp);
+    fseek(fp, 0, SEEK_END);
+    const long file_size = ftell(fp);
+    fclose(fp);
+
+    zis_file_handle_t f = zis_file_open(path, ZIS_FILE_MODE_RD);
+    zis_test_assert(f);
+    size_t map_size = 0;
+    zis_test_assert(!zis_file_map(f, (size_t)file_size + 1, &map_size));
+    const char *addr = zis_file_map(f, 0, &map_size);
+    zis_file_close(f);
+    zis_test_assert(addr);
+    zis_test_assert_eq(map_size, (size_t)file_size);
+    zis_test_assert(memcmp(addr, buffer, head_size) == 0);
+    zis_file_unmap((void *)addr, map_size);
+#endif // ZIS_FS_POSIX
+}
+
 zis_test0_list(
     core_fsutil,
     zis_test0_case(path_len),
@@ -226,4 +250,5 @@ zis_test0_list(
     zis_test0_case(path_extension),
     zis_test0_case(path_parent),
     zis_test0_case(path_with_extension),
+    zis_test0_case(file_map),
 )
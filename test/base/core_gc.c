@@ -2,9 +2,14 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <setjmp.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "zis_config.h" // ZIS_ENVIRON_NAME_MEMS
+
 #define REG_MAX 200
 #define TMP_REG_MAX 4
 
@@ -18,6 +23,38 @@ static void clear_stack_tmp(zis_t z) {
     zis_test_assert_eq(status, ZIS_OK);
 }
 
+#ifdef ZIS_ENVIRON_NAME_MEMS
+
+/// Set or unset (if `value` is NULL) the environment variable for memory options.
+static void set_environ_mems(const char *value) {
+#ifdef _WIN32
+    _putenv_s(ZIS_ENVIRON_NAME_MEMS, value ? value : "");
+#else
+    if (value)
+        setenv(ZIS_ENVIRON_NAME_MEMS, value, 1);
+    else
+        unsetenv(ZIS_ENVIRON_NAME_MEMS);
+#endif // _WIN32
+}
+
+#endif // ZIS_ENVIRON_NAME_MEMS
+
+/// Run `fn(z, arg)` in a new instance, whose memory options are `mems` (in the
+/// syntax of the `ZIS_ENVIRON_NAME_MEMS` environment variable) if supported.
+static void run_in_new_instance(const char *mems, int (*fn)(zis_t, void *), void *arg) {
+#ifdef ZIS_ENVIRON_NAME_MEMS
+    set_environ_mems(mems);
+    zis_t z = zis_create();
+    set_environ_mems(NULL);
+#else
+    (void)mems;
+    zis_t z = zis_create();
+#endif // ZIS_ENVIRON_NAME_MEMS
+    const int status = zis_native_block(z, REG_MAX, fn, arg);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_destroy(z);
+}
+
 static void make_random_data(zis_t z, int64_t seed) {
     const int N = 200;
     int status;
@@ -262,6 +299,271 @@ zis_test_define(complex_references, z) {
     clear_stack(z);
 }
 
+struct code_run {
+    const char *code;
+    int64_t n; // Value of variable `n` in the module.
+    struct zis_gc_stats stats_before, stats_after;
+};
+
+/// Run `run->code` as a module, with GC statistics read before and after it.
+static int run_code(zis_t z, void *_run) {
+    struct code_run *const run = _run;
+    zis_gc_stats(z, &run->stats_before);
+    run->n = zis_test_run_code(z, run->code, "n");
+    zis_gc_stats(z, &run->stats_after);
+    clear_stack(z);
+    return ZIS_OK;
+}
+
+zis_test_define(pretenured_objects, z) {
+    // Objects from the first `[...]` in the loop survive, so that allocation
+    // site will be pretenured. They refer to young objects (the strings).
+    const char *const code =
+        "N = 200000\n"
+        "a = []\n"
+        "i = 0\n"
+        "while i < N\n"
+        "    s = i:to_string()\n"
+        "    a:append([s, (i, s)])\n"
+        "    x = [i, i]\n"
+        "    i = i + 1\n"
+        "end\n"
+        "n = 0\n"
+        "i = 0\n"
+        "while i < N\n"
+        "    e = a[i + 1]\n"
+        "    if e[1] == i:to_string()\n"
+        "        if e[2][1] == i\n"
+        "            if e[2][2] == e[1]\n"
+        "                n = n + 1\n"
+        "            end\n"
+        "        end\n"
+        "    end\n"
+        "    i = i + 1\n"
+        "end\n";
+    (void)z;
+    struct code_run run = { .code = code };
+    // A small new space, so that there are enough fast GCs to sample the sites.
+    run_in_new_instance("0;262144:262144", run_code, &run);
+    zis_test_assert_eq(run.n, INT64_C(200000));
+    const uint64_t old_space_allocated =
+        run.stats_after.old_space_allocated - run.stats_before.old_space_allocated;
+    const uint64_t promoted = run.stats_after.promoted - run.stats_before.promoted;
+    zis_test_log(
+        ZIS_TEST_LOG_STATUS, "old space allocated %" PRIu64 ", promoted %" PRIu64,
+        old_space_allocated, promoted
+    );
+    // Most survivors are allocated in old space instead of being promoted.
+    zis_test_assert(old_space_allocated > promoted);
+}
+
+zis_test_define(growing_large_array, z) {
+    // The slots grow far beyond the big-space limit, mostly in place.
+    const char *const code =
+        "N = 300000\n"
+        "a = []\n"
+        "i = 0\n"
+        "while i < N\n"
+        "    a:append(i:to_string())\n"
+        "    x = [i, i]\n"
+        "    i = i + 1\n"
+        "end\n"
+        "n = 0\n"
+        "i = 0\n"
+        "while i < N\n"
+        "    if a[i + 1] == i:to_string()\n"
+        "        n = n + 1\n"
+        "    end\n"
+        "    i = i + 1\n"
+        "end\n";
+    struct code_run run = { .code = code };
+    run_code(z, &run);
+    zis_test_assert_eq(run.n, INT64_C(300000));
+    const uint64_t big_space_allocated =
+        run.stats_after.big_space_allocated - run.stats_before.big_space_allocated;
+    const uint64_t slots_size = 524288 * sizeof(void *); // The capacity doubles from 4.
+    zis_test_log(
+        ZIS_TEST_LOG_STATUS, "big space allocated %" PRIu64 ", final slots %" PRIu64,
+        big_space_allocated, slots_size
+    );
+    // Copying the slots at every doubling would allocate twice the final size.
+    zis_test_assert(big_space_allocated < slots_size * 3 / 2);
+}
+
+zis_test_define(promoted_young_referents, z) {
+    // Each `[i]` is first reached from a local variable while its array is
+    // still young, and then from the old `a`, which promotes the array.
+    const char *const code =
+        "func count()\n"
+        "    a = []\n"
+        "    i = 0\n"
+        "    while i < 300000\n"
+        "        x = [i, i + 1, [i], 'abc']\n"
+        "        if i % 7 == 0\n"
+        "            a:append(x)\n"
+        "        end\n"
+        "        i = i + 1\n"
+        "    end\n"
+        "    n = 0\n"
+        "    i = 0\n"
+        "    while i < a:length()\n"
+        "        if a[i + 1][3][1] == i * 7\n"
+        "            n = n + 1\n"
+        "        end\n"
+        "        i = i + 1\n"
+        "    end\n"
+        "    return n\n"
+        "end\n"
+        "n = count()\n";
+    struct code_run run = { .code = code };
+    run_code(z, &run);
+    zis_test_assert_eq(run.n, INT64_C(42858));
+    zis_test_assert(run.stats_after.promoted > run.stats_before.promoted);
+}
+
+zis_test_define(buffered_stack_traces, z) {
+    // More exceptions are kept alive than the stack trace buffer can hold, with
+    // collections in between, so that records are flushed, moved, and dropped.
+    const char *const code =
+        "func f(n)\n"
+        "    if n == 0\n"
+        "        return [][1]\n"
+        "    end\n"
+        "    return f(n - 1)\n"
+        "end\n";
+    const unsigned int func_reg = TMP_REG_MAX + 1, arg_reg = TMP_REG_MAX + 2;
+    int status = zis_import(z, func_reg, code, ZIS_IMP_CODE);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, func_reg, "f", (size_t)-1, func_reg);
+    zis_test_assert_eq(status, ZIS_OK);
+
+    const unsigned int kept_reg_begin = TMP_REG_MAX + 3, kept_count = 40;
+    for (unsigned int i = 0; i < kept_count * 2; i++) {
+        const unsigned int regs[] = {0, func_reg, arg_reg};
+        zis_make_int(z, arg_reg, (int64_t)(i % 10));
+        status = zis_invoke(z, regs, 1);
+        zis_test_assert_eq(status, ZIS_THR);
+        status = zis_read_exception(z, 0, ZIS_RDE_TEST, 0);
+        zis_test_assert_eq(status, ZIS_OK);
+        if (i & 1)
+            zis_move_local(z, kept_reg_begin + i / 2, 0);
+        make_random_data(z, (int64_t)i);
+    }
+    for (unsigned int i = 0; i < kept_count; i++) {
+        status = zis_read_exception(z, kept_reg_begin + i, ZIS_RDE_DUMP, 0);
+        zis_test_assert_eq(status, ZIS_OK);
+    }
+
+    clear_stack(z);
+}
+
+zis_test_define(gc_stats, z) {
+    struct zis_gc_stats s0, s1;
+    zis_gc_stats(z, &s0);
+
+    make_random_data(z, 0);
+    zis_move_local(z, TMP_REG_MAX + 1, 0);
+    make_random_large_object(z, 0);
+    zis_move_local(z, TMP_REG_MAX + 2, 0);
+    const unsigned long N = 1000000;
+    for (unsigned long i = 0; i < N; i++)
+        zis_make_float(z, 0, (double)i);
+
+    zis_gc_stats(z, &s1);
+    zis_test_log(
+        ZIS_TEST_LOG_STATUS, "%zu fast GCs, %zu full GCs, %" PRIu64 " ns",
+        s1.fast_gc_count, s1.full_gc_count, s1.pause_time_total
+    );
+    zis_test_assert(s1.fast_gc_count > s0.fast_gc_count);
+    zis_test_assert(s1.full_gc_count >= s0.full_gc_count);
+    size_t pause_count = 0;
+    for (size_t i = 0; i < ZIS_GC_STATS_PAUSE_BUCKETS; i++)
+        pause_count += s1.pause_histogram[i];
+    zis_test_assert_eq(pause_count, s1.fast_gc_count + s1.full_gc_count);
+    zis_test_assert(s1.pause_time_max <= s1.pause_time_total);
+    zis_test_assert(s1.new_space_allocated - s0.new_space_allocated >= N * sizeof(double));
+    zis_test_assert(s1.big_space_allocated - s0.big_space_allocated >= sizeof long_str_buf);
+    zis_test_assert(s1.promoted > s0.promoted);
+
+    zis_move_local(z, 0, TMP_REG_MAX + 2);
+    check_random_large_object(z, 0);
+    zis_move_local(z, 0, TMP_REG_MAX + 1);
+    check_random_data(z, 0);
+
+    clear_stack(z);
+}
+
+struct new_space_sizes {
+    size_t initial, final;
+};
+
+static int keep_random_data(zis_t z, void *arg) {
+    struct new_space_sizes *const sizes = arg;
+    struct zis_gc_stats stats;
+    zis_gc_stats(z, &stats);
+    sizes->initial = stats.new_space_size;
+    for (unsigned int j = 0; j < REG_MAX - TMP_REG_MAX - 1; j++) {
+        make_random_data(z, j);
+        zis_move_local(z, TMP_REG_MAX + 1 + j, 0);
+    }
+    zis_gc_stats(z, &stats);
+    sizes->final = stats.new_space_size;
+    return ZIS_OK;
+}
+
+/// Keep lots of objects alive in a new instance with memory options `mems`.
+static struct new_space_sizes new_space_sizes_with_survivors(const char *mems) {
+    struct new_space_sizes sizes;
+    run_in_new_instance(mems, keep_random_data, &sizes);
+    zis_test_log(
+        ZIS_TEST_LOG_TRACE, "%s: new space size %zu -> %zu",
+        mems, sizes.initial, sizes.final
+    );
+    return sizes;
+}
+
+zis_test_define(new_space_resizing, z) {
+    (void)z;
+#ifdef ZIS_ENVIRON_NAME_MEMS
+    struct new_space_sizes sizes;
+
+    // "NEW_SPC:NEW_SPC_MAX". Many survivors make new space grow to the maximum.
+    sizes = new_space_sizes_with_survivors("0;262144:1048576");
+    zis_test_assert_eq(sizes.initial, 262144);
+    zis_test_assert_eq(sizes.final, 1048576);
+
+    // The maximum equal to the initial size fixes the size.
+    sizes = new_space_sizes_with_survivors("0;262144:262144");
+    zis_test_assert_eq(sizes.initial, 262144);
+    zis_test_assert_eq(sizes.final, 262144);
+
+    // "NEW_SPC" only, with the remaining options.
+    sizes = new_space_sizes_with_survivors("0;262144,0:0,0:0");
+    zis_test_assert_eq(sizes.initial, 262144);
+    zis_test_assert(sizes.final > sizes.initial);
+#endif // ZIS_ENVIRON_NAME_MEMS
+}
+
+static jmp_buf oom_panic_jb;
+
+static void oom_panic_handler(zis_t z, int c) {
+    (void)z;
+    zis_test_log(ZIS_TEST_LOG_TRACE, "panic code=%i", c);
+    longjmp(oom_panic_jb, c);
+}
+
+zis_test_define(oversized_object, z) {
+    zis_at_panic(z, oom_panic_handler);
+    const int panic_code = setjmp(oom_panic_jb);
+    if (!panic_code) {
+        // The storage is too large to be mapped. The data is not read.
+        zis_make_bytes(z, 1, "", SIZE_MAX / 4);
+        zis_test_assert(false);
+    }
+    zis_at_panic(z, NULL);
+    zis_test_assert_eq(panic_code, ZIS_PANIC_OOM);
+}
+
 zis_test_list(
     core_gc,
     REG_MAX,
@@ -271,4 +573,11 @@ zis_test_list(
     zis_test_case(massive_survivors),
     zis_test_case(large_object),
     zis_test_case(complex_references),
+    zis_test_case(pretenured_objects),
+    zis_test_case(growing_large_array),
+    zis_test_case(promoted_young_referents),
+    zis_test_case(buffered_stack_traces),
+    zis_test_case(gc_stats),
+    zis_test_case(new_space_resizing),
+    zis_test_case(oversized_object),
 )
@@ -0,0 +1,137 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#define MODULE_NAME "core_reset_tmp"
+#define MODULE_FILE MODULE_NAME ".zis"
+
+static void write_module_file(int x) {
+    FILE *fp = fopen(MODULE_FILE, "w");
+    zis_test_assert(fp);
+    fprintf(fp, "x = %i\n", x);
+    fclose(fp);
+}
+
+struct import_module_args {
+    bool add_path;
+    int expected_status;
+    int64_t expected_x;
+};
+
+static int import_module(zis_t z, void *_args) {
+    const struct import_module_args *const args = _args;
+    int status;
+    if (args->add_path) {
+        status = zis_import(z, 0, ".", ZIS_IMP_ADDP);
+        zis_test_assert_eq(status, ZIS_OK);
+    }
+    status = zis_import(z, 0, MODULE_NAME, ZIS_IMP_NAME);
+    zis_test_assert_eq(status, args->expected_status);
+    if (status != ZIS_OK)
+        return ZIS_OK;
+    status = zis_load_field(z, 0, "x", (size_t)-1, 1);
+    zis_test_assert_eq(status, ZIS_OK);
+    int64_t x;
+    status = zis_read_int(z, 1, &x);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_test_assert_eq(x, args->expected_x);
+    return ZIS_OK;
+}
+
+zis_test0_define(forget_modules) {
+    zis_t z = zis_create();
+
+    write_module_file(1);
+    zis_native_block(z, 1, import_module, &(struct import_module_args){true, ZIS_OK, 1});
+    // Already loaded. The file is not read again.
+    write_module_file(2);
+    zis_native_block(z, 1, import_module, &(struct import_module_args){false, ZIS_OK, 1});
+
+    zis_reset(z);
+    // The search path has been dropped.
+    zis_native_block(z, 1, import_module, &(struct import_module_args){false, ZIS_THR, 0});
+    // The module is loaded again.
+    zis_native_block(z, 1, import_module, &(struct import_module_args){true, ZIS_OK, 2});
+
+    zis_destroy(z);
+    remove(MODULE_FILE);
+}
+
+static const char *const test_code =
+    "a = []\n"
+    "i = 0\n"
+    "while i < 20000\n"
+    "    a:append(i:to_string())\n"
+    "    i = i + 1\n"
+    "end\n"
+    "n = 0\n"
+    "i = 0\n"
+    "while i < 1000\n"
+    "    n = n + a[i + 1]:length()\n"
+    "    i = i + 1\n"
+    "end\n";
+
+/// A job that expects a clean instance: the module is read from the file and
+/// its variable `y`, which the job sets, does not exist yet.
+static int run_job(zis_t z, void *_expected_x) {
+    const int64_t expected_x = *(const int64_t *)_expected_x;
+    int status;
+    status = zis_import(z, 0, ".", ZIS_IMP_ADDP);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_import(z, 1, MODULE_NAME, ZIS_IMP_NAME);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, 1, "x", (size_t)-1, 0);
+    zis_test_assert_eq(status, ZIS_OK);
+    int64_t x;
+    status = zis_read_int(z, 0, &x);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_test_assert_eq(x, expected_x);
+    status = zis_load_field(z, 1, "y", (size_t)-1, 0);
+    zis_test_assert_eq(status, ZIS_THR);
+    zis_make_int(z, 0, x);
+    status = zis_store_field(z, 1, "y", (size_t)-1, 0);
+    zis_test_assert_eq(status, ZIS_OK);
+
+    zis_test_assert_eq(zis_test_run_code(z, test_code, "n"), INT64_C(2890));
+    return ZIS_OK;
+}
+
+zis_test0_define(reuse) {
+    const int N = 20;
+    clock_t t0, t1;
+
+    t0 = clock();
+    for (int64_t i = 0; i < N; i++) {
+        write_module_file((int)i);
+        zis_t z = zis_create();
+        zis_native_block(z, 1, run_job, &i);
+        zis_destroy(z);
+    }
+    t1 = clock();
+    const double create_time = (double)(t1 - t0) / CLOCKS_PER_SEC / N;
+
+    zis_t z = zis_create();
+    t0 = clock();
+    for (int64_t i = 0; i < N; i++) {
+        // A different file each time, which the job must import again.
+        write_module_file((int)i);
+        zis_native_block(z, 1, run_job, &i);
+        zis_reset(z);
+    }
+    t1 = clock();
+    zis_destroy(z);
+    const double reset_time = (double)(t1 - t0) / CLOCKS_PER_SEC / N;
+    remove(MODULE_FILE);
+
+    zis_test_log(
+        ZIS_TEST_LOG_STATUS, "per job: create+destroy %.3f ms; reuse+reset %.3f ms",
+        create_time * 1e3, reset_time * 1e3
+    );
+}
+
+zis_test0_list(
+    core_reset,
+    zis_test0_case(forget_modules),
+    zis_test0_case(reuse),
+)
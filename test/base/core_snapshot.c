@@ -0,0 +1,196 @@
+#include "test.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#define SNAPSHOT_FILE "core_snapshot.tmp"
+
+static const char *const test_code =
+    "m = {}\n"
+    "i = 0\n"
+    "while i < 1000\n"
+    "    m[i:to_string()] = i\n"
+    "    i = i + 1\n"
+    "end\n"
+    "a = []\n"
+    "i = 0\n"
+    "while i < 50000\n"
+    "    a:append(i:to_string())\n"
+    "    i = i + 1\n"
+    "end\n"
+    "n = 0\n"
+    "i = 0\n"
+    "while i < 1000\n"
+    "    n = n + m[a[i + 1]]\n"
+    "    i = i + 1\n"
+    "end\n";
+
+static int run_test_code(zis_t z, void *arg) {
+    (void)arg;
+    zis_test_assert_eq(zis_test_run_code(z, test_code, "n"), INT64_C(499500));
+    return ZIS_OK;
+}
+
+static void make_snapshot(void) {
+    zis_t z = zis_create();
+    const int status = zis_save_snapshot(z, SNAPSHOT_FILE);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_destroy(z);
+}
+
+zis_test0_define(save_and_restore) {
+    make_snapshot();
+    for (int i = 0; i < 2; i++) {
+        zis_t z = zis_create_from_snapshot(SNAPSHOT_FILE);
+        zis_test_assert(z);
+        zis_native_block(z, 1, run_test_code, NULL);
+        // A snapshot of a restored context.
+        const int status = zis_save_snapshot(z, SNAPSHOT_FILE);
+        zis_test_assert_eq(status, ZIS_OK);
+        zis_destroy(z);
+    }
+    remove(SNAPSHOT_FILE);
+}
+
+#define TEST_MODULE_NAME "core_snapshot_mod"
+#define TEST_MODULE_FILE TEST_MODULE_NAME ".zis"
+
+// Hash codes of functions are made from addresses, which change after restoring.
+static const char *const test_module_code =
+    "func g()\n"
+    "end\n"
+    "m = {g -> 1, (g, 1) -> 2, 'g' -> 3}\n"
+    "s = Set.new([g, (g, 1), 'g'])\n"
+    "func check()\n"
+    "    n = 0\n"
+    "    if m:get(g) == 1\n"
+    "        n = n + 1\n"
+    "    end\n"
+    "    if m:get((g, 1)) == 2\n"
+    "        n = n + 1\n"
+    "    end\n"
+    "    if m:get('g') == 3\n"
+    "        n = n + 1\n"
+    "    end\n"
+    "    if s:contains(g)\n"
+    "        n = n + 1\n"
+    "    end\n"
+    "    if s:contains((g, 1))\n"
+    "        n = n + 1\n"
+    "    end\n"
+    "    if s:contains('g')\n"
+    "        n = n + 1\n"
+    "    end\n"
+    "    return n\n"
+    "end\n";
+
+static int check_test_module(zis_t z, void *arg) {
+    const int64_t expected_n = *(const int64_t *)arg;
+    int status = zis_import(z, 1, TEST_MODULE_NAME, ZIS_IMP_NAME);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, 1, "check", (size_t)-1, 1);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_invoke(z, (unsigned[]){0, 1}, 0);
+    zis_test_assert_eq(status, ZIS_OK);
+    int64_t n;
+    status = zis_read_int(z, 0, &n);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_test_assert_eq(n, expected_n);
+    return ZIS_OK;
+}
+
+zis_test0_define(address_hashed_keys) {
+    const int64_t expected_n = 6;
+
+    FILE *fp = fopen(TEST_MODULE_FILE, "w");
+    zis_test_assert(fp);
+    fputs(test_module_code, fp);
+    fclose(fp);
+
+    zis_t z = zis_create();
+    zis_import(z, 0, ".", ZIS_IMP_ADDP);
+    zis_native_block(z, 1, check_test_module, (void *)&expected_n);
+    int status = zis_save_snapshot(z, SNAPSHOT_FILE);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_destroy(z);
+    remove(TEST_MODULE_FILE);
+
+    for (int i = 0; i < 2; i++) {
+        z = zis_create_from_snapshot(SNAPSHOT_FILE);
+        zis_test_assert(z);
+        zis_native_block(z, 1, check_test_module, (void *)&expected_n);
+        // A snapshot of a restored context.
+        status = zis_save_snapshot(z, SNAPSHOT_FILE);
+        zis_test_assert_eq(status, ZIS_OK);
+        zis_destroy(z);
+    }
+    remove(SNAPSHOT_FILE);
+}
+
+zis_test0_define(invalid_file) {
+    zis_t z;
+
+    remove(SNAPSHOT_FILE);
+    z = zis_create_from_snapshot(SNAPSHOT_FILE);
+    zis_test_assert_eq(z, NULL);
+
+    FILE *fp = fopen(SNAPSHOT_FILE, "wb");
+    zis_test_assert(fp);
+    for (int i = 0; i < 1000; i++)
+        fputs("not a snapshot ", fp);
+    fclose(fp);
+    z = zis_create_from_snapshot(SNAPSHOT_FILE);
+    zis_test_assert_eq(z, NULL);
+
+    // A truncated snapshot.
+    make_snapshot();
+    fp = fopen(SNAPSHOT_FILE, "rb");
+    zis_test_assert(fp);
+    char buffer[4096];
+    const size_t size = fread(buffer, 1, sizeof buffer, fp);
+    fclose(fp);
+    zis_test_assert_eq(size, sizeof buffer);
+    fp = fopen(SNAPSHOT_FILE, "wb");
+    zis_test_assert(fp);
+    fwrite(buffer, 1, size, fp);
+    fclose(fp);
+    z = zis_create_from_snapshot(SNAPSHOT_FILE);
+    zis_test_assert_eq(z, NULL);
+
+    remove(SNAPSHOT_FILE);
+}
+
+static uint64_t allocated_bytes(zis_t z) {
+    struct zis_gc_stats stats;
+    zis_gc_stats(z, &stats);
+    return stats.new_space_allocated + stats.old_space_allocated + stats.big_space_allocated;
+}
+
+zis_test0_define(restored_not_allocated) {
+    zis_t z = zis_create();
+    const uint64_t create_allocated = allocated_bytes(z);
+    int status = zis_save_snapshot(z, SNAPSHOT_FILE);
+    zis_test_assert_eq(status, ZIS_OK);
+    zis_destroy(z);
+
+    // The objects are read into place rather than allocated one by one.
+    z = zis_create_from_snapshot(SNAPSHOT_FILE);
+    zis_test_assert(z);
+    const uint64_t restore_allocated = allocated_bytes(z);
+    zis_destroy(z);
+    remove(SNAPSHOT_FILE);
+
+    zis_test_log(
+        ZIS_TEST_LOG_TRACE, "allocated: zis_create(): %" PRIu64 " B; zis_create_from_snapshot(): %" PRIu64 " B",
+        create_allocated, restore_allocated
+    );
+    zis_test_assert(restore_allocated < create_allocated / 10);
+}
+
+zis_test0_list(
+    core_snapshot,
+    zis_test0_case(save_and_restore),
+    zis_test0_case(address_hashed_keys),
+    zis_test0_case(invalid_file),
+    zis_test0_case(restored_not_allocated),
+)
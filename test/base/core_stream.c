@@ -0,0 +1,169 @@
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "core/streamobj.h"
+
+#define TEST_FILE "core_stream.tmp"
+
+/// The byte at offset `i` of a test file.
+static char test_file_byte(size_t i) {
+    return i % 64 == 63 ? '\n' : (char)('a' + i % 26);
+}
+
+/// Writes bytes [`begin`, `end`) of a test file, opening the file with `mode`.
+static void write_test_file(const char *mode, size_t begin, size_t end) {
+    FILE *fp = fopen(TEST_FILE, mode);
+    zis_test_assert(fp);
+    for (size_t i = begin; i < end; i++)
+        fputc(test_file_byte(i), fp);
+    fclose(fp);
+}
+
+/// Opens the test file as a UTF-8 text stream. Only one stream is used at a time,
+/// so that it is not collected by the GC while being read.
+static struct zis_stream_obj *open_test_file(zis_t z, int extra_flags, size_t buffer_size) {
+    const int flags = ZIS_STREAM_OBJ_MODE_IN | ZIS_STREAM_OBJ_TEXT | ZIS_STREAM_OBJ_UTF8 | extra_flags;
+    struct zis_stream_obj *stream = zis_stream_obj_new_file(z, ZIS_PATH_STR(TEST_FILE), flags, buffer_size);
+    zis_test_assert(stream);
+    return stream;
+}
+
+static bool stream_is_mapped(const struct zis_stream_obj *stream) {
+    return stream->_flags & ZIS_STREAM_OBJ_DIRECT;
+}
+
+/// Reads `n` characters (or until EOF) and checks them against the test file,
+/// starting from offset `pos`. Returns the number of characters read.
+static size_t read_and_check(struct zis_stream_obj *stream, size_t pos, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        const int32_t c = zis_stream_obj_read_char(stream);
+        if (c == -1)
+            break;
+        zis_test_assert_eq(c, test_file_byte(pos + i));
+    }
+    return i;
+}
+
+zis_test_define(mmap_opt_in, z) {
+    write_test_file("wb", 0, 16 * 1024);
+    struct zis_stream_obj *stream;
+
+    stream = open_test_file(z, 0, 1024);
+    zis_test_assert(!stream_is_mapped(stream));
+    zis_stream_obj_close(stream);
+
+    stream = open_test_file(z, ZIS_STREAM_OBJ_MMAP, 1024);
+    zis_test_assert(stream_is_mapped(stream));
+    zis_test_assert_eq(read_and_check(stream, 0, (size_t)-1), 16 * 1024);
+    zis_stream_obj_close(stream);
+
+    stream = open_test_file(z, ZIS_STREAM_OBJ_MMAP, 64 * 1024); // The file fits in the buffer.
+    zis_test_assert(!stream_is_mapped(stream));
+    zis_stream_obj_close(stream);
+
+    remove(TEST_FILE);
+}
+
+zis_test_define(mmap_read_bytes, z) {
+    const size_t file_size = 16 * 1024;
+    write_test_file("wb", 0, file_size);
+    const int flags = ZIS_STREAM_OBJ_MODE_IN | ZIS_STREAM_OBJ_MMAP;
+    struct zis_stream_obj *stream = zis_stream_obj_new_file(z, ZIS_PATH_STR(TEST_FILE), flags, 1024);
+    zis_test_assert(stream && stream_is_mapped(stream));
+    char buffer[3000];
+    size_t pos = 0;
+    while (true) {
+        const size_t n = zis_stream_obj_read_bytes(stream, buffer, sizeof buffer);
+        zis_test_assert(n != (size_t)-1);
+        if (!n)
+            break;
+        for (size_t i = 0; i < n; i++)
+            zis_test_assert_eq(buffer[i], test_file_byte(pos + i));
+        pos += n;
+    }
+    zis_test_assert_eq(pos, file_size);
+    zis_stream_obj_close(stream);
+    remove(TEST_FILE);
+}
+
+static void do_test_seek(struct zis_stream_obj *stream, size_t size) {
+    zis_test_assert_eq(zis_stream_obj_seek(stream, 1000, SEEK_SET), 1000);
+    zis_test_assert_eq(read_and_check(stream, 1000, 5), 5);
+    zis_test_assert_eq(zis_stream_obj_seek(stream, -15, SEEK_CUR), 990);
+    zis_test_assert_eq(read_and_check(stream, 990, 100), 100);
+    zis_test_assert_eq(zis_stream_obj_seek(stream, -3, SEEK_END), (zis_ssize_t)size - 3);
+    zis_test_assert_eq(read_and_check(stream, size - 3, 10), 3);
+    zis_test_assert_eq(zis_stream_obj_seek(stream, 0, SEEK_SET), 0);
+    zis_test_assert_eq(read_and_check(stream, 0, 10), 10);
+    zis_test_assert_eq(zis_stream_obj_seek(stream, -1, SEEK_SET), -1);
+    if (stream_is_mapped(stream))
+        zis_test_assert_eq(zis_stream_obj_seek(stream, 1, SEEK_END), -1);
+}
+
+zis_test_define(seek, z) {
+    const size_t file_size = 16 * 1024;
+    write_test_file("wb", 0, file_size);
+    struct zis_stream_obj *stream;
+
+    zis_test_log(ZIS_TEST_LOG_TRACE, "seek: file stream");
+    stream = open_test_file(z, 0, 1024);
+    do_test_seek(stream, file_size);
+    zis_stream_obj_close(stream);
+
+    zis_test_log(ZIS_TEST_LOG_TRACE, "seek: mapped file stream");
+    stream = open_test_file(z, ZIS_STREAM_OBJ_MMAP, 1024);
+    zis_test_assert(stream_is_mapped(stream));
+    do_test_seek(stream, file_size);
+    zis_stream_obj_close(stream);
+
+    zis_test_log(ZIS_TEST_LOG_TRACE, "seek: string stream");
+    char string[2000];
+    for (size_t i = 0; i < sizeof string; i++)
+        string[i] = test_file_byte(i);
+    stream = zis_stream_obj_new_str(z, string, sizeof string, true);
+    do_test_seek(stream, sizeof string);
+    zis_test_assert_eq(zis_stream_obj_seek(stream, 1, SEEK_END), -1);
+    zis_stream_obj_close(stream);
+
+    remove(TEST_FILE);
+}
+
+zis_test_define(mmap_file_grown, z) {
+    write_test_file("wb", 0, 8 * 1024);
+    struct zis_stream_obj *stream = open_test_file(z, ZIS_STREAM_OBJ_MMAP, 1024);
+    zis_test_assert(stream_is_mapped(stream));
+    zis_test_assert_eq(read_and_check(stream, 0, 100), 100);
+    write_test_file("ab", 8 * 1024, 20 * 1024);
+    zis_test_assert_eq(read_and_check(stream, 100, (size_t)-1), 20 * 1024 - 100);
+    zis_stream_obj_close(stream);
+    remove(TEST_FILE);
+}
+
+zis_test_define(mmap_file_truncated, z) {
+#if ZIS_FS_POSIX // A file that has a mapped view cannot be truncated on Windows.
+    write_test_file("wb", 0, 64 * 1024);
+    struct zis_stream_obj *stream = open_test_file(z, ZIS_STREAM_OBJ_MMAP, 1024);
+    zis_test_assert(stream_is_mapped(stream));
+    zis_test_assert_eq(read_and_check(stream, 0, 100), 100);
+    write_test_file("wb", 0, 2000);
+    // Without checking the file size, reading the pages beyond the new end raises SIGBUS.
+    zis_test_assert_eq(read_and_check(stream, 100, (size_t)-1), 2000 - 100);
+    zis_stream_obj_close(stream);
+    remove(TEST_FILE);
+#else
+    zis_unused_var(z);
+#endif // ZIS_FS_POSIX
+}
+
+zis_test_list(
+    core_stream,
+    10,
+    zis_test_case(mmap_opt_in),
+    zis_test_case(mmap_read_bytes),
+    zis_test_case(seek),
+    zis_test_case(mmap_file_grown),
+    zis_test_case(mmap_file_truncated),
+)
@@ -1,3 +1,5 @@
+#define _GNU_SOURCE // memmem() in core/strutil.c
+
 #include "test.h"
 
 #include "core/strutil.c"
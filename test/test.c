@@ -197,14 +197,17 @@ union test_entry_ptr {
 };
 
 static int test_run_common(
-    union test_entry_ptr entries,
+    union test_entry_ptr _entries,
     zis_t z, int argc, char * argv[]
 ) {
     logging_init();
     zis_unused_var(argc);
     test_state.test_list_name = argv[0] ? argv[0] : "??";
 
-    unsigned int failure_count = 0;
+    // Modified after `setjmp()`, so they must be volatile to keep their values
+    // when a failed test jumps back.
+    volatile union test_entry_ptr entries = _entries;
+    volatile unsigned int failure_count = 0;
     test_state.test_name = NULL;
 
     if (test_state_setjmp()) {
@@ -152,3 +152,18 @@ zis_noreturn void __zis_test_assert_eq_fail_i(const char *, unsigned int, const
 zis_noreturn void __zis_test_assert_eq_fail_u(const char *, unsigned int, const char *, const char *, const char *, uintmax_t, uintmax_t);
 zis_noreturn void __zis_test_assert_eq_fail_f(const char *, unsigned int, const char *, const char *, const char *, double, double);
 zis_noreturn void __zis_test_assert_eq_fail_p(const char *, unsigned int, const char *, const char *, const char *, const void *, const void *);
+
+/* ----- running code ------------------------------------------------------- */
+
+/// Import `code` as a module into REG-0 and return its variable `var_name`,
+/// which must be an Int. REG-1 is also used.
+zis_unused_fn static int64_t zis_test_run_code(zis_t z, const char *code, const char *var_name) {
+    int status = zis_import(z, 0, code, ZIS_IMP_CODE);
+    zis_test_assert_eq(status, ZIS_OK);
+    status = zis_load_field(z, 0, var_name, (size_t)-1, 1);
+    zis_test_assert_eq(status, ZIS_OK);
+    int64_t value;
+    status = zis_read_int(z, 1, &value);
+    zis_test_assert_eq(status, ZIS_OK);
+    return value;
+}
@@ -0,0 +1,62 @@
+#!/bin/env python3
+
+"""
+Compare benchmark results (JSON output of `zis_bench -j`).
+"""
+
+import argparse
+import json
+import sys
+
+
+def load_results(path: str) -> dict[str, dict]:
+    with open(path, 'r', encoding='utf-8') as f:
+        data = json.load(f)
+    return {r['name']: r for r in data['results']}
+
+
+def ratio_str(old: float, new: float) -> str:
+    if old == 0:
+        return '     -' if new == 0 else '   new'
+    return f'{(new - old) / old * 100:+6.1f}%'
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Compare benchmark results.')
+    ap.add_argument(
+        '-t', '--threshold', type=float, default=5.0,
+        help='percentage of ns/op increase to report as a regression (default: 5)')
+    ap.add_argument('BASE', help='results of the baseline')
+    ap.add_argument('NEW', help='results to compare')
+    args = ap.parse_args()
+
+    base = load_results(args.BASE)
+    new = load_results(args.NEW)
+
+    print(f'{"benchmark":32} {"ns/op (base)":>14} {"ns/op (new)":>14} {"time":>7} {"alloc":>7} {"GC":>7}')
+    regressions = []
+    for name, n in new.items():
+        b = base.get(name)
+        if b is None:
+            print(f'{name:32} {"-":>14} {n["ns_per_op"]:14.2f}')
+            continue
+        time_diff = ratio_str(b['ns_per_op'], n['ns_per_op'])
+        alloc_diff = ratio_str(b['alloc_bytes_per_op'], n['alloc_bytes_per_op'])
+        b_gc_per_op = b['gc_time_ns'] / b['iterations']
+        n_gc_per_op = n['gc_time_ns'] / n['iterations']
+        gc_diff = ratio_str(b_gc_per_op, n_gc_per_op)
+        mark = ''
+        if b['ns_per_op'] > 0 and (n['ns_per_op'] - b['ns_per_op']) / b['ns_per_op'] * 100 > args.threshold:
+            regressions.append(name)
+            mark = '  <- regression'
+        print(f'{name:32} {b["ns_per_op"]:14.2f} {n["ns_per_op"]:14.2f} {time_diff} {alloc_diff} {gc_diff}{mark}')
+    for name in base.keys() - new.keys():
+        print(f'{name:32} {base[name]["ns_per_op"]:14.2f} {"-":>14}')
+
+    if regressions:
+        print(f'\n{len(regressions)} regression(s) over {args.threshold}%', file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()